@@ -68,15 +68,17 @@
 #define configTICK_RATE_HZ                       ((TickType_t)1000)
 #define configMAX_PRIORITIES                     ( 56 )
 #define configMINIMAL_STACK_SIZE                 ((uint16_t)128)
-#define configTOTAL_HEAP_SIZE                    ((size_t)15360)
+#define configTOTAL_HEAP_SIZE                    ((size_t)1024)
 #define configMAX_TASK_NAME_LEN                  ( 16 )
 #define configUSE_TRACE_FACILITY                 1
+#define configGENERATE_RUN_TIME_STATS            1
 #define configUSE_16_BIT_TICKS                   0
 #define configUSE_MUTEXES                        1
 #define configQUEUE_REGISTRY_SIZE                8
 #define configUSE_RECURSIVE_MUTEXES              1
 #define configUSE_COUNTING_SEMAPHORES            1
 #define configUSE_PORT_OPTIMISED_TASK_SELECTION  0
+#define configCHECK_FOR_STACK_OVERFLOW           2
 /* USER CODE BEGIN MESSAGE_BUFFER_LENGTH_TYPE */
 /* Defaults to size_t for backward compatibility, but can be changed
    if lengths will always be less than the number of bytes in a size_t. */
@@ -91,7 +93,7 @@
 #define configUSE_TIMERS                         1
 #define configTIMER_TASK_PRIORITY                ( 2 )
 #define configTIMER_QUEUE_LENGTH                 10
-#define configTIMER_TASK_STACK_DEPTH             256
+#define configTIMER_TASK_STACK_DEPTH             384
 
 /* The following flag must be enabled only when using newlib */
 #define configUSE_NEWLIB_REENTRANT          1
@@ -157,6 +159,13 @@ header file. */
 #define configASSERT( x ) if ((x) == 0) {taskDISABLE_INTERRUPTS(); for( ;; );}
 /* USER CODE END 1 */
 
+/* USER CODE BEGIN 2 */
+/* Definitions needed when configGENERATE_RUN_TIME_STATS is on */
+/* Время потоков в тактах DWT->CYCCNT, см. freertos.c */
+#define portCONFIGURE_TIMER_FOR_RUN_TIME_STATS configureTimerForRunTimeStats
+#define portGET_RUN_TIME_COUNTER_VALUE getRunTimeCounterValue
+/* USER CODE END 2 */
+
 /* Definitions that map the FreeRTOS port interrupt handlers to their CMSIS
 standard names. */
 #define vPortSVCHandler    SVC_Handler
@@ -168,6 +177,17 @@ standard names. */
 
 /* USER CODE BEGIN Defines */
 /* Section where parameter definitions can be added (for instance, to override default ones in FreeRTOS.h) */
+/* Задачи и объекты ядра создаются статически. Куча FreeRTOS (CCM RAM, см. freertos.c)
+   остается на случай объектов без собственной памяти, ее расход виден в /debug/memory */
+#define configAPPLICATION_ALLOCATED_HEAP 1
+/* Запас стека службы таймеров в /debug/memory. Глубина configTIMER_TASK_STACK_DEPTH -
+   худший путь от prvTimerTask по сборкам ARM с запасом, см. Tools/stack_budget/stack_budget.sh */
+#define INCLUDE_xTimerGetTimerDaemonTaskHandle 1
+/* Журнал трассировки: переключение потоков по номеру TCB, см. trace.c */
+#if defined(__ICCARM__) || defined(__CC_ARM) || defined(__GNUC__)
+void Trace_TaskSwitchedIn(uint32_t task_number);
+#endif
+#define traceTASK_SWITCHED_IN() Trace_TaskSwitchedIn(pxCurrentTCB->uxTCBNumber)
 /* USER CODE END Defines */
 
 #endif /* FREERTOS_CONFIG_H */
@@ -0,0 +1,100 @@
+// at_engine.h
+#ifndef __AT_ENGINE_H
+#define __AT_ENGINE_H
+
+#include "main.h"
+#include "cmsis_os.h"
+#include "at_parser.h"
+
+#define AT_COMMAND_SIZE 96      // Текст команды с \r\n
+#define AT_QUEUE_SIZE 8         // Команды в очереди движка
+#define AT_STATS_COUNT 12       // Команды со своей статистикой, последняя запись - "прочие"
+#define AT_STATS_NAME_SIZE 16
+#define AT_ENGINE_DONE_FLAG 0x1000U // Флаг потока ожидающего AT_Engine_Execute
+
+typedef enum {
+    AT_STATUS_PENDING = 0,
+    AT_STATUS_OK,       // Получена строка expected
+    AT_STATUS_ERROR,    // ERROR, FAIL или SEND FAIL
+    AT_STATUS_TIMEOUT   // Нет ответа до истечения timeout
+} AT_StatusTypeDef;
+
+typedef struct AT_Request AT_RequestTypeDef;
+
+// Завершение команды, вызывается в потоке движка
+typedef void (*AT_DoneTypeDef)(void *ctx, AT_RequestTypeDef *request);
+
+// Передача данных на ESP
+typedef void (*AT_TransmitTypeDef)(const uint8_t *data, uint32_t length);
+
+// Прием от ESP: передает накопленные данные в разборщик
+typedef void (*AT_PollTypeDef)(void);
+
+struct AT_Request {
+    char command[AT_COMMAND_SIZE];  // Пустая строка - только ожидание строки expected
+    const uint8_t *data;            // Данные после приглашения ">" (AT+CIPSEND)
+    uint32_t data_length;
+    const char *expected;           // Начало строки успешного ответа, NULL - "OK"
+    uint32_t timeout;               // Мс от отправки команды
+
+    char *response;                 // Строки ответа через '\n', может быть NULL
+    uint32_t response_size;
+    uint32_t response_length;
+
+    AT_DoneTypeDef done;
+    void *ctx;
+
+    // Заполняются движком
+    volatile AT_StatusTypeDef status;
+    uint32_t submitted;
+    osThreadId_t waiter;
+};
+
+typedef enum {
+    AT_ENGINE_IDLE = 0,
+    AT_ENGINE_WAIT_PROMPT,  // Команда отправлена, ждем ">"
+    AT_ENGINE_WAIT_RESULT   // Ждем финальный ответ
+} AT_EngineStateTypeDef;
+
+typedef struct {
+    char name[AT_STATS_NAME_SIZE];  // Команда до '=' или '?'
+    uint32_t count;
+    uint32_t errors;
+    uint32_t timeouts;
+    uint32_t total_ms;              // Задержка от постановки в очередь до ответа
+    uint32_t max_ms;
+} AT_CommandStatsTypeDef;
+
+typedef struct {
+    osMessageQueueId_t queue;
+    StaticQueue_t queue_cb;   // Память очереди: движок не использует кучу FreeRTOS
+    AT_RequestTypeDef *queue_storage[AT_QUEUE_SIZE];
+    osEventFlagsId_t event;   // Пробуждение потока движка
+    uint32_t wake_flag;       // Новая команда
+    uint32_t data_flag;       // Новые данные от ESP
+    osThreadId_t thread;      // Поток-владелец USART6
+    AT_TransmitTypeDef transmit;
+    AT_PollTypeDef poll;
+
+    AT_EngineStateTypeDef state;
+    AT_RequestTypeDef *current;
+    uint32_t started;
+
+    AT_CommandStatsTypeDef stats[AT_STATS_COUNT];
+    uint8_t stats_count;
+} AT_EngineTypeDef;
+
+void AT_Engine_Init(AT_EngineTypeDef *engine, AT_ParserTypeDef *parser,
+                    AT_TransmitTypeDef transmit, AT_PollTypeDef poll,
+                    osEventFlagsId_t event, uint32_t wake_flag, uint32_t data_flag);
+void AT_Engine_SetThread(AT_EngineTypeDef *engine, osThreadId_t thread);
+uint8_t AT_Engine_Submit(AT_EngineTypeDef *engine, AT_RequestTypeDef *request);
+AT_StatusTypeDef AT_Engine_Execute(AT_EngineTypeDef *engine, AT_RequestTypeDef *request);
+void AT_Engine_Process(AT_EngineTypeDef *engine);
+void AT_Engine_Abort(AT_EngineTypeDef *engine);
+uint8_t AT_Engine_Busy(AT_EngineTypeDef *engine);
+uint32_t AT_Engine_Timeout(AT_EngineTypeDef *engine);
+void AT_Request_Init(AT_RequestTypeDef *request, const char *command,
+                     const char *expected, uint32_t timeout);
+
+#endif /* __AT_ENGINE_H */
@@ -0,0 +1,59 @@
+// at_parser.h
+#ifndef __AT_PARSER_H
+#define __AT_PARSER_H
+
+#include <stdint.h>
+
+#define AT_LINE_SIZE 128     // Самая длинная строка ответа ESP
+#define AT_HANDLER_COUNT 16  // Максимум зарегистрированных обработчиков
+#define AT_RECV_LINK 0xFF    // link_id данных ответа AT+CIPRECVDATA (соединение знает запросивший)
+
+// Обработчик строки ответа. Для приглашения передается строка ">"
+typedef void (*AT_LineHandlerTypeDef)(void *ctx, const char *line);
+
+// Обработчик данных соединения из +IPD или +CIPRECVDATA
+// (может вызываться несколько раз на пакет)
+typedef void (*AT_DataHandlerTypeDef)(void *ctx, uint8_t link_id, const uint8_t *data, uint32_t length);
+
+typedef struct {
+    const char *prefix;  // Начало строки, '?' - любой символ, "" - все строки
+    AT_LineHandlerTypeDef handler;
+    void *ctx;
+} AT_HandlerTypeDef;
+
+typedef enum {
+    AT_RX_LINE = 0,      // Строки ответов и уведомлений
+    AT_RX_IPD_HEADER,    // +IPD,<link>,<len>[,"<ip>",<port>]: или +CIPRECVDATA:<len>[,"<ip>",<port>],
+    AT_RX_IPD_DATA       // Данные соединения
+} AT_RxStateTypeDef;
+
+typedef struct {
+    AT_HandlerTypeDef handlers[AT_HANDLER_COUNT];
+    uint8_t handler_count;
+    AT_DataHandlerTypeDef data_handler;
+    void *data_ctx;
+
+    AT_RxStateTypeDef state;
+    char line[AT_LINE_SIZE];
+    uint16_t line_length;
+    uint8_t data_link;
+    uint32_t data_remaining;
+    uint8_t recv_fields;     // Полей перед данными +CIPRECVDATA: 1 или 3 при AT+CIPDINFO=1
+    uint8_t header_fields;
+
+    // Статистика
+    uint32_t bytes;      // Всего принято байт
+    uint32_t lines;      // Разобрано строк
+    uint32_t unhandled;  // Строки без обработчика
+    uint32_t overflows;  // Строки длиннее AT_LINE_SIZE
+} AT_ParserTypeDef;
+
+void AT_Parser_Init(AT_ParserTypeDef *parser);
+void AT_Parser_Reset(AT_ParserTypeDef *parser);
+uint8_t AT_Parser_Register(AT_ParserTypeDef *parser, const char *prefix,
+                           AT_LineHandlerTypeDef handler, void *ctx);
+void AT_Parser_SetDataHandler(AT_ParserTypeDef *parser, AT_DataHandlerTypeDef handler, void *ctx);
+void AT_Parser_SetRecvInfo(AT_ParserTypeDef *parser, uint8_t remote_info);
+void AT_Parser_Input(AT_ParserTypeDef *parser, const uint8_t *data, uint32_t length);
+
+#endif /* __AT_PARSER_H */
@@ -0,0 +1,9 @@
+// crc32.h
+#ifndef __CRC32_H
+#define __CRC32_H
+
+#include "main.h"
+
+uint32_t CRC32_Compute(const void *data, uint32_t length);
+
+#endif /* __CRC32_H */
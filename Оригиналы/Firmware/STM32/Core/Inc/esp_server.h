@@ -0,0 +1,122 @@
+// esp_server.h
+#ifndef __ESP_SERVER_H
+#define __ESP_SERVER_H
+
+#include "main.h"
+#include "at_parser.h"
+#include "at_engine.h"
+#include "mem_pool.h"
+
+#define ESP_LINK_COUNT 5             // ESP-AT поддерживает link ID 0..4
+#define ESP_LINK_REQUEST_SIZE 512    // Строка запроса и тело, остальные заголовки отбрасываются,
+                                     // больший запрос получает 413 без вызова обработчика
+#define ESP_LINK_RESPONSE_SIZE 2048  // Буфер динамического ответа соединения
+#define ESP_LINK_LINE_SIZE 32        // Начало строки заголовка для поиска Content-Length
+#define ESP_SEND_CHUNK 2048          // Максимум данных в одной AT+CIPSEND
+#define ESP_SEND_TIMEOUT 5000        // AT+CIPSEND до SEND OK, мс
+#define ESP_CLOSE_TIMEOUT 1000       // AT+CIPCLOSE, мс
+#define ESP_RECV_CHUNK 512           // Максимум данных в одной AT+CIPRECVDATA (половина кольца DMA)
+#define ESP_RECV_TIMEOUT 1000        // AT+CIPRECVDATA, мс
+#define ESP_LINK_IDLE_TIMEOUT 10000  // Незавершенный запрос, мс
+
+typedef enum {
+    ESP_LINK_IDLE = 0,    // Соединения нет
+    ESP_LINK_RECEIVING,   // Прием запроса
+    ESP_LINK_READY,       // Запрос принят, ждет обработки
+    ESP_LINK_HANDLING,    // Запрос у обработчика, буферы соединения принадлежат ему
+    ESP_LINK_RESPONDING,  // Ответ в очереди на отправку
+    ESP_LINK_CLOSING      // Ответ отправлен, нужно закрыть соединение
+} ESP_LinkStateTypeDef;
+
+// Вызывается после отправки (или отмены) ответа, освобождает его буфер
+typedef void (*ESP_SentTypeDef)(void *ctx);
+
+// Обработчик принятого запроса, вызывается в потоке движка AT и должен
+// быстро вернуть управление. Ответ ESP_Server_Respond можно передать позже
+// из другого потока, буфер request принадлежит обработчику до этого вызова
+typedef void (*ESP_RequestHandlerTypeDef)(uint8_t link_id, char *request, uint32_t length);
+
+typedef struct {
+    volatile ESP_LinkStateTypeDef state;
+    volatile uint8_t peer_closed;  // Соединение закрыто во время обработки или отправки
+    uint8_t rx_pending;            // Пассивный прием: в ESP есть непрочитанные данные
+    uint32_t last_activity;
+
+    // Разбор запроса в блоке пула запросов, NULL - блок не выделен
+    char *request;
+    uint16_t request_length;
+    uint8_t first_line_done;
+    uint8_t header_done;
+    uint8_t overflow;   // Запрос не помещается в блок: ответ 413
+    char line[ESP_LINK_LINE_SIZE];
+    uint8_t line_length;
+    uint32_t body_expected;
+    uint32_t body_received;
+
+    // Ответ: блок пула ответов выдается обработчику по требованию
+    char *response;
+    const char *tx_data;
+    uint32_t tx_length;
+    uint32_t tx_offset;
+    ESP_SentTypeDef tx_done;
+    void *tx_ctx;
+    uint32_t tx_start;  // Время постановки ответа в очередь
+    uint32_t ready_at;  // Время приема запроса целиком
+} ESP_LinkTypeDef;
+
+typedef struct {
+    ESP_LinkTypeDef links[ESP_LINK_COUNT];
+    AT_EngineTypeDef *engine;
+    ESP_RequestHandlerTypeDef handler;
+    uint8_t reserved;  // Маска link ID, не принадлежащих серверу
+
+    // Блоки ESP_LINK_REQUEST_SIZE и ESP_LINK_RESPONSE_SIZE: соединения
+    // занимают память только на время приема запроса и отправки ответа
+    MemPoolTypeDef *request_pool;
+    MemPoolTypeDef *response_pool;
+
+    // Очередь отправки: в движке не больше одной AT+CIPSEND/AT+CIPCLOSE
+    AT_RequestTypeDef tx_request;
+    uint8_t tx_busy;
+    uint8_t tx_link;
+    uint32_t tx_chunk;
+
+    // Пассивный прием (AT+CIPRECVMODE=1): данные забираются по одной AT+CIPRECVDATA
+    uint8_t passive;
+    AT_RequestTypeDef rx_request;
+    uint8_t rx_busy;
+    uint8_t rx_link;
+    uint32_t rx_requested;
+    uint32_t rx_received;
+
+    // Статистика
+    uint32_t requests;
+    uint32_t responses;
+    uint32_t send_errors;
+    uint32_t bytes_sent;
+    uint32_t bytes_received;
+    uint32_t recv_reads;           // Выполнено AT+CIPRECVDATA
+    uint32_t rejected;             // Соединения, закрытые без ответа: нет блока запроса
+    uint32_t oversized;            // Ответов 413: запрос больше ESP_LINK_REQUEST_SIZE
+    uint32_t last_response_bytes;  // Размер последнего отправленного ответа
+    uint32_t last_response_ms;     // Время его отправки от постановки в очередь
+    uint32_t latency_last_ms;      // От приема запроса до отправки ответа
+    uint32_t latency_max_ms;
+    uint32_t latency_total_ms;     // Сумма по responses
+} ESP_ServerTypeDef;
+
+void ESP_Server_Init(ESP_ServerTypeDef *server, AT_EngineTypeDef *engine,
+                     ESP_RequestHandlerTypeDef handler,
+                     MemPoolTypeDef *request_pool, MemPoolTypeDef *response_pool);
+void ESP_Server_Reset(ESP_ServerTypeDef *server);
+void ESP_Server_Attach(ESP_ServerTypeDef *server, AT_ParserTypeDef *parser);
+void ESP_Server_ReserveLink(ESP_ServerTypeDef *server, uint8_t link_id);
+void ESP_Server_SetPassive(ESP_ServerTypeDef *server, uint8_t passive);
+void ESP_Server_Process(ESP_ServerTypeDef *server);
+char* ESP_Server_ResponseBuffer(ESP_ServerTypeDef *server, uint8_t link_id, uint32_t *size);
+void ESP_Server_Respond(ESP_ServerTypeDef *server, uint8_t link_id, const char *data,
+                        uint32_t length, ESP_SentTypeDef done, void *ctx);
+uint8_t ESP_Server_Busy(ESP_ServerTypeDef *server);
+uint32_t ESP_Server_Timeout(ESP_ServerTypeDef *server);
+
+#endif /* __ESP_SERVER_H */
@@ -0,0 +1,62 @@
+// esp_setup.h
+#ifndef __ESP_SETUP_H
+#define __ESP_SETUP_H
+
+#include "main.h"
+#include "at_engine.h"
+#include "mem_pool.h"
+
+#define ESP_SETUP_DEFAULT_BAUDRATE 115200  // Скорость ESP после сброса
+#define ESP_SETUP_BOOT_TIMEOUT 3000        // Максимальное ожидание "ready" после сброса, мс
+#define ESP_SETUP_RETRIES 5                // Попытки AT после загрузки
+
+// Неизвестная команда: ESP ответит ERROR, но эхо проверяет оба направления
+#define ESP_SETUP_CHECK_PATTERN "AT+UARTCHECK=0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz~U*"
+
+// Доступ к USART6 (поток движка AT)
+typedef struct {
+    void (*set_baudrate)(uint32_t baudrate);  // Смена скорости, прием сбрасывается
+    uint32_t (*rx_errors)(void);              // Счетчик ошибок приема
+} ESP_SetupPortTypeDef;
+
+// Конфигурация ESP-AT v2.2.1.0 после сброса. Точка доступа задается
+// командами AT+CWSAP и AT+CIPAP при AT+SYSSTORE=0 - без записи во flash ESP
+typedef struct {
+    const char *ap_config;      // "<ssid>","<pwd>",<chl>,<ecn>
+    const char *ap_ip;          // "<ip>" в кавычках
+    const uint32_t *baudrates;  // Скорости USART6 по убыванию
+    uint8_t baudrate_count;
+    uint8_t max_connections;    // AT+CIPSERVERMAXCONN, 0 - по умолчанию ESP
+    uint16_t server_port;
+    uint16_t server_timeout;    // AT+CIPSTO, с
+} ESP_SetupConfigTypeDef;
+
+typedef struct {
+    AT_EngineTypeDef *engine;
+    MemPoolTypeDef *response_pool;  // Блоки для строк ответа на запросы
+    const ESP_SetupPortTypeDef *port;
+    uint32_t baudrate;              // Текущая скорость USART6
+    uint8_t passive;                // ESP принял AT+CIPRECVMODE=1
+    uint8_t remote_info;            // ESP принял AT+CIPDINFO=1: адрес клиента в +IPD и +CIPRECVDATA
+
+    // Статистика
+    uint32_t checks;                // Проверок канала
+    uint32_t check_failures;
+    uint32_t boot_ms;               // От сброса до "ready" при последнем запуске
+    uint32_t changes;               // Настройки точки доступа, отличавшиеся от заданных
+} ESP_SetupTypeDef;
+
+void ESP_Setup_Init(ESP_SetupTypeDef *setup, AT_EngineTypeDef *engine,
+                    MemPoolTypeDef *response_pool, const ESP_SetupPortTypeDef *port);
+AT_StatusTypeDef ESP_Setup_Command(ESP_SetupTypeDef *setup, const char *cmd, const char *expected,
+                                   uint32_t timeout, char *response, uint32_t size);
+const char* ESP_Setup_FindLine(const char *response, const char *prefix);
+uint8_t ESP_Setup_Query(ESP_SetupTypeDef *setup, const char *cmd, const char *prefix,
+                        char *value, uint32_t size);
+void ESP_Setup_SetBaudrate(ESP_SetupTypeDef *setup, uint32_t baudrate);
+uint8_t ESP_Setup_CheckUart(ESP_SetupTypeDef *setup);
+uint32_t ESP_Setup_Negotiate(ESP_SetupTypeDef *setup, const uint32_t *baudrates, uint8_t count);
+uint8_t ESP_Setup_AccessPoint(ESP_SetupTypeDef *setup, const char *ap_config, const char *ap_ip);
+uint8_t ESP_Setup_Start(ESP_SetupTypeDef *setup, const ESP_SetupConfigTypeDef *config);
+
+#endif /* __ESP_SETUP_H */
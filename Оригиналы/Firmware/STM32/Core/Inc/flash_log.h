@@ -0,0 +1,80 @@
+// flash_log.h
+#ifndef __FLASH_LOG_H
+#define __FLASH_LOG_H
+
+#include "main.h"
+
+#define FLASH_LOG_SECTOR_MAX 8      // Максимум секторов в журнале
+#define FLASH_LOG_DATA_SIZE 8       // Полезные данные записи, байт
+#define FLASH_LOG_BATCH_RECORDS 4   // Записей в буфере RAM до программирования
+#define FLASH_LOG_MAGIC 0x474F4C48UL // "HLOG"
+
+// Запись журнала: 16 байт, программируется словами
+typedef struct {
+    uint32_t timestamp;
+    uint8_t data[FLASH_LOG_DATA_SIZE];
+    uint32_t crc;
+} FlashLog_RecordTypeDef;
+
+// Заголовок сектора, записывается после стирания
+typedef struct {
+    uint32_t magic;
+    uint32_t sequence;     // Порядковый номер заполнения сектора
+    uint32_t erase_count;  // Количество стираний сектора
+    uint32_t crc;
+} FlashLog_HeaderTypeDef;
+
+// Доступ к памяти: чтение через отображение в адресное пространство,
+// стирание и программирование - через функции платформы.
+// Смещения отсчитываются от начала области журнала
+typedef struct {
+    const uint8_t *base;
+    uint32_t sector_size;
+    uint8_t sector_count;
+    uint8_t (*erase)(uint8_t sector);
+    uint8_t (*program)(uint32_t offset, const uint32_t *words, uint32_t count);
+} FlashLog_PortTypeDef;
+
+// Индекс сектора, строится при запуске
+typedef struct {
+    uint8_t valid;
+    uint32_t sequence;
+    uint32_t erase_count;
+    uint32_t count;       // Записано записей (включая поврежденные)
+    uint32_t first_time;
+    uint32_t last_time;
+} FlashLog_SectorTypeDef;
+
+typedef struct {
+    uint8_t order;    // Позиция в order[] (от старого сектора к новому)
+    uint32_t record;
+} FlashLog_CursorTypeDef;
+
+typedef struct {
+    const FlashLog_PortTypeDef *port;
+    FlashLog_SectorTypeDef sectors[FLASH_LOG_SECTOR_MAX];
+    uint8_t order[FLASH_LOG_SECTOR_MAX];  // Действительные секторы по возрастанию sequence
+    uint8_t order_count;
+    uint8_t active;
+    uint32_t records_per_sector;
+
+    FlashLog_RecordTypeDef buffer[FLASH_LOG_BATCH_RECORDS];
+    uint8_t buffered;
+
+    // Статистика
+    uint32_t records;        // Записей во flash
+    uint32_t flushes;
+    uint32_t erases;
+    uint32_t errors;
+    uint32_t crc_errors;     // Поврежденные записи, пропущенные при чтении
+} FlashLogTypeDef;
+
+void FlashLog_Init(FlashLogTypeDef *log, const FlashLog_PortTypeDef *port);
+void FlashLog_Append(FlashLogTypeDef *log, uint32_t timestamp, const void *data);
+uint8_t FlashLog_Flush(FlashLogTypeDef *log);
+uint8_t FlashLog_Seek(FlashLogTypeDef *log, uint32_t timestamp, FlashLog_CursorTypeDef *cursor);
+uint8_t FlashLog_SeekLast(FlashLogTypeDef *log, uint32_t count, FlashLog_CursorTypeDef *cursor);
+uint8_t FlashLog_Next(FlashLogTypeDef *log, FlashLog_CursorTypeDef *cursor,
+                      uint32_t *timestamp, void *data);
+
+#endif /* __FLASH_LOG_H */
@@ -0,0 +1,15 @@
+// flash_log_port.h
+#ifndef __FLASH_LOG_PORT_H
+#define __FLASH_LOG_PORT_H
+
+#include "flash_log.h"
+
+// Секторы 8..11 (4 x 128 КБ) вне области программы, см. STM32F405RGTX_FLASH.ld
+#define FLASH_LOG_BASE 0x08080000UL
+#define FLASH_LOG_FIRST_SECTOR FLASH_SECTOR_8
+#define FLASH_LOG_SECTOR_SIZE (128 * 1024)
+#define FLASH_LOG_SECTOR_COUNT 4
+
+extern const FlashLog_PortTypeDef flash_log_port;
+
+#endif /* __FLASH_LOG_PORT_H */
@@ -0,0 +1,47 @@
+// history_codec.h
+#ifndef __HISTORY_CODEC_H
+#define __HISTORY_CODEC_H
+
+#include "main.h"
+
+#define CODEC_CHANNELS 2                          // Температура и влажность
+#define CODEC_SCALE 10.0f                         // Значения в десятых долях
+#define CODEC_BLOCK_DATA 64                       // Сжатые показания блока, байт
+#define CODEC_BLOCK_SAMPLES (CODEC_BLOCK_DATA + 1) // Максимум показаний в блоке
+
+// Блок сжатых показаний, декодируется независимо от остальных.
+// Первое показание хранится в заголовке, следующие - в data:
+// время - разность разностей, значения - разности (zig-zag). Если
+// разность разностей времени равна нулю, а разности значений малы,
+// показание занимает один байт 0ttttthhh, иначе байт 0x80 и три varint
+typedef struct {
+    uint32_t first_time;
+    int16_t first_value[CODEC_CHANNELS];
+    uint16_t count;
+    uint16_t length;
+    uint8_t data[CODEC_BLOCK_DATA];
+} Codec_BlockTypeDef;
+
+typedef struct {
+    Codec_BlockTypeDef block;
+    uint32_t last_time;
+    int32_t last_delta;
+    int16_t last_value[CODEC_CHANNELS];
+} Codec_EncoderTypeDef;
+
+typedef struct {
+    const Codec_BlockTypeDef *block;
+    uint16_t index;
+    uint16_t position;
+    uint32_t time;
+    int32_t delta;
+    int16_t value[CODEC_CHANNELS];
+} Codec_DecoderTypeDef;
+
+void Codec_Reset(Codec_EncoderTypeDef *encoder);
+uint8_t Codec_Append(Codec_EncoderTypeDef *encoder, uint32_t time, const int16_t *value);
+void Codec_DecoderInit(Codec_DecoderTypeDef *decoder, const Codec_BlockTypeDef *block);
+uint8_t Codec_Next(Codec_DecoderTypeDef *decoder, uint32_t *time, int16_t *value);
+int16_t Codec_Fixed(float value);
+
+#endif /* __HISTORY_CODEC_H */
@@ -0,0 +1,44 @@
+// http_cache.h
+#ifndef __HTTP_CACHE_H
+#define __HTTP_CACHE_H
+
+#include "main.h"
+
+// Источники данных, от которых зависят ответы веб-сервера
+typedef enum {
+    HTTP_STATE_SENSOR = 0,  // Показания датчика, состояние выходов и связи
+    HTTP_STATE_SETTINGS,    // Настройки системы
+    HTTP_STATE_HISTORY,     // История измерений
+    HTTP_STATE_CLOCK,       // Текущее время с точностью до минуты
+    HTTP_STATE_COUNT
+} HTTP_StateTypeDef;
+
+#define HTTP_DEP(state) (1UL << (state))
+
+// Формирование полного ответа (заголовки + тело), возвращает его длину
+typedef uint32_t (*HTTP_RenderTypeDef)(char *buffer, uint32_t size);
+
+typedef struct {
+    char *buffer;                         // Готовый ответ
+    uint32_t size;
+    uint32_t length;                      // 0 - ответ еще не сформирован
+    uint32_t deps;                        // Маска HTTP_DEP(...)
+    HTTP_RenderTypeDef render;
+    uint32_t versions[HTTP_STATE_COUNT];  // Версии данных на момент рендера
+    volatile uint32_t readers;            // Незавершенные отправки из буфера, только атомарно
+
+    // Статистика
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t stale_hits;                  // Отдан устаревший ответ, буфер занят
+    uint64_t hit_cycles;
+    uint64_t miss_cycles;
+} HTTP_CacheEntryTypeDef;
+
+void HTTP_Cache_Init(HTTP_CacheEntryTypeDef *entry, char *buffer, uint32_t size,
+                     uint32_t deps, HTTP_RenderTypeDef render);
+const char* HTTP_Cache_Get(HTTP_CacheEntryTypeDef *entry, uint32_t *length);
+void HTTP_Cache_Release(HTTP_CacheEntryTypeDef *entry);
+void HTTP_Cache_Touch(HTTP_StateTypeDef state);
+
+#endif /* __HTTP_CACHE_H */
@@ -0,0 +1,19 @@
+// lttb.h
+#ifndef __LTTB_H
+#define __LTTB_H
+
+#include <stdint.h>
+
+// Точка временного ряда в фиксированной точке
+typedef struct {
+    int32_t x;  // Время, с
+    int32_t y;  // Значение в десятых долях (21.5°C -> 215)
+} LTTB_PointTypeDef;
+
+// Чтение точки исходного ряда по индексу (в хронологическом порядке)
+typedef LTTB_PointTypeDef (*LTTB_SourceTypeDef)(void *ctx, uint32_t index);
+
+uint32_t LTTB_Downsample(LTTB_SourceTypeDef source, void *ctx, uint32_t count,
+                         uint32_t threshold, uint32_t *selected);
+
+#endif /* __LTTB_H */
@@ -46,6 +46,10 @@ extern "C" {
 
 /* Exported macro ------------------------------------------------------------*/
 /* USER CODE BEGIN EM */
+// Размещение в CCM RAM (64 КБ, только для процессора). DMA к ней доступа
+// не имеет: буферы приема и передачи через DMA остаются в SRAM
+#define CCMRAM __attribute__((section(".ccmram_bss")))
+#define IS_CCMRAM(address) (((uint32_t)(address) & 0xFFFF0000UL) == 0x10000000UL)
 
 /* USER CODE END EM */
 
@@ -0,0 +1,33 @@
+// mem_pool.h
+#ifndef __MEM_POOL_H
+#define __MEM_POOL_H
+
+#include "main.h"
+
+// Хранилище пула: count блоков размера size, выровненных по слову
+#define MEM_POOL_WORDS(size, count) ((count) * (((size) + 3) / 4))
+
+// Пул блоков одного размера. Выделение и освобождение - O(1) из
+// потоков и прерываний (приоритет не выше configMAX_SYSCALL_INTERRUPT_PRIORITY).
+// Блок передается между потоками по указателю, владелец освобождает его
+typedef struct {
+    const char *name;
+    uint8_t *storage;
+    uint32_t block_size;  // Байт в блоке, кратно 4
+    uint16_t count;
+    void *free_list;      // Первое слово свободного блока - следующий свободный
+
+    // Статистика
+    volatile uint16_t used;
+    uint16_t used_max;
+    uint32_t allocs;
+    uint32_t failures;    // Отказы: все блоки заняты
+} MemPoolTypeDef;
+
+void MemPool_Init(MemPoolTypeDef *pool, const char *name, void *storage,
+                  uint32_t block_size, uint16_t count);
+void* MemPool_Alloc(MemPoolTypeDef *pool);
+void MemPool_Free(MemPoolTypeDef *pool, void *block);
+void MemPool_Read(const MemPoolTypeDef *pool, MemPoolTypeDef *copy);
+
+#endif /* __MEM_POOL_H */
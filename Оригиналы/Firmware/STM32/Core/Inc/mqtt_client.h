@@ -0,0 +1,71 @@
+// mqtt_client.h
+#ifndef __MQTT_CLIENT_H
+#define __MQTT_CLIENT_H
+
+#include "main.h"
+#include "cmsis_os.h"
+#include "at_parser.h"
+#include "at_engine.h"
+
+#define MQTT_QUEUE_SIZE 256          // Показаний в очереди (~20 минут при опросе раз в 5 с)
+#define MQTT_BATCH_SIZE 12           // Показаний в одной публикации
+#define MQTT_BURST_BATCHES 4         // Публикаций подряд при разборе накопленной очереди
+#define MQTT_BURST_PAUSE 1000        // Пауза между сериями публикаций, мс
+#define MQTT_PUBLISH_INTERVAL 60000  // Неполная пачка публикуется не реже, мс
+#define MQTT_RETRY_INTERVAL 15000    // Первое повторное подключение к брокеру, мс
+#define MQTT_RETRY_MAX 600000        // Интервал удваивается после каждой неудачи до, мс
+#define MQTT_CONNECT_TIMEOUT 10000   // AT+MQTTCONN, мс
+#define MQTT_PUBLISH_TIMEOUT 5000    // AT+MQTTPUBRAW до +MQTTPUB:OK, мс
+#define MQTT_PAYLOAD_SIZE (48 + MQTT_BATCH_SIZE * 32)
+
+typedef struct {
+    uint32_t timestamp;   // Unix-время, с
+    int16_t temperature;  // Десятые доли градуса
+    uint16_t humidity;    // Десятые доли процента
+} MQTT_SampleTypeDef;
+
+typedef struct {
+    AT_EngineTypeDef *engine;
+    const char *host;
+    uint16_t port;
+    const char *client_id;
+    const char *topic;
+
+    // Кольцевая очередь показаний, при переполнении теряются самые старые
+    MQTT_SampleTypeDef samples[MQTT_QUEUE_SIZE];
+    uint16_t head;   // Самое старое показание
+    uint16_t count;
+    uint32_t batch_dropped;  // Значение dropped при формировании пачки
+
+    volatile uint8_t connected;
+    volatile uint8_t connecting;         // Подключение в очереди движка
+    volatile uint8_t configured;         // AT+MQTTUSERCFG принята после сброса ESP
+    volatile uint8_t unsupported;        // Прошивка ESP без AT+MQTT*, до следующего сброса
+    volatile uint32_t last_attempt;      // Завершение последней попытки подключения
+    volatile uint32_t retry_delay;       // Пауза до следующей попытки, 0 - сразу
+    uint32_t last_publish;
+    osThreadId_t thread;                 // Пробуждается по завершении подключения
+    uint32_t wake_flag;
+    AT_RequestTypeDef config_request;
+    AT_RequestTypeDef connect_request;
+    AT_RequestTypeDef request;
+    char payload[MQTT_PAYLOAD_SIZE];
+
+    // Статистика
+    uint32_t published;         // Отправлено показаний
+    uint32_t publishes;         // Выполнено AT+MQTTPUBRAW
+    uint32_t dropped;           // Потеряно при переполнении очереди
+    uint32_t connects;
+    uint32_t errors;
+} MQTT_ClientTypeDef;
+
+void MQTT_Client_Init(MQTT_ClientTypeDef *client, AT_EngineTypeDef *engine,
+                      const char *host, uint16_t port, const char *client_id, const char *topic);
+void MQTT_Client_Attach(MQTT_ClientTypeDef *client, AT_ParserTypeDef *parser);
+void MQTT_Client_SetThread(MQTT_ClientTypeDef *client, osThreadId_t thread, uint32_t wake_flag);
+void MQTT_Client_Reset(MQTT_ClientTypeDef *client);
+void MQTT_Client_Push(MQTT_ClientTypeDef *client, uint32_t timestamp, float temperature, float humidity);
+uint32_t MQTT_Client_Process(MQTT_ClientTypeDef *client);
+uint16_t MQTT_Client_Pending(MQTT_ClientTypeDef *client);
+
+#endif /* __MQTT_CLIENT_H */
@@ -16,7 +16,9 @@ typedef struct {
 
 void PID_Init(PID_HandleTypeDef *pid, float Kp, float Ki, float Kd);
 void PID_SetOutputLimits(PID_HandleTypeDef *pid, float min, float max);
+void PID_SetTunings(PID_HandleTypeDef *pid, float Kp, float Ki, float Kd);
 float PID_Compute(PID_HandleTypeDef *pid, float input, float setpoint);
+float PID_Evaluate(PID_HandleTypeDef *pid, float input, float setpoint);
 void PID_Reset(PID_HandleTypeDef *pid);
 
 #endif /* __PID_H */
@@ -0,0 +1,24 @@
+// ring_buffer.h
+#ifndef __RING_BUFFER_H
+#define __RING_BUFFER_H
+
+#include "main.h"
+
+// Кольцевой буфер записей фиксированного размера: один писатель,
+// любое число читателей без блокировок. Записи нумеруются монотонно
+// (seq), позиция в хранилище - seq % capacity
+typedef struct {
+    uint8_t *storage;
+    uint32_t element_size;
+    uint32_t capacity;
+    volatile uint32_t head;        // Записей добавлено полностью
+    volatile uint32_t generation;  // Нечетное значение - идет запись
+} RingBufferTypeDef;
+
+void Ring_Init(RingBufferTypeDef *ring, void *storage, uint32_t element_size, uint32_t capacity);
+void Ring_Append(RingBufferTypeDef *ring, const void *element);
+uint32_t Ring_Snapshot(const RingBufferTypeDef *ring, uint32_t *first);
+uint8_t Ring_Get(const RingBufferTypeDef *ring, uint32_t seq, void *element);
+void Ring_Clear(RingBufferTypeDef *ring);
+
+#endif /* __RING_BUFFER_H */
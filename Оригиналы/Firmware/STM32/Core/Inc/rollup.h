@@ -0,0 +1,56 @@
+// rollup.h
+#ifndef __ROLLUP_H
+#define __ROLLUP_H
+
+#include "main.h"
+#include "cmsis_os.h"
+#include "ring_buffer.h"
+
+#define ROLLUP_CHANNELS 2  // Температура и влажность
+#define ROLLUP_SCALE 10.0f // Значения хранятся в десятых долях
+
+// Закрытый интервал: значения в десятых долях
+typedef struct {
+    int16_t min[ROLLUP_CHANNELS];
+    int16_t max[ROLLUP_CHANNELS];
+    int16_t mean[ROLLUP_CHANNELS];
+    uint16_t count;  // 0 - показаний не было
+} Rollup_BucketTypeDef;
+
+// Текущий интервал, обновляется с каждым показанием
+typedef struct {
+    uint32_t start;
+    int16_t min[ROLLUP_CHANNELS];
+    int16_t max[ROLLUP_CHANNELS];
+    int32_t sum[ROLLUP_CHANNELS];
+    uint16_t count;
+} Rollup_OpenTypeDef;
+
+// Уровень детализации: закрытые интервалы в кольце, время интервала
+// номер seq - origin + seq * period, пропуски заполняются пустыми интервалами
+typedef struct {
+    uint32_t period;     // Длительность интервала, с
+    RingBufferTypeDef ring;
+    uint32_t origin;
+    uint8_t started;
+    Rollup_OpenTypeDef open;
+} Rollup_TierTypeDef;
+
+// Строка ответа: объединение интервалов уровня за шаг запроса. Шаг
+// не ограничен, за год показаний раз в 5 с сумма не помещается в int32
+typedef struct {
+    uint32_t time;
+    int16_t min[ROLLUP_CHANNELS];
+    int16_t max[ROLLUP_CHANNELS];
+    int64_t sum[ROLLUP_CHANNELS];
+    uint32_t count;
+} Rollup_RowTypeDef;
+
+void Rollup_TierInit(Rollup_TierTypeDef *tier, uint32_t period,
+                     Rollup_BucketTypeDef *storage, uint32_t capacity);
+void Rollup_Add(Rollup_TierTypeDef *tier, uint32_t timestamp, const float *values);
+uint8_t Rollup_Select(Rollup_TierTypeDef *tiers, uint8_t count, uint32_t from, uint32_t step);
+uint32_t Rollup_Query(Rollup_TierTypeDef *tier, uint32_t from, uint32_t to, uint32_t step,
+                      Rollup_RowTypeDef *rows, uint32_t max_rows);
+
+#endif /* __ROLLUP_H */
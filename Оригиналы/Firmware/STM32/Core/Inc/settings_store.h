@@ -0,0 +1,33 @@
+// settings_store.h
+#ifndef __SETTINGS_STORE_H
+#define __SETTINGS_STORE_H
+
+#include "main.h"
+
+#define SETTINGS_STORE_MAGIC 0x53455454UL  // "SETT"
+#define SETTINGS_STORE_PAYLOAD_MAX 96      // Максимальный размер сохраняемых данных, байт
+#define SETTINGS_STORE_BASE BKPSRAM_BASE   // Резервная SRAM 4 КБ, питание от VBAT
+
+// Слот в резервной SRAM. CRC записывается последней, поэтому прерванная
+// запись оставляет слот недействительным, а предыдущий - нетронутым
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;
+    uint32_t sequence;
+    uint8_t payload[SETTINGS_STORE_PAYLOAD_MAX];
+    uint32_t crc;
+} SettingsStore_SlotTypeDef;
+
+typedef struct {
+    uint32_t sequence;  // Номер последней действительной записи
+    uint8_t active;     // Слот последней записи
+    uint32_t saves;
+    uint32_t restores;  // Загрузки при запуске (0 - использованы значения по умолчанию)
+} SettingsStoreTypeDef;
+
+void SettingsStore_Init(SettingsStoreTypeDef *store);
+uint8_t SettingsStore_Load(SettingsStoreTypeDef *store, uint16_t version, void *data, uint16_t length);
+uint8_t SettingsStore_Save(SettingsStoreTypeDef *store, uint16_t version, const void *data, uint16_t length);
+
+#endif /* __SETTINGS_STORE_H */
@@ -0,0 +1,54 @@
+// stats.h
+#ifndef __STATS_H
+#define __STATS_H
+
+#include "main.h"
+#include "cmsis_os.h"
+
+#define STATS_CHANNELS 2   // Температура (обогрев) и влажность (увлажнение)
+#define STATS_MAX_GAP 60   // Больший промежуток между показаниями не учитывается во времени, с
+
+// Статистика канала за окно
+typedef struct {
+    uint32_t count;
+    float mean;        // Среднее и сумма квадратов отклонений (алгоритм Уэлфорда)
+    float m2;
+    float min;
+    float max;
+    uint32_t min_time;
+    uint32_t max_time;
+    uint32_t in_band;  // Время в пределах полосы вокруг уставки, с
+    uint32_t relay_on; // Время включенного выхода, с
+} Stats_ChannelTypeDef;
+
+typedef struct {
+    uint32_t start;    // Начало окна
+    uint32_t duration; // Учтенное время, с
+    Stats_ChannelTypeDef channel[STATS_CHANNELS];
+} Stats_SummaryTypeDef;
+
+// Окно фиксированной длительности, выровненное по period: текущее и
+// предыдущее завершенное
+typedef struct {
+    uint32_t period;
+    uint32_t last_time;
+    Stats_SummaryTypeDef current;
+    Stats_SummaryTypeDef previous;
+} Stats_WindowTypeDef;
+
+// Показание со всем, что нужно для учета
+typedef struct {
+    uint32_t timestamp;
+    float value[STATS_CHANNELS];
+    float setpoint[STATS_CHANNELS];
+    float band[STATS_CHANNELS];
+    uint8_t relay[STATS_CHANNELS];
+} Stats_SampleTypeDef;
+
+void Stats_Init(Stats_WindowTypeDef *window, uint32_t period);
+void Stats_Add(Stats_WindowTypeDef *window, const Stats_SampleTypeDef *sample);
+void Stats_Read(const Stats_WindowTypeDef *window, Stats_SummaryTypeDef *current,
+                Stats_SummaryTypeDef *previous);
+float Stats_StdDev(const Stats_ChannelTypeDef *channel);
+
+#endif /* __STATS_H */
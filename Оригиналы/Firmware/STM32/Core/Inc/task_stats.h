@@ -0,0 +1,37 @@
+// task_stats.h
+#ifndef __TASK_STATS_H
+#define __TASK_STATS_H
+
+#include "main.h"
+#include "cmsis_os.h"
+
+#define TASK_STATS_COUNT 10       // Потоки приложения, IDLE и служба таймеров с запасом
+#define TASK_STATS_INTERVAL 1000  // Период замера, мс (счетчик DWT переполняется за 25 с)
+
+// Поток за последний интервал замера
+typedef struct {
+    TaskHandle_t handle;
+    char name[configMAX_TASK_NAME_LEN];
+    eTaskState state;
+    UBaseType_t priority;
+    uint32_t stack_free_min;  // Наименьший запас стека за время работы, байт
+    uint32_t runtime;         // Счетчик тактов потока на момент замера
+    uint32_t cycles;          // Тактов за интервал
+} TaskStats_EntryTypeDef;
+
+typedef struct {
+    TaskStats_EntryTypeDef entries[TASK_STATS_COUNT];
+    uint8_t count;
+    uint32_t total;           // DWT->CYCCNT на момент замера
+    uint32_t interval;        // Тактов в последнем интервале
+    uint32_t samples;
+    uint32_t sample_cycles;   // Длительность последнего замера
+    uint32_t sample_max_cycles;
+} TaskStatsTypeDef;
+
+void TaskStats_Init(TaskStatsTypeDef *stats);
+void TaskStats_Sample(TaskStatsTypeDef *stats);
+void TaskStats_Read(const TaskStatsTypeDef *stats, TaskStatsTypeDef *copy);
+const char* TaskStats_StateName(eTaskState state);
+
+#endif /* __TASK_STATS_H */
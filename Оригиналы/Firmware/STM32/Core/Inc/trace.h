@@ -0,0 +1,75 @@
+// trace.h
+#ifndef __TRACE_H
+#define __TRACE_H
+
+#include "main.h"
+
+// Переключения потоков пишет хук traceTASK_SWITCHED_IN (FreeRTOSConfig.h)
+#define TRACE_ENABLED 1          // 0 - вызовы TRACE() не компилируются
+#define TRACE_EVENT_COUNT 512    // Событий в кольце, степень двойки (8 байт на событие)
+#define TRACE_NAME_COUNT 32      // Имена потоков, прерываний и AT команд в дампе
+#define TRACE_NAME_SIZE 14
+#define TRACE_MAGIC 0x31435254U  // "TRC1"
+#define TRACE_VERSION 1
+
+typedef enum {
+    TRACE_TASK_SWITCH = 1,  // id - номер потока (xTaskNumber), поток начал выполняться
+    TRACE_ISR_ENTER,        // id - номер IRQ
+    TRACE_ISR_EXIT,
+    TRACE_AT_START,         // id - номер команды в статистике движка AT
+    TRACE_AT_END,           // arg - AT_StatusTypeDef
+    TRACE_MODBUS_START,     // arg - адрес регистра
+    TRACE_MODBUS_END,       // arg - 1 ответ принят, 0 ошибка или тайм-аут
+    TRACE_HTTP_CONNECT,     // id - link ID
+    TRACE_HTTP_REQUEST,     // Запрос передан обработчику, arg - длина
+    TRACE_HTTP_RESPOND,     // Ответ в очереди отправки, arg - длина (до 65535)
+    TRACE_HTTP_SENT,        // Ответ отправлен, arg - 1 при ошибке
+    TRACE_HTTP_CLOSE
+} TraceEventTypeDef;
+
+typedef enum {
+    TRACE_NAME_TASK = 1,
+    TRACE_NAME_IRQ,
+    TRACE_NAME_AT
+} TraceNameKindTypeDef;
+
+// Событие: 8 байт, время - DWT->CYCCNT
+typedef struct {
+    uint32_t cycles;
+    uint8_t type;
+    uint8_t id;
+    uint16_t arg;
+} TraceRecordTypeDef;
+
+typedef struct {
+    uint8_t kind;
+    uint8_t id;
+    char name[TRACE_NAME_SIZE];
+} TraceNameTypeDef;
+
+// Дамп целиком, формат для Tools/trace_convert (little-endian)
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t name_count;
+    uint32_t cpu_hz;
+    uint32_t head;      // Событий записано с очистки, последнее - head - 1
+    uint32_t capacity;  // TRACE_EVENT_COUNT
+    TraceNameTypeDef names[TRACE_NAME_COUNT];
+    TraceRecordTypeDef events[TRACE_EVENT_COUNT];
+} TraceDumpTypeDef;
+
+#if TRACE_ENABLED
+#define TRACE(type, id, arg) Trace_Record((type), (id), (arg))
+#else
+#define TRACE(type, id, arg) ((void)0)
+#endif
+
+void Trace_Init(TraceDumpTypeDef *dump);
+void Trace_Record(uint8_t type, uint8_t id, uint16_t arg);
+void Trace_TaskSwitchedIn(uint32_t task_number);
+void Trace_SetName(uint8_t kind, uint8_t id, const char *name);
+uint32_t Trace_Freeze(void);
+void Trace_Resume(void);
+
+#endif /* __TRACE_H */
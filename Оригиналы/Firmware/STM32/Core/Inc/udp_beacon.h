@@ -0,0 +1,63 @@
+// udp_beacon.h
+#ifndef __UDP_BEACON_H
+#define __UDP_BEACON_H
+
+#include "main.h"
+#include "cmsis_os.h"
+#include "at_parser.h"
+#include "at_engine.h"
+
+#define UDP_BEACON_MAGIC 0x4D43U       // "CM" в порядке байт little-endian
+#define UDP_BEACON_VERSION 1
+#define UDP_BEACON_PACKET_SIZE 24
+#define UDP_BEACON_LOCAL_PORT 40001    // Порт отправителя на ESP
+#define UDP_BEACON_TIMEOUT 2000        // AT+CIPSTART и AT+CIPSEND, мс
+
+// Биты поля flags пакета
+#define UDP_BEACON_FLAG_HEATING        0x01
+#define UDP_BEACON_FLAG_HUMIDIFICATION 0x02
+#define UDP_BEACON_FLAG_HUM_ALARM      0x04
+#define UDP_BEACON_FLAG_HUM_RUNNING    0x08
+#define UDP_BEACON_FLAG_HUM_SERVICE    0x10
+#define UDP_BEACON_FLAG_AUTO_MODE      0x20
+
+// Пакет маяка, все поля little-endian:
+//  0 u16 magic       4 u32 device_id   12 u32 timestamp (Unix, с)   20 u32 uptime (мс)
+//  2 u8  version     8 u32 sequence    16 i16 temperature (0.1 °C)
+//  3 u8  flags                         18 u16 humidity (0.1 %)
+typedef struct {
+    uint32_t timestamp;
+    float temperature;
+    float humidity;
+    uint8_t flags;
+} UDP_BeaconSampleTypeDef;
+
+typedef struct {
+    AT_EngineTypeDef *engine;
+    uint8_t link_id;          // Link ID ESP, зарезервированный под маяк
+    const char *host;         // Широковещательный или multicast адрес
+    uint16_t port;
+    uint32_t device_id;
+    char closed_prefix[12];   // "<link>,CLOSED"
+
+    volatile uint8_t opened;
+    volatile uint8_t busy;    // Пакет в очереди движка
+    uint32_t sequence;
+    uint8_t packet[UDP_BEACON_PACKET_SIZE];
+    AT_RequestTypeDef open_request;
+    char open_response[48];
+    AT_RequestTypeDef send_request;
+
+    // Статистика
+    uint32_t sent;
+    uint32_t errors;
+    uint32_t skipped;         // Предыдущий пакет еще не отправлен
+} UDP_BeaconTypeDef;
+
+void UDP_Beacon_Init(UDP_BeaconTypeDef *beacon, AT_EngineTypeDef *engine, uint8_t link_id,
+                     const char *host, uint16_t port, uint32_t device_id);
+void UDP_Beacon_Attach(UDP_BeaconTypeDef *beacon, AT_ParserTypeDef *parser);
+void UDP_Beacon_Reset(UDP_BeaconTypeDef *beacon);
+void UDP_Beacon_Send(UDP_BeaconTypeDef *beacon, const UDP_BeaconSampleTypeDef *sample);
+
+#endif /* __UDP_BEACON_H */
@@ -0,0 +1,336 @@
+/*
+ * at_engine.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// at_engine.c
+// Движок AT команд. Единственный владелец USART6: остальные потоки ставят
+// команды в очередь, движок отправляет их по одной, сопоставляет ответы
+// и сообщает о завершении. Ответы разных команд не перемешиваются.
+#include "at_engine.h"
+#include "trace.h"
+#include <stdio.h>
+#include <string.h>
+
+static AT_CommandStatsTypeDef* AT_Engine_Stats(AT_EngineTypeDef *engine, const char *command)
+{
+    char name[AT_STATS_NAME_SIZE];
+    uint32_t length = strcspn(command, "=?\r\n");
+
+    if(length == 0)
+    {
+        // Ожидание уведомления без команды
+        command = "(wait)";
+        length = strlen(command);
+    }
+    if(length >= sizeof(name))
+    {
+        length = sizeof(name) - 1;
+    }
+    memcpy(name, command, length);
+    name[length] = '\0';
+
+    for(uint8_t i = 0; i < engine->stats_count; i++)
+    {
+        if(strcmp(engine->stats[i].name, name) == 0)
+            return &engine->stats[i];
+    }
+
+    if(engine->stats_count < AT_STATS_COUNT - 1)
+    {
+        AT_CommandStatsTypeDef *stats = &engine->stats[engine->stats_count++];
+        strcpy(stats->name, name);
+        return stats;
+    }
+
+    // Таблица заполнена - общая запись для остальных команд
+    AT_CommandStatsTypeDef *other = &engine->stats[AT_STATS_COUNT - 1];
+    if(other->name[0] == '\0')
+    {
+        strcpy(other->name, "other");
+        engine->stats_count = AT_STATS_COUNT;
+    }
+    return other;
+}
+
+static void AT_Engine_Complete(AT_EngineTypeDef *engine, AT_StatusTypeDef status)
+{
+    AT_RequestTypeDef *request = engine->current;
+    AT_CommandStatsTypeDef *stats = AT_Engine_Stats(engine, request->command);
+    uint32_t latency = osKernelGetTickCount() - request->submitted;
+
+    TRACE(TRACE_AT_END, stats - engine->stats, status);
+
+    stats->count++;
+    stats->total_ms += latency;
+    if(latency > stats->max_ms)
+    {
+        stats->max_ms = latency;
+    }
+    if(status == AT_STATUS_ERROR)
+    {
+        stats->errors++;
+    }
+    else if(status == AT_STATUS_TIMEOUT)
+    {
+        stats->timeouts++;
+    }
+
+    engine->current = NULL;
+    engine->state = AT_ENGINE_IDLE;
+
+    request->status = status;
+    if(request->done)
+    {
+        request->done(request->ctx, request);
+    }
+    if(request->waiter)
+    {
+        osThreadFlagsSet(request->waiter, AT_ENGINE_DONE_FLAG);
+    }
+}
+
+static void AT_Engine_Capture(AT_RequestTypeDef *request, const char *line)
+{
+    uint32_t length = strlen(line);
+
+    if(request->response &&
+       request->response_length + length + 2 <= request->response_size)
+    {
+        memcpy(request->response + request->response_length, line, length);
+        request->response_length += length;
+        request->response[request->response_length++] = '\n';
+        request->response[request->response_length] = '\0';
+    }
+}
+
+/**
+  * @brief Все строки от ESP: сопоставление с текущей командой
+  */
+static void AT_Engine_OnLine(void *ctx, const char *line)
+{
+    AT_EngineTypeDef *engine = ctx;
+    AT_RequestTypeDef *request = engine->current;
+
+    if(request == NULL)
+        return;
+
+    if(engine->state == AT_ENGINE_WAIT_PROMPT && strcmp(line, ">") == 0)
+    {
+        engine->transmit(request->data, request->data_length);
+        engine->state = AT_ENGINE_WAIT_RESULT;
+        return;
+    }
+
+    AT_Engine_Capture(request, line);
+
+    const char *expected = request->expected ? request->expected : "OK";
+    if(strncmp(line, expected, strlen(expected)) == 0)
+    {
+        // До приглашения "OK" на AT+CIPSEND не является результатом
+        if(engine->state == AT_ENGINE_WAIT_RESULT)
+        {
+            AT_Engine_Complete(engine, AT_STATUS_OK);
+        }
+    }
+    else if(strcmp(line, "ERROR") == 0 || strcmp(line, "FAIL") == 0 ||
+            strcmp(line, "SEND FAIL") == 0)
+    {
+        AT_Engine_Complete(engine, AT_STATUS_ERROR);
+    }
+}
+
+/**
+  * @brief Инициализация движка (до запуска планировщика)
+  * @param poll: прием данных от ESP, вызывается при синхронном ожидании
+  *              внутри потока движка
+  * @param wake_flag, data_flag: флаги event новой команды и приема от ESP
+  */
+void AT_Engine_Init(AT_EngineTypeDef *engine, AT_ParserTypeDef *parser,
+                    AT_TransmitTypeDef transmit, AT_PollTypeDef poll,
+                    osEventFlagsId_t event, uint32_t wake_flag, uint32_t data_flag)
+{
+    memset(engine, 0, sizeof(*engine));
+
+    const osMessageQueueAttr_t queue_attributes = {
+        .name = "AtEngine",
+        .cb_mem = &engine->queue_cb,
+        .cb_size = sizeof(engine->queue_cb),
+        .mq_mem = engine->queue_storage,
+        .mq_size = sizeof(engine->queue_storage)
+    };
+    engine->queue = osMessageQueueNew(AT_QUEUE_SIZE, sizeof(AT_RequestTypeDef*), &queue_attributes);
+    engine->event = event;
+    engine->wake_flag = wake_flag;
+    engine->data_flag = data_flag;
+    engine->transmit = transmit;
+    engine->poll = poll;
+
+    AT_Parser_Register(parser, "", AT_Engine_OnLine, engine);
+}
+
+/**
+  * @brief Поток, в котором работает движок
+  */
+void AT_Engine_SetThread(AT_EngineTypeDef *engine, osThreadId_t thread)
+{
+    engine->thread = thread;
+}
+
+/**
+  * @brief Подготовка команды
+  * @param command: текст команды без \r\n, NULL - только ожидание expected
+  */
+void AT_Request_Init(AT_RequestTypeDef *request, const char *command,
+                     const char *expected, uint32_t timeout)
+{
+    memset(request, 0, sizeof(*request));
+    if(command)
+    {
+        snprintf(request->command, sizeof(request->command), "%s\r\n", command);
+    }
+    request->expected = expected;
+    request->timeout = timeout;
+}
+
+/**
+  * @brief Постановка команды в очередь (из любого потока)
+  * Структура команды должна существовать до завершения
+  * @retval 1 - команда принята, 0 - очередь заполнена
+  */
+uint8_t AT_Engine_Submit(AT_EngineTypeDef *engine, AT_RequestTypeDef *request)
+{
+    request->status = AT_STATUS_PENDING;
+    request->response_length = 0;
+    if(request->response && request->response_size > 0)
+    {
+        request->response[0] = '\0';
+    }
+    request->submitted = osKernelGetTickCount();
+
+    if(osMessageQueuePut(engine->queue, &request, 0, 0) != osOK)
+        return 0;
+
+    osEventFlagsSet(engine->event, engine->wake_flag);
+    return 1;
+}
+
+/**
+  * @brief Выполнение команды с ожиданием результата
+  * В потоке движка ожидание совмещено с приемом и обработкой очереди
+  */
+AT_StatusTypeDef AT_Engine_Execute(AT_EngineTypeDef *engine, AT_RequestTypeDef *request)
+{
+    uint8_t own_thread = (osThreadGetId() == engine->thread);
+
+    request->waiter = own_thread ? NULL : osThreadGetId();
+    if(!own_thread)
+    {
+        osThreadFlagsClear(AT_ENGINE_DONE_FLAG);
+    }
+
+    if(!AT_Engine_Submit(engine, request))
+    {
+        request->status = AT_STATUS_ERROR;
+        return request->status;
+    }
+
+    if(own_thread)
+    {
+        while(request->status == AT_STATUS_PENDING)
+        {
+            engine->poll();
+            AT_Engine_Process(engine);
+            if(request->status == AT_STATUS_PENDING)
+            {
+                // Сон до ответа ESP или тайм-аута текущей команды
+                osEventFlagsWait(engine->event, engine->wake_flag | engine->data_flag,
+                                 osFlagsWaitAny, AT_Engine_Timeout(engine));
+            }
+        }
+    }
+    else
+    {
+        // Движок всегда завершает команду не позже timeout
+        while(request->status == AT_STATUS_PENDING)
+        {
+            osThreadFlagsWait(AT_ENGINE_DONE_FLAG, osFlagsWaitAny, osWaitForever);
+        }
+    }
+
+    return request->status;
+}
+
+/**
+  * @brief Отправка следующей команды и контроль тайм-аута (поток движка)
+  */
+void AT_Engine_Process(AT_EngineTypeDef *engine)
+{
+    if(engine->current &&
+       (osKernelGetTickCount() - engine->started) >= engine->current->timeout)
+    {
+        AT_Engine_Complete(engine, AT_STATUS_TIMEOUT);
+    }
+
+    if(engine->current)
+        return;
+
+    AT_RequestTypeDef *request;
+    if(osMessageQueueGet(engine->queue, &request, NULL, 0) != osOK)
+        return;
+
+    engine->current = request;
+    engine->started = osKernelGetTickCount();
+    engine->state = request->data ? AT_ENGINE_WAIT_PROMPT : AT_ENGINE_WAIT_RESULT;
+    TRACE(TRACE_AT_START, AT_Engine_Stats(engine, request->command) - engine->stats, 0);
+
+    uint32_t length = strlen(request->command);
+    if(length > 0)
+    {
+        engine->transmit((const uint8_t*)request->command, length);
+    }
+}
+
+/**
+  * @brief Отмена текущей и всех ожидающих команд (после сброса ESP)
+  */
+void AT_Engine_Abort(AT_EngineTypeDef *engine)
+{
+    AT_RequestTypeDef *request;
+
+    if(engine->current)
+    {
+        AT_Engine_Complete(engine, AT_STATUS_ERROR);
+    }
+
+    while(osMessageQueueGet(engine->queue, &request, NULL, 0) == osOK)
+    {
+        engine->current = request;
+        AT_Engine_Complete(engine, AT_STATUS_ERROR);
+    }
+}
+
+/**
+  * @brief Есть ли выполняемые или ожидающие команды
+  */
+uint8_t AT_Engine_Busy(AT_EngineTypeDef *engine)
+{
+    return engine->current != NULL || osMessageQueueGetCount(engine->queue) > 0;
+}
+
+/**
+  * @brief Мс до тайм-аута текущей команды (поток движка)
+  * @retval 0 - нужен AT_Engine_Process, osWaitForever - очередь пуста
+  */
+uint32_t AT_Engine_Timeout(AT_EngineTypeDef *engine)
+{
+    if(engine->current)
+    {
+        uint32_t elapsed = osKernelGetTickCount() - engine->started;
+        return (elapsed < engine->current->timeout) ? engine->current->timeout - elapsed : 0;
+    }
+
+    return (osMessageQueueGetCount(engine->queue) > 0) ? 0 : osWaitForever;
+}
@@ -0,0 +1,243 @@
+/*
+ * at_parser.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// at_parser.c
+// Построчный разбор потока ESP-AT. Финальные ответы (OK, ERROR, SEND OK),
+// приглашение ">" и уведомления (+IPD, <link>,CONNECT, +STA_CONNECTED...)
+// передаются зарегистрированным обработчикам по началу строки.
+// Данные +IPD (активный прием) и +CIPRECVDATA (пассивный прием)
+// передаются получателю данных. Формат ESP-AT v2.2.1.0:
+// +IPD,<link>,<len>[,"<ip>",<port>]:<data> и
+// +CIPRECVDATA:<len>[,"<ip>",<port>],<data> - адрес при AT+CIPDINFO=1.
+#include "at_parser.h"
+#include <stdlib.h>
+#include <string.h>
+
+static uint8_t AT_Parser_Match(const char *prefix, const char *line)
+{
+    while(*prefix)
+    {
+        if(*line == '\0' || (*prefix != '?' && *prefix != *line))
+            return 0;
+        prefix++;
+        line++;
+    }
+    return 1;
+}
+
+static void AT_Parser_Dispatch(AT_ParserTypeDef *parser, const char *line)
+{
+    uint8_t handled = 0;
+
+    parser->lines++;
+    for(uint8_t i = 0; i < parser->handler_count; i++)
+    {
+        AT_HandlerTypeDef *entry = &parser->handlers[i];
+        if(AT_Parser_Match(entry->prefix, line))
+        {
+            entry->handler(entry->ctx, line);
+            handled = 1;
+        }
+    }
+
+    if(!handled)
+    {
+        parser->unhandled++;
+    }
+}
+
+/**
+  * @brief Инициализация разборщика без обработчиков
+  */
+void AT_Parser_Init(AT_ParserTypeDef *parser)
+{
+    memset(parser, 0, sizeof(*parser));
+    parser->recv_fields = 1;
+}
+
+/**
+  * @brief Сброс незавершенной строки или пакета (после перезапуска ESP)
+  */
+void AT_Parser_Reset(AT_ParserTypeDef *parser)
+{
+    parser->state = AT_RX_LINE;
+    parser->line_length = 0;
+    parser->data_remaining = 0;
+}
+
+/**
+  * @brief Регистрация обработчика строк
+  * @param prefix: начало строки, '?' совпадает с любым символом
+  * @retval 1 - зарегистрирован, 0 - таблица заполнена
+  */
+uint8_t AT_Parser_Register(AT_ParserTypeDef *parser, const char *prefix,
+                           AT_LineHandlerTypeDef handler, void *ctx)
+{
+    if(parser->handler_count >= AT_HANDLER_COUNT)
+        return 0;
+
+    AT_HandlerTypeDef *entry = &parser->handlers[parser->handler_count++];
+    entry->prefix = prefix;
+    entry->handler = handler;
+    entry->ctx = ctx;
+    return 1;
+}
+
+/**
+  * @brief Регистрация получателя данных +IPD
+  */
+void AT_Parser_SetDataHandler(AT_ParserTypeDef *parser, AT_DataHandlerTypeDef handler, void *ctx)
+{
+    parser->data_handler = handler;
+    parser->data_ctx = ctx;
+}
+
+/**
+  * @brief Формат ответа AT+CIPRECVDATA
+  * @param remote_info: 1 - ESP настроен AT+CIPDINFO=1, перед данными
+  *        адрес и порт клиента. Данные могут начинаться с любого символа,
+  *        поэтому число полей задается явно, а не угадывается
+  */
+void AT_Parser_SetRecvInfo(AT_ParserTypeDef *parser, uint8_t remote_info)
+{
+    parser->recv_fields = remote_info ? 3 : 1;
+}
+
+/**
+  * @brief Разбор очередной порции потока
+  * Каждый байт просматривается один раз, данные +IPD передаются
+  * получателю непрерывными кусками без копирования
+  */
+void AT_Parser_Input(AT_ParserTypeDef *parser, const uint8_t *data, uint32_t length)
+{
+    uint32_t i = 0;
+
+    parser->bytes += length;
+
+    while(i < length)
+    {
+        if(parser->state == AT_RX_IPD_DATA)
+        {
+            uint32_t chunk = length - i;
+            if(chunk > parser->data_remaining)
+            {
+                chunk = parser->data_remaining;
+            }
+            if(parser->data_handler)
+            {
+                parser->data_handler(parser->data_ctx, parser->data_link, data + i, chunk);
+            }
+            parser->data_remaining -= chunk;
+            i += chunk;
+            if(parser->data_remaining == 0)
+            {
+                parser->state = AT_RX_LINE;
+            }
+            continue;
+        }
+
+        char c = (char)data[i++];
+
+        if(parser->state == AT_RX_IPD_HEADER)
+        {
+            uint8_t recv = (parser->line[1] == 'C');
+
+            // +CIPRECVDATA: данные начинаются после запятой, завершающей
+            // recv_fields полей, в адресе запятых нет
+            if(recv && c == ',' && ++parser->header_fields == parser->recv_fields)
+            {
+                // +CIPRECVDATA:<len>[,"<ip>",<port>]
+                parser->line[parser->line_length] = '\0';
+                parser->data_link = AT_RECV_LINK;
+                parser->data_remaining = strtoul(parser->line + 13, NULL, 10);
+                parser->line_length = 0;
+                parser->lines++;
+                parser->state = (parser->data_remaining > 0) ? AT_RX_IPD_DATA : AT_RX_LINE;
+            }
+            else if(!recv && c == ':')
+            {
+                // +IPD,<link>,<len>[,"<ip>",<port>]
+                char *field;
+                parser->line[parser->line_length] = '\0';
+                field = parser->line + 5;
+                parser->data_link = (uint8_t)strtoul(field, &field, 10);
+                parser->data_remaining = (*field == ',') ? strtoul(field + 1, NULL, 10) : 0;
+                parser->line_length = 0;
+                parser->lines++;
+                parser->state = (parser->data_remaining > 0) ? AT_RX_IPD_DATA : AT_RX_LINE;
+            }
+            else if(c == '\n' && parser->line[1] == 'I')
+            {
+                // Пассивный прием: +IPD,<link>,<len> без данных - обычное уведомление
+                if(parser->line_length > 0 && parser->line[parser->line_length - 1] == '\r')
+                {
+                    parser->line_length--;
+                }
+                parser->line[parser->line_length] = '\0';
+                AT_Parser_Dispatch(parser, parser->line);
+                parser->line_length = 0;
+                parser->state = AT_RX_LINE;
+            }
+            else if(c == '\n' || parser->line_length >= AT_LINE_SIZE - 1)
+            {
+                // Поврежденный заголовок
+                parser->overflows++;
+                parser->line_length = 0;
+                parser->state = AT_RX_LINE;
+            }
+            else
+            {
+                parser->line[parser->line_length++] = c;
+            }
+            continue;
+        }
+
+        // Приглашение ">" приходит без перевода строки
+        if(c == '>' && parser->line_length == 0)
+        {
+            AT_Parser_Dispatch(parser, ">");
+            continue;
+        }
+
+        if(c == '\n')
+        {
+            if(parser->line_length > AT_LINE_SIZE - 1)
+            {
+                parser->line_length = AT_LINE_SIZE - 1;
+            }
+            if(parser->line_length > 0 && parser->line[parser->line_length - 1] == '\r')
+            {
+                parser->line_length--;
+            }
+            parser->line[parser->line_length] = '\0';
+            if(parser->line_length > 0)
+            {
+                AT_Parser_Dispatch(parser, parser->line);
+            }
+            parser->line_length = 0;
+            continue;
+        }
+
+        if(parser->line_length < AT_LINE_SIZE - 1)
+        {
+            parser->line[parser->line_length++] = c;
+        }
+        else if(parser->line_length == AT_LINE_SIZE - 1)
+        {
+            // Остаток длинной строки отбрасывается
+            parser->overflows++;
+            parser->line_length++;
+        }
+
+        if((parser->line_length == 5 && strncmp(parser->line, "+IPD,", 5) == 0) ||
+           (parser->line_length == 13 && strncmp(parser->line, "+CIPRECVDATA:", 13) == 0))
+        {
+            parser->state = AT_RX_IPD_HEADER;
+            parser->header_fields = 0;
+        }
+    }
+}
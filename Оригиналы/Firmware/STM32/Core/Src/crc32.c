@@ -0,0 +1,30 @@
+/*
+ * crc32.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// crc32.c
+// CRC-32 (IEEE 802.3) для записей во flash и резервной памяти
+#include "crc32.h"
+
+/**
+  * @brief CRC-32 блока данных, побитовый расчет без таблицы
+  */
+uint32_t CRC32_Compute(const void *data, uint32_t length)
+{
+    const uint8_t *bytes = data;
+    uint32_t crc = 0xFFFFFFFFUL;
+
+    for(uint32_t i = 0; i < length; i++)
+    {
+        crc ^= bytes[i];
+        for(uint8_t bit = 0; bit < 8; bit++)
+        {
+            crc = (crc >> 1) ^ (0xEDB88320UL & -(crc & 1));
+        }
+    }
+
+    return ~crc;
+}
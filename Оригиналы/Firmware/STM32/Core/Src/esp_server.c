@@ -0,0 +1,635 @@
+/*
+ * esp_server.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// esp_server.c
+// HTTP сервер поверх ESP-AT в режиме CIPMUX=1: таблица соединений
+// с собственным разбором запроса для каждого link ID и очередь отправки,
+// которая чередует порции AT+CIPSEND между соединениями.
+// В пассивном режиме приема данные забираются командой AT+CIPRECVDATA
+// порциями, которые помещаются в кольцевой буфер приема.
+// Уведомления и данные приходят от разборщика at_parser, команды
+// отправляются через движок at_engine. Буферы запроса и ответа
+// соединение берет из пулов на время обмена.
+#include "esp_server.h"
+#include "trace.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Ответ на запрос, который не помещается в блок запроса
+static const char esp_payload_too_large[] =
+    "HTTP/1.1 413 Payload Too Large\r\n"
+    "Content-Length: 0\r\n\r\n";
+
+static void ESP_Link_Clear(ESP_ServerTypeDef *server, ESP_LinkTypeDef *link)
+{
+    link->state = ESP_LINK_IDLE;
+    link->peer_closed = 0;
+    link->rx_pending = 0;
+    MemPool_Free(server->request_pool, link->request);
+    link->request = NULL;
+    link->request_length = 0;
+    MemPool_Free(server->response_pool, link->response);
+    link->response = NULL;
+    link->first_line_done = 0;
+    link->header_done = 0;
+    link->overflow = 0;
+    link->line_length = 0;
+    link->body_expected = 0;
+    link->body_received = 0;
+    link->tx_data = NULL;
+    link->tx_length = 0;
+    link->tx_offset = 0;
+    link->tx_done = NULL;
+    link->tx_ctx = NULL;
+}
+
+// Освобождение буфера ответа (отправлен или отменен)
+static void ESP_Link_ReleaseResponse(ESP_ServerTypeDef *server, ESP_LinkTypeDef *link)
+{
+    if(link->tx_done)
+    {
+        link->tx_done(link->tx_ctx);
+    }
+    link->tx_done = NULL;
+    link->tx_data = NULL;
+    MemPool_Free(server->response_pool, link->response);
+    link->response = NULL;
+}
+
+static void ESP_Link_Append(ESP_LinkTypeDef *link, char c)
+{
+    if(link->request && link->request_length < ESP_LINK_REQUEST_SIZE - 1)
+    {
+        link->request[link->request_length++] = c;
+        link->request[link->request_length] = '\0';
+    }
+    else
+    {
+        link->overflow = 1;
+    }
+}
+
+/**
+  * @brief Разбор очередного байта запроса соединения
+  * В буфере остаются строка запроса, пустая строка и тело:
+  * "GET /data HTTP/1.1\r\n\r\n<body>"
+  * Запрос, который не помещается в блок, завершается сразу с флагом
+  * overflow: обработчик не должен получить обрезанное тело
+  */
+static void ESP_Link_ParseByte(ESP_LinkTypeDef *link, char c)
+{
+    if(link->state == ESP_LINK_IDLE)
+    {
+        link->state = ESP_LINK_RECEIVING;
+    }
+    else if(link->state != ESP_LINK_RECEIVING)
+    {
+        // Данные после полного запроса игнорируются
+        return;
+    }
+
+    if(link->header_done)
+    {
+        ESP_Link_Append(link, c);
+        link->body_received++;
+    }
+    else if(!link->first_line_done)
+    {
+        ESP_Link_Append(link, c);
+        if(c == '\n')
+        {
+            link->first_line_done = 1;
+        }
+    }
+    else if(c == '\n')
+    {
+        // Пустая строка - конец заголовков
+        if(link->line_length == 0 || (link->line_length == 1 && link->line[0] == '\r'))
+        {
+            link->header_done = 1;
+            ESP_Link_Append(link, '\r');
+            ESP_Link_Append(link, '\n');
+            if(link->body_expected > ESP_LINK_REQUEST_SIZE - 1 - link->request_length)
+            {
+                link->overflow = 1;
+            }
+        }
+        else
+        {
+            link->line[(link->line_length < ESP_LINK_LINE_SIZE) ? link->line_length : ESP_LINK_LINE_SIZE - 1] = '\0';
+            if(strncasecmp(link->line, "Content-Length:", 15) == 0)
+            {
+                link->body_expected = strtoul(link->line + 15, NULL, 10);
+            }
+        }
+        link->line_length = 0;
+    }
+    else
+    {
+        // Начало строки заголовка, остаток строки не нужен
+        if(link->line_length < ESP_LINK_LINE_SIZE - 1)
+        {
+            link->line[link->line_length] = c;
+        }
+        if(link->line_length < 0xFF)
+        {
+            link->line_length++;
+        }
+    }
+
+    if(link->overflow || (link->header_done && link->body_received >= link->body_expected))
+    {
+        link->state = ESP_LINK_READY;
+        link->ready_at = HAL_GetTick();
+    }
+}
+// Link ID клиента веб-сервера (не зарезервирован под другие соединения)
+static uint8_t ESP_Server_IsClient(ESP_ServerTypeDef *server, uint8_t link_id)
+{
+    return link_id < ESP_LINK_COUNT && !(server->reserved & (1U << link_id));
+}
+
+/**
+  * @brief Уведомления соединений: "<link>,CONNECT" и "<link>,CLOSED"
+  */
+static void ESP_Server_OnLink(void *ctx, const char *line)
+{
+    ESP_ServerTypeDef *server = ctx;
+    uint8_t link_id = line[0] - '0';
+
+    if(!ESP_Server_IsClient(server, link_id))
+        return;
+
+    ESP_LinkTypeDef *link = &server->links[link_id];
+    uint8_t in_use = (link->state == ESP_LINK_HANDLING) ||
+                     (server->tx_busy && server->tx_link == link_id);
+
+    if(strncmp(line + 2, "CONNECT", 7) == 0)
+    {
+        if(in_use)
+            return;
+
+        ESP_Link_ReleaseResponse(server, link);
+        ESP_Link_Clear(server, link);
+        link->last_activity = HAL_GetTick();
+        TRACE(TRACE_HTTP_CONNECT, link_id, 0);
+    }
+    else if(in_use)
+    {
+        // Буферы соединения заняты обработчиком или отправкой,
+        // соединение освобождается после их завершения
+        link->peer_closed = 1;
+    }
+    else
+    {
+        // Соединение закрыто клиентом или по нашей команде
+        ESP_Link_ReleaseResponse(server, link);
+        ESP_Link_Clear(server, link);
+        TRACE(TRACE_HTTP_CLOSE, link_id, 0);
+    }
+}
+
+/**
+  * @brief Пассивный прием: "+IPD,<link>,<len>" - в ESP появились данные
+  */
+static void ESP_Server_OnNotify(void *ctx, const char *line)
+{
+    ESP_ServerTypeDef *server = ctx;
+    uint8_t link_id = line[5] - '0';
+
+    if(ESP_Server_IsClient(server, link_id))
+    {
+        server->links[link_id].rx_pending = 1;
+    }
+}
+
+/**
+  * @brief Данные +IPD или +CIPRECVDATA соединения
+  */
+static void ESP_Server_OnData(void *ctx, uint8_t link_id, const uint8_t *data, uint32_t length)
+{
+    ESP_ServerTypeDef *server = ctx;
+
+    if(link_id == AT_RECV_LINK)
+    {
+        // Ответ на AT+CIPRECVDATA: соединение известно по запросу
+        link_id = server->rx_link;
+        server->rx_received += length;
+    }
+    if(!ESP_Server_IsClient(server, link_id))
+        return;
+
+    server->bytes_received += length;
+
+    ESP_LinkTypeDef *link = &server->links[link_id];
+    if(link->request == NULL &&
+       (link->state == ESP_LINK_IDLE || link->state == ESP_LINK_RECEIVING))
+    {
+        link->request = MemPool_Alloc(server->request_pool);
+        if(link->request == NULL)
+        {
+            // Все блоки запросов заняты: соединение закрывается без ответа
+            link->state = ESP_LINK_CLOSING;
+            server->rejected++;
+        }
+        else
+        {
+            link->request[0] = '\0';
+        }
+    }
+    for(uint32_t i = 0; i < length; i++)
+    {
+        ESP_Link_ParseByte(link, (char)data[i]);
+    }
+    link->last_activity = HAL_GetTick();
+}
+
+/**
+  * @brief Завершение AT+CIPSEND или AT+CIPCLOSE (поток движка)
+  */
+static void ESP_Server_OnSent(void *ctx, AT_RequestTypeDef *request)
+{
+    ESP_ServerTypeDef *server = ctx;
+    ESP_LinkTypeDef *link = &server->links[server->tx_link];
+
+    server->tx_busy = 0;
+
+    if(link->state == ESP_LINK_RESPONDING)
+    {
+        if(request->status == AT_STATUS_OK)
+        {
+            link->tx_offset += server->tx_chunk;
+            server->bytes_sent += server->tx_chunk;
+            if(link->tx_offset >= link->tx_length)
+            {
+                ESP_Link_ReleaseResponse(server, link);
+                link->state = ESP_LINK_CLOSING;
+                server->responses++;
+                server->last_response_bytes = link->tx_length;
+                server->last_response_ms = HAL_GetTick() - link->tx_start;
+                TRACE(TRACE_HTTP_SENT, server->tx_link, 0);
+
+                // Задержка запрос-ответ
+                server->latency_last_ms = HAL_GetTick() - link->ready_at;
+                server->latency_total_ms += server->latency_last_ms;
+                if(server->latency_last_ms > server->latency_max_ms)
+                {
+                    server->latency_max_ms = server->latency_last_ms;
+                }
+            }
+        }
+        else
+        {
+            // Соединение недоступно - ответ отменяется
+            ESP_Link_ReleaseResponse(server, link);
+            link->state = ESP_LINK_CLOSING;
+            server->send_errors++;
+            TRACE(TRACE_HTTP_SENT, server->tx_link, 1);
+        }
+
+        if(link->peer_closed)
+        {
+            // Клиент уже закрыл соединение, AT+CIPCLOSE не нужна
+            ESP_Link_ReleaseResponse(server, link);
+            ESP_Link_Clear(server, link);
+            TRACE(TRACE_HTTP_CLOSE, server->tx_link, 0);
+        }
+    }
+    else if(link->state == ESP_LINK_CLOSING)
+    {
+        // OK или ERROR (соединение уже закрыто) - link ID свободен
+        ESP_Link_Clear(server, link);
+        TRACE(TRACE_HTTP_CLOSE, server->tx_link, 0);
+    }
+}
+
+/**
+  * @brief Завершение AT+CIPRECVDATA (поток движка)
+  */
+static void ESP_Server_OnReceived(void *ctx, AT_RequestTypeDef *request)
+{
+    ESP_ServerTypeDef *server = ctx;
+    ESP_LinkTypeDef *link = &server->links[server->rx_link];
+
+    server->rx_busy = 0;
+    server->recv_reads++;
+
+    // Пустой ответ - буфер ESP прочитан полностью, иначе забираем
+    // следующую порцию после разбора этой. Новые данные ESP снова
+    // сообщит уведомлением +IPD
+    if(request->status != AT_STATUS_OK || server->rx_received == 0)
+    {
+        link->rx_pending = 0;
+    }
+}
+
+/**
+  * @brief Запрос следующей порции данных в пассивном режиме приема
+  * Одна AT+CIPRECVDATA за раз: прием не может переполнить кольцевой буфер
+  */
+static void ESP_Server_Pull(ESP_ServerTypeDef *server)
+{
+    char command[32];
+
+    if(!server->passive || server->rx_busy)
+        return;
+
+    for(uint8_t n = 1; n <= ESP_LINK_COUNT; n++)
+    {
+        uint8_t i = (server->rx_link + n) % ESP_LINK_COUNT;
+        ESP_LinkTypeDef *link = &server->links[i];
+
+        // Запрос уже принят полностью - остальные данные не нужны
+        if(!link->rx_pending ||
+           (link->state != ESP_LINK_IDLE && link->state != ESP_LINK_RECEIVING))
+            continue;
+
+        snprintf(command, sizeof(command), "AT+CIPRECVDATA=%u,%u", i, ESP_RECV_CHUNK);
+        AT_Request_Init(&server->rx_request, command, "OK", ESP_RECV_TIMEOUT);
+        server->rx_request.done = ESP_Server_OnReceived;
+        server->rx_request.ctx = server;
+        server->rx_link = i;
+        server->rx_requested = ESP_RECV_CHUNK;
+        server->rx_received = 0;
+        server->rx_busy = AT_Engine_Submit(server->engine, &server->rx_request);
+        return;
+    }
+}
+
+/**
+  * @brief Инициализация сервера
+  * @param engine: движок AT команд для AT+CIPSEND/AT+CIPCLOSE
+  * @param handler: обработчик принятых запросов
+  * @param request_pool, response_pool: блоки не меньше ESP_LINK_REQUEST_SIZE
+  *        и ESP_LINK_RESPONSE_SIZE
+  */
+void ESP_Server_Init(ESP_ServerTypeDef *server, AT_EngineTypeDef *engine,
+                     ESP_RequestHandlerTypeDef handler,
+                     MemPoolTypeDef *request_pool, MemPoolTypeDef *response_pool)
+{
+    memset(server, 0, sizeof(*server));
+    server->engine = engine;
+    server->handler = handler;
+    server->request_pool = request_pool;
+    server->response_pool = response_pool;
+    ESP_Server_Reset(server);
+}
+
+/**
+  * @brief Сброс всех соединений (после перезапуска ESP и AT_Engine_Abort)
+  */
+void ESP_Server_Reset(ESP_ServerTypeDef *server)
+{
+    for(uint8_t i = 0; i < ESP_LINK_COUNT; i++)
+    {
+        ESP_LinkTypeDef *link = &server->links[i];
+
+        if(link->state == ESP_LINK_HANDLING)
+        {
+            // Обработчик еще работает с буферами соединения
+            link->peer_closed = 1;
+            continue;
+        }
+        ESP_Link_ReleaseResponse(server, link);
+        ESP_Link_Clear(server, link);
+    }
+    server->tx_busy = 0;
+    server->rx_busy = 0;
+}
+
+/**
+  * @brief Подключение к разборщику ответов ESP
+  */
+void ESP_Server_Attach(ESP_ServerTypeDef *server, AT_ParserTypeDef *parser)
+{
+    AT_Parser_Register(parser, "?,CONNECT", ESP_Server_OnLink, server);
+    AT_Parser_Register(parser, "?,CLOSED", ESP_Server_OnLink, server);
+    AT_Parser_Register(parser, "+IPD,", ESP_Server_OnNotify, server);
+    AT_Parser_SetDataHandler(parser, ESP_Server_OnData, server);
+}
+
+/**
+  * @brief Резервирование link ID под соединение, открытое не сервером
+  * Уведомления и данные этого link ID сервер пропускает
+  */
+void ESP_Server_ReserveLink(ESP_ServerTypeDef *server, uint8_t link_id)
+{
+    server->reserved |= 1U << link_id;
+}
+
+/**
+  * @brief Режим приема ESP: 1 - AT+CIPRECVMODE=1, данные по AT+CIPRECVDATA
+  */
+void ESP_Server_SetPassive(ESP_ServerTypeDef *server, uint8_t passive)
+{
+    server->passive = passive;
+}
+
+/**
+  * @brief Буфер ответа соединения для небольших динамических ответов
+  * Блок выделяется при первом запросе и возвращается в пул после отправки
+  * @retval NULL - пул ответов исчерпан
+  */
+char* ESP_Server_ResponseBuffer(ESP_ServerTypeDef *server, uint8_t link_id, uint32_t *size)
+{
+    ESP_LinkTypeDef *link = &server->links[link_id];
+
+    if(link->response == NULL)
+    {
+        link->response = MemPool_Alloc(server->response_pool);
+    }
+    *size = link->response ? ESP_LINK_RESPONSE_SIZE : 0;
+    return link->response;
+}
+
+/**
+  * @brief Постановка ответа в очередь отправки (из любого потока)
+  * @param data: данные должны оставаться доступными до вызова done
+  * @param length: 0 - закрыть соединение без ответа
+  */
+void ESP_Server_Respond(ESP_ServerTypeDef *server, uint8_t link_id, const char *data,
+                        uint32_t length, ESP_SentTypeDef done, void *ctx)
+{
+    ESP_LinkTypeDef *link = &server->links[link_id];
+    uint8_t accepted = 0;
+
+    // Поток движка не должен увидеть ответ заполненным частично
+    osKernelLock();
+    if(link->state == ESP_LINK_HANDLING)
+    {
+        if(link->peer_closed)
+        {
+            // Клиент ушел, пока формировался ответ
+            ESP_Link_ReleaseResponse(server, link);
+            ESP_Link_Clear(server, link);
+            TRACE(TRACE_HTTP_CLOSE, link_id, 0);
+        }
+        else
+        {
+            // Запрос обработан - блок запроса больше не нужен
+            MemPool_Free(server->request_pool, link->request);
+            link->request = NULL;
+            link->request_length = 0;
+
+            link->tx_data = data;
+            link->tx_length = length;
+            link->tx_offset = 0;
+            link->tx_done = done;
+            link->tx_ctx = ctx;
+            link->tx_start = HAL_GetTick();
+            link->state = (length > 0) ? ESP_LINK_RESPONDING : ESP_LINK_CLOSING;
+            accepted = 1;
+            TRACE(TRACE_HTTP_RESPOND, link_id, (length > 0xFFFF) ? 0xFFFF : length);
+        }
+    }
+    osKernelUnlock();
+
+    if(!accepted && done)
+    {
+        done(ctx);
+    }
+
+    // Пробуждение потока движка
+    osEventFlagsSet(server->engine->event, server->engine->wake_flag);
+}
+
+/**
+  * @brief Обработка принятых запросов, тайм-аутов и очереди отправки
+  * Вызывается в потоке движка AT
+  */
+void ESP_Server_Process(ESP_ServerTypeDef *server)
+{
+    uint32_t now = HAL_GetTick();
+    char command[32];
+
+    for(uint8_t i = 0; i < ESP_LINK_COUNT; i++)
+    {
+        ESP_LinkTypeDef *link = &server->links[i];
+
+        if(link->state == ESP_LINK_READY && link->overflow)
+        {
+            // Остаток запроса не читается, соединение закрывается после ответа
+            server->oversized++;
+            link->state = ESP_LINK_HANDLING;
+            ESP_Server_Respond(server, i, esp_payload_too_large,
+                               sizeof(esp_payload_too_large) - 1, NULL, NULL);
+        }
+        else if(link->state == ESP_LINK_READY)
+        {
+            server->requests++;
+            link->state = ESP_LINK_HANDLING;
+            TRACE(TRACE_HTTP_REQUEST, i, link->request_length);
+            server->handler(i, link->request, link->request_length);
+        }
+        else if(link->state == ESP_LINK_RECEIVING &&
+                (now - link->last_activity) > ESP_LINK_IDLE_TIMEOUT)
+        {
+            // Клиент не дослал запрос
+            link->state = ESP_LINK_CLOSING;
+        }
+    }
+
+    ESP_Server_Pull(server);
+
+    if(server->tx_busy)
+        return;
+
+    // Следующее соединение по кругу: одна порция на соединение за раз,
+    // чтобы медленный клиент не задерживал остальных
+    for(uint8_t n = 1; n <= ESP_LINK_COUNT; n++)
+    {
+        uint8_t i = (server->tx_link + n) % ESP_LINK_COUNT;
+        ESP_LinkTypeDef *link = &server->links[i];
+
+        if(link->state == ESP_LINK_RESPONDING)
+        {
+            server->tx_chunk = link->tx_length - link->tx_offset;
+            if(server->tx_chunk > ESP_SEND_CHUNK)
+            {
+                server->tx_chunk = ESP_SEND_CHUNK;
+            }
+            snprintf(command, sizeof(command), "AT+CIPSEND=%u,%lu",
+                     i, (unsigned long)server->tx_chunk);
+            AT_Request_Init(&server->tx_request, command, "SEND OK", ESP_SEND_TIMEOUT);
+            server->tx_request.data = (const uint8_t*)link->tx_data + link->tx_offset;
+            server->tx_request.data_length = server->tx_chunk;
+        }
+        else if(link->state == ESP_LINK_CLOSING)
+        {
+            snprintf(command, sizeof(command), "AT+CIPCLOSE=%u", i);
+            AT_Request_Init(&server->tx_request, command, "OK", ESP_CLOSE_TIMEOUT);
+        }
+        else
+        {
+            continue;
+        }
+
+        server->tx_request.done = ESP_Server_OnSent;
+        server->tx_request.ctx = server;
+        server->tx_link = i;
+        server->tx_busy = AT_Engine_Submit(server->engine, &server->tx_request);
+        return;
+    }
+}
+
+/**
+  * @brief Есть ли незавершенные операции
+  */
+uint8_t ESP_Server_Busy(ESP_ServerTypeDef *server)
+{
+    if(server->tx_busy || server->rx_busy)
+        return 1;
+
+    for(uint8_t i = 0; i < ESP_LINK_COUNT; i++)
+    {
+        if(server->links[i].state != ESP_LINK_IDLE)
+            return 1;
+    }
+
+    return 0;
+}
+
+/**
+  * @brief Мс до следующего вызова ESP_Server_Process (поток движка)
+  * @retval 0 - есть работа, osWaitForever - только по событию
+  */
+uint32_t ESP_Server_Timeout(ESP_ServerTypeDef *server)
+{
+    uint32_t now = HAL_GetTick();
+    uint32_t timeout = osWaitForever;
+
+    // Команду некуда поставить - работа продолжится после ответа ESP
+    uint8_t can_submit = osMessageQueueGetSpace(server->engine->queue) > 0;
+
+    for(uint8_t i = 0; i < ESP_LINK_COUNT; i++)
+    {
+        ESP_LinkTypeDef *link = &server->links[i];
+
+        if(link->state == ESP_LINK_READY)
+            return 0;
+        if(can_submit && !server->tx_busy &&
+           (link->state == ESP_LINK_RESPONDING || link->state == ESP_LINK_CLOSING))
+            return 0;
+        if(can_submit && server->passive && !server->rx_busy && link->rx_pending &&
+           (link->state == ESP_LINK_IDLE || link->state == ESP_LINK_RECEIVING))
+            return 0;
+
+        if(link->state == ESP_LINK_RECEIVING)
+        {
+            // Тайм-аут незавершенного запроса
+            uint32_t elapsed = now - link->last_activity;
+            uint32_t remaining = (elapsed > ESP_LINK_IDLE_TIMEOUT) ? 0 : ESP_LINK_IDLE_TIMEOUT + 1 - elapsed;
+            if(remaining < timeout)
+            {
+                timeout = remaining;
+            }
+        }
+    }
+
+    return timeout;
+}
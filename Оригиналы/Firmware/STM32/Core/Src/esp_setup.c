@@ -0,0 +1,285 @@
+/*
+ * esp_setup.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// esp_setup.c
+// Настройка ESP через движок AT: запуск после аппаратного сброса,
+// запросы значений, проверка канала UART и повышение скорости обмена,
+// точка доступа и сервер. Команды и форматы ответов - ESP-AT v2.2.1.0
+// (у нее нет AT+CWMODE_CUR и подобных, кроме AT+UART_CUR, сохранение
+// во flash задает AT+SYSSTORE). Доступ к USART6 - через функции платформы,
+// поэтому модуль проверяется с моделью ESP на Linux (Tools/host_tests).
+// Все функции выполняются в потоке движка AT.
+#include "esp_setup.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+  * @brief Инициализация, USART6 на скорости ESP после сброса
+  * @param response_pool: блоки для строк ответа, не меньше 128 байт
+  */
+void ESP_Setup_Init(ESP_SetupTypeDef *setup, AT_EngineTypeDef *engine,
+                    MemPoolTypeDef *response_pool, const ESP_SetupPortTypeDef *port)
+{
+    memset(setup, 0, sizeof(*setup));
+    setup->engine = engine;
+    setup->response_pool = response_pool;
+    setup->port = port;
+    setup->baudrate = ESP_SETUP_DEFAULT_BAUDRATE;
+}
+
+/**
+  * @brief Выполнение AT команды через движок с ожиданием результата
+  * @param cmd: команда без \r\n, NULL - только ожидание строки expected
+  * @param response: строки ответа через '\n', может быть NULL
+  */
+AT_StatusTypeDef ESP_Setup_Command(ESP_SetupTypeDef *setup, const char *cmd, const char *expected,
+                                   uint32_t timeout, char *response, uint32_t size)
+{
+    AT_RequestTypeDef request;
+
+    AT_Request_Init(&request, cmd, expected, timeout);
+    request.response = response;
+    request.response_size = size;
+    return AT_Engine_Execute(setup->engine, &request);
+}
+
+/**
+  * @brief Поиск строки в ответе на команду
+  * @retval Начало найденной строки или NULL
+  */
+const char* ESP_Setup_FindLine(const char *response, const char *prefix)
+{
+    uint32_t prefix_length = strlen(prefix);
+
+    for(const char *line = response; *line; )
+    {
+        if(strncmp(line, prefix, prefix_length) == 0)
+            return line;
+        line = strchr(line, '\n');
+        line = line ? line + 1 : "";
+    }
+
+    return NULL;
+}
+
+/**
+  * @brief Запрос текущего значения настройки ESP
+  * @param prefix: начало строки ответа, value получает остаток строки
+  * @retval 1 - значение получено
+  */
+uint8_t ESP_Setup_Query(ESP_SetupTypeDef *setup, const char *cmd, const char *prefix,
+                        char *value, uint32_t size)
+{
+    char *response = MemPool_Alloc(setup->response_pool);
+    const char *line = NULL;
+
+    if(response == NULL)
+        return 0;
+
+    if(ESP_Setup_Command(setup, cmd, "OK", 1000, response, setup->response_pool->block_size) == AT_STATUS_OK)
+    {
+        line = ESP_Setup_FindLine(response, prefix);
+    }
+    if(line)
+    {
+        line += strlen(prefix);
+        uint32_t length = strcspn(line, "\n");
+        if(length >= size)
+        {
+            length = size - 1;
+        }
+        memcpy(value, line, length);
+        value[length] = '\0';
+    }
+
+    MemPool_Free(setup->response_pool, response);
+    return line != NULL;
+}
+
+/**
+  * @brief Смена скорости USART6 (скорость ESP меняется отдельно)
+  */
+void ESP_Setup_SetBaudrate(ESP_SetupTypeDef *setup, uint32_t baudrate)
+{
+    setup->port->set_baudrate(baudrate);
+    setup->baudrate = baudrate;
+}
+
+/**
+  * @brief Проверка канала: ESP возвращает эхо команды с полным набором символов
+  * @retval 1 - эхо совпало, получен ответ на команду и нет ошибок приема
+  */
+uint8_t ESP_Setup_CheckUart(ESP_SetupTypeDef *setup)
+{
+    char *response = MemPool_Alloc(setup->response_pool);
+    uint32_t errors = setup->port->rx_errors();
+    uint8_t passed = 0;
+
+    if(response == NULL)
+        return 0;
+
+    setup->checks++;
+    if(ESP_Setup_Command(setup, ESP_SETUP_CHECK_PATTERN, "ERROR", 500,
+                         response, setup->response_pool->block_size) == AT_STATUS_OK &&
+       ESP_Setup_FindLine(response, ESP_SETUP_CHECK_PATTERN "\n") != NULL)
+    {
+        passed = ESP_Setup_Command(setup, "AT", "OK", 500, NULL, 0) == AT_STATUS_OK &&
+                 setup->port->rx_errors() == errors;
+    }
+    MemPool_Free(setup->response_pool, response);
+
+    if(!passed)
+    {
+        setup->check_failures++;
+    }
+    return passed;
+}
+
+/**
+  * @brief Повышение скорости обмена с ESP (AT+UART_CUR, без записи во flash ESP)
+  * Выбирается наибольшая скорость, прошедшая проверку. При ошибке ESP
+  * возвращается на исходную скорость; после аппаратного сброса ESP
+  * работает на ESP_SETUP_DEFAULT_BAUDRATE
+  * @param baudrates: скорости по убыванию
+  * @retval Установленная скорость
+  */
+uint32_t ESP_Setup_Negotiate(ESP_SetupTypeDef *setup, const uint32_t *baudrates, uint8_t count)
+{
+    char cmd[48];
+    uint32_t base = setup->baudrate;
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        uint32_t baudrate = baudrates[i];
+
+        if(baudrate <= base)
+            break;
+
+        snprintf(cmd, sizeof(cmd), "AT+UART_CUR=%lu,8,1,0,0", (unsigned long)baudrate);
+        if(ESP_Setup_Command(setup, cmd, "OK", 1000, NULL, 0) != AT_STATUS_OK)
+            continue;
+
+        ESP_Setup_SetBaudrate(setup, baudrate);
+        if(ESP_Setup_CheckUart(setup))
+            break;
+
+        // Скорость не держится: возврат ESP на исходную скорость вслепую
+        snprintf(cmd, sizeof(cmd), "AT+UART_CUR=%lu,8,1,0,0", (unsigned long)base);
+        ESP_Setup_Command(setup, cmd, "OK", 100, NULL, 0);
+        ESP_Setup_SetBaudrate(setup, base);
+
+        if(ESP_Setup_Command(setup, "AT", "OK", 1000, NULL, 0) != AT_STATUS_OK)
+        {
+            // Связь потеряна - дальнейшая инициализация покажет ошибку
+            break;
+        }
+    }
+
+    return setup->baudrate;
+}
+
+/**
+  * @brief Режим и параметры точки доступа, меняются только при отличии
+  * Настройки действуют до сброса ESP: AT+SYSSTORE=0 отключает запись во
+  * flash, поэтому запуск не изнашивает flash ESP
+  * @param ap_config: "<ssid>","<pwd>",<chl>,<ecn>
+  * @param ap_ip: "<ip>" в кавычках
+  * @retval 1 - точка доступа настроена
+  */
+uint8_t ESP_Setup_AccessPoint(ESP_SetupTypeDef *setup, const char *ap_config, const char *ap_ip)
+{
+    char command[96];
+    char value[96];
+    uint32_t length = strlen(ap_config);
+
+    if(ESP_Setup_Command(setup, "AT+SYSSTORE=0", "OK", 1000, NULL, 0) != AT_STATUS_OK)
+        return 0;
+
+    // Режим (1=Station, 2=AP, 3=Both): ответ +CWMODE:<mode>
+    if(!ESP_Setup_Query(setup, "AT+CWMODE?", "+CWMODE:", value, sizeof(value)) ||
+       strcmp(value, "2") != 0)
+    {
+        setup->changes++;
+        if(ESP_Setup_Command(setup, "AT+CWMODE=2", "OK", 2000, NULL, 0) != AT_STATUS_OK)
+            return 0;
+    }
+
+    // Точка доступа: ответ +CWSAP:"<ssid>","<pwd>",<chl>,<ecn>,<max conn>,<ssid hidden>
+    if(!ESP_Setup_Query(setup, "AT+CWSAP?", "+CWSAP:", value, sizeof(value)) ||
+       strncmp(value, ap_config, length) != 0 || value[length] != ',')
+    {
+        setup->changes++;
+        snprintf(command, sizeof(command), "AT+CWSAP=%s", ap_config);
+        if(ESP_Setup_Command(setup, command, "OK", 5000, NULL, 0) != AT_STATUS_OK)
+            return 0;
+    }
+
+    // Адрес: первая строка ответа +CIPAP:ip:"<ip>", затем gateway и netmask
+    if(!ESP_Setup_Query(setup, "AT+CIPAP?", "+CIPAP:ip:", value, sizeof(value)) ||
+       strcmp(value, ap_ip) != 0)
+    {
+        setup->changes++;
+        snprintf(command, sizeof(command), "AT+CIPAP=%s", ap_ip);
+        ESP_Setup_Command(setup, command, "OK", 2000, NULL, 0);
+    }
+
+    return 1;
+}
+
+/**
+  * @brief Запуск ESP после аппаратного сброса: загрузка, скорость обмена,
+  *        точка доступа и веб-сервер
+  * USART6 должен работать на ESP_SETUP_DEFAULT_BAUDRATE
+  * @retval 1 - сервер запущен
+  */
+uint8_t ESP_Setup_Start(ESP_SetupTypeDef *setup, const ESP_SetupConfigTypeDef *config)
+{
+    uint32_t start = osKernelGetTickCount();
+    char command[48];
+    uint8_t retry;
+
+    // Загрузка модуля по уведомлению "ready" вместо фиксированной паузы
+    ESP_Setup_Command(setup, NULL, "ready", ESP_SETUP_BOOT_TIMEOUT, NULL, 0);
+    setup->boot_ms = osKernelGetTickCount() - start;
+
+    // Проверка связи (попытки)
+    for(retry = 0; retry < ESP_SETUP_RETRIES; retry++)
+    {
+        if(ESP_Setup_Command(setup, "AT", "OK", 500, NULL, 0) == AT_STATUS_OK)
+            break;
+        osDelay(100);
+    }
+    if(retry >= ESP_SETUP_RETRIES)
+        return 0;
+
+    ESP_Setup_Negotiate(setup, config->baudrates, config->baudrate_count);
+
+    if(!ESP_Setup_AccessPoint(setup, config->ap_config, config->ap_ip))
+        return 0;
+
+    // Множественные подключения и адрес клиента в +IPD
+    // (после сброса всегда выключены, запрос не нужен)
+    ESP_Setup_Command(setup, "AT+CIPMUX=1", "OK", 1000, NULL, 0);
+    setup->remote_info = ESP_Setup_Command(setup, "AT+CIPDINFO=1", "OK", 1000, NULL, 0) == AT_STATUS_OK;
+
+    // Пассивный прием: данные соединений остаются в ESP, пока сервер
+    // не заберет их AT+CIPRECVDATA. Без поддержки - активный прием +IPD
+    setup->passive = ESP_Setup_Command(setup, "AT+CIPRECVMODE=1", "OK", 1000, NULL, 0) == AT_STATUS_OK;
+
+    if(config->max_connections > 0)
+    {
+        snprintf(command, sizeof(command), "AT+CIPSERVERMAXCONN=%u", config->max_connections);
+        ESP_Setup_Command(setup, command, "OK", 1000, NULL, 0);
+    }
+    snprintf(command, sizeof(command), "AT+CIPSERVER=1,%u", config->server_port);
+    if(ESP_Setup_Command(setup, command, "OK", 2000, NULL, 0) != AT_STATUS_OK)
+        return 0;
+
+    snprintf(command, sizeof(command), "AT+CIPSTO=%u", config->server_timeout);
+    ESP_Setup_Command(setup, command, "OK", 1000, NULL, 0);
+    return 1;
+}
@@ -0,0 +1,382 @@
+/*
+ * flash_log.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// flash_log.c
+// Журнал записей во flash только на добавление. Секторы заполняются по
+// кругу, поэтому стирания распределяются между ними равномерно. Записи
+// копятся в RAM и программируются пачкой. При запуске по заголовкам
+// секторов и бинарному поиску строится индекс: для каждого сектора
+// количество записей и диапазон времени. Все функции вызываются из
+// одного потока.
+#include "flash_log.h"
+#include "crc32.h"
+#include <stddef.h>
+#include <string.h>
+
+#define FLASH_LOG_ERASED 0xFFFFFFFFUL
+
+static const FlashLog_HeaderTypeDef* FlashLog_Header(FlashLogTypeDef *log, uint8_t sector)
+{
+    return (const FlashLog_HeaderTypeDef*)(log->port->base + sector * log->port->sector_size);
+}
+
+static const FlashLog_RecordTypeDef* FlashLog_Record(FlashLogTypeDef *log, uint8_t sector,
+                                                     uint32_t record)
+{
+    return (const FlashLog_RecordTypeDef*)(log->port->base + sector * log->port->sector_size +
+                                           sizeof(FlashLog_HeaderTypeDef) +
+                                           record * sizeof(FlashLog_RecordTypeDef));
+}
+
+static uint8_t FlashLog_RecordErased(const FlashLog_RecordTypeDef *record)
+{
+    const uint32_t *words = (const uint32_t*)record;
+
+    for(uint32_t i = 0; i < sizeof(*record) / sizeof(uint32_t); i++)
+    {
+        if(words[i] != FLASH_LOG_ERASED)
+            return 0;
+    }
+    return 1;
+}
+
+static uint8_t FlashLog_RecordValid(const FlashLog_RecordTypeDef *record)
+{
+    return record->crc == CRC32_Compute(record, offsetof(FlashLog_RecordTypeDef, crc));
+}
+
+/**
+  * @brief Время записи для поиска
+  * У записи, прерванной отключением питания, время может быть любым:
+  * берется время предыдущей целой записи, 0 - целых записей до нее нет
+  */
+static uint32_t FlashLog_Time(FlashLogTypeDef *log, uint8_t sector, uint32_t record)
+{
+    for(;;)
+    {
+        const FlashLog_RecordTypeDef *entry = FlashLog_Record(log, sector, record);
+
+        if(FlashLog_RecordValid(entry))
+            return entry->timestamp;
+        if(record == 0)
+            return 0;
+        record--;
+    }
+}
+
+/**
+  * @brief Количество записанных записей сектора (бинарный поиск первой стертой)
+  */
+static uint32_t FlashLog_ScanCount(FlashLogTypeDef *log, uint8_t sector)
+{
+    uint32_t low = 0;
+    uint32_t high = log->records_per_sector;
+
+    while(low < high)
+    {
+        uint32_t middle = low + (high - low) / 2;
+
+        if(FlashLog_RecordErased(FlashLog_Record(log, sector, middle)))
+        {
+            high = middle;
+        }
+        else
+        {
+            low = middle + 1;
+        }
+    }
+
+    return low;
+}
+
+/**
+  * @brief Порядок секторов от старого к новому
+  */
+static void FlashLog_Sort(FlashLogTypeDef *log)
+{
+    log->order_count = 0;
+
+    for(uint8_t s = 0; s < log->port->sector_count; s++)
+    {
+        if(!log->sectors[s].valid)
+            continue;
+
+        uint8_t i = log->order_count++;
+        while(i > 0 && log->sectors[log->order[i - 1]].sequence > log->sectors[s].sequence)
+        {
+            log->order[i] = log->order[i - 1];
+            i--;
+        }
+        log->order[i] = s;
+    }
+}
+
+/**
+  * @brief Стирание сектора и запись заголовка
+  * Стирание сектора 128 КБ занимает около секунды, все это время
+  * выполнение из flash остановлено
+  */
+static uint8_t FlashLog_Activate(FlashLogTypeDef *log, uint8_t sector, uint32_t sequence)
+{
+    FlashLog_SectorTypeDef *info = &log->sectors[sector];
+    FlashLog_HeaderTypeDef header = {
+        .magic = FLASH_LOG_MAGIC,
+        .sequence = sequence,
+        .erase_count = info->erase_count + 1
+    };
+    header.crc = CRC32_Compute(&header, offsetof(FlashLog_HeaderTypeDef, crc));
+
+    if(info->valid)
+    {
+        log->records -= info->count;
+    }
+    memset(info, 0, sizeof(*info));
+    info->erase_count = header.erase_count;
+
+    log->erases++;
+    if(!log->port->erase(sector) ||
+       !log->port->program(sector * log->port->sector_size, (const uint32_t*)&header,
+                           sizeof(header) / sizeof(uint32_t)))
+    {
+        log->errors++;
+        FlashLog_Sort(log);
+        return 0;
+    }
+
+    info->valid = 1;
+    info->sequence = sequence;
+    log->active = sector;
+    FlashLog_Sort(log);
+    return 1;
+}
+
+/**
+  * @brief Построение индекса по содержимому flash
+  */
+void FlashLog_Init(FlashLogTypeDef *log, const FlashLog_PortTypeDef *port)
+{
+    memset(log, 0, sizeof(*log));
+    log->port = port;
+    log->records_per_sector = (port->sector_size - sizeof(FlashLog_HeaderTypeDef)) /
+                              sizeof(FlashLog_RecordTypeDef);
+
+    for(uint8_t s = 0; s < port->sector_count; s++)
+    {
+        const FlashLog_HeaderTypeDef *header = FlashLog_Header(log, s);
+        FlashLog_SectorTypeDef *info = &log->sectors[s];
+
+        if(header->magic != FLASH_LOG_MAGIC ||
+           header->crc != CRC32_Compute(header, offsetof(FlashLog_HeaderTypeDef, crc)))
+            continue;
+
+        info->valid = 1;
+        info->sequence = header->sequence;
+        info->erase_count = header->erase_count;
+        info->count = FlashLog_ScanCount(log, s);
+        for(uint32_t i = 0; i < info->count; i++)
+        {
+            // Первая целая запись сектора
+            if(FlashLog_RecordValid(FlashLog_Record(log, s, i)))
+            {
+                info->first_time = FlashLog_Record(log, s, i)->timestamp;
+                break;
+            }
+        }
+        if(info->count > 0)
+        {
+            info->last_time = FlashLog_Time(log, s, info->count - 1);
+        }
+        log->records += info->count;
+    }
+
+    FlashLog_Sort(log);
+
+    if(log->order_count == 0)
+    {
+        // Пустая или чужая область - начинаем с первого сектора
+        FlashLog_Activate(log, 0, 1);
+        return;
+    }
+
+    log->active = log->order[log->order_count - 1];
+}
+
+/**
+  * @brief Добавление записи в буфер RAM, при заполнении - запись во flash
+  * @param data: FLASH_LOG_DATA_SIZE байт
+  */
+void FlashLog_Append(FlashLogTypeDef *log, uint32_t timestamp, const void *data)
+{
+    FlashLog_RecordTypeDef *record = &log->buffer[log->buffered++];
+
+    record->timestamp = timestamp;
+    memcpy(record->data, data, FLASH_LOG_DATA_SIZE);
+    record->crc = CRC32_Compute(record, offsetof(FlashLog_RecordTypeDef, crc));
+
+    if(log->buffered >= FLASH_LOG_BATCH_RECORDS)
+    {
+        FlashLog_Flush(log);
+    }
+}
+
+/**
+  * @brief Программирование буферизованных записей
+  * @retval 1 - успешно, 0 - ошибка flash (записи отброшены)
+  */
+uint8_t FlashLog_Flush(FlashLogTypeDef *log)
+{
+    uint8_t written = 0;
+    uint8_t result = 1;
+
+    while(written < log->buffered)
+    {
+        FlashLog_SectorTypeDef *info = &log->sectors[log->active];
+
+        if(!info->valid || info->count >= log->records_per_sector)
+        {
+            // Следующий сектор по кругу, самые старые записи теряются
+            uint8_t next = (log->active + 1) % log->port->sector_count;
+            uint32_t sequence = log->order_count ?
+                                log->sectors[log->order[log->order_count - 1]].sequence + 1 : 1;
+            if(!FlashLog_Activate(log, next, sequence))
+            {
+                result = 0;
+                break;
+            }
+            continue;
+        }
+
+        uint32_t count = log->buffered - written;
+        if(count > log->records_per_sector - info->count)
+        {
+            count = log->records_per_sector - info->count;
+        }
+
+        uint32_t offset = (const uint8_t*)FlashLog_Record(log, log->active, info->count) -
+                          log->port->base;
+        if(!log->port->program(offset, (const uint32_t*)&log->buffer[written],
+                               count * sizeof(FlashLog_RecordTypeDef) / sizeof(uint32_t)))
+        {
+            // Частично записанная пачка отбрасывается проверкой CRC при чтении
+            log->errors++;
+            info->count = FlashLog_ScanCount(log, log->active);
+            result = 0;
+            break;
+        }
+
+        if(info->count == 0)
+        {
+            info->first_time = log->buffer[written].timestamp;
+        }
+        info->count += count;
+        info->last_time = log->buffer[written + count - 1].timestamp;
+        log->records += count;
+        written += count;
+    }
+
+    log->buffered = 0;
+    log->flushes++;
+    return result;
+}
+
+/**
+  * @brief Позиция первой записи со временем не раньше timestamp
+  * Время записей внутри журнала считается неубывающим
+  * @retval 1 - запись найдена, 0 - все записи раньше timestamp
+  */
+uint8_t FlashLog_Seek(FlashLogTypeDef *log, uint32_t timestamp, FlashLog_CursorTypeDef *cursor)
+{
+    for(uint8_t i = 0; i < log->order_count; i++)
+    {
+        uint8_t sector = log->order[i];
+        FlashLog_SectorTypeDef *info = &log->sectors[sector];
+
+        if(info->count == 0 || info->last_time < timestamp)
+            continue;
+
+        uint32_t low = 0;
+        uint32_t high = info->count;
+        while(low < high)
+        {
+            uint32_t middle = low + (high - low) / 2;
+
+            if(FlashLog_Time(log, sector, middle) < timestamp)
+            {
+                low = middle + 1;
+            }
+            else
+            {
+                high = middle;
+            }
+        }
+
+        cursor->order = i;
+        cursor->record = low;
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+  * @brief Позиция count-й записи с конца журнала (или самой старой)
+  * @retval 1 - журнал не пуст
+  */
+uint8_t FlashLog_SeekLast(FlashLogTypeDef *log, uint32_t count, FlashLog_CursorTypeDef *cursor)
+{
+    cursor->order = 0;
+    cursor->record = 0;
+
+    for(uint8_t i = log->order_count; i > 0; i--)
+    {
+        uint32_t sector_count = log->sectors[log->order[i - 1]].count;
+
+        if(count <= sector_count)
+        {
+            cursor->order = i - 1;
+            cursor->record = sector_count - count;
+            break;
+        }
+        count -= sector_count;
+    }
+
+    return log->records > 0;
+}
+
+/**
+  * @brief Чтение записи и переход к следующей, поврежденные записи пропускаются
+  * @param data: FLASH_LOG_DATA_SIZE байт
+  * @retval 1 - запись прочитана, 0 - конец журнала
+  */
+uint8_t FlashLog_Next(FlashLogTypeDef *log, FlashLog_CursorTypeDef *cursor,
+                      uint32_t *timestamp, void *data)
+{
+    while(cursor->order < log->order_count)
+    {
+        uint8_t sector = log->order[cursor->order];
+
+        if(cursor->record >= log->sectors[sector].count)
+        {
+            cursor->order++;
+            cursor->record = 0;
+            continue;
+        }
+
+        const FlashLog_RecordTypeDef *record = FlashLog_Record(log, sector, cursor->record++);
+        if(!FlashLog_RecordValid(record))
+        {
+            log->crc_errors++;
+            continue;
+        }
+
+        *timestamp = record->timestamp;
+        memcpy(data, record->data, FLASH_LOG_DATA_SIZE);
+        return 1;
+    }
+
+    return 0;
+}
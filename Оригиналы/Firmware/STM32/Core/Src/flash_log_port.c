@@ -0,0 +1,50 @@
+/*
+ * flash_log_port.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// flash_log_port.c
+// Доступ журнала к внутренней flash STM32F405 через HAL
+#include "flash_log_port.h"
+
+static uint8_t FlashLogPort_Erase(uint8_t sector)
+{
+    FLASH_EraseInitTypeDef erase = {
+        .TypeErase = FLASH_TYPEERASE_SECTORS,
+        .Sector = FLASH_LOG_FIRST_SECTOR + sector,
+        .NbSectors = 1,
+        .VoltageRange = FLASH_VOLTAGE_RANGE_3
+    };
+    uint32_t sector_error;
+
+    HAL_FLASH_Unlock();
+    HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&erase, &sector_error);
+    HAL_FLASH_Lock();
+
+    return status == HAL_OK;
+}
+
+static uint8_t FlashLogPort_Program(uint32_t offset, const uint32_t *words, uint32_t count)
+{
+    HAL_StatusTypeDef status = HAL_OK;
+
+    // Одна разблокировка на всю пачку
+    HAL_FLASH_Unlock();
+    for(uint32_t i = 0; i < count && status == HAL_OK; i++)
+    {
+        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, FLASH_LOG_BASE + offset + i * 4, words[i]);
+    }
+    HAL_FLASH_Lock();
+
+    return status == HAL_OK;
+}
+
+const FlashLog_PortTypeDef flash_log_port = {
+    .base = (const uint8_t*)FLASH_LOG_BASE,
+    .sector_size = FLASH_LOG_SECTOR_SIZE,
+    .sector_count = FLASH_LOG_SECTOR_COUNT,
+    .erase = FlashLogPort_Erase,
+    .program = FlashLogPort_Program
+};
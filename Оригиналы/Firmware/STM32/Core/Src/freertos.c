@@ -44,6 +44,11 @@
 
 /* Private variables ---------------------------------------------------------*/
 /* USER CODE BEGIN Variables */
+// Куча только у процессора, передачи DMA из нее не выполняются
+uint8_t ucHeap[configTOTAL_HEAP_SIZE] CCMRAM;
+
+// Поток, переполнивший стек (для отладчика после остановки в Error_Handler)
+volatile const char *stack_overflow_task = NULL;
 
 /* USER CODE END Variables */
 
@@ -52,6 +57,37 @@
 
 /* USER CODE END FunctionPrototypes */
 
+/* Hook prototypes */
+void configureTimerForRunTimeStats(void);
+unsigned long getRunTimeCounterValue(void);
+void vApplicationStackOverflowHook(TaskHandle_t xTask, char *pcTaskName);
+
+/* USER CODE BEGIN 1 */
+/* Functions needed when configGENERATE_RUN_TIME_STATS is on */
+void configureTimerForRunTimeStats(void)
+{
+  // Счетчик тактов уже запущен в main, повторное включение не сбрасывает его
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+unsigned long getRunTimeCounterValue(void)
+{
+  // Вызывается при каждом переключении потоков: одно чтение регистра
+  return DWT->CYCCNT;
+}
+/* USER CODE END 1 */
+
+/* USER CODE BEGIN 4 */
+void vApplicationStackOverflowHook(TaskHandle_t xTask, char *pcTaskName)
+{
+  // Стек уже испорчен, продолжать работу нельзя: останов до сброса сторожевым таймером
+  (void)xTask;
+  stack_overflow_task = pcTaskName;
+  Error_Handler();
+}
+/* USER CODE END 4 */
+
 /* Private application code --------------------------------------------------*/
 /* USER CODE BEGIN Application */
 
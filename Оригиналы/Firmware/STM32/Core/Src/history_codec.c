@@ -0,0 +1,185 @@
+/*
+ * history_codec.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// history_codec.c
+// Сжатие истории блоками. Показания меняются медленно: при постоянном
+// интервале записи и изменении на несколько десятых показание занимает
+// один байт вместо двенадцати.
+#include "history_codec.h"
+#include <string.h>
+
+#define CODEC_LONG_FORM 0x80
+#define CODEC_SAMPLE_MAX 16  // Длинная форма: маркер и три varint
+
+static uint32_t Codec_ZigZag(int32_t value)
+{
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t Codec_UnZigZag(uint32_t value)
+{
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static uint8_t Codec_PutVarint(uint8_t *data, uint32_t value)
+{
+    uint8_t length = 0;
+
+    while(value >= 0x80)
+    {
+        data[length++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    data[length++] = (uint8_t)value;
+    return length;
+}
+
+static uint8_t Codec_GetVarint(const Codec_BlockTypeDef *block, uint16_t *position, uint32_t *value)
+{
+    uint32_t result = 0;
+
+    for(uint8_t shift = 0; shift < 35 && *position < block->length; shift += 7)
+    {
+        uint8_t byte = block->data[(*position)++];
+
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if(!(byte & 0x80))
+        {
+            *value = result;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+  * @brief Значение в десятых долях с округлением
+  */
+int16_t Codec_Fixed(float value)
+{
+    return (int16_t)(value * CODEC_SCALE + (value < 0.0f ? -0.5f : 0.5f));
+}
+
+/**
+  * @brief Начало нового блока
+  */
+void Codec_Reset(Codec_EncoderTypeDef *encoder)
+{
+    memset(encoder, 0, sizeof(*encoder));
+}
+
+/**
+  * @brief Добавление показания в текущий блок
+  * @param value: CODEC_CHANNELS значений в десятых долях
+  * @retval 1 - добавлено, 0 - блок заполнен (нужен Codec_Reset)
+  */
+uint8_t Codec_Append(Codec_EncoderTypeDef *encoder, uint32_t time, const int16_t *value)
+{
+    Codec_BlockTypeDef *block = &encoder->block;
+
+    if(block->count == 0)
+    {
+        block->first_time = time;
+        memcpy(block->first_value, value, sizeof(block->first_value));
+    }
+    else
+    {
+        uint8_t sample[CODEC_SAMPLE_MAX];
+        uint8_t length = 0;
+        // Разности времени - по модулю 2^32: перевод часов на любую
+        // величину кодируется без переполнения int32
+        int32_t delta = (int32_t)(time - encoder->last_time);
+        uint32_t dod = Codec_ZigZag((int32_t)((uint32_t)delta - (uint32_t)encoder->last_delta));
+        uint32_t d0 = Codec_ZigZag(value[0] - encoder->last_value[0]);
+        uint32_t d1 = Codec_ZigZag(value[1] - encoder->last_value[1]);
+
+        if(dod == 0 && d0 < 16 && d1 < 8)
+        {
+            sample[length++] = (uint8_t)((d0 << 3) | d1);
+        }
+        else
+        {
+            sample[length++] = CODEC_LONG_FORM;
+            length += Codec_PutVarint(sample + length, dod);
+            length += Codec_PutVarint(sample + length, d0);
+            length += Codec_PutVarint(sample + length, d1);
+        }
+
+        if(block->length + length > CODEC_BLOCK_DATA)
+            return 0;
+
+        memcpy(block->data + block->length, sample, length);
+        block->length += length;
+        encoder->last_delta = delta;
+    }
+
+    encoder->last_time = time;
+    memcpy(encoder->last_value, value, sizeof(encoder->last_value));
+    block->count++;
+    return 1;
+}
+
+/**
+  * @brief Начало чтения блока
+  */
+void Codec_DecoderInit(Codec_DecoderTypeDef *decoder, const Codec_BlockTypeDef *block)
+{
+    memset(decoder, 0, sizeof(*decoder));
+    decoder->block = block;
+}
+
+/**
+  * @brief Следующее показание блока
+  * @retval 1 - показание прочитано, 0 - конец блока или данные повреждены
+  */
+uint8_t Codec_Next(Codec_DecoderTypeDef *decoder, uint32_t *time, int16_t *value)
+{
+    const Codec_BlockTypeDef *block = decoder->block;
+
+    if(decoder->index >= block->count)
+        return 0;
+
+    if(decoder->index == 0)
+    {
+        decoder->time = block->first_time;
+        memcpy(decoder->value, block->first_value, sizeof(decoder->value));
+    }
+    else
+    {
+        uint32_t dod = 0;
+        uint32_t d[CODEC_CHANNELS];
+
+        if(decoder->position >= block->length)
+            return 0;
+
+        uint8_t byte = block->data[decoder->position++];
+        if(byte & CODEC_LONG_FORM)
+        {
+            if(!Codec_GetVarint(block, &decoder->position, &dod) ||
+               !Codec_GetVarint(block, &decoder->position, &d[0]) ||
+               !Codec_GetVarint(block, &decoder->position, &d[1]))
+                return 0;
+        }
+        else
+        {
+            d[0] = byte >> 3;
+            d[1] = byte & 0x07;
+        }
+
+        decoder->delta = (int32_t)((uint32_t)decoder->delta + (uint32_t)Codec_UnZigZag(dod));
+        decoder->time += (uint32_t)decoder->delta;
+        for(uint8_t c = 0; c < CODEC_CHANNELS; c++)
+        {
+            decoder->value[c] = (int16_t)(decoder->value[c] + Codec_UnZigZag(d[c]));
+        }
+    }
+
+    decoder->index++;
+    *time = decoder->time;
+    memcpy(value, decoder->value, sizeof(decoder->value));
+    return 1;
+}
@@ -0,0 +1,115 @@
+/*
+ * http_cache.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// http_cache.c
+// Кэш готовых HTTP ответов. Каждый ответ помнит версии данных, из которых
+// он сформирован, и перерисовывается только после их изменения.
+#include "http_cache.h"
+
+// Версии источников данных, увеличиваются при каждом изменении
+static volatile uint32_t http_state_version[HTTP_STATE_COUNT];
+
+/**
+  * @brief Инициализация записи кэша
+  * @param buffer: буфер под заголовки и тело ответа
+  * @param deps: маска источников данных HTTP_DEP(...)
+  */
+void HTTP_Cache_Init(HTTP_CacheEntryTypeDef *entry, char *buffer, uint32_t size,
+                     uint32_t deps, HTTP_RenderTypeDef render)
+{
+    entry->buffer = buffer;
+    entry->size = size;
+    entry->length = 0;
+    entry->deps = deps;
+    entry->render = render;
+    entry->readers = 0;
+    entry->hits = 0;
+    entry->misses = 0;
+    entry->stale_hits = 0;
+    entry->hit_cycles = 0;
+    entry->miss_cycles = 0;
+}
+
+/**
+  * @brief Получение ответа из кэша с перерисовкой при устаревании
+  * @param length: длина ответа
+  * @retval Указатель на ответ внутри буфера кэша, после отправки
+  *         нужно вызвать HTTP_Cache_Release
+  * Вызывается из одного потока (веб-сервер), Release - из любого
+  */
+const char* HTTP_Cache_Get(HTTP_CacheEntryTypeDef *entry, uint32_t *length)
+{
+    uint32_t start = DWT->CYCCNT;
+    uint32_t versions[HTTP_STATE_COUNT];
+    uint8_t stale = (entry->length == 0);
+
+    // Версии снимаются до рендера: изменение во время рендера
+    // приведет к повторной перерисовке при следующем запросе
+    for(uint32_t i = 0; i < HTTP_STATE_COUNT; i++)
+    {
+        versions[i] = __atomic_load_n(&http_state_version[i], __ATOMIC_ACQUIRE);
+        if((entry->deps & HTTP_DEP(i)) && versions[i] != entry->versions[i])
+        {
+            stale = 1;
+        }
+    }
+
+    // Буфер перерисовывается, только если его никто не отправляет:
+    // проверка и захват - одна операция, readers уменьшает поток движка AT
+    uint32_t idle = 0;
+    if(stale && __atomic_compare_exchange_n(&entry->readers, &idle, 1, 0,
+                                            __ATOMIC_ACQUIRE, __ATOMIC_RELAXED))
+    {
+        entry->length = entry->render(entry->buffer, entry->size);
+        for(uint32_t i = 0; i < HTTP_STATE_COUNT; i++)
+        {
+            entry->versions[i] = versions[i];
+        }
+        entry->misses++;
+        entry->miss_cycles += DWT->CYCCNT - start;
+    }
+    else
+    {
+        // Ответ свежий или буфер еще отправляется другому клиенту -
+        // тогда перерисовка откладывается до следующего запроса
+        __atomic_fetch_add(&entry->readers, 1, __ATOMIC_ACQUIRE);
+        if(stale)
+        {
+            entry->stale_hits++;
+        }
+        else
+        {
+            entry->hits++;
+        }
+        entry->hit_cycles += DWT->CYCCNT - start;
+    }
+
+    *length = entry->length;
+    return entry->buffer;
+}
+
+/**
+  * @brief Завершение отправки ответа, полученного через HTTP_Cache_Get
+  */
+void HTTP_Cache_Release(HTTP_CacheEntryTypeDef *entry)
+{
+    uint32_t readers = __atomic_load_n(&entry->readers, __ATOMIC_RELAXED);
+
+    while(readers > 0 &&
+          !__atomic_compare_exchange_n(&entry->readers, &readers, readers - 1, 1,
+                                       __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+/**
+  * @brief Отметка об изменении источника данных (можно вызывать из любого потока)
+  */
+void HTTP_Cache_Touch(HTTP_StateTypeDef state)
+{
+    __atomic_fetch_add(&http_state_version[state], 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,103 @@
+/*
+ * lttb.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// lttb.c
+// Прореживание временного ряда методом Largest-Triangle-Three-Buckets.
+// Вся арифметика целочисленная: границы корзин в формате Q16,
+// площади треугольников в int64 без деления.
+#include "lttb.h"
+
+// Начало корзины номер bucket (внутренние точки 1..count-2)
+static uint32_t LTTB_BucketStart(uint32_t bucket, uint32_t step)
+{
+    return 1 + (uint32_t)(((uint64_t)bucket * step) >> 16);
+}
+
+/**
+  * @brief Выбор threshold опорных точек из count исходных
+  * @param selected: массив не менее чем на threshold индексов
+  * @retval Количество выбранных точек
+  */
+uint32_t LTTB_Downsample(LTTB_SourceTypeDef source, void *ctx, uint32_t count,
+                         uint32_t threshold, uint32_t *selected)
+{
+    // Прореживать нечего - отдаем ряд целиком
+    if(threshold >= count || count <= 2)
+    {
+        for(uint32_t i = 0; i < count; i++)
+        {
+            selected[i] = i;
+        }
+        return count;
+    }
+
+    if(threshold < 3)
+        threshold = 3;
+
+    // Размер корзины в Q16
+    uint32_t buckets = threshold - 2;
+    uint32_t step = (uint32_t)(((uint64_t)(count - 2) << 16) / buckets);
+
+    // Первая точка выбирается всегда
+    uint32_t out = 0;
+    selected[out++] = 0;
+    LTTB_PointTypeDef a = source(ctx, 0);
+
+    for(uint32_t bucket = 0; bucket < buckets; bucket++)
+    {
+        uint32_t start = LTTB_BucketStart(bucket, step);
+        uint32_t end = (bucket == buckets - 1) ? count - 1 : LTTB_BucketStart(bucket + 1, step);
+
+        // Средняя точка следующей корзины (для последней - последняя точка ряда)
+        uint32_t next_start = end;
+        uint32_t next_end = (bucket + 1 >= buckets - 1) ? count - 1 : LTTB_BucketStart(bucket + 2, step);
+        if(bucket == buckets - 1)
+            next_end = count;
+        else if(next_end <= next_start)
+            next_end = next_start + 1;
+
+        int64_t sum_x = 0;
+        int64_t sum_y = 0;
+        for(uint32_t i = next_start; i < next_end; i++)
+        {
+            LTTB_PointTypeDef p = source(ctx, i);
+            sum_x += p.x;
+            sum_y += p.y;
+        }
+        int64_t n = next_end - next_start;
+        int64_t cx = sum_x / n;
+        int64_t cy = sum_y / n;
+
+        // Точка текущей корзины с максимальной площадью треугольника
+        int64_t best_area = -1;
+        uint32_t best_index = start;
+        LTTB_PointTypeDef best = a;
+        for(uint32_t i = start; i < end; i++)
+        {
+            LTTB_PointTypeDef p = source(ctx, i);
+            int64_t area = ((int64_t)a.x - cx) * ((int64_t)p.y - a.y) -
+                           ((int64_t)a.x - p.x) * (cy - a.y);
+            if(area < 0)
+                area = -area;
+
+            if(area > best_area)
+            {
+                best_area = area;
+                best_index = i;
+                best = p;
+            }
+        }
+
+        selected[out++] = best_index;
+        a = best;
+    }
+
+    // Последняя точка выбирается всегда
+    selected[out++] = count - 1;
+
+    return out;
+}
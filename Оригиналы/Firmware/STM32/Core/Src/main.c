@@ -22,15 +22,38 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* USER CODE BEGIN Includes */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "pid.h"  // Для ПИД регуляторов
+#include "lttb.h" // Для прореживания истории
+#include "http_cache.h" // Для кэша HTTP ответов
+#include "at_parser.h" // Для разбора ответов ESP
+#include "at_engine.h" // Для очереди AT команд
+#include "esp_server.h" // Для соединений клиентов ESP
+#include "esp_setup.h" // Для настройки ESP и скорости обмена
+#include "mqtt_client.h" // Для публикации показаний на брокер
+#include "udp_beacon.h" // Для UDP маяка телеметрии
+#include "ring_buffer.h" // Для хранения истории
+#include "flash_log.h" // Для журнала истории во flash
+#include "rollup.h" // Для многоуровневой истории
+#include "history_codec.h" // Для сжатия истории
+#include "settings_store.h" // Для сохранения настроек
+#include "stats.h" // Для статистики стабильности
+#include "flash_log_port.h"
+#include "timers.h" // Для запаса стека службы таймеров
+#include "task_stats.h" // Для загрузки процессора по потокам
+#include "mem_pool.h" // Для пулов буферов сети
+#include "trace.h" // Для журнала трассировки
 /* USER CODE END Includes */
 
 /* Private typedef -----------------------------------------------------------*/
+typedef StaticTask_t osStaticThreadDef_t;
 /* USER CODE BEGIN PTD */
 typedef struct {
     float temperature;
     float humidity;
-    uint32_t timestamp;
+    uint32_t timestamp; // Секунды от 2000-01-01 00:00:00 (эпоха RTC)
 } SensorData;
 
 typedef struct {
@@ -39,6 +62,8 @@ typedef struct {
     uint8_t auto_mode;
     uint8_t heating_enabled;
     uint8_t humidification_enabled;
+    float pid_gains[2][3];   // Kp, Ki, Kd: [0] - температура, [1] - влажность
+    float sensor_offset[2];  // Калибровка: поправка к температуре и влажности
 } SystemSettings;
 
 typedef enum {
@@ -47,11 +72,124 @@ typedef enum {
     HUM_STATUS_RUNNING,
     HUM_STATUS_SERVICE
 } HumidifierStatus;
+
+// Принятый HTTP запрос, передается из потока движка AT в поток веб-интерфейса
+typedef struct {
+    uint8_t link_id;
+    char *request;   // Блок пула запросов, принадлежит обработчику до ответа
+    uint32_t length;
+} WebRequest;
+
+// Изменения настроек из веб-интерфейса. Поля с установленным битом в mask
+// заменяют текущие значения; более поздние изменения того же поля
+// вытесняют еще не примененные
+typedef struct {
+    uint16_t mask;
+    uint8_t auto_mode;
+    uint8_t heating_enabled;
+    uint8_t humidification_enabled;
+    float temperature_setpoint;
+    float humidity_setpoint;
+    float pid_gains[2][3];
+    float sensor_offset[2];
+    RTC_DateTypeDef date;  // Часы RTC: устанавливаются сразу, не накапливаются
+    RTC_TimeTypeDef time;
+    uint8_t invalid;       // Неверные дата или время - ответ 400
+    uint32_t cycles;  // DWT->CYCCNT первого непримененного запроса
+} WebSettingsUpdate;
 /* USER CODE END PTD */
 
 /* Private define ------------------------------------------------------------*/
 /* USER CODE BEGIN PD */
-#define HISTORY_SIZE 48
+#ifndef HISTORY_BLOCKS
+#define HISTORY_BLOCKS 48 // Сжатых блоков истории, до CODEC_BLOCK_SAMPLES записей в блоке
+#endif
+#define HISTORY_TABLE_ROWS 48 // Строк истории в таблице на странице
+
+// Уровни истории: 1 минута за сутки, 30 минут за 30 суток, сутки за год
+#define ROLLUP_TIER_COUNT 3
+#define ROLLUP_MINUTE_BUCKETS (24 * 60)
+#define ROLLUP_HALF_HOUR_BUCKETS (30 * 48)
+#define ROLLUP_DAY_BUCKETS 365
+#define ROLLUP_ROWS_MAX 30 // Максимум строк в ответе /history/rollup
+
+// Окна статистики /stats: час и сутки по часам RTC
+#define STATS_WINDOW_COUNT 2
+#define STATS_WINDOW_PERIODS { 60 * 60, 24 * 60 * 60 }
+#define EPOCH_2000_UNIX 946684800UL // 2000-01-01 в Unix-времени
+
+// Буферы кэша готовых HTTP ответов
+#define HTTP_PAGE_CACHE_SIZE (24 * 1024)
+#define HTTP_DATA_CACHE_SIZE 512
+#define HTTP_HEADER_RESERVE 128 // Место под заголовки перед телом ответа
+
+// Ответ /history: точек в каждом из двух рядов столько, сколько помещается в буфер
+#define HISTORY_JSON_SIZE (8 * 1024)
+#define HISTORY_POINT_JSON_SIZE 20 // Самая длинная точка: "[4294967295,-32768],"
+#define HISTORY_POINTS_MIN 3       // Первая, последняя и хотя бы одна корзина LTTB
+#define HISTORY_POINTS_MAX ((HISTORY_JSON_SIZE - HTTP_HEADER_RESERVE - 64) / (2 * HISTORY_POINT_JSON_SIZE))
+#define ESP_TX_TIMEOUT 1000     // Ожидание окончания предыдущей передачи DMA, мс
+#define ESP_RX_DMA_SIZE 1024    // Кольцевой буфер приема DMA, степень двойки
+#define ESP_RX_EVENT_DATA 0x01  // Флаг esp_rx_event: в кольцевом буфере новые данные
+#define ESP_EVENT_WAKE 0x02     // Флаг esp_rx_event: новая команда для движка AT
+#define WEB_REQUEST_QUEUE_SIZE ESP_LINK_COUNT
+
+// Пулы буферов: одновременно принимаемые запросы и формируемые/отправляемые ответы
+#define HTTP_REQUEST_BLOCKS 3
+#define HTTP_RESPONSE_BLOCKS 2
+#define AT_RESPONSE_SIZE 160  // Строки ответа на запрос настроек ESP
+#define AT_RESPONSE_BLOCKS 1  // Запросы выполняет только поток движка AT
+
+// Флаги потоков управления
+#define CONTROL_FLAG_SENSOR   0x01  // Новые показания датчика
+#define CONTROL_FLAG_SETTINGS 0x02  // Изменены настройки из веб-интерфейса
+
+// Флаги потока обмена AT командами
+#define EXCHANGE_FLAG_SAMPLE   0x01  // Новое показание в очереди MQTT
+#define EXCHANGE_FLAG_SETTINGS 0x02  // Изменены настройки, нужна запись
+#define EXCHANGE_FLAG_WIFI     0x04  // Изменилось состояние точки доступа
+#define EXCHANGE_FLAG_MQTT     0x08  // Завершено подключение к брокеру
+#define WIFI_CHECK_INTERVAL 10000    // Запрос списка клиентов точки доступа, мс
+
+// Флаги потока RS485 (из прерываний USART1)
+#define RS485_FLAG_DONE  0x01  // Ответ датчика принят
+#define RS485_FLAG_ERROR 0x02  // Ошибка приема или передачи
+
+// Биты WebSettingsUpdate.mask
+#define WEB_SET_MODE            0x01
+#define WEB_SET_HEATING         0x02
+#define WEB_SET_HUMIDIFICATION  0x04
+#define WEB_SET_TEMP_SETPOINT   0x08
+#define WEB_SET_HUM_SETPOINT    0x10
+#define WEB_SET_PID_GAIN(i)     (0x20U << (i))   // i = канал * 3 + коэффициент, 0..5
+#define WEB_SET_OFFSET(i)       (0x800U << (i))  // i = канал, 0..1
+#define WEB_SET_DATE            0x2000
+#define WEB_SET_TIME            0x4000
+
+// Сохранение настроек в резервной SRAM
+#define SETTINGS_VERSION 1            // Меняется при изменении SystemSettings
+#define SETTINGS_SAVE_DELAY 2000      // Запись после паузы в изменениях, мс
+#define SETTINGS_SAVE_INTERVAL 10000  // Минимальный интервал между записями, мс
+
+// Настройки точки доступа в формате AT+CWSAP и AT+CIPAP (ESP-AT v2.2.1.0),
+// задаются при AT+SYSSTORE=0 и не записываются во flash ESP
+#define ESP_AP_CONFIG "\"SVS_Kursov\",\"12345678\",1,3"
+#define ESP_AP_IP "\"192.168.4.1\""
+
+// MQTT брокер архива: узел, подключенный к точке доступа устройства.
+// Выключен по умолчанию: пока брокера нет, каждая попытка AT+MQTTCONN
+// занимает ESP до MQTT_CONNECT_TIMEOUT
+#define MQTT_ENABLED 0                  // 1 - публикация показаний на брокер
+#define MQTT_BROKER_HOST "192.168.4.2"
+#define MQTT_BROKER_PORT 1883
+#define MQTT_CLIENT_ID "svs_kursov"
+#define MQTT_TOPIC "microclimate/" MQTT_CLIENT_ID "/telemetry"
+
+// UDP маяк телеметрии для сборщика (Tools/udp_beacon_rx)
+#define UDP_BEACON_INTERVAL 5000        // Период пакетов, мс; 0 - маяк выключен
+#define UDP_BEACON_HOST "192.168.4.255" // Широковещательный адрес сети точки доступа
+#define UDP_BEACON_PORT 40000
+#define UDP_BEACON_LINK 4               // Link ID маяка, веб-серверу остаются 0..3
 #define MODBUS_ADDRESS 0x01
 #define MODBUS_READ_HOLDING_REG 0x03
 #define TEMP_REG_ADDR 0x0001
@@ -82,8 +220,9 @@ typedef enum {
 #define TEMP_HYSTERESIS 0.5f
 #define HUM_HYSTERESIS 2.0f
 
-// Максимальное время ожидания ответа от датчика (мс)
+// Максимальное время обмена с датчиком: запрос и ответ (мс)
 #define RS485_TIMEOUT 100
+#define RS485_PERIOD 5000  // Период опроса датчика, мс
 /* USER CODE END PD */
 
 /* Private macro -------------------------------------------------------------*/
@@ -101,68 +240,179 @@ RTC_HandleTypeDef hrtc;
 UART_HandleTypeDef huart1;
 UART_HandleTypeDef huart6;
 DMA_HandleTypeDef hdma_usart6_tx;
+DMA_HandleTypeDef hdma_usart6_rx;
 
 /* Definitions for readRS485 */
 osThreadId_t readRS485Handle;
+uint32_t readRS485Buffer[ 256 ];
+osStaticThreadDef_t readRS485ControlBlock;
 const osThreadAttr_t readRS485_attributes = {
   .name = "readRS485",
-  .stack_size = 128 * 4,
+  .cb_mem = &readRS485ControlBlock,
+  .cb_size = sizeof(readRS485ControlBlock),
+  .stack_mem = &readRS485Buffer[0],
+  .stack_size = sizeof(readRS485Buffer),
   .priority = (osPriority_t) osPriorityNormal,
 };
 /* Definitions for controlPIDTemp */
 osThreadId_t controlPIDTempHandle;
+uint32_t controlPIDTempBuffer[ 192 ];
+osStaticThreadDef_t controlPIDTempControlBlock;
 const osThreadAttr_t controlPIDTemp_attributes = {
   .name = "controlPIDTemp",
-  .stack_size = 128 * 4,
+  .cb_mem = &controlPIDTempControlBlock,
+  .cb_size = sizeof(controlPIDTempControlBlock),
+  .stack_mem = &controlPIDTempBuffer[0],
+  .stack_size = sizeof(controlPIDTempBuffer),
   .priority = (osPriority_t) osPriorityLow,
 };
 /* Definitions for controlPIDHum */
 osThreadId_t controlPIDHumHandle;
+uint32_t controlPIDHumBuffer[ 192 ];
+osStaticThreadDef_t controlPIDHumControlBlock;
 const osThreadAttr_t controlPIDHum_attributes = {
   .name = "controlPIDHum",
-  .stack_size = 128 * 4,
+  .cb_mem = &controlPIDHumControlBlock,
+  .cb_size = sizeof(controlPIDHumControlBlock),
+  .stack_mem = &controlPIDHumBuffer[0],
+  .stack_size = sizeof(controlPIDHumBuffer),
   .priority = (osPriority_t) osPriorityLow,
 };
 /* Definitions for exchangeATComma */
 osThreadId_t exchangeATCommaHandle;
+uint32_t exchangeATCommaBuffer[ 256 ];
+osStaticThreadDef_t exchangeATCommaControlBlock;
 const osThreadAttr_t exchangeATComma_attributes = {
   .name = "exchangeATComma",
-  .stack_size = 128 * 4,
+  .cb_mem = &exchangeATCommaControlBlock,
+  .cb_size = sizeof(exchangeATCommaControlBlock),
+  .stack_mem = &exchangeATCommaBuffer[0],
+  .stack_size = sizeof(exchangeATCommaBuffer),
   .priority = (osPriority_t) osPriorityLow,
 };
 /* Definitions for webInterface */
 osThreadId_t webInterfaceHandle;
+uint32_t webInterfaceBuffer[ 576 ];
+osStaticThreadDef_t webInterfaceControlBlock;
 const osThreadAttr_t webInterface_attributes = {
   .name = "webInterface",
-  .stack_size = 128 * 4,
+  .cb_mem = &webInterfaceControlBlock,
+  .cb_size = sizeof(webInterfaceControlBlock),
+  .stack_mem = &webInterfaceBuffer[0],
+  .stack_size = sizeof(webInterfaceBuffer),
   .priority = (osPriority_t) osPriorityLow,
 };
+/* Definitions for atEngine */
+osThreadId_t atEngineHandle;
+uint32_t atEngineBuffer[ 640 ];
+osStaticThreadDef_t atEngineControlBlock;
+const osThreadAttr_t atEngine_attributes = {
+  .name = "atEngine",
+  .cb_mem = &atEngineControlBlock,
+  .cb_size = sizeof(atEngineControlBlock),
+  .stack_mem = &atEngineBuffer[0],
+  .stack_size = sizeof(atEngineBuffer),
+  .priority = (osPriority_t) osPriorityNormal,
+};
 /* USER CODE BEGIN PV */
 // Глобальные переменные системы
 SensorData current_sensor_data = {0};
-SensorData history_data[HISTORY_SIZE];
-uint8_t history_index = 0;
+
+// Снимок сжатой истории для чтения и кэш последнего распакованного блока
+typedef struct {
+    uint32_t first;                    // Номер самого старого блока в кольце
+    uint32_t blocks;                   // Блоков в кольце, текущий блок - после них
+    Codec_BlockTypeDef open;           // Копия текущего блока
+    uint32_t start[HISTORY_BLOCKS + 1]; // Номер первой записи блока
+    uint32_t count;                    // Всего записей
+    uint32_t decoded_block;
+    uint32_t decoded_count;
+    uint32_t times[CODEC_BLOCK_SAMPLES];
+    int16_t values[CODEC_BLOCK_SAMPLES][CODEC_CHANNELS];
+} HistoryView;
+
+// История: пишет только поток опроса датчиков, читатели не блокируют его.
+// Заполненные блоки сжатых записей - в кольце (одно место сверх
+// HISTORY_BLOCKS - запас на добавление во время чтения), текущий - в кодере
+Codec_BlockTypeDef history_storage[HISTORY_BLOCKS + 1] CCMRAM;
+RingBufferTypeDef history_ring;
+Codec_EncoderTypeDef history_encoder CCMRAM;
+
+// Многоуровневая история: каждое показание учитывается во всех уровнях
+// (одно место сверх размера - запас для читателей кольца).
+// Получасовой уровень (20 КБ) в CCM RAM не помещается
+Rollup_BucketTypeDef rollup_minute_storage[ROLLUP_MINUTE_BUCKETS + 1] CCMRAM;
+Rollup_BucketTypeDef rollup_half_hour_storage[ROLLUP_HALF_HOUR_BUCKETS + 1];
+Rollup_BucketTypeDef rollup_day_storage[ROLLUP_DAY_BUCKETS + 1] CCMRAM;
+Rollup_TierTypeDef history_tiers[ROLLUP_TIER_COUNT];
+
+// Статистика показаний и работы выходов по окнам
+Stats_WindowTypeDef stats_windows[STATS_WINDOW_COUNT];
+
+// Журнал истории во flash, переживает сброс
+FlashLogTypeDef history_log;
+uint32_t history_log_scan_us = 0; // Построение индекса журнала при запуске
 SystemSettings system_settings = {
     .temperature_setpoint = 22.0f,
     .humidity_setpoint = 50.0f,
     .auto_mode = 1,  // Автоматический режим по умолчанию
     .heating_enabled = 0,
-    .humidification_enabled = 0
+    .humidification_enabled = 0,
+    .pid_gains = {
+        { TEMP_KP, TEMP_KI, TEMP_KD },
+        { HUM_KP, HUM_KI, HUM_KD }
+    },
+    .sensor_offset = { 0.0f, 0.0f }
 };
 
+// Настройки в резервной SRAM: загружаются при запуске, записываются
+// после паузы в изменениях
+SettingsStoreTypeDef settings_store;
+static uint8_t settings_dirty = 0;
+static uint32_t settings_changed_tick = 0;
+static uint32_t settings_saved_tick = 0;
+static uint32_t settings_restore_us = 0; // Загрузка настроек при запуске
+
 // ПИД регуляторы
-PID_HandleTypeDef pid_temp;
-PID_HandleTypeDef pid_hum;
+PID_HandleTypeDef pid_temp CCMRAM;
+PID_HandleTypeDef pid_hum CCMRAM;
 
 // Очереди для межпоточного взаимодействия
-osMessageQueueId_t sensor_data_queue;
-osMessageQueueId_t settings_queue;
-osMessageQueueId_t web_command_queue;
+osMessageQueueId_t web_request_queue;
 
 // Семафоры и мьютексы
 osMutexId_t sensor_data_mutex;
 osMutexId_t settings_mutex;
-osMutexId_t history_mutex;
+osSemaphoreId_t esp_tx_semaphore; // Свободен, когда DMA передача на ESP завершена
+osEventFlagsId_t esp_rx_event;    // Пробуждение потока движка AT
+
+// Память объектов ядра: все создаются статически, куча FreeRTOS не используется
+static StaticQueue_t web_request_queue_cb CCMRAM;
+static WebRequest web_request_queue_storage[WEB_REQUEST_QUEUE_SIZE] CCMRAM;
+static StaticSemaphore_t sensor_data_mutex_cb CCMRAM;
+static StaticSemaphore_t settings_mutex_cb CCMRAM;
+static StaticSemaphore_t esp_tx_semaphore_cb CCMRAM;
+static StaticEventGroup_t esp_rx_event_cb CCMRAM;
+static StaticTimer_t udp_beacon_timer_cb CCMRAM;
+static StaticTimer_t task_stats_timer_cb CCMRAM;
+
+// Бюджет стека потоков для отчета о запасе (/debug/memory). Размеры стеков
+// (.ioc, Tasks01) - худший путь Tools/stack_budget по сборкам Debug и Release
+// для Cortex-M4 с запасом не менее 25%, округленные до 256 байт. После
+// изменения цепочек вызовов или буферов на стеке анализ повторяется
+typedef struct {
+    osThreadId_t *handle;
+    const osThreadAttr_t *attributes;
+} TaskStackBudget;
+
+static const TaskStackBudget task_stack_budget[] = {
+    { &readRS485Handle, &readRS485_attributes },
+    { &controlPIDTempHandle, &controlPIDTemp_attributes },
+    { &controlPIDHumHandle, &controlPIDHum_attributes },
+    { &exchangeATCommaHandle, &exchangeATComma_attributes },
+    { &webInterfaceHandle, &webInterface_attributes },
+    { &atEngineHandle, &atEngine_attributes }
+};
 
 // Флаги состояния
 volatile uint8_t heating_active = 0;
@@ -174,10 +424,94 @@ volatile uint8_t humidifier_service = 0;
 
 // Буферы для связи
 uint8_t rs485_rx_buffer[64];
-uint8_t rs485_tx_buffer[64];
-uint8_t esp_rx_buffer[256];
-uint8_t esp_tx_buffer[512];
+uint8_t esp_tx_buffer[512]; // Промежуточный буфер DMA для данных из CCM RAM
 uint8_t modbus_frame[8];
+static volatile uint16_t rs485_rx_length; // Длина ожидаемого ответа датчика
+
+// Кэш готовых ответов для главной страницы и /data
+static char http_page_cache_buffer[HTTP_PAGE_CACHE_SIZE];
+static char http_data_cache_buffer[HTTP_DATA_CACHE_SIZE];
+HTTP_CacheEntryTypeDef http_page_cache;
+HTTP_CacheEntryTypeDef http_data_cache;
+
+// Настройки, принятые веб-интерфейсом и еще не примененные
+static WebSettingsUpdate web_settings_pending;
+uint32_t web_settings_requests;  // Принято запросов с настройками
+uint32_t web_settings_applied;   // Применено транзакций
+static uint32_t web_settings_cycles; // DWT->CYCCNT первого запроса последней транзакции
+
+// Задержка от приема команды до записи выхода, мкс
+uint32_t control_latency_count;
+uint32_t control_latency_last_us;
+uint32_t control_latency_max_us;
+uint64_t control_latency_total_us;
+
+// Пулы буферов сети: блоки выдаются на время обмена и передаются по указателю
+static uint32_t http_request_pool_storage[MEM_POOL_WORDS(ESP_LINK_REQUEST_SIZE, HTTP_REQUEST_BLOCKS)];
+static uint32_t http_response_pool_storage[MEM_POOL_WORDS(ESP_LINK_RESPONSE_SIZE, HTTP_RESPONSE_BLOCKS)];
+static uint32_t at_response_pool_storage[MEM_POOL_WORDS(AT_RESPONSE_SIZE, AT_RESPONSE_BLOCKS)];
+MemPoolTypeDef http_request_pool;
+MemPoolTypeDef http_response_pool;
+MemPoolTypeDef at_response_pool;
+static MemPoolTypeDef *const mem_pools[] = { &http_request_pool, &http_response_pool, &at_response_pool };
+
+// Ответ при исчерпании пула ответов
+static const char http_busy_response[] =
+  "HTTP/1.1 503 Service Unavailable\r\n"
+  "Content-Length: 0\r\n\r\n";
+
+// Ответ на запрос с неверным параметром
+static const char http_bad_request_response[] =
+  "HTTP/1.1 400 Bad Request\r\n"
+  "Content-Length: 0\r\n\r\n";
+
+// Ответ /history: больше блока пула ответов, занят до окончания отправки
+static uint32_t history_json_buffer[HISTORY_JSON_SIZE / 4];
+static volatile uint8_t history_json_busy;
+
+// HTTP сервер ESP: соединения клиентов и очередь отправки
+ESP_ServerTypeDef esp_server;
+
+// Движок AT команд, единственный владелец USART6
+AT_EngineTypeDef at_engine;
+
+// Публикация показаний на MQTT брокер с очередью на время недоступности
+MQTT_ClientTypeDef mqtt_client;
+
+// Периодический запрос клиентов точки доступа, занят до завершения в движке
+static AT_RequestTypeDef cwlif_request;
+static volatile uint8_t cwlif_busy;
+
+// UDP маяк телеметрии, отправляется по таймеру
+UDP_BeaconTypeDef udp_beacon;
+osTimerId_t udp_beacon_timer;
+
+// Загрузка процессора по потокам, замер по таймеру раз в TASK_STATS_INTERVAL
+TaskStatsTypeDef task_stats CCMRAM;
+osTimerId_t task_stats_timer;
+
+// Журнал трассировки: место под заголовки HTTP перед дампом,
+// ответ /debug/trace собирается на месте без копирования кольца
+static uint32_t trace_buffer[(HTTP_HEADER_RESERVE + sizeof(TraceDumpTypeDef)) / 4 + 1];
+
+// Прием от ESP: DMA пишет по кругу, счетчики растут монотонно,
+// позиция в буфере - счетчик по модулю ESP_RX_DMA_SIZE
+static uint8_t esp_rx_dma_buffer[ESP_RX_DMA_SIZE];
+static volatile uint32_t esp_rx_total;   // Принято DMA (обновляется в прерывании)
+static volatile uint32_t esp_rx_resync;  // Граница перезапуска DMA после ошибки
+static uint16_t esp_rx_dma_pos;          // Последняя позиция DMA, для прерывания
+static uint32_t esp_rx_read_total;       // Передано в разборщик
+uint32_t esp_rx_dropped;                 // Потеряно байт (перезапись или ошибка UART)
+uint32_t esp_rx_errors;                  // Ошибки UART при приеме
+AT_ParserTypeDef at_parser;
+uint32_t esp_init_ms;  // Длительность последней инициализации ESP
+uint32_t esp_ready_ms; // Время от включения до запуска веб-сервера
+
+// Скорости для согласования, от большей к меньшей
+static const uint32_t esp_uart_baudrates[] = { 921600, 460800, 230400 };
+
+// Настройка ESP: запросы значений и скорость USART6
+ESP_SetupTypeDef esp_setup;
 
 // HTML страница веб-интерфейса
 const char* html_page =
@@ -215,6 +549,7 @@ const char* html_page =
 ".indicator { background-color: rgba(0, 0, 0, 0.3); border-radius: 10px; padding: 15px; width: 48%; text-align: center; font-weight: bold; display: flex; flex-direction: column; align-items: center; }"
 ".indicator-light { width: 20px; height: 20px; border-radius: 50%; background-color: #555; margin-top: 10px; transition: all 0.3s ease; }"
 ".indicator-light.on { background-color: #4caf50; box-shadow: 0 0 15px #4caf50; }"
+".history-chart { width: 100%; height: 200px; background-color: rgba(0, 0, 0, 0.2); border-radius: 10px; margin-bottom: 15px; }"
 ".history-table-container { overflow-x: auto; max-height: 400px; }"
 ".history-table { width: 100%; border-collapse: collapse; }"
 ".history-table th, .history-table td { padding: 12px 15px; text-align: center; border-bottom: 1px solid rgba(255, 255, 255, 0.1); }"
@@ -294,6 +629,7 @@ const char* html_page =
 "<div id=\"history\" class=\"page\">"
 "<h2 class=\"page-title\">История за сутки</h2>"
 "<p style=\"text-align: center; margin-bottom: 15px; opacity: 0.8;\">Данные обновляются каждые 30 минут</p>"
+"<canvas class=\"history-chart\" id=\"history-chart\" width=\"460\" height=\"200\"></canvas>"
 "<div class=\"history-table-container\">"
 "<table class=\"history-table\"><thead><tr><th>Дата и время</th><th>Температура</th><th>Влажность</th></tr></thead><tbody id=\"history-table-body\">%s</tbody></table>"
 "</div>"
@@ -335,7 +671,33 @@ const char* html_page =
 "this.classList.add('active');"
 "document.querySelectorAll('.page').forEach(page => page.classList.remove('active'));"
 "document.getElementById(this.getAttribute('data-page')).classList.add('active');"
+"if(this.getAttribute('data-page') === 'history') drawHistory();"
 "});});"
+"function drawHistory() {"
+"const canvas = document.getElementById('history-chart');"
+"fetch('/history?points=' + canvas.width)"
+".then(response => response.json())"
+".then(data => {"
+"const ctx = canvas.getContext('2d');"
+"ctx.clearRect(0, 0, canvas.width, canvas.height);"
+"[['temp', '#ff9966'], ['hum', '#66ccff']].forEach(([key, color]) => {"
+"const series = data[key];"
+"if(series.length < 2) return;"
+"const t0 = series[0][0], t1 = series[series.length - 1][0];"
+"const values = series.map(p => p[1]);"
+"const lo = Math.min(...values), hi = Math.max(...values);"
+"ctx.strokeStyle = color;"
+"ctx.lineWidth = 2;"
+"ctx.beginPath();"
+"series.forEach((p, i) => {"
+"const x = (p[0] - t0) / ((t1 - t0) || 1) * canvas.width;"
+"const y = canvas.height - 10 - (p[1] - lo) / ((hi - lo) || 1) * (canvas.height - 20);"
+"if(i) ctx.lineTo(x, y); else ctx.moveTo(x, y);"
+"});"
+"ctx.stroke();"
+"});"
+"});"
+"}"
 "const heatingToggle = document.getElementById('heating-toggle');"
 "const heatingIndicator = document.getElementById('heating-indicator');"
 "const humidificationToggle = document.getElementById('humidification-toggle');"
@@ -356,23 +718,38 @@ const char* html_page =
 "let heatingOn = %s;"
 "let humidificationOn = %s;"
 "let autoMode = %s;"
+"let pendingSettings = {};"
+"let settingsTimer = null;"
+"function queueSettings(name, value) {"
+"pendingSettings[name] = value;"
+"clearTimeout(settingsTimer);"
+"settingsTimer = setTimeout(sendSettings, 400);"
+"}"
+"function sendSettings() {"
+"clearTimeout(settingsTimer);"
+"if(Object.keys(pendingSettings).length === 0) return Promise.resolve(true);"
+"const body = new URLSearchParams(pendingSettings).toString();"
+"pendingSettings = {};"
+"return fetch('/settings', { method: 'POST', headers: { 'Content-Type': 'application/x-www-form-urlencoded' }, body: body })"
+".then(response => response.ok).catch(() => false);"
+"}"
 "heatingToggle.addEventListener('click', function() {"
 "heatingOn = !heatingOn;"
-"fetch('/control?heating=' + (heatingOn ? '1' : '0'));"
+"queueSettings('heating', heatingOn ? '1' : '0');"
 "this.textContent = heatingOn ? 'Выключить обогрев' : 'Включить обогрев';"
 "this.classList.toggle('off', !heatingOn);"
 "heatingIndicator.classList.toggle('on', heatingOn);"
 "});"
 "humidificationToggle.addEventListener('click', function() {"
 "humidificationOn = !humidificationOn;"
-"fetch('/control?humidification=' + (humidificationOn ? '1' : '0'));"
+"queueSettings('humidification', humidificationOn ? '1' : '0');"
 "this.textContent = humidificationOn ? 'Выключить увлажнение' : 'Включить увлажнение';"
 "this.classList.toggle('off', !humidificationOn);"
 "humidificationIndicator.classList.toggle('on', humidificationOn);"
 "});"
 "modeSwitch.addEventListener('change', function() {"
 "autoMode = this.checked;"
-"fetch('/control?mode=' + (autoMode ? '1' : '0'));"
+"queueSettings('mode', autoMode ? '1' : '0');"
 "document.getElementById('heat-setpoint-container').classList.toggle('active', autoMode);"
 "document.getElementById('hum-setpoint-container').classList.toggle('active', autoMode);"
 "heatingToggle.disabled = autoMode;"
@@ -386,23 +763,23 @@ const char* html_page =
 "heatSetpointValue.textContent = heatSetpoint.toFixed(1) + '°C';"
 "heatSetpointInput.textContent = heatSetpoint.toFixed(1);"
 "document.getElementById('current-heat-setpoint').textContent = heatSetpoint.toFixed(1);"
-"fetch('/settings?heat_setpoint=' + heatSetpoint.toFixed(1));"
+"queueSettings('heat_setpoint', heatSetpoint.toFixed(1));"
 "}"
 "function updateHumSetpoint() {"
 "humSetpointValue.textContent = humSetpoint.toFixed(1) + '%%';"
 "humSetpointInput.textContent = humSetpoint.toFixed(1);"
 "document.getElementById('current-hum-setpoint').textContent = humSetpoint.toFixed(1);"
-"fetch('/settings?hum_setpoint=' + humSetpoint.toFixed(1));"
+"queueSettings('hum_setpoint', humSetpoint.toFixed(1));"
 "}"
 "saveTimeBtn.addEventListener('click', function() {"
 "const date = document.getElementById('date-input').value;"
 "const time = document.getElementById('time-input').value;"
-"fetch('/settings?date=' + date + '&time=' + time);"
-"alert('Время установлено');"
+"queueSettings('date', date);"
+"queueSettings('time', time);"
+"sendSettings().then(ok => alert(ok ? 'Время установлено' : 'Время не установлено'));"
 "});"
 "saveSettingsBtn.addEventListener('click', function() {"
-"fetch('/settings?save_all=1');"
-"alert('Настройки сохранены');"
+"sendSettings().then(ok => alert(ok ? 'Настройки сохранены' : 'Настройки не сохранены'));"
 "});"
 "setInterval(function() {"
 "fetch('/data')"
@@ -440,11 +817,13 @@ void StartControlPIDTemp(void *argument);
 void StartControlPIDHum(void *argument);
 void StartExchangeATCommand(void *argument);
 void StartWebInterface(void *argument);
+void StartATEngine(void *argument);
 
 /* USER CODE BEGIN PFP */
 // Вспомогательные функции
 static void RS485_EnableTX(void);
 static void RS485_EnableRX(void);
+static uint8_t RS485_Transaction(uint16_t rx_length);
 static uint16_t Modbus_CRC16(uint8_t *data, uint16_t length);
 static void Send_Modbus_Request(uint8_t slave_addr, uint8_t function_code, uint16_t reg_addr, uint16_t reg_count);
 static uint8_t Parse_Modbus_Response(uint8_t *response, uint16_t *temperature, uint16_t *humidity);
@@ -452,18 +831,73 @@ static void Update_History(SensorData data);
 static void Update_LEDs(void);
 static void Control_Heating(float current_temp, float setpoint);
 static void Control_Humidification(float current_hum, float setpoint);
-static void Process_Web_Command(char *command);
-static void Send_AT_Command(const char *cmd);
-static uint8_t Wait_AT_Response(const char *expected, uint32_t timeout);
+static void Web_Settings_Parse(char *query, WebSettingsUpdate *update);
+static void Web_Settings_Submit(const WebSettingsUpdate *update);
+static void Web_Clock_Set(WebSettingsUpdate *update);
+static void Web_Settings_Apply(void);
+static void Settings_Restore(void);
+static uint32_t Settings_Save_Process(void);
+static void Control_Latency_Record(uint32_t command_cycles);
+static void Generate_Control_Stats_JSON(char *buffer, uint32_t size);
+static void Generate_Flash_Stats_JSON(char *buffer, uint32_t size);
+static void Generate_Memory_Stats_JSON(char *buffer, uint32_t size);
+static void History_Restore(void);
+static void History_Store(const SensorData *data);
+static void History_Rollup_Add(const SensorData *data);
+static void Generate_Rollup_JSON(char *buffer, uint32_t size, uint32_t from, uint32_t to, uint32_t step);
+static void Generate_Stats_JSON(char *buffer, uint32_t size);
+static void Send_AT_Data(const uint8_t *data, uint32_t length);
+static void Queue_HTTP_Request(uint8_t link_id, char *request, uint32_t length);
+static void Handle_HTTP_Request(uint8_t link_id, char *request, uint32_t length);
+static void HTTP_Cache_Sent(void *ctx);
+static uint32_t Generate_Trace_Dump(void);
+static void Trace_Sent(void *ctx);
+static void ESP_RX_Start(void);
+static void ESP_RX_Poll(void);
+static void ESP_RX_Flush(void);
+static void ESP_RX_Restart(void);
+static void ESP_UART_SetBaudrate(uint32_t baudrate);
+static uint32_t ESP_UART_Errors(void);
+static void Generate_ESP_Stats_JSON(char *buffer, uint32_t size);
 static void ESP_Init(void);
-static void Generate_HTML_Page(char *buffer, uint32_t size);
-static void Check_WiFi_Status(void);
-static void Generate_JSON_Data(char *buffer, uint32_t size);
+static uint32_t Generate_HTML_Page(char *buffer, uint32_t size);
+static uint32_t Check_WiFi_Status(void);
+static void CWLIF_Done(void *ctx, AT_RequestTypeDef *request);
+static uint32_t Generate_JSON_Data(char *buffer, uint32_t size);
+static uint32_t HTTP_Build_Response(char *buffer, uint32_t size, const char *content_type, uint32_t body_length);
+static void Generate_Cache_Stats_JSON(char *buffer, uint32_t size);
+static void Set_Heating_Output(uint8_t active);
+static void Set_Humidification_Output(uint8_t active);
+static void Set_WiFi_State(uint8_t active);
+static void UDP_Beacon_Timer(void *argument);
+static void TaskStats_Timer(void *argument);
+static void Generate_Tasks_JSON(char *buffer, uint32_t size);
 static void Generate_History_HTML(char *buffer, uint32_t size);
+static uint8_t History_ParsePoints(const char *request, uint32_t *points);
+static void Generate_History_JSON(char *buffer, uint32_t size, uint32_t points);
+static void History_Sent(void *ctx);
+static uint32_t Timestamp_FromRTC(const RTC_DateTypeDef *date, const RTC_TimeTypeDef *time);
+static void Timestamp_Format(uint32_t timestamp, char *buffer, uint32_t size);
 /* USER CODE END PFP */
 
 /* Private user code ---------------------------------------------------------*/
 /* USER CODE BEGIN 0 */
+// Доступ модуля настройки ESP к USART6
+static const ESP_SetupPortTypeDef esp_setup_port = {
+  .set_baudrate = ESP_UART_SetBaudrate,
+  .rx_errors = ESP_UART_Errors
+};
+
+// Точка доступа и веб-сервер на порту 80. Link ID маяка клиентам не выдается
+static const ESP_SetupConfigTypeDef esp_setup_config = {
+  .ap_config = ESP_AP_CONFIG,
+  .ap_ip = ESP_AP_IP,
+  .baudrates = esp_uart_baudrates,
+  .baudrate_count = sizeof(esp_uart_baudrates) / sizeof(esp_uart_baudrates[0]),
+  .max_connections = (UDP_BEACON_INTERVAL > 0) ? UDP_BEACON_LINK : 0,
+  .server_port = 80,
+  .server_timeout = 30  // Таймаут соединения 30 секунд
+};
 
 /* USER CODE END 0 */
 
@@ -502,16 +936,52 @@ int main(void)
   MX_IWDG_Init();
   MX_RTC_Init();
   /* USER CODE BEGIN 2 */
+  // Включение счетчика тактов DWT для измерения времени обработки
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+
+  // Настройки, коэффициенты ПИД и калибровка из резервной SRAM
+  Settings_Restore();
+
   // Инициализация ПИД регуляторов
-  PID_Init(&pid_temp, TEMP_KP, TEMP_KI, TEMP_KD);
-  PID_Init(&pid_hum, HUM_KP, HUM_KI, HUM_KD);
+  PID_Init(&pid_temp, system_settings.pid_gains[0][0], system_settings.pid_gains[0][1],
+           system_settings.pid_gains[0][2]);
+  PID_Init(&pid_hum, system_settings.pid_gains[1][0], system_settings.pid_gains[1][1],
+           system_settings.pid_gains[1][2]);
 
   // Установка пределов ПИД регуляторов
   PID_SetOutputLimits(&pid_temp, 0.0f, 1.0f);
   PID_SetOutputLimits(&pid_hum, 0.0f, 1.0f);
 
   // Инициализация истории
-  memset(history_data, 0, sizeof(history_data));
+  Ring_Init(&history_ring, history_storage, sizeof(Codec_BlockTypeDef), HISTORY_BLOCKS + 1);
+  Codec_Reset(&history_encoder);
+  Rollup_TierInit(&history_tiers[0], 60, rollup_minute_storage, ROLLUP_MINUTE_BUCKETS + 1);
+  Rollup_TierInit(&history_tiers[1], 30 * 60, rollup_half_hour_storage, ROLLUP_HALF_HOUR_BUCKETS + 1);
+  Rollup_TierInit(&history_tiers[2], 24 * 60 * 60, rollup_day_storage, ROLLUP_DAY_BUCKETS + 1);
+
+  // Окна статистики
+  const uint32_t stats_periods[STATS_WINDOW_COUNT] = STATS_WINDOW_PERIODS;
+  for(uint8_t i = 0; i < STATS_WINDOW_COUNT; i++)
+  {
+    Stats_Init(&stats_windows[i], stats_periods[i]);
+  }
+
+  // Восстановление истории из журнала во flash
+  History_Restore();
+
+  // Кэш ответов: страница зависит от всех данных, JSON - от показаний и настроек
+  HTTP_Cache_Init(&http_page_cache, http_page_cache_buffer, sizeof(http_page_cache_buffer),
+                  HTTP_DEP(HTTP_STATE_SENSOR) | HTTP_DEP(HTTP_STATE_SETTINGS) |
+                  HTTP_DEP(HTTP_STATE_HISTORY) | HTTP_DEP(HTTP_STATE_CLOCK),
+                  Generate_HTML_Page);
+  HTTP_Cache_Init(&http_data_cache, http_data_cache_buffer, sizeof(http_data_cache_buffer),
+                  HTTP_DEP(HTTP_STATE_SENSOR) | HTTP_DEP(HTTP_STATE_SETTINGS),
+                  Generate_JSON_Data);
+
+  // Разбор потока ESP: строки ответов - движку AT, соединения - серверу
+  AT_Parser_Init(&at_parser);
 
   // Включаем ESP модуль
   HAL_GPIO_WritePin(EN_ESP_Out_GPIO_Port, EN_ESP_Out_Pin, GPIO_PIN_SET);
@@ -532,36 +1002,107 @@ int main(void)
   // Создание мьютексов
   const osMutexAttr_t mutex_attributes = {
     .name = "SensorDataMutex",
-    .attr_bits = osMutexRecursive
+    .attr_bits = osMutexRecursive,
+    .cb_mem = &sensor_data_mutex_cb,
+    .cb_size = sizeof(sensor_data_mutex_cb)
   };
   sensor_data_mutex = osMutexNew(&mutex_attributes);
 
   const osMutexAttr_t settings_mutex_attr = {
     .name = "SettingsMutex",
-    .attr_bits = osMutexRecursive
+    .attr_bits = osMutexRecursive,
+    .cb_mem = &settings_mutex_cb,
+    .cb_size = sizeof(settings_mutex_cb)
   };
   settings_mutex = osMutexNew(&settings_mutex_attr);
-
-  const osMutexAttr_t history_mutex_attr = {
-    .name = "HistoryMutex",
-    .attr_bits = osMutexRecursive
-  };
-  history_mutex = osMutexNew(&history_mutex_attr);
   /* USER CODE END RTOS_MUTEX */
 
   /* USER CODE BEGIN RTOS_SEMAPHORES */
-  /* add semaphores, ... */
+  // Передатчик ESP свободен до первой передачи
+  const osSemaphoreAttr_t esp_tx_semaphore_attr = {
+    .name = "EspTx",
+    .cb_mem = &esp_tx_semaphore_cb,
+    .cb_size = sizeof(esp_tx_semaphore_cb)
+  };
+  esp_tx_semaphore = osSemaphoreNew(1, 1, &esp_tx_semaphore_attr);
   /* USER CODE END RTOS_SEMAPHORES */
 
   /* USER CODE BEGIN RTOS_TIMERS */
-  /* start timers, add new ones, ... */
+  // Период маяка не зависит от загрузки потоков обмена с ESP
+  const osTimerAttr_t udp_beacon_timer_attr = {
+    .name = "UdpBeacon",
+    .cb_mem = &udp_beacon_timer_cb,
+    .cb_size = sizeof(udp_beacon_timer_cb)
+  };
+  udp_beacon_timer = osTimerNew(UDP_Beacon_Timer, osTimerPeriodic, NULL, &udp_beacon_timer_attr);
+  if(UDP_BEACON_INTERVAL > 0)
+  {
+    osTimerStart(udp_beacon_timer, UDP_BEACON_INTERVAL);
+  }
+
+  // Журнал трассировки: прерывания обмена с датчиком и ESP
+  // (тик HAL TIM1 раз в 1 мс не пишется, он вытеснил бы остальные события)
+  Trace_Init((TraceDumpTypeDef*)((char*)trace_buffer + HTTP_HEADER_RESERVE));
+  Trace_SetName(TRACE_NAME_IRQ, USART1_IRQn, "USART1");
+  Trace_SetName(TRACE_NAME_IRQ, USART6_IRQn, "USART6");
+  Trace_SetName(TRACE_NAME_IRQ, DMA2_Stream1_IRQn, "DMA USART6 RX");
+  Trace_SetName(TRACE_NAME_IRQ, DMA2_Stream6_IRQn, "DMA USART6 TX");
+
+  // Замер загрузки потоков: интервал много меньше переполнения DWT->CYCCNT
+  TaskStats_Init(&task_stats);
+  const osTimerAttr_t task_stats_timer_attr = {
+    .name = "TaskStats",
+    .cb_mem = &task_stats_timer_cb,
+    .cb_size = sizeof(task_stats_timer_cb)
+  };
+  task_stats_timer = osTimerNew(TaskStats_Timer, osTimerPeriodic, NULL, &task_stats_timer_attr);
+  osTimerStart(task_stats_timer, TASK_STATS_INTERVAL);
   /* USER CODE END RTOS_TIMERS */
 
   /* USER CODE BEGIN RTOS_QUEUES */
   // Создание очередей
-  sensor_data_queue = osMessageQueueNew(10, sizeof(SensorData), NULL);
-  settings_queue = osMessageQueueNew(10, sizeof(SystemSettings), NULL);
-  web_command_queue = osMessageQueueNew(20, 64, NULL);
+  const osMessageQueueAttr_t web_request_queue_attr = {
+    .name = "WebRequest",
+    .cb_mem = &web_request_queue_cb,
+    .cb_size = sizeof(web_request_queue_cb),
+    .mq_mem = web_request_queue_storage,
+    .mq_size = sizeof(web_request_queue_storage)
+  };
+  web_request_queue = osMessageQueueNew(WEB_REQUEST_QUEUE_SIZE, sizeof(WebRequest), &web_request_queue_attr);
+
+  // Движок AT создает свою очередь, поэтому после osKernelInitialize
+  const osEventFlagsAttr_t esp_rx_event_attr = {
+    .name = "EspRx",
+    .cb_mem = &esp_rx_event_cb,
+    .cb_size = sizeof(esp_rx_event_cb)
+  };
+  esp_rx_event = osEventFlagsNew(&esp_rx_event_attr);
+  AT_Engine_Init(&at_engine, &at_parser, Send_AT_Data, ESP_RX_Poll, esp_rx_event,
+                 ESP_EVENT_WAKE, ESP_RX_EVENT_DATA);
+  MemPool_Init(&http_request_pool, "http_request", http_request_pool_storage,
+               ESP_LINK_REQUEST_SIZE, HTTP_REQUEST_BLOCKS);
+  MemPool_Init(&http_response_pool, "http_response", http_response_pool_storage,
+               ESP_LINK_RESPONSE_SIZE, HTTP_RESPONSE_BLOCKS);
+  MemPool_Init(&at_response_pool, "at_response", at_response_pool_storage,
+               AT_RESPONSE_SIZE, AT_RESPONSE_BLOCKS);
+  ESP_Setup_Init(&esp_setup, &at_engine, &at_response_pool, &esp_setup_port);
+  ESP_Server_Init(&esp_server, &at_engine, Queue_HTTP_Request,
+                  &http_request_pool, &http_response_pool);
+  ESP_Server_Attach(&esp_server, &at_parser);
+  if(MQTT_ENABLED)
+  {
+    MQTT_Client_Init(&mqtt_client, &at_engine, MQTT_BROKER_HOST, MQTT_BROKER_PORT,
+                     MQTT_CLIENT_ID, MQTT_TOPIC);
+    MQTT_Client_Attach(&mqtt_client, &at_parser);
+  }
+  if(UDP_BEACON_INTERVAL > 0)
+  {
+    // Идентификатор устройства - свертка уникального номера STM32
+    UDP_Beacon_Init(&udp_beacon, &at_engine, UDP_BEACON_LINK, UDP_BEACON_HOST, UDP_BEACON_PORT,
+                    HAL_GetUIDw0() ^ HAL_GetUIDw1() ^ HAL_GetUIDw2());
+    UDP_Beacon_Attach(&udp_beacon, &at_parser);
+    ESP_Server_ReserveLink(&esp_server, UDP_BEACON_LINK);
+  }
   /* USER CODE END RTOS_QUEUES */
 
   /* Create the thread(s) */
@@ -580,12 +1121,17 @@ int main(void)
   /* creation of webInterface */
   webInterfaceHandle = osThreadNew(StartWebInterface, NULL, &webInterface_attributes);
 
+  /* creation of atEngine */
+  atEngineHandle = osThreadNew(StartATEngine, NULL, &atEngine_attributes);
+
   /* USER CODE BEGIN RTOS_THREADS */
-  /* add threads, ... */
+  // Синхронные команды в потоке движка выполняются без ожидания флага
+  AT_Engine_SetThread(&at_engine, atEngineHandle);
   /* USER CODE END RTOS_THREADS */
 
   /* USER CODE BEGIN RTOS_EVENTS */
-  /* add events, ... */
+  // Прием от ESP запускается после создания объектов, с которыми работает прерывание
+  ESP_RX_Start();
   /* USER CODE END RTOS_EVENTS */
 
   /* Start scheduler */
@@ -822,6 +1368,9 @@ static void MX_DMA_Init(void)
   __HAL_RCC_DMA2_CLK_ENABLE();
 
   /* DMA interrupt init */
+  /* DMA2_Stream1_IRQn interrupt configuration */
+  HAL_NVIC_SetPriority(DMA2_Stream1_IRQn, 5, 0);
+  HAL_NVIC_EnableIRQ(DMA2_Stream1_IRQn);
   /* DMA2_Stream6_IRQn interrupt configuration */
   HAL_NVIC_SetPriority(DMA2_Stream6_IRQn, 5, 0);
   HAL_NVIC_EnableIRQ(DMA2_Stream6_IRQn);
@@ -894,24 +1443,29 @@ static void MX_GPIO_Init(void)
 void StartReadRS485(void *argument)
 {
   uint32_t last_save_time = 0;
+  uint8_t last_minute = 0xFF;
   SensorData sensor_data;
+  SystemSettings settings;
+  uint32_t next_poll = osKernelGetTickCount();
 
   for(;;)
   {
+    // Калибровка датчика и уставки для статистики
+    osMutexAcquire(settings_mutex, osWaitForever);
+    settings = system_settings;
+    osMutexRelease(settings_mutex);
+
     // Отправка запроса на чтение температуры
     Send_Modbus_Request(MODBUS_ADDRESS, MODBUS_READ_HOLDING_REG,
                        TEMP_REG_ADDR, 1);
-    RS485_EnableTX();
-    HAL_UART_Transmit(&huart1, modbus_frame, 8, RS485_TIMEOUT);
-    RS485_EnableRX();
 
     // Ожидание ответа
-    if(HAL_UART_Receive(&huart1, rs485_rx_buffer, 7, RS485_TIMEOUT) == HAL_OK)
+    if(RS485_Transaction(7))
     {
       uint16_t temp_raw;
       if(Parse_Modbus_Response(rs485_rx_buffer, &temp_raw, NULL))
       {
-        sensor_data.temperature = temp_raw / 10.0f; // Датчик возвращает значение * 10
+        sensor_data.temperature = temp_raw / 10.0f + settings.sensor_offset[0]; // Датчик возвращает значение * 10
       }
     }
 
@@ -920,17 +1474,14 @@ void StartReadRS485(void *argument)
     // Отправка запроса на чтение влажности
     Send_Modbus_Request(MODBUS_ADDRESS, MODBUS_READ_HOLDING_REG,
                        HUM_REG_ADDR, 1);
-    RS485_EnableTX();
-    HAL_UART_Transmit(&huart1, modbus_frame, 8, RS485_TIMEOUT);
-    RS485_EnableRX();
 
     // Ожидание ответа
-    if(HAL_UART_Receive(&huart1, rs485_rx_buffer, 7, RS485_TIMEOUT) == HAL_OK)
+    if(RS485_Transaction(7))
     {
       uint16_t hum_raw;
       if(Parse_Modbus_Response(rs485_rx_buffer, NULL, &hum_raw))
       {
-        sensor_data.humidity = hum_raw / 10.0f; // Датчик возвращает значение * 10
+        sensor_data.humidity = hum_raw / 10.0f + settings.sensor_offset[1]; // Датчик возвращает значение * 10
       }
     }
 
@@ -941,20 +1492,47 @@ void StartReadRS485(void *argument)
     HAL_RTC_GetDate(&hrtc, &sDate, RTC_FORMAT_BIN);
 
     // Создание timestamp
-    sensor_data.timestamp =
-        (sDate.Year + 2000) * 100000000 +
-        sDate.Month * 1000000 +
-        sDate.Date * 10000 +
-        sTime.Hours * 100 +
-        sTime.Minutes;
+    sensor_data.timestamp = Timestamp_FromRTC(&sDate, &sTime);
+
+    // Время на странице отображается с точностью до минуты
+    if(sTime.Minutes != last_minute)
+    {
+      last_minute = sTime.Minutes;
+      HTTP_Cache_Touch(HTTP_STATE_CLOCK);
+    }
 
     // Обновление текущих данных с защитой мьютексом
     osMutexAcquire(sensor_data_mutex, osWaitForever);
     current_sensor_data = sensor_data;
     osMutexRelease(sensor_data_mutex);
 
-    // Отправка данных в очередь для других потоков
-    osMessageQueuePut(sensor_data_queue, &sensor_data, 0, 0);
+    // Пробуждение потоков управления
+    osThreadFlagsSet(controlPIDTempHandle, CONTROL_FLAG_SENSOR);
+    osThreadFlagsSet(controlPIDHumHandle, CONTROL_FLAG_SENSOR);
+
+    // Очередь публикации на MQTT брокер (Unix-время)
+    if(MQTT_ENABLED)
+    {
+      MQTT_Client_Push(&mqtt_client, sensor_data.timestamp + EPOCH_2000_UNIX,
+                       sensor_data.temperature, sensor_data.humidity);
+      osThreadFlagsSet(exchangeATCommaHandle, EXCHANGE_FLAG_SAMPLE);
+    }
+
+    // Минимум, максимум и среднее во всех уровнях истории
+    History_Rollup_Add(&sensor_data);
+
+    // Стабильность: отклонения, время в пределах точности от уставки, работа выходов
+    Stats_SampleTypeDef sample = {
+      .timestamp = sensor_data.timestamp,
+      .value = { sensor_data.temperature, sensor_data.humidity },
+      .setpoint = { settings.temperature_setpoint, settings.humidity_setpoint },
+      .band = { TEMP_ACCURACY, HUM_ACCURACY },
+      .relay = { heating_active, humidification_active }
+    };
+    for(uint8_t i = 0; i < STATS_WINDOW_COUNT; i++)
+    {
+      Stats_Add(&stats_windows[i], &sample);
+    }
 
     // Сохранение в историю каждые 30 минут
     uint32_t current_time = osKernelGetTickCount();
@@ -972,7 +1550,16 @@ void StartReadRS485(void *argument)
     humidifier_running = HAL_GPIO_ReadPin(HumRun_In_GPIO_Port, HumRun_In_Pin);
     humidifier_service = HAL_GPIO_ReadPin(HumServ_In_GPIO_Port, HumServ_In_Pin);
 
-    osDelay(5000); // Чтение данных каждые 5 секунд
+    // Новые показания - кэшированные ответы устарели
+    HTTP_Cache_Touch(HTTP_STATE_SENSOR);
+
+    // Чтение данных каждые 5 секунд без накопления сдвига
+    next_poll += RS485_PERIOD;
+    if((int32_t)(next_poll - osKernelGetTickCount()) <= 0)
+    {
+      next_poll = osKernelGetTickCount() + RS485_PERIOD;
+    }
+    osDelayUntil(next_poll);
   }
 }
 
@@ -982,47 +1569,61 @@ void StartReadRS485(void *argument)
 void StartControlPIDTemp(void *argument)
 {
   SensorData sensor_data;
+  SystemSettings settings;
+  uint32_t command_cycles;
+  uint8_t have_sample = 0;
   float pid_output;
 
   for(;;)
   {
-    // Получение текущих данных из очереди
-    if(osMessageQueueGet(sensor_data_queue, &sensor_data, NULL, 100) == osOK)
+    // Управление по событию: новые показания или изменение настроек
+    uint32_t flags = osThreadFlagsWait(CONTROL_FLAG_SENSOR | CONTROL_FLAG_SETTINGS,
+                                       osFlagsWaitAny, osWaitForever);
+    if(flags & osFlagsError)
+      continue;
+
+    osMutexAcquire(sensor_data_mutex, osWaitForever);
+    sensor_data = current_sensor_data;
+    osMutexRelease(sensor_data_mutex);
+
+    // Получение текущих настроек с защитой мьютексом
+    osMutexAcquire(settings_mutex, osWaitForever);
+    Web_Settings_Apply();
+    settings = system_settings;
+    command_cycles = web_settings_cycles;
+    osMutexRelease(settings_mutex);
+
+    if(flags & CONTROL_FLAG_SENSOR)
     {
-      // Получение текущих настроек с защитой мьютексом
-      SystemSettings settings;
-      osMutexAcquire(settings_mutex, osWaitForever);
-      settings = system_settings;
-      osMutexRelease(settings_mutex);
+      have_sample = 1;
+    }
 
-      if(settings.auto_mode)
-      {
-        // Автоматический режим - использование ПИД регулятора
-        pid_output = PID_Compute(&pid_temp, sensor_data.temperature,
-                                settings.temperature_setpoint);
+    if(settings.auto_mode)
+    {
+      if(!have_sample)
+        continue;
 
-        // Преобразование выхода ПИД в релейное управление
-        if(pid_output > 0.5f)
-        {
-          heating_active = 1;
-          HAL_GPIO_WritePin(Heat_Out_GPIO_Port, Heat_Out_Pin, GPIO_PIN_SET);
-        }
-        else
-        {
-          heating_active = 0;
-          HAL_GPIO_WritePin(Heat_Out_GPIO_Port, Heat_Out_Pin, GPIO_PIN_RESET);
-        }
-      }
-      else
-      {
-        // Ручной режим
-        heating_active = settings.heating_enabled;
-        HAL_GPIO_WritePin(Heat_Out_GPIO_Port, Heat_Out_Pin,
-                         settings.heating_enabled ? GPIO_PIN_SET : GPIO_PIN_RESET);
-      }
+      // Автоматический режим - использование ПИД регулятора. Шаг регулятора
+      // только по новым показаниям, при смене уставки - пересчет выхода
+      PID_SetTunings(&pid_temp, settings.pid_gains[0][0], settings.pid_gains[0][1],
+                     settings.pid_gains[0][2]);
+      pid_output = (flags & CONTROL_FLAG_SENSOR) ?
+                   PID_Compute(&pid_temp, sensor_data.temperature, settings.temperature_setpoint) :
+                   PID_Evaluate(&pid_temp, sensor_data.temperature, settings.temperature_setpoint);
+
+      // Преобразование выхода ПИД в релейное управление
+      Set_Heating_Output(pid_output > 0.5f);
+    }
+    else
+    {
+      // Ручной режим
+      Set_Heating_Output(settings.heating_enabled);
     }
 
-    osDelay(1000); // Управление каждую секунду
+    if(flags & CONTROL_FLAG_SETTINGS)
+    {
+      Control_Latency_Record(command_cycles);
+    }
   }
 }
 
@@ -1032,57 +1633,66 @@ void StartControlPIDTemp(void *argument)
 void StartControlPIDHum(void *argument)
 {
   SensorData sensor_data;
+  SystemSettings settings;
+  uint32_t command_cycles;
+  uint8_t have_sample = 0;
   float pid_output;
 
   for(;;)
   {
-    // Получение текущих данных из очереди
-    if(osMessageQueueGet(sensor_data_queue, &sensor_data, NULL, 100) == osOK)
+    // Управление по событию: новые показания или изменение настроек
+    uint32_t flags = osThreadFlagsWait(CONTROL_FLAG_SENSOR | CONTROL_FLAG_SETTINGS,
+                                       osFlagsWaitAny, osWaitForever);
+    if(flags & osFlagsError)
+      continue;
+
+    osMutexAcquire(sensor_data_mutex, osWaitForever);
+    sensor_data = current_sensor_data;
+    osMutexRelease(sensor_data_mutex);
+
+    // Получение текущих настроек с защитой мьютексом
+    osMutexAcquire(settings_mutex, osWaitForever);
+    Web_Settings_Apply();
+    settings = system_settings;
+    command_cycles = web_settings_cycles;
+    osMutexRelease(settings_mutex);
+
+    if(flags & CONTROL_FLAG_SENSOR)
     {
-      // Получение текущих настроек с защитой мьютексом
-      SystemSettings settings;
-      osMutexAcquire(settings_mutex, osWaitForever);
-      settings = system_settings;
-      osMutexRelease(settings_mutex);
+      have_sample = 1;
+    }
 
-      // Проверка аварии увлажнителя
-      if(humidifier_alarm)
-      {
-        // Авария - выключаем увлажнение
-        humidification_active = 0;
-        HAL_GPIO_WritePin(Humidification_Out_GPIO_Port, Humidification_Out_Pin, GPIO_PIN_RESET);
-        osDelay(1000);
+    // Проверка аварии увлажнителя
+    if(humidifier_alarm)
+    {
+      // Авария - выключаем увлажнение
+      Set_Humidification_Output(0);
+    }
+    else if(settings.auto_mode)
+    {
+      if(!have_sample)
         continue;
-      }
 
-      if(settings.auto_mode)
-      {
-        // Автоматический режим - использование ПИД регулятора
-        pid_output = PID_Compute(&pid_hum, sensor_data.humidity,
-                                settings.humidity_setpoint);
+      // Автоматический режим - использование ПИД регулятора
+      PID_SetTunings(&pid_hum, settings.pid_gains[1][0], settings.pid_gains[1][1],
+                     settings.pid_gains[1][2]);
+      pid_output = (flags & CONTROL_FLAG_SENSOR) ?
+                   PID_Compute(&pid_hum, sensor_data.humidity, settings.humidity_setpoint) :
+                   PID_Evaluate(&pid_hum, sensor_data.humidity, settings.humidity_setpoint);
 
-        // Преобразование выхода ПИД в релейное управление
-        if(pid_output > 0.5f)
-        {
-          humidification_active = 1;
-          HAL_GPIO_WritePin(Humidification_Out_GPIO_Port, Humidification_Out_Pin, GPIO_PIN_SET);
-        }
-        else
-        {
-          humidification_active = 0;
-          HAL_GPIO_WritePin(Humidification_Out_GPIO_Port, Humidification_Out_Pin, GPIO_PIN_RESET);
-        }
-      }
-      else
-      {
-        // Ручной режим
-        humidification_active = settings.humidification_enabled;
-        HAL_GPIO_WritePin(Humidification_Out_GPIO_Port, Humidification_Out_Pin,
-                         settings.humidification_enabled ? GPIO_PIN_SET : GPIO_PIN_RESET);
-      }
+      // Преобразование выхода ПИД в релейное управление
+      Set_Humidification_Output(pid_output > 0.5f);
+    }
+    else
+    {
+      // Ручной режим
+      Set_Humidification_Output(settings.humidification_enabled);
     }
 
-    osDelay(1000); // Управление каждую секунду
+    if(flags & CONTROL_FLAG_SETTINGS)
+    {
+      Control_Latency_Record(command_cycles);
+    }
   }
 }
 
@@ -1091,168 +1701,333 @@ void StartControlPIDHum(void *argument)
   */
 void StartExchangeATCommand(void *argument)
 {
-    char command[64];
-
-    // Инициализация ESP модуля
-    ESP_Init();
+    // Подключение к брокеру идет в потоке движка AT, результат будит этот поток
+    MQTT_Client_SetThread(&mqtt_client, osThreadGetId(), EXCHANGE_FLAG_MQTT);
 
     for(;;)
     {
-        // Проверка очереди команд от веб-интерфейса
-        if(osMessageQueueGet(web_command_queue, command, NULL, 0) == osOK)
+        // Проверка состояния Wi-Fi
+        uint32_t timeout = Check_WiFi_Status();
+
+        // Подключение к брокеру и публикация накопленных показаний
+        if(MQTT_ENABLED && wifi_ap_active)
         {
-            Process_Web_Command(command);
+            timeout = MIN(timeout, MQTT_Client_Process(&mqtt_client));
         }
 
-        // Проверка состояния Wi-Fi
-        Check_WiFi_Status();
+        // Запись измененных настроек в резервную SRAM
+        timeout = MIN(timeout, Settings_Save_Process());
 
-        osDelay(1000);
+        // Сон до ближайшего срока или до нового показания, изменения настроек, Wi-Fi, брокера
+        osThreadFlagsWait(EXCHANGE_FLAG_SAMPLE | EXCHANGE_FLAG_SETTINGS | EXCHANGE_FLAG_WIFI |
+                          EXCHANGE_FLAG_MQTT, osFlagsWaitAny, timeout);
     }
 }
 
 /**
   * @brief Поток веб-интерфейса
+  * Формирует ответы на запросы, принятые потоком движка AT
   */
 void StartWebInterface(void *argument)
 {
-    char http_request[512];
-    char http_response[2048];
-    uint8_t client_id = 0;
-    char *ipd_marker = "+IPD,";
+    WebRequest web_request;
+
+    for(;;)
+    {
+        if(osMessageQueueGet(web_request_queue, &web_request, NULL, osWaitForever) == osOK)
+        {
+            Handle_HTTP_Request(web_request.link_id, web_request.request, web_request.length);
+        }
+    }
+}
+
+/**
+  * @brief Поток движка AT: единственный владелец USART6
+  * Разбирает прием, отправляет команды из очереди и ответы HTTP сервера
+  */
+void StartATEngine(void *argument)
+{
+    static uint32_t last_retry = 0;
 
-    // Начальная очистка буфера
-    memset(esp_rx_buffer, 0, sizeof(esp_rx_buffer));
+    // Инициализация ESP модуля
+    ESP_Init();
+    last_retry = osKernelGetTickCount();
 
     for(;;)
     {
+        // Разбор всего принятого DMA: ответы на команды, уведомления
+        // соединений и данные +IPD разных клиентов
+        ESP_RX_Poll();
+        AT_Engine_Process(&at_engine);
+
         if(wifi_ap_active)
         {
-            // Асинхронное чтение данных от ESP
-            uint16_t bytes_available = 0;
-            uint8_t tmp_buffer[256];
+            // Готовые запросы - потоку веб-интерфейса, готовые ответы - в очередь движка
+            ESP_Server_Process(&esp_server);
+            AT_Engine_Process(&at_engine);
+        }
+        else if(osKernelGetTickCount() - last_retry > 30000)
+        {
+            // Если Wi-Fi неактивен, пробуем переинициализировать каждые 30 секунд
+            ESP_Init();
+            last_retry = osKernelGetTickCount();
+        }
 
-            // Проверяем, есть ли данные в UART
-            if(HAL_UART_Receive(&huart6, tmp_buffer, sizeof(tmp_buffer), 10) == HAL_OK)
-            {
-                // Добавляем данные в буфер
-                strncat((char*)esp_rx_buffer, (char*)tmp_buffer, sizeof(tmp_buffer));
-
-                // Ищем маркер входящих данных "+IPD"
-                char *ipd_start = strstr((char*)esp_rx_buffer, ipd_marker);
-                if(ipd_start)
-                {
-                    // Извлекаем ID клиента и длину данных
-                    // Формат: +IPD,<client_id>,<length>:<data>
-                    char *comma = strchr(ipd_start, ',');
-                    if(comma)
-                    {
-                        client_id = atoi(comma + 1);
-                        char *colon = strchr(comma, ':');
-                        if(colon)
-                        {
-                            // Копируем HTTP запрос
-                            strncpy(http_request, colon + 1, sizeof(http_request) - 1);
-                            http_request[sizeof(http_request) - 1] = '\0';
-
-                            // Обработка HTTP запроса
-                            if(strstr(http_request, "GET / "))
-                            {
-                                // Главная страница
-                                Generate_HTML_Page(http_response, sizeof(http_response));
-                            }
-                            else if(strstr(http_request, "GET /index.html"))
-                            {
-                                // Главная страница
-                                Generate_HTML_Page(http_response, sizeof(http_response));
-                            }
-                            else if(strstr(http_request, "GET /data"))
-                            {
-                                // JSON данные для AJAX
-                                Generate_JSON_Data(http_response, sizeof(http_response));
-                            }
-                            else if(strstr(http_request, "GET /control"))
-                            {
-                                // Обработка команд управления
-                                char *query = strstr(http_request, "?");
-                                if(query)
-                                {
-                                    osMessageQueuePut(web_command_queue, query, 0, 0);
-                                }
-                                snprintf(http_response, sizeof(http_response),
-                                         "HTTP/1.1 200 OK\r\n"
-                                         "Content-Type: text/plain\r\n"
-                                         "Access-Control-Allow-Origin: *\r\n"
-                                         "\r\nOK");
-                            }
-                            else if(strstr(http_request, "GET /settings"))
-                            {
-                                // Обработка настроек
-                                char *query = strstr(http_request, "?");
-                                if(query)
-                                {
-                                    osMessageQueuePut(web_command_queue, query, 0, 0);
-                                }
-                                snprintf(http_response, sizeof(http_response),
-                                         "HTTP/1.1 200 OK\r\n"
-                                         "Content-Type: text/plain\r\n"
-                                         "Access-Control-Allow-Origin: *\r\n"
-                                         "\r\nOK");
-                            }
-                            else
-                            {
-                                // Страница не найдена
-                                snprintf(http_response, sizeof(http_response),
-                                         "HTTP/1.1 404 Not Found\r\n"
-                                         "Content-Type: text/html\r\n"
-                                         "\r\n<h1>404 Not Found</h1>");
-                            }
-
-                            // Отправка HTTP ответа
-                            char send_cmd[64];
-                            snprintf(send_cmd, sizeof(send_cmd),
-                                     "AT+CIPSEND=%d,%d\r\n",
-                                     client_id, strlen(http_response));
-                            Send_AT_Command(send_cmd);
-
-                            // Ждем приглашения ">"
-                            if(Wait_AT_Response(">", 1000))
-                            {
-                                // Отправляем HTTP ответ
-                                Send_AT_Command(http_response);
-
-                                // Закрываем соединение
-                                snprintf(send_cmd, sizeof(send_cmd),
-                                         "AT+CIPCLOSE=%d\r\n", client_id);
-                                Send_AT_Command(send_cmd);
-                            }
-
-                            // Очищаем буфер после обработки
-                            memset(esp_rx_buffer, 0, sizeof(esp_rx_buffer));
-                        }
-                    }
-                }
-
-                // Очистка буфера если он переполнен
-                if(strlen((char*)esp_rx_buffer) > 400)
-                {
-                    memset(esp_rx_buffer, 0, sizeof(esp_rx_buffer));
-                }
-            }
+        // Сон до данных от ESP, новой команды или ответа либо до ближайшего
+        // тайм-аута: команды движка, незавершенного запроса, повтора инициализации
+        uint32_t timeout = AT_Engine_Timeout(&at_engine);
+        if(wifi_ap_active)
+        {
+            timeout = MIN(timeout, ESP_Server_Timeout(&esp_server));
         }
         else
         {
-            // Если Wi-Fi неактивен, пробуем переинициализировать каждые 30 секунд
-            static uint32_t last_retry = 0;
-            if(osKernelGetTickCount() - last_retry > 30000)
+            uint32_t elapsed = osKernelGetTickCount() - last_retry;
+            timeout = MIN(timeout, (elapsed > 30000) ? 0 : 30001 - elapsed);
+        }
+        osEventFlagsWait(esp_rx_event, ESP_RX_EVENT_DATA | ESP_EVENT_WAKE, osFlagsWaitAny, timeout);
+    }
+}
+
+/**
+  * @brief Передача принятого запроса потоку веб-интерфейса (поток движка AT)
+  */
+static void Queue_HTTP_Request(uint8_t link_id, char *request, uint32_t length)
+{
+    WebRequest web_request = { link_id, request, length };
+
+    if(osMessageQueuePut(web_request_queue, &web_request, 0, 0) != osOK)
+    {
+        // Очередь заполнена: соединение закрывается без ответа
+        ESP_Server_Respond(&esp_server, link_id, NULL, 0, NULL, NULL);
+    }
+}
+
+/**
+  * @brief Обработка HTTP запроса клиента
+  * @param request: строка запроса и тело, заголовки отброшены
+  */
+static void Handle_HTTP_Request(uint8_t link_id, char *request, uint32_t length)
+{
+    uint32_t size;
+    char *http_response;
+    const char *response;
+    uint32_t response_length;
+
+    if(strncmp(request, "GET / ", 6) == 0 || strncmp(request, "GET /index.html", 15) == 0)
+    {
+        // Главная страница отправляется прямо из буфера кэша
+        response = HTTP_Cache_Get(&http_page_cache, &response_length);
+        ESP_Server_Respond(&esp_server, link_id, response, response_length,
+                           HTTP_Cache_Sent, &http_page_cache);
+        return;
+    }
+
+    if(strncmp(request, "GET /data", 9) == 0)
+    {
+        // JSON данные для AJAX
+        response = HTTP_Cache_Get(&http_data_cache, &response_length);
+        ESP_Server_Respond(&esp_server, link_id, response, response_length,
+                           HTTP_Cache_Sent, &http_data_cache);
+        return;
+    }
+
+    if(strncmp(request, "GET /debug/trace", 16) == 0)
+    {
+        // Двоичный дамп журнала трассировки (Tools/trace_convert)
+        response_length = Generate_Trace_Dump();
+        if(response_length > 0)
+        {
+            ESP_Server_Respond(&esp_server, link_id, (const char*)trace_buffer, response_length,
+                               Trace_Sent, NULL);
+        }
+        else
+        {
+            // Предыдущий дамп еще отправляется
+            ESP_Server_Respond(&esp_server, link_id, http_busy_response,
+                               sizeof(http_busy_response) - 1, NULL, NULL);
+        }
+        return;
+    }
+
+    if(strncmp(request, "GET /history", 12) == 0 && strncmp(request + 12, "/rollup", 7) != 0)
+    {
+        // Прореженный ряд истории для графика, число точек выбирает клиент
+        uint32_t points;
+
+        if(!History_ParsePoints(request, &points))
+        {
+            ESP_Server_Respond(&esp_server, link_id, http_bad_request_response,
+                               sizeof(http_bad_request_response) - 1, NULL, NULL);
+        }
+        else if(history_json_busy)
+        {
+            // Предыдущий ответ еще отправляется
+            ESP_Server_Respond(&esp_server, link_id, http_busy_response,
+                               sizeof(http_busy_response) - 1, NULL, NULL);
+        }
+        else
+        {
+            history_json_busy = 1;
+            Generate_History_JSON((char*)history_json_buffer, sizeof(history_json_buffer), points);
+            ESP_Server_Respond(&esp_server, link_id, (const char*)history_json_buffer,
+                               strlen((const char*)history_json_buffer), History_Sent, NULL);
+        }
+        return;
+    }
+
+    // Остальные ответы формируются в блоке пула ответов
+    http_response = ESP_Server_ResponseBuffer(&esp_server, link_id, &size);
+    if(http_response == NULL)
+    {
+        ESP_Server_Respond(&esp_server, link_id, http_busy_response,
+                           sizeof(http_busy_response) - 1, NULL, NULL);
+        return;
+    }
+
+    if(strncmp(request, "GET /history/rollup", 19) == 0)
+    {
+        // Минимум, максимум и среднее за диапазон (Unix-время), по умолчанию - сутки
+        uint32_t now = current_sensor_data.timestamp + EPOCH_2000_UNIX;
+        char *param;
+
+        uint32_t to = (param = strstr(request, "to=")) ? strtoul(param + 3, NULL, 10) : now + 1;
+        uint32_t from = (param = strstr(request, "from=")) ? strtoul(param + 5, NULL, 10) : to - 24 * 60 * 60;
+        uint32_t step = (param = strstr(request, "step=")) ? strtoul(param + 5, NULL, 10) : 0;
+        Generate_Rollup_JSON(http_response, size, from, to, step);
+    }
+    else if(strncmp(request, "GET /stats", 10) == 0)
+    {
+        // Статистика за текущие и предыдущие окна
+        Generate_Stats_JSON(http_response, size);
+    }
+    else if(strncmp(request, "GET /control", 12) == 0 || strncmp(request, "GET /settings", 13) == 0 ||
+            strncmp(request, "POST /settings", 14) == 0)
+    {
+        // Несколько полей за один запрос: в теле POST
+        // (application/x-www-form-urlencoded) или в строке запроса GET
+        WebSettingsUpdate update;
+        char *query;
+
+        if(request[0] == 'P')
+        {
+            query = strstr(request, "\r\n\r\n");
+            query = query ? query + 4 : NULL;
+        }
+        else
+        {
+            query = strchr(request, '?');
+            if(query)
             {
-                ESP_Init();
-                last_retry = osKernelGetTickCount();
+                query[strcspn(query, " \r\n")] = '\0';
             }
         }
+        memset(&update, 0, sizeof(update));
+        if(query)
+        {
+            Web_Settings_Parse(query, &update);
+        }
+        if(update.invalid)
+        {
+            // Запрос не применяется частично
+            snprintf(http_response, size, "%s", http_bad_request_response);
+        }
+        else
+        {
+            Web_Clock_Set(&update);
+            Web_Settings_Submit(&update);
+            snprintf(http_response, size,
+                     "HTTP/1.1 200 OK\r\n"
+                     "Content-Type: text/plain\r\n"
+                     "Access-Control-Allow-Origin: *\r\n"
+                     "\r\nOK");
+        }
+    }
+    else if(strncmp(request, "GET /debug/cache", 16) == 0)
+    {
+        // Статистика кэша ответов
+        Generate_Cache_Stats_JSON(http_response, size);
+    }
+    else if(strncmp(request, "GET /debug/control", 18) == 0)
+    {
+        // Задержка от команды до переключения выхода
+        Generate_Control_Stats_JSON(http_response, size);
+    }
+    else if(strncmp(request, "GET /debug/memory", 17) == 0)
+    {
+        // Занятость SRAM и CCM RAM по символам компоновщика
+        Generate_Memory_Stats_JSON(http_response, size);
+    }
+    else if(strncmp(request, "GET /debug/tasks", 16) == 0)
+    {
+        // Загрузка процессора, состояние и запас стека потоков
+        Generate_Tasks_JSON(http_response, size);
+    }
+    else if(strncmp(request, "GET /debug/flash", 16) == 0)
+    {
+        // Состояние журнала истории во flash
+        Generate_Flash_Stats_JSON(http_response, size);
+    }
+    else if(strncmp(request, "GET /debug/esp", 14) == 0)
+    {
+        // Статистика приема и отправки ESP
+        Generate_ESP_Stats_JSON(http_response, size);
+    }
+    else
+    {
+        // Страница не найдена
+        snprintf(http_response, size,
+                 "HTTP/1.1 404 Not Found\r\n"
+                 "Content-Type: text/html\r\n"
+                 "\r\n<h1>404 Not Found</h1>");
+    }
+
+    ESP_Server_Respond(&esp_server, link_id, http_response, strlen(http_response), NULL, NULL);
+}
+
+/**
+  * @brief Ответ из кэша отправлен, буфер можно перерисовывать
+  */
+static void HTTP_Cache_Sent(void *ctx)
+{
+    HTTP_Cache_Release((HTTP_CacheEntryTypeDef*)ctx);
+}
 
-        osDelay(50);
+/**
+  * @brief Ответ /history отправлен, буфер свободен
+  */
+static void History_Sent(void *ctx)
+{
+    history_json_busy = 0;
+}
+
+/**
+  * @brief Дамп журнала трассировки в trace_buffer
+  * Запись событий остановлена до вызова Trace_Sent
+  * @retval Длина ответа вместе с заголовками, 0 - предыдущий дамп не отправлен
+  */
+static uint32_t Generate_Trace_Dump(void)
+{
+    // Имена команд AT по номерам в статистике движка
+    for(uint8_t i = 0; i < at_engine.stats_count; i++)
+    {
+        Trace_SetName(TRACE_NAME_AT, i, at_engine.stats[i].name);
     }
+
+    uint32_t length = Trace_Freeze();
+    if(length == 0)
+        return 0;
+
+    return HTTP_Build_Response((char*)trace_buffer, sizeof(trace_buffer),
+                               "application/octet-stream", length);
+}
+
+/**
+  * @brief Дамп отправлен: кольцо очищается и запись продолжается
+  */
+static void Trace_Sent(void *ctx)
+{
+    Trace_Resume();
 }
 
 /**
@@ -1270,22 +2045,61 @@ static void RS485_EnableTX(void)
   */
 static void RS485_EnableRX(void)
 {
+  // Вызывается и из прерывания окончания передачи: без задержки,
+  // ответ датчика начинается через 3.5 символа
   HAL_GPIO_WritePin(DE_RS_Out_GPIO_Port, DE_RS_Out_Pin, GPIO_PIN_RESET);
   HAL_GPIO_WritePin(RE_RS_Out_GPIO_Port, RE_RS_Out_Pin, GPIO_PIN_RESET);
-  osDelay(1); // Задержка для стабилизации
 }
 
 /**
-  * @brief Расчет CRC16 для Modbus
+  * @brief Обмен с датчиком: передача modbus_frame и прием ответа в прерываниях
+  * Поток спит до флага из callback'ов USART1 или до RS485_TIMEOUT
+  * @retval 1 - принят ответ длиной rx_length
   */
-static uint16_t Modbus_CRC16(uint8_t *data, uint16_t length)
+static uint8_t RS485_Transaction(uint16_t rx_length)
 {
-  uint16_t crc = 0xFFFF;
+  uint8_t result = 0;
 
-  for(uint16_t i = 0; i < length; i++)
+  TRACE(TRACE_MODBUS_START, modbus_frame[0], (modbus_frame[2] << 8) | modbus_frame[3]);
+  osThreadFlagsClear(RS485_FLAG_DONE | RS485_FLAG_ERROR);
+  rs485_rx_length = rx_length;
+
+  // Прием запускается в HAL_UART_TxCpltCallback после последнего стоп-бита
+  RS485_EnableTX();
+  if(HAL_UART_Transmit_IT(&huart1, modbus_frame, sizeof(modbus_frame)) != HAL_OK)
   {
-    crc ^= data[i];
-    for(uint8_t j = 0; j < 8; j++)
+    RS485_EnableRX();
+  }
+  else
+  {
+    uint32_t flags = osThreadFlagsWait(RS485_FLAG_DONE | RS485_FLAG_ERROR, osFlagsWaitAny, RS485_TIMEOUT);
+    if((flags & osFlagsError) || (flags & RS485_FLAG_ERROR))
+    {
+      // Нет ответа или ошибка: незавершенный обмен прерывается
+      HAL_UART_Abort(&huart1);
+      RS485_EnableRX();
+    }
+    else
+    {
+      result = 1;
+    }
+  }
+
+  TRACE(TRACE_MODBUS_END, modbus_frame[0], result);
+  return result;
+}
+
+/**
+  * @brief Расчет CRC16 для Modbus
+  */
+static uint16_t Modbus_CRC16(uint8_t *data, uint16_t length)
+{
+  uint16_t crc = 0xFFFF;
+
+  for(uint16_t i = 0; i < length; i++)
+  {
+    crc ^= data[i];
+    for(uint8_t j = 0; j < 8; j++)
     {
       if(crc & 0x0001)
       {
@@ -1359,21 +2173,60 @@ static uint8_t Parse_Modbus_Response(uint8_t *response, uint16_t *temperature, u
   */
 static void Update_History(SensorData data)
 {
-  osMutexAcquire(history_mutex, osWaitForever);
+  History_Store(&data);
+
+  // Копия во flash, программируется пачками по FLASH_LOG_BATCH_RECORDS
+  float values[2] = { data.temperature, data.humidity };
+  FlashLog_Append(&history_log, data.timestamp, values);
+
+  HTTP_Cache_Touch(HTTP_STATE_HISTORY);
+}
+
+/**
+  * @brief Управление выходом обогрева
+  */
+static void Set_Heating_Output(uint8_t active)
+{
+  HAL_GPIO_WritePin(Heat_Out_GPIO_Port, Heat_Out_Pin, active ? GPIO_PIN_SET : GPIO_PIN_RESET);
 
-  // Сдвиг истории
-  for(int i = HISTORY_SIZE - 1; i > 0; i--)
+  // Состояние выхода отображается в веб-интерфейсе
+  if(heating_active != active)
   {
-    history_data[i] = history_data[i-1];
+    heating_active = active;
+    HTTP_Cache_Touch(HTTP_STATE_SENSOR);
   }
+}
+
+/**
+  * @brief Управление выходом увлажнения
+  */
+static void Set_Humidification_Output(uint8_t active)
+{
+  HAL_GPIO_WritePin(Humidification_Out_GPIO_Port, Humidification_Out_Pin, active ? GPIO_PIN_SET : GPIO_PIN_RESET);
 
-  // Добавление новых данных
-  history_data[0] = data;
+  if(humidification_active != active)
+  {
+    humidification_active = active;
+    HTTP_Cache_Touch(HTTP_STATE_SENSOR);
+  }
+}
 
-  // Обновление индекса
-  history_index = (history_index + 1) % HISTORY_SIZE;
+/**
+  * @brief Учет задержки от приема команды до записи выхода
+  */
+static void Control_Latency_Record(uint32_t command_cycles)
+{
+  uint32_t latency_us = (DWT->CYCCNT - command_cycles) / (SystemCoreClock / 1000000);
 
-  osMutexRelease(history_mutex);
+  osKernelLock();
+  control_latency_count++;
+  control_latency_last_us = latency_us;
+  control_latency_total_us += latency_us;
+  if(latency_us > control_latency_max_us)
+  {
+    control_latency_max_us = latency_us;
+  }
+  osKernelUnlock();
 }
 
 /**
@@ -1401,344 +2254,1591 @@ static void Update_LEDs(void)
 }
 
 /**
-  * @brief Обработка веб-команд
+  * @brief Числа значения поля через '-' или ':': "2026-10-19", "14%3A30"
+  * @retval Количество прочитанных чисел
   */
-static void Process_Web_Command(char *command)
+static uint8_t Web_Parse_Numbers(const char *value, uint16_t *numbers, uint8_t count)
 {
-  char *token;
-  char *saveptr;
+  uint8_t read = 0;
 
-  token = strtok_r(command, "?&", &saveptr);
-  while(token != NULL)
+  while(read < count && *value >= '0' && *value <= '9')
   {
-    if(strstr(token, "mode="))
-    {
-      system_settings.auto_mode = atoi(token + 5);
-    }
-    else if(strstr(token, "heating="))
-    {
-      system_settings.heating_enabled = atoi(token + 8);
-    }
-    else if(strstr(token, "humidification="))
-    {
-      system_settings.humidification_enabled = atoi(token + 15);
-    }
-    else if(strstr(token, "heat_setpoint="))
+    char *end;
+    unsigned long number = strtoul(value, &end, 10);
+
+    numbers[read++] = (number > 0xFFFF) ? 0xFFFF : (uint16_t)number;
+    value = end;
+    if(*value == '-' || *value == ':')
     {
-      system_settings.temperature_setpoint = atof(token + 14);
-      system_settings.temperature_setpoint =
-          CLAMP(system_settings.temperature_setpoint, TEMP_MIN, TEMP_MAX);
+      value++;
     }
-    else if(strstr(token, "hum_setpoint="))
+    else if(strncasecmp(value, "%3A", 3) == 0)
     {
-      system_settings.humidity_setpoint = atof(token + 13);
-      system_settings.humidity_setpoint =
-          CLAMP(system_settings.humidity_setpoint, HUM_MIN, HUM_MAX);
+      value += 3;
     }
-    else if(strstr(token, "date=") && strstr(token, "time="))
+    else
     {
-      // Установка времени RTC
-      // Парсинг даты и времени из команды
-      // Реализация зависит от формата
+      break;
     }
-
-    token = strtok_r(NULL, "?&", &saveptr);
   }
+  return (*value == '\0') ? read : 0;
 }
 
 /**
-  * @brief Отправка AT команды
+  * @brief Дней в месяце, year - от 2000
   */
-static void Send_AT_Command(const char *cmd)
+static uint8_t Days_In_Month(uint16_t year, uint16_t month)
 {
-  HAL_UART_Transmit(&huart6, (uint8_t*)cmd, strlen(cmd), 1000);
+  static const uint8_t days_in_month[12] = {
+    31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+  };
+
+  return days_in_month[month - 1] + ((month == 2 && (year % 4) == 0) ? 1 : 0);
 }
 
 /**
-  * @brief Ожидание AT ответа
+  * @brief Разбор полей настроек: "mode=1&heat_setpoint=22.5&..."
+  * Значения ограничиваются допустимыми диапазонами
   */
-static uint8_t Wait_AT_Response(const char *expected, uint32_t timeout)
+static void Web_Settings_Parse(char *query, WebSettingsUpdate *update)
 {
-  uint32_t start_time = osKernelGetTickCount();
-  uint16_t index = 0;
+  char *token;
+  char *saveptr;
+
+  memset(update, 0, sizeof(*update));
 
-  while((osKernelGetTickCount() - start_time) < timeout)
+  token = strtok_r(query, "?&\r\n", &saveptr);
+  while(token != NULL)
   {
-    if(HAL_UART_Receive(&huart6, &esp_rx_buffer[index], 1, 10) == HAL_OK)
+    if(strncmp(token, "mode=", 5) == 0)
     {
-      index++;
-      esp_rx_buffer[index] = '\0';
-
-      if(strstr((char*)esp_rx_buffer, expected))
+      update->auto_mode = atoi(token + 5) != 0;
+      update->mask |= WEB_SET_MODE;
+    }
+    else if(strncmp(token, "heating=", 8) == 0)
+    {
+      update->heating_enabled = atoi(token + 8) != 0;
+      update->mask |= WEB_SET_HEATING;
+    }
+    else if(strncmp(token, "humidification=", 15) == 0)
+    {
+      update->humidification_enabled = atoi(token + 15) != 0;
+      update->mask |= WEB_SET_HUMIDIFICATION;
+    }
+    else if(strncmp(token, "heat_setpoint=", 14) == 0)
+    {
+      update->temperature_setpoint = CLAMP((float)atof(token + 14), TEMP_MIN, TEMP_MAX);
+      update->mask |= WEB_SET_TEMP_SETPOINT;
+    }
+    else if(strncmp(token, "hum_setpoint=", 13) == 0)
+    {
+      update->humidity_setpoint = CLAMP((float)atof(token + 13), HUM_MIN, HUM_MAX);
+      update->mask |= WEB_SET_HUM_SETPOINT;
+    }
+    else if(strncmp(token, "temp_offset=", 12) == 0 || strncmp(token, "hum_offset=", 11) == 0)
+    {
+      // Калибровка датчика
+      uint8_t channel = (token[0] == 'h');
+      char *value = strchr(token, '=') + 1;
+      update->sensor_offset[channel] = CLAMP((float)atof(value), -10.0f, 10.0f);
+      update->mask |= WEB_SET_OFFSET(channel);
+    }
+    else if((strncmp(token, "temp_k", 6) == 0 || strncmp(token, "hum_k", 5) == 0) &&
+            strchr(token, '=') != NULL)
+    {
+      // Коэффициенты ПИД: temp_kp, temp_ki, temp_kd, hum_kp, hum_ki, hum_kd
+      uint8_t channel = (token[0] == 'h');
+      char *name = strchr(token, '_') + 2;
+      const char *gains = "pid";
+      const char *gain = (name[1] == '=') ? strchr(gains, name[0]) : NULL;
+      if(gain)
       {
-        return 1;
+        uint8_t index = channel * 3 + (gain - gains);
+        update->pid_gains[channel][gain - gains] = CLAMP((float)atof(name + 2), 0.0f, 100.0f);
+        update->mask |= WEB_SET_PID_GAIN(index);
       }
-
-      if(index >= sizeof(esp_rx_buffer) - 1)
+    }
+    else if(strncmp(token, "date=", 5) == 0)
+    {
+      // Дата RTC: ГГГГ-ММ-ДД
+      uint16_t field[3];
+      if(Web_Parse_Numbers(token + 5, field, 3) == 3 &&
+         field[0] >= 2000 && field[0] <= 2099 && field[1] >= 1 && field[1] <= 12 &&
+         field[2] >= 1 && field[2] <= Days_In_Month(field[0] - 2000, field[1]))
+      {
+        update->date.Year = field[0] - 2000;
+        update->date.Month = field[1];
+        update->date.Date = field[2];
+        update->mask |= WEB_SET_DATE;
+      }
+      else
       {
-        index = 0;
+        update->invalid = 1;
+      }
+    }
+    else if(strncmp(token, "time=", 5) == 0)
+    {
+      // Время RTC: ЧЧ:ММ или ЧЧ:ММ:СС, двоеточие может прийти как %3A
+      uint16_t field[3] = { 0, 0, 0 };
+      uint8_t count = Web_Parse_Numbers(token + 5, field, 3);
+      if(count >= 2 && field[0] < 24 && field[1] < 60 && field[2] < 60)
+      {
+        update->time.Hours = field[0];
+        update->time.Minutes = field[1];
+        update->time.Seconds = field[2];
+        update->mask |= WEB_SET_TIME;
+      }
+      else
+      {
+        update->invalid = 1;
       }
     }
-  }
 
-  return 0;
+    token = strtok_r(NULL, "?&\r\n", &saveptr);
+  }
 }
 
 /**
-  * @brief Инициализация ESP модуля
+  * @brief Установка часов RTC из полей date и time (поток веб-интерфейса)
+  * Часть, которой нет в запросе, остается прежней. Поля снимаются
+  * с маски: часы - не настройки и в резервную SRAM не записываются
   */
-static void ESP_Init(void)
+static void Web_Clock_Set(WebSettingsUpdate *update)
 {
-    uint8_t retry = 0;
+  RTC_TimeTypeDef sTime;
+  RTC_DateTypeDef sDate;
+  RTC_TimeTypeDef midnight = {0};
 
-    // 1. Аппаратный сброс
-    HAL_GPIO_WritePin(RST_ESP_Out_GPIO_Port, RST_ESP_Out_Pin, GPIO_PIN_RESET);
-    osDelay(100);
-    HAL_GPIO_WritePin(RST_ESP_Out_GPIO_Port, RST_ESP_Out_Pin, GPIO_PIN_SET);
-    osDelay(3000); // Увеличенная пауза для загрузки модуля
+  if(!(update->mask & (WEB_SET_DATE | WEB_SET_TIME)))
+    return;
 
-    // 2. Очистка буфера UART
-    uint8_t dummy;
-    while(HAL_UART_Receive(&huart6, &dummy, 1, 10) == HAL_OK);
+  HAL_RTC_GetTime(&hrtc, &sTime, RTC_FORMAT_BIN);
+  HAL_RTC_GetDate(&hrtc, &sDate, RTC_FORMAT_BIN);
+  if(update->mask & WEB_SET_DATE)
+  {
+    sDate.Year = update->date.Year;
+    sDate.Month = update->date.Month;
+    sDate.Date = update->date.Date;
+  }
+  if(update->mask & WEB_SET_TIME)
+  {
+    sTime.Hours = update->time.Hours;
+    sTime.Minutes = update->time.Minutes;
+    sTime.Seconds = update->time.Seconds;
+  }
 
-    // 3. Проверка связи (попытки)
-    for(retry = 0; retry < 5; retry++)
-    {
-        Send_AT_Command("AT\r\n");
-        if(Wait_AT_Response("OK", 1000))
-        {
-            break;
-        }
-        osDelay(500);
-    }
+  // День недели RTC: 1 - понедельник, 2000-01-01 - суббота
+  sDate.WeekDay = (Timestamp_FromRTC(&sDate, &midnight) / 86400 + 5) % 7 + 1;
+  sTime.DayLightSaving = RTC_DAYLIGHTSAVING_NONE;
+  sTime.StoreOperation = RTC_STOREOPERATION_RESET;
 
-    if(retry >= 5)
-    {
-        // Ошибка связи с модулем
-        wifi_ap_active = 0;
-        return;
-    }
+  // После времени записывается дата: теневые регистры читаются в этом порядке
+  HAL_RTC_SetTime(&hrtc, &sTime, RTC_FORMAT_BIN);
+  HAL_RTC_SetDate(&hrtc, &sDate, RTC_FORMAT_BIN);
 
-    // 4. Сброс к заводским настройкам
-    Send_AT_Command("AT+RESTORE\r\n");
-    osDelay(2000);
+  update->mask &= ~(WEB_SET_DATE | WEB_SET_TIME);
+  HTTP_Cache_Touch(HTTP_STATE_CLOCK);
+}
 
-    // Очистка буфера после сброса
-    while(HAL_UART_Receive(&huart6, &dummy, 1, 10) == HAL_OK);
+/**
+  * @brief Добавление изменений к еще не примененным (поток веб-интерфейса)
+  * Повторное изменение поля заменяет предыдущее значение
+  */
+static void Web_Settings_Submit(const WebSettingsUpdate *update)
+{
+  if(update->mask == 0)
+    return;
 
-    // 5. Установка режима точки доступа (1=Station, 2=AP, 3=Both)
-    Send_AT_Command("AT+CWMODE=2\r\n");
-    if(!Wait_AT_Response("OK", 2000))
+  osKernelLock();
+  WebSettingsUpdate *pending = &web_settings_pending;
+  if(update->mask & WEB_SET_MODE)
+  {
+    pending->auto_mode = update->auto_mode;
+  }
+  if(update->mask & WEB_SET_HEATING)
+  {
+    pending->heating_enabled = update->heating_enabled;
+  }
+  if(update->mask & WEB_SET_HUMIDIFICATION)
+  {
+    pending->humidification_enabled = update->humidification_enabled;
+  }
+  if(update->mask & WEB_SET_TEMP_SETPOINT)
+  {
+    pending->temperature_setpoint = update->temperature_setpoint;
+  }
+  if(update->mask & WEB_SET_HUM_SETPOINT)
+  {
+    pending->humidity_setpoint = update->humidity_setpoint;
+  }
+  for(uint8_t i = 0; i < 6; i++)
+  {
+    if(update->mask & WEB_SET_PID_GAIN(i))
     {
-        wifi_ap_active = 0;
-        return;
+      pending->pid_gains[i / 3][i % 3] = update->pid_gains[i / 3][i % 3];
     }
-
-    // 6. Конфигурация точки доступа
-    Send_AT_Command("AT+CWSAP=\"SVS_Kursov\",\"12345678\",1,3\r\n");
-    if(!Wait_AT_Response("OK", 5000))
+  }
+  for(uint8_t i = 0; i < 2; i++)
+  {
+    if(update->mask & WEB_SET_OFFSET(i))
     {
-        wifi_ap_active = 0;
-        return;
+      pending->sensor_offset[i] = update->sensor_offset[i];
     }
+  }
+  if(pending->mask == 0)
+  {
+    // Задержка до выхода считается от первого запроса транзакции
+    pending->cycles = DWT->CYCCNT;
+  }
+  pending->mask |= update->mask;
+  web_settings_requests++;
+  osKernelUnlock();
 
-    // 7. Установка статического IP-адреса
-    Send_AT_Command("AT+CIPAP=\"192.168.4.1\"\r\n");
-    Wait_AT_Response("OK", 2000);
-
-    // 8. Разрешение множественных подключений
-    Send_AT_Command("AT+CIPMUX=1\r\n");
-    Wait_AT_Response("OK", 2000);
-
-    // 9. Запуск веб-сервера на порту 80
-    Send_AT_Command("AT+CIPSERVER=1,80\r\n");
-    if(Wait_AT_Response("OK", 2000))
-    {
-        wifi_ap_active = 1;
+  // Настройки применяет первый проснувшийся поток управления
+  osThreadFlagsSet(controlPIDTempHandle, CONTROL_FLAG_SETTINGS);
+  osThreadFlagsSet(controlPIDHumHandle, CONTROL_FLAG_SETTINGS);
+}
 
-        // Дополнительные настройки
-        Send_AT_Command("AT+CIPSTO=30\r\n"); // Таймаут соединения 30 секунд
-        Wait_AT_Response("OK", 1000);
+/**
+  * @brief Применение накопленных изменений одной транзакцией
+  * Вызывается потоком управления с захваченным settings_mutex.
+  * Версия настроек для кэша ответов увеличивается один раз
+  */
+static void Web_Settings_Apply(void)
+{
+  WebSettingsUpdate update;
 
-        // Включение автоматического принятия данных
-        Send_AT_Command("AT+CIPDINFO=1\r\n");
-        Wait_AT_Response("OK", 1000);
+  osKernelLock();
+  update = web_settings_pending;
+  web_settings_pending.mask = 0;
+  osKernelUnlock();
 
-        // Получение информации о точке доступа
-        Send_AT_Command("AT+CWSAP?\r\n");
-        Wait_AT_Response("+CWSAP:", 2000);
+  if(update.mask == 0)
+    return;
 
-        HAL_GPIO_WritePin(Led_WifI_Out_GPIO_Port, Led_WifI_Out_Pin, GPIO_PIN_SET);
+  web_settings_cycles = update.cycles;
+  if(update.mask & WEB_SET_MODE)
+  {
+    system_settings.auto_mode = update.auto_mode;
+  }
+  if(update.mask & WEB_SET_HEATING)
+  {
+    system_settings.heating_enabled = update.heating_enabled;
+  }
+  if(update.mask & WEB_SET_HUMIDIFICATION)
+  {
+    system_settings.humidification_enabled = update.humidification_enabled;
+  }
+  if(update.mask & WEB_SET_TEMP_SETPOINT)
+  {
+    system_settings.temperature_setpoint = update.temperature_setpoint;
+  }
+  if(update.mask & WEB_SET_HUM_SETPOINT)
+  {
+    system_settings.humidity_setpoint = update.humidity_setpoint;
+  }
+  for(uint8_t i = 0; i < 6; i++)
+  {
+    if(update.mask & WEB_SET_PID_GAIN(i))
+    {
+      system_settings.pid_gains[i / 3][i % 3] = update.pid_gains[i / 3][i % 3];
     }
-    else
+  }
+  for(uint8_t i = 0; i < 2; i++)
+  {
+    if(update.mask & WEB_SET_OFFSET(i))
     {
-        wifi_ap_active = 0;
-        HAL_GPIO_WritePin(Led_WifI_Out_GPIO_Port, Led_WifI_Out_Pin, GPIO_PIN_RESET);
+      system_settings.sensor_offset[i] = update.sensor_offset[i];
     }
+  }
+
+  // Запись откладывается до паузы в изменениях
+  settings_dirty = 1;
+  settings_changed_tick = osKernelGetTickCount();
+  osThreadFlagsSet(exchangeATCommaHandle, EXCHANGE_FLAG_SETTINGS);
+
+  web_settings_applied++;
+  HTTP_Cache_Touch(HTTP_STATE_SETTINGS);
 }
 
 /**
-  * @brief Генерация HTML страницы
+  * @brief Загрузка настроек при запуске
+  * Без действительной записи остаются значения по умолчанию
   */
-static void Generate_HTML_Page(char *buffer, uint32_t size)
+static void Settings_Restore(void)
 {
-  char history_html[2048] = "";
-  char date_str[11] = "2026-02-27";
-  char time_str[6] = "14:30";
-  RTC_TimeTypeDef sTime;
-  RTC_DateTypeDef sDate;
+  SystemSettings settings;
+  uint32_t start = DWT->CYCCNT;
 
-  // Получение текущего времени
-  HAL_RTC_GetTime(&hrtc, &sTime, RTC_FORMAT_BIN);
-  HAL_RTC_GetDate(&hrtc, &sDate, RTC_FORMAT_BIN);
+  SettingsStore_Init(&settings_store);
+  if(SettingsStore_Load(&settings_store, SETTINGS_VERSION, &settings, sizeof(settings)))
+  {
+    system_settings = settings;
+  }
+  settings_restore_us = (DWT->CYCCNT - start) / (SystemCoreClock / 1000000);
+}
 
-  // Форматирование даты и времени
-  sprintf(date_str, "%04d-%02d-%02d",
-          sDate.Year + 2000, sDate.Month, sDate.Date);
-  sprintf(time_str, "%02d:%02d", sTime.Hours, sTime.Minutes);
+/**
+  * @brief Запись измененных настроек (поток обмена AT командами)
+  * Серия изменений из интерфейса записывается один раз после паузы
+  * SETTINGS_SAVE_DELAY, но не чаще SETTINGS_SAVE_INTERVAL
+  * @retval Мс до следующего вызова, osWaitForever - записывать нечего
+  */
+static uint32_t Settings_Save_Process(void)
+{
+  SystemSettings settings;
+  uint32_t now = osKernelGetTickCount();
+  uint32_t since_change = now - settings_changed_tick;
+  uint32_t since_save = now - settings_saved_tick;
 
-  // Генерация HTML истории
-  Generate_History_HTML(history_html, sizeof(history_html));
+  if(!settings_dirty)
+    return osWaitForever;
 
-  // Получение текущих данных и настроек
-  osMutexAcquire(sensor_data_mutex, osWaitForever);
-  float current_temp = current_sensor_data.temperature;
-  float current_hum = current_sensor_data.humidity;
-  osMutexRelease(sensor_data_mutex);
+  if(since_change < SETTINGS_SAVE_DELAY || since_save < SETTINGS_SAVE_INTERVAL)
+  {
+    return MAX((since_change < SETTINGS_SAVE_DELAY) ? SETTINGS_SAVE_DELAY - since_change : 0,
+               (since_save < SETTINGS_SAVE_INTERVAL) ? SETTINGS_SAVE_INTERVAL - since_save : 0);
+  }
 
   osMutexAcquire(settings_mutex, osWaitForever);
-  SystemSettings settings = system_settings;
+  settings = system_settings;
+  settings_dirty = 0;
   osMutexRelease(settings_mutex);
 
-  // Формирование полной HTML страницы
-  snprintf(buffer, size, html_page,
-           current_temp, settings.temperature_setpoint,
-           current_hum, settings.humidity_setpoint,
-           settings.heating_enabled ? "Выключить обогрев" : "Включить обогрев",
-           settings.humidification_enabled ? "Выключить увлажнение" : "Включить увлажнение",
-           settings.auto_mode ? "#4fc3f7" : "#ff9800",
-           settings.auto_mode ? "Автоматический" : "Ручной",
-           history_html,
-           settings.auto_mode ? "checked" : "",
-           settings.auto_mode ? "active" : "",
-           settings.temperature_setpoint, settings.temperature_setpoint,
-           settings.auto_mode ? "active" : "",
-           settings.humidity_setpoint, settings.humidity_setpoint,
-           date_str, time_str,
-		   wifi_ap_active ? "Wi-Fi подключен" : "Wi-Fi отключен",
-           settings.temperature_setpoint, settings.humidity_setpoint,
-           settings.heating_enabled ? "true" : "false",
-           settings.humidification_enabled ? "true" : "false",
-           settings.auto_mode ? "true" : "false");
+  SettingsStore_Save(&settings_store, SETTINGS_VERSION, &settings, sizeof(settings));
+  settings_saved_tick = now;
+
+  // Изменения во время записи ждут следующего интервала
+  return settings_dirty ? SETTINGS_SAVE_INTERVAL : osWaitForever;
 }
 
 /**
-  * @brief Генерация JSON данных
+  * @brief Ожидание окончания предыдущей передачи на ESP
   */
-static void Generate_JSON_Data(char *buffer, uint32_t size)
+static void ESP_TX_Acquire(void)
 {
-  osMutexAcquire(sensor_data_mutex, osWaitForever);
-  float current_temp = current_sensor_data.temperature;
-  float current_hum = current_sensor_data.humidity;
-  osMutexRelease(sensor_data_mutex);
-
-  osMutexAcquire(settings_mutex, osWaitForever);
-  SystemSettings settings = system_settings;
-  osMutexRelease(settings_mutex);
-
-  snprintf(buffer, size, json_data_template,
-           current_temp, current_hum,
-           heating_active, humidification_active,
-           settings.temperature_setpoint, settings.humidity_setpoint,
-           settings.auto_mode,
-		   wifi_ap_active, humidifier_alarm,
-           humidifier_running, humidifier_service);
-
-  // Добавление HTTP заголовков
-  char http_header[256];
-  snprintf(http_header, sizeof(http_header),
-           "HTTP/1.1 200 OK\r\n"
-           "Content-Type: application/json\r\n"
-           "Access-Control-Allow-Origin: *\r\n"
-           "Content-Length: %d\r\n\r\n%s",
-           strlen(buffer), buffer);
-
-  strcpy(buffer, http_header);
+  if(osSemaphoreAcquire(esp_tx_semaphore, ESP_TX_TIMEOUT) != osOK)
+  {
+    // Передача не завершилась - прерываем ее и забираем передатчик
+    HAL_UART_AbortTransmit(&huart6);
+  }
 }
 
 /**
-  * @brief Генерация HTML для истории
+  * @brief Запуск передачи DMA, завершение отмечается в HAL_UART_TxCpltCallback
   */
-static void Generate_History_HTML(char *buffer, uint32_t size)
+static void ESP_TX_Start(const uint8_t *data, uint32_t length)
 {
-  char temp[512] = "";
-  osMutexAcquire(history_mutex, osWaitForever);
-
-  for(int i = 0; i < HISTORY_SIZE; i++)
+  if(length == 0 || HAL_UART_Transmit_DMA(&huart6, (uint8_t*)data, length) != HAL_OK)
   {
-    if(history_data[i].timestamp != 0)
-    {
-      uint32_t ts = history_data[i].timestamp;
-      char row[128];
-
-      // Форматирование даты и времени из timestamp
-      snprintf(row, sizeof(row),
-               "<tr><td>%04d-%02d-%02d %02d:%02d</td>"
-               "<td>%.1f°C</td><td>%.1f%%</td></tr>",
-               ts / 100000000, (ts % 100000000) / 1000000,
-               (ts % 1000000) / 10000, (ts % 10000) / 100,
-               ts % 100,
-               history_data[i].temperature,
-               history_data[i].humidity);
-
-      strcat(temp, row);
-    }
+    osSemaphoreRelease(esp_tx_semaphore);
   }
-
-  osMutexRelease(history_mutex);
-  strncpy(buffer, temp, size);
 }
 
 /**
-  * @brief Проверка состояния Wi-Fi
+  * @brief Отправка произвольных данных на ESP без копирования
+  * Буфер должен оставаться неизменным до окончания передачи
+  * (для ответов HTTP - до SEND OK)
   */
-static void Check_WiFi_Status(void)
+static void Send_AT_Data(const uint8_t *data, uint32_t length)
 {
-    static uint32_t last_check = 0;
-    uint32_t current_time = osKernelGetTickCount();
+  if(!IS_CCMRAM(data))
+  {
+    ESP_TX_Acquire();
+    ESP_TX_Start(data, length);
+    return;
+  }
 
-    if(current_time - last_check > 10000) // Проверка каждые 10 секунд
-    {
-        if(wifi_ap_active)
-        {
-            // Отправляем команду проверки клиентов
-            Send_AT_Command("AT+CWLIF\r\n");
-            Wait_AT_Response("+CWLIF:", 1000);
-        }
-        last_check = current_time;
-    }
+  // Стеки задач в CCM RAM недоступны DMA - команды передаются через esp_tx_buffer
+  while(length > 0)
+  {
+    uint32_t chunk = MIN(length, sizeof(esp_tx_buffer));
+
+    ESP_TX_Acquire();
+    memcpy(esp_tx_buffer, data, chunk);
+    ESP_TX_Start(esp_tx_buffer, chunk);
+    data += chunk;
+    length -= chunk;
+  }
 }
 
 /**
-  * @brief Callback обработки прерывания USART6
+  * @brief Запуск приема USART6 в кольцевой буфер DMA
+  * HAL_UARTEx_RxEventCallback вызывается на половине, конце буфера и паузе в приеме
   */
-void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+static void ESP_RX_Start(void)
 {
-  if(huart->Instance == USART6)
+  esp_rx_dma_pos = 0;
+  if(HAL_UARTEx_ReceiveToIdle_DMA(&huart6, esp_rx_dma_buffer, ESP_RX_DMA_SIZE) != HAL_OK)
   {
-    // Обработка данных от ESP
-    // Данные обрабатываются в потоке веб-интерфейса
+    esp_rx_errors++;
   }
 }
 
 /**
-  * @brief Callback обработки DMA
+  * @brief Передача принятых DMA данных в разборщик (поток движка AT)
+  */
+static void ESP_RX_Poll(void)
+{
+  uint32_t total = esp_rx_total;
+  uint32_t resync = esp_rx_resync;
+
+  // После ошибки прием начат с начала буфера, недочитанное потеряно
+  if((int32_t)(resync - esp_rx_read_total) > 0)
+  {
+    esp_rx_dropped += resync - esp_rx_read_total;
+    esp_rx_read_total = resync;
+    AT_Parser_Reset(&at_parser);
+  }
+
+  uint32_t pending = total - esp_rx_read_total;
+
+  // Разборщик отстал больше чем на размер буфера - старые данные перезаписаны
+  if(pending > ESP_RX_DMA_SIZE)
+  {
+    esp_rx_dropped += pending - ESP_RX_DMA_SIZE;
+    esp_rx_read_total = total - ESP_RX_DMA_SIZE;
+    pending = ESP_RX_DMA_SIZE;
+    AT_Parser_Reset(&at_parser);
+  }
+
+  while(pending > 0)
+  {
+    uint32_t index = esp_rx_read_total & (ESP_RX_DMA_SIZE - 1);
+    uint32_t chunk = MIN(pending, ESP_RX_DMA_SIZE - index);
+
+    AT_Parser_Input(&at_parser, &esp_rx_dma_buffer[index], chunk);
+    esp_rx_read_total += chunk;
+    pending -= chunk;
+  }
+}
+
+/**
+  * @brief Повторный запуск приема после остановки DMA
+  * Прием продолжается с начала буфера, поэтому счетчик выравнивается
+  * на границу буфера, а недочитанные данные считаются потерянными
+  */
+static void ESP_RX_Restart(void)
+{
+  esp_rx_total = (esp_rx_total + ESP_RX_DMA_SIZE - 1) & ~(uint32_t)(ESP_RX_DMA_SIZE - 1);
+  esp_rx_resync = esp_rx_total;
+  ESP_RX_Start();
+}
+
+/**
+  * @brief Сброс принятых данных (после перезапуска ESP)
+  */
+static void ESP_RX_Flush(void)
+{
+  esp_rx_read_total = esp_rx_total;
+  AT_Parser_Reset(&at_parser);
+}
+
+/**
+  * @brief Смена скорости USART6 (поток движка AT)
+  */
+static void ESP_UART_SetBaudrate(uint32_t baudrate)
+{
+  // Дожидаемся окончания передачи (в том числе ответа ESP на смену скорости)
+  ESP_TX_Acquire();
+  osDelay(5);
+
+  HAL_UART_AbortReceive(&huart6);
+  huart6.Init.BaudRate = baudrate;
+  if (HAL_UART_Init(&huart6) != HAL_OK)
+  {
+    Error_Handler();
+  }
+
+  osSemaphoreRelease(esp_tx_semaphore);
+  ESP_RX_Restart();
+  ESP_RX_Flush();
+}
+
+/**
+  * @brief Счетчик ошибок приема USART6 для проверки канала
+  */
+static uint32_t ESP_UART_Errors(void)
+{
+  return esp_rx_errors;
+}
+
+/**
+  * @brief Инициализация ESP модуля (поток движка AT)
+  */
+static void ESP_Init(void)
+{
+    uint32_t start = osKernelGetTickCount();
+
+    // Команды и ответы, ожидавшие старый модуль, отменяются
+    AT_Engine_Abort(&at_engine);
+    ESP_Server_Reset(&esp_server);
+    MQTT_Client_Reset(&mqtt_client);
+    UDP_Beacon_Reset(&udp_beacon);
+    Set_WiFi_State(0);
+
+    // 1. Аппаратный сброс. Скорость UART и настройки, заданные при
+    // AT+SYSSTORE=0, сбрасываются: ESP загружает сохраненные во flash
+    // режим и точку доступа, ESP_Setup_Start задает их заново без записи
+    HAL_GPIO_WritePin(RST_ESP_Out_GPIO_Port, RST_ESP_Out_Pin, GPIO_PIN_RESET);
+    osDelay(10);
+    if(esp_setup.baudrate != ESP_SETUP_DEFAULT_BAUDRATE)
+    {
+        ESP_Setup_SetBaudrate(&esp_setup, ESP_SETUP_DEFAULT_BAUDRATE);
+    }
+    ESP_RX_Flush();
+    HAL_GPIO_WritePin(RST_ESP_Out_GPIO_Port, RST_ESP_Out_Pin, GPIO_PIN_SET);
+
+    // 2. Загрузка по "ready", скорость обмена, точка доступа и веб-сервер
+    if(ESP_Setup_Start(&esp_setup, &esp_setup_config))
+    {
+        AT_Parser_SetRecvInfo(&at_parser, esp_setup.remote_info);
+        ESP_Server_SetPassive(&esp_server, esp_setup.passive);
+        Set_WiFi_State(1);
+
+        // Время инициализации и время от включения до готовности сервера
+        esp_init_ms = osKernelGetTickCount() - start;
+        esp_ready_ms = osKernelGetTickCount();
+    }
+    else
+    {
+        Set_WiFi_State(0);
+    }
+}
+
+/**
+  * @brief Установка состояния Wi-Fi с индикацией
+  */
+static void Set_WiFi_State(uint8_t active)
+{
+  if(wifi_ap_active != active)
+  {
+    wifi_ap_active = active;
+    HTTP_Cache_Touch(HTTP_STATE_SENSOR);
+    osThreadFlagsSet(exchangeATCommaHandle, EXCHANGE_FLAG_WIFI);
+  }
+
+  HAL_GPIO_WritePin(Led_WifI_Out_GPIO_Port, Led_WifI_Out_Pin,
+                    active ? GPIO_PIN_SET : GPIO_PIN_RESET);
+}
+
+/**
+  * @brief Формирование HTTP ответа из тела, записанного по смещению HTTP_HEADER_RESERVE
+  * @retval Полная длина ответа
+  */
+static uint32_t HTTP_Build_Response(char *buffer, uint32_t size, const char *content_type, uint32_t body_length)
+{
+  char http_header[HTTP_HEADER_RESERVE];
+
+  body_length = MIN(body_length, size - HTTP_HEADER_RESERVE - 1);
+
+  int header_length = snprintf(http_header, sizeof(http_header),
+                               "HTTP/1.1 200 OK\r\n"
+                               "Content-Type: %s\r\n"
+                               "Access-Control-Allow-Origin: *\r\n"
+                               "Content-Length: %lu\r\n\r\n",
+                               content_type, (unsigned long)body_length);
+
+  // Сдвиг тела вплотную к заголовку
+  memmove(buffer + header_length, buffer + HTTP_HEADER_RESERVE, body_length);
+  memcpy(buffer, http_header, header_length);
+  buffer[header_length + body_length] = '\0';
+
+  return header_length + body_length;
+}
+
+/**
+  * @brief Генерация HTML страницы
+  * @retval Длина ответа вместе с заголовками
+  */
+static uint32_t Generate_HTML_Page(char *buffer, uint32_t size)
+{
+  static char history_html[4096] CCMRAM;
+  char date_str[11] = "2026-02-27";
+  char time_str[6] = "14:30";
+  RTC_TimeTypeDef sTime;
+  RTC_DateTypeDef sDate;
+
+  // Получение текущего времени
+  HAL_RTC_GetTime(&hrtc, &sTime, RTC_FORMAT_BIN);
+  HAL_RTC_GetDate(&hrtc, &sDate, RTC_FORMAT_BIN);
+
+  // Форматирование даты и времени
+  sprintf(date_str, "%04d-%02d-%02d",
+          sDate.Year + 2000, sDate.Month, sDate.Date);
+  sprintf(time_str, "%02d:%02d", sTime.Hours, sTime.Minutes);
+
+  // Генерация HTML истории
+  Generate_History_HTML(history_html, sizeof(history_html));
+
+  // Получение текущих данных и настроек
+  osMutexAcquire(sensor_data_mutex, osWaitForever);
+  float current_temp = current_sensor_data.temperature;
+  float current_hum = current_sensor_data.humidity;
+  osMutexRelease(sensor_data_mutex);
+
+  osMutexAcquire(settings_mutex, osWaitForever);
+  SystemSettings settings = system_settings;
+  osMutexRelease(settings_mutex);
+
+  // Формирование полной HTML страницы
+  int body_length = snprintf(buffer + HTTP_HEADER_RESERVE, size - HTTP_HEADER_RESERVE, html_page,
+           current_temp, settings.temperature_setpoint,
+           current_hum, settings.humidity_setpoint,
+           settings.heating_enabled ? "Выключить обогрев" : "Включить обогрев",
+           settings.humidification_enabled ? "Выключить увлажнение" : "Включить увлажнение",
+           settings.auto_mode ? "#4fc3f7" : "#ff9800",
+           settings.auto_mode ? "Автоматический" : "Ручной",
+           history_html,
+           settings.auto_mode ? "checked" : "",
+           settings.auto_mode ? "active" : "",
+           settings.temperature_setpoint, settings.temperature_setpoint,
+           settings.auto_mode ? "active" : "",
+           settings.humidity_setpoint, settings.humidity_setpoint,
+           date_str, time_str,
+		   wifi_ap_active ? "Wi-Fi подключен" : "Wi-Fi отключен",
+           settings.temperature_setpoint, settings.humidity_setpoint,
+           settings.heating_enabled ? "true" : "false",
+           settings.humidification_enabled ? "true" : "false",
+           settings.auto_mode ? "true" : "false");
+
+  return HTTP_Build_Response(buffer, size, "text/html; charset=UTF-8", body_length);
+}
+
+/**
+  * @brief Генерация JSON данных
+  * @retval Длина ответа вместе с заголовками
+  */
+static uint32_t Generate_JSON_Data(char *buffer, uint32_t size)
+{
+  osMutexAcquire(sensor_data_mutex, osWaitForever);
+  float current_temp = current_sensor_data.temperature;
+  float current_hum = current_sensor_data.humidity;
+  osMutexRelease(sensor_data_mutex);
+
+  osMutexAcquire(settings_mutex, osWaitForever);
+  SystemSettings settings = system_settings;
+  osMutexRelease(settings_mutex);
+
+  int body_length = snprintf(buffer + HTTP_HEADER_RESERVE, size - HTTP_HEADER_RESERVE, json_data_template,
+           current_temp, current_hum,
+           heating_active, humidification_active,
+           settings.temperature_setpoint, settings.humidity_setpoint,
+           settings.auto_mode,
+		   wifi_ap_active, humidifier_alarm,
+           humidifier_running, humidifier_service);
+
+  // Добавление HTTP заголовков
+  return HTTP_Build_Response(buffer, size, "application/json", body_length);
+}
+
+/**
+  * @brief Построение индекса журнала и загрузка последних записей в историю
+  */
+static void History_Restore(void)
+{
+  FlashLog_CursorTypeDef cursor;
+  uint32_t start = DWT->CYCCNT;
+
+  FlashLog_Init(&history_log, &flash_log_port);
+  history_log_scan_us = (DWT->CYCCNT - start) / (SystemCoreClock / 1000000);
+
+  if(!FlashLog_SeekLast(&history_log, HISTORY_BLOCKS * CODEC_BLOCK_SAMPLES, &cursor))
+    return;
+
+  SensorData entry;
+  float values[2];
+  while(FlashLog_Next(&history_log, &cursor, &entry.timestamp, values))
+  {
+    entry.temperature = values[0];
+    entry.humidity = values[1];
+    History_Store(&entry);
+
+    // Уровни истории восстанавливаются приближенно, по одному показанию на 30 минут
+    History_Rollup_Add(&entry);
+  }
+}
+
+/**
+  * @brief Учет показания во всех уровнях истории
+  */
+static void History_Rollup_Add(const SensorData *data)
+{
+  float values[ROLLUP_CHANNELS] = { data->temperature, data->humidity };
+
+  for(uint8_t i = 0; i < ROLLUP_TIER_COUNT; i++)
+  {
+    Rollup_Add(&history_tiers[i], data->timestamp, values);
+  }
+}
+
+/**
+  * @brief Добавление записи в сжатую историю (только поток опроса датчиков)
+  * Самый старый блок вытесняется без сдвига массива
+  */
+static void History_Store(const SensorData *data)
+{
+  int16_t value[CODEC_CHANNELS] = { Codec_Fixed(data->temperature), Codec_Fixed(data->humidity) };
+
+  // Читатели копируют текущий блок и границы кольца под той же блокировкой
+  osKernelLock();
+  if(!Codec_Append(&history_encoder, data->timestamp, value))
+  {
+    Ring_Append(&history_ring, &history_encoder.block);
+    Codec_Reset(&history_encoder);
+    Codec_Append(&history_encoder, data->timestamp, value);
+  }
+  osKernelUnlock();
+}
+
+/**
+  * @brief Снимок истории для чтения: блоки кольца и копия текущего блока
+  */
+static void History_View_Init(HistoryView *view)
+{
+  osKernelLock();
+  view->open = history_encoder.block;
+  view->blocks = Ring_Snapshot(&history_ring, &view->first);
+  osKernelUnlock();
+
+  // Номер первой записи каждого блока, текущий блок - последний
+  view->count = 0;
+  for(uint32_t i = 0; i <= view->blocks; i++)
+  {
+    Codec_BlockTypeDef block;
+
+    view->start[i] = view->count;
+    if(i == view->blocks)
+    {
+      view->count += view->open.count;
+    }
+    else if(Ring_Get(&history_ring, view->first + i, &block))
+    {
+      view->count += block.count;
+    }
+  }
+
+  view->decoded_block = UINT32_MAX;
+}
+
+/**
+  * @brief Распаковка блока view в кэш
+  * Блок, перезаписанный после снимка, распаковывается пустым
+  */
+static void History_View_Decode(HistoryView *view, uint32_t block_index)
+{
+  static Codec_BlockTypeDef block CCMRAM;
+  Codec_DecoderTypeDef decoder;
+
+  if(view->decoded_block == block_index)
+    return;
+
+  view->decoded_block = block_index;
+  view->decoded_count = 0;
+
+  if(block_index == view->blocks)
+  {
+    block = view->open;
+  }
+  else if(!Ring_Get(&history_ring, view->first + block_index, &block))
+    return;
+
+  Codec_DecoderInit(&decoder, &block);
+  while(view->decoded_count < CODEC_BLOCK_SAMPLES &&
+        Codec_Next(&decoder, &view->times[view->decoded_count], view->values[view->decoded_count]))
+  {
+    view->decoded_count++;
+  }
+}
+
+/**
+  * @brief Генерация HTML для истории
+  */
+static void Generate_History_HTML(char *buffer, uint32_t size)
+{
+  static HistoryView view CCMRAM;
+  uint32_t used = 0;
+  uint32_t rows = 0;
+
+  buffer[0] = '\0';
+  History_View_Init(&view);
+
+  // Новые записи сверху: блоки и записи в них с конца
+  for(uint32_t b = view.blocks + 1; b > 0 && rows < HISTORY_TABLE_ROWS; b--)
+  {
+    History_View_Decode(&view, b - 1);
+
+    for(uint32_t i = view.decoded_count; i > 0 && rows < HISTORY_TABLE_ROWS; i--, rows++)
+    {
+      char date_time[20];
+
+      // Форматирование даты и времени из timestamp
+      Timestamp_Format(view.times[i - 1], date_time, sizeof(date_time));
+      int length = snprintf(buffer + used, size - used,
+               "<tr><td>%s</td>"
+               "<td>%.1f°C</td><td>%.1f%%</td></tr>",
+               date_time,
+               view.values[i - 1][0] / CODEC_SCALE,
+               view.values[i - 1][1] / CODEC_SCALE);
+
+      // Неполная строка таблицы отбрасывается
+      if(length < 0 || used + length >= size)
+      {
+        buffer[used] = '\0';
+        return;
+      }
+      used += length;
+    }
+  }
+}
+
+/**
+  * @brief Точка истории для LTTB по индексу от самой старой записи (ctx - HistoryView)
+  * LTTB читает записи почти по порядку, поэтому блок обычно уже распакован
+  */
+static LTTB_PointTypeDef History_Point(HistoryView *view, uint32_t index, uint8_t channel)
+{
+  LTTB_PointTypeDef point = { 0, 0 };
+  uint32_t low = 0;
+  uint32_t high = view->blocks;
+
+  // Последний блок, начинающийся не позже index
+  while(low < high)
+  {
+    uint32_t middle = (low + high + 1) / 2;
+
+    if(view->start[middle] <= index)
+    {
+      low = middle;
+    }
+    else
+    {
+      high = middle - 1;
+    }
+  }
+
+  History_View_Decode(view, low);
+  index -= view->start[low];
+  if(index < view->decoded_count)
+  {
+    point.x = (int32_t)view->times[index];
+    point.y = view->values[index][channel];
+  }
+  return point;
+}
+
+/**
+  * @brief Точка температуры для LTTB
+  */
+static LTTB_PointTypeDef History_TemperaturePoint(void *ctx, uint32_t index)
+{
+  return History_Point(ctx, index, 0);
+}
+
+/**
+  * @brief Точка влажности для LTTB
+  */
+static LTTB_PointTypeDef History_HumidityPoint(void *ctx, uint32_t index)
+{
+  return History_Point(ctx, index, 1);
+}
+
+/**
+  * @brief Добавление прореженного ряда в JSON
+  * @retval Количество записанных символов
+  */
+static uint32_t History_AppendSeries(char *buffer, uint32_t size, const char *name,
+                                     LTTB_SourceTypeDef source, HistoryView *view, uint32_t points)
+{
+  static uint32_t selected[HISTORY_POINTS_MAX];
+  uint32_t used = 0;
+
+  uint32_t selected_count = LTTB_Downsample(source, view, view->count, points, selected);
+
+  used += snprintf(buffer + used, size - used, "\"%s\":[", name);
+  for(uint32_t i = 0; i < selected_count && used < size; i++)
+  {
+    LTTB_PointTypeDef point = source(view, selected[i]);
+    used += snprintf(buffer + used, size - used, "%s[%lu,%ld]",
+                     i ? "," : "",
+                     (unsigned long)(point.x + EPOCH_2000_UNIX), (long)point.y);
+  }
+  if(used < size)
+  {
+    used += snprintf(buffer + used, size - used, "]");
+  }
+
+  return MIN(used, size - 1);
+}
+
+/**
+  * @brief Число точек из строки запроса /history?points=N
+  * N больше HISTORY_POINTS_MAX уменьшается, ответ сообщает предел в points_max
+  * @retval 0 - N не число или меньше HISTORY_POINTS_MIN
+  */
+static uint8_t History_ParsePoints(const char *request, uint32_t *points)
+{
+  // Параметр ищется только в пути запроса "GET /history?... HTTP/1.1"
+  const char *path_end = request + 4 + strcspn(request + 4, " \r\n");
+  const char *param = strstr(request, "points=");
+  char *end;
+
+  *points = HISTORY_POINTS_MAX;
+  if(param == NULL || param >= path_end)
+    return 1;
+
+  param += 7;
+  if(*param < '0' || *param > '9')
+    return 0;
+
+  unsigned long value = strtoul(param, &end, 10);
+  if((*end != '\0' && *end != '&' && *end != ' ' && *end != '\r' && *end != '\n') ||
+     value < HISTORY_POINTS_MIN)
+    return 0;
+
+  *points = MIN(value, HISTORY_POINTS_MAX);
+  return 1;
+}
+
+/**
+  * @brief Генерация JSON истории, прореженной до points точек
+  * Формат: {"points_max":N,"temp":[[unix_time,value*10],...],"hum":[[unix_time,value*10],...]}
+  */
+static void Generate_History_JSON(char *buffer, uint32_t size, uint32_t points)
+{
+  uint32_t used = 0;
+
+  // Тело ответа формируется после места под заголовок
+  char *body = buffer + HTTP_HEADER_RESERVE;
+  uint32_t body_size = size - HTTP_HEADER_RESERVE;
+
+  // Без блокировки: запас кольца покрывает добавление во время чтения
+  static HistoryView view CCMRAM;
+  History_View_Init(&view);
+
+  used += snprintf(body + used, body_size - used, "{\"points_max\":%u,", (unsigned)HISTORY_POINTS_MAX);
+  used += History_AppendSeries(body + used, body_size - used, "temp",
+                               History_TemperaturePoint, &view, points);
+  used += snprintf(body + used, body_size - used, ",");
+  used += History_AppendSeries(body + used, body_size - used, "hum",
+                               History_HumidityPoint, &view, points);
+
+  if(used < body_size)
+  {
+    used += snprintf(body + used, body_size - used, "}");
+  }
+
+  // Добавление HTTP заголовков
+  HTTP_Build_Response(buffer, size, "application/json", used);
+}
+
+/**
+  * @brief Добавление в JSON статистики окна
+  * @retval Количество записанных символов
+  */
+static uint32_t Stats_AppendSummary(char *buffer, uint32_t size, const char *name,
+                                    const Stats_SummaryTypeDef *summary)
+{
+  const char *channels[STATS_CHANNELS] = { "temp", "hum" };
+  uint32_t used = 0;
+
+  used += snprintf(buffer + used, size - used, "\"%s\":{\"start\":%lu,\"seconds\":%lu",
+                   name, (unsigned long)(summary->start + EPOCH_2000_UNIX),
+                   (unsigned long)summary->duration);
+
+  for(uint8_t c = 0; c < STATS_CHANNELS && used < size; c++)
+  {
+    const Stats_ChannelTypeDef *channel = &summary->channel[c];
+    uint32_t duration = summary->duration ? summary->duration : 1;
+
+    // Время в полосе и работа выхода - в процентах от учтенного времени
+    used += snprintf(buffer + used, size - used,
+                     ",\"%s\":{\"n\":%lu,\"mean\":%.2f,\"stddev\":%.2f,"
+                     "\"min\":%.1f,\"min_at\":%lu,\"max\":%.1f,\"max_at\":%lu,"
+                     "\"in_band\":%.1f,\"duty\":%.1f}",
+                     channels[c], (unsigned long)channel->count, channel->mean,
+                     Stats_StdDev(channel),
+                     channel->min, (unsigned long)(channel->count ? channel->min_time + EPOCH_2000_UNIX : 0),
+                     channel->max, (unsigned long)(channel->count ? channel->max_time + EPOCH_2000_UNIX : 0),
+                     channel->in_band * 100.0f / duration, channel->relay_on * 100.0f / duration);
+  }
+  if(used < size)
+  {
+    used += snprintf(buffer + used, size - used, "}");
+  }
+
+  return MIN(used, size - 1);
+}
+
+/**
+  * @brief Генерация JSON статистики
+  * Формат: {"band":[0.5,3.0],"windows":[{"period":3600,"current":{...},"previous":{...}},...]}
+  */
+static void Generate_Stats_JSON(char *buffer, uint32_t size)
+{
+  Stats_SummaryTypeDef current;
+  Stats_SummaryTypeDef previous;
+  uint32_t used = 0;
+
+  char *body = buffer + HTTP_HEADER_RESERVE;
+  uint32_t body_size = size - HTTP_HEADER_RESERVE;
+
+  used += snprintf(body + used, body_size - used, "{\"band\":[%.1f,%.1f],\"windows\":[",
+                   TEMP_ACCURACY, HUM_ACCURACY);
+  for(uint8_t i = 0; i < STATS_WINDOW_COUNT && used < body_size; i++)
+  {
+    Stats_Read(&stats_windows[i], &current, &previous);
+
+    used += snprintf(body + used, body_size - used, "%s{\"period\":%lu,",
+                     i ? "," : "", (unsigned long)stats_windows[i].period);
+    if(used >= body_size)
+      break;
+    used += Stats_AppendSummary(body + used, body_size - used, "current", &current);
+    used += snprintf(body + used, body_size - used, ",");
+    if(used >= body_size)
+      break;
+    used += Stats_AppendSummary(body + used, body_size - used, "previous", &previous);
+    used += snprintf(body + used, body_size - used, "}");
+  }
+  if(used < body_size)
+  {
+    used += snprintf(body + used, body_size - used, "]}");
+  }
+
+  HTTP_Build_Response(buffer, size, "application/json", MIN(used, body_size - 1));
+}
+
+/**
+  * @brief Генерация JSON многоуровневой истории
+  * Уровень выбирается по шагу: самый грубый, интервал которого не длиннее step.
+  * Формат: {"period":60,"step":2880,"rows":[[unix_time,count,
+  *          t_min,t_max,t_avg,h_min,h_max,h_avg],...]}, значения * 10
+  */
+static void Generate_Rollup_JSON(char *buffer, uint32_t size, uint32_t from, uint32_t to, uint32_t step)
+{
+  static Rollup_RowTypeDef rows[ROLLUP_ROWS_MAX] CCMRAM;
+  uint32_t used = 0;
+
+  // Время уровней - от эпохи RTC
+  from = (from > EPOCH_2000_UNIX) ? from - EPOCH_2000_UNIX : 0;
+  to = (to > EPOCH_2000_UNIX) ? to - EPOCH_2000_UNIX : 0;
+  if(to <= from)
+  {
+    to = from + 1;
+  }
+
+  // Шаг не мельче, чем позволяет количество строк
+  uint32_t min_step = (to - from + ROLLUP_ROWS_MAX - 1) / ROLLUP_ROWS_MAX;
+  step = MAX(step, min_step);
+
+  Rollup_TierTypeDef *tier = &history_tiers[Rollup_Select(history_tiers, ROLLUP_TIER_COUNT, from, step)];
+  step = MAX(step, tier->period);
+  uint32_t count = Rollup_Query(tier, from, to, step, rows, ROLLUP_ROWS_MAX);
+
+  char *body = buffer + HTTP_HEADER_RESERVE;
+  uint32_t body_size = size - HTTP_HEADER_RESERVE;
+
+  used += snprintf(body + used, body_size - used, "{\"period\":%lu,\"step\":%lu,\"rows\":[",
+                   (unsigned long)tier->period, (unsigned long)step);
+  for(uint32_t i = 0; i < count && used < body_size; i++)
+  {
+    const Rollup_RowTypeDef *row = &rows[i];
+
+    used += snprintf(body + used, body_size - used, "%s[%lu,%lu,%d,%d,%ld,%d,%d,%ld]",
+                     i ? "," : "",
+                     (unsigned long)(row->time + EPOCH_2000_UNIX), (unsigned long)row->count,
+                     row->min[0], row->max[0], (long)(row->sum[0] / (int64_t)row->count),
+                     row->min[1], row->max[1], (long)(row->sum[1] / (int64_t)row->count));
+  }
+  if(used < body_size)
+  {
+    used += snprintf(body + used, body_size - used, "]}");
+  }
+
+  HTTP_Build_Response(buffer, size, "application/json", MIN(used, body_size - 1));
+}
+
+/**
+  * @brief Генерация JSON статистики кэша ответов
+  */
+static void Generate_Cache_Stats_JSON(char *buffer, uint32_t size)
+{
+  const HTTP_CacheEntryTypeDef *entries[] = { &http_page_cache, &http_data_cache };
+  const char *names[] = { "page", "data" };
+  uint32_t cycles_per_us = SystemCoreClock / 1000000;
+  uint32_t used = 0;
+
+  used += snprintf(buffer + HTTP_HEADER_RESERVE + used, size - HTTP_HEADER_RESERVE - used, "{");
+  for(uint32_t i = 0; i < 2; i++)
+  {
+    const HTTP_CacheEntryTypeDef *entry = entries[i];
+    uint32_t total = entry->hits + entry->misses;
+
+    // Доля попаданий в процентах, среднее время обработки в микросекундах
+    used += snprintf(buffer + HTTP_HEADER_RESERVE + used, size - HTTP_HEADER_RESERVE - used,
+                     "%s\"%s\":{\"hits\":%lu,\"misses\":%lu,\"hit_rate\":%lu,"
+                     "\"stale\":%lu,\"hit_us\":%lu,\"miss_us\":%lu,\"bytes\":%lu}",
+                     i ? "," : "", names[i],
+                     (unsigned long)entry->hits, (unsigned long)entry->misses,
+                     (unsigned long)(total ? entry->hits * 100UL / total : 0),
+                     (unsigned long)entry->stale_hits,
+                     (unsigned long)(entry->hits ? entry->hit_cycles / entry->hits / cycles_per_us : 0),
+                     (unsigned long)(entry->misses ? entry->miss_cycles / entry->misses / cycles_per_us : 0),
+                     (unsigned long)entry->length);
+  }
+  // Запросы настроек и транзакции после объединения (одна смена версии на транзакцию)
+  used += snprintf(buffer + HTTP_HEADER_RESERVE + used, size - HTTP_HEADER_RESERVE - used,
+                   ",\"settings\":{\"requests\":%lu,\"applied\":%lu,\"saves\":%lu,"
+                   "\"restored\":%lu,\"restore_us\":%lu}}",
+                   (unsigned long)web_settings_requests, (unsigned long)web_settings_applied,
+                   (unsigned long)settings_store.saves, (unsigned long)settings_store.restores,
+                   (unsigned long)settings_restore_us);
+
+  HTTP_Build_Response(buffer, size, "application/json", used);
+}
+
+/**
+  * @brief Генерация JSON занятости памяти
+  * SRAM: статические данные (.data + .bss) и остаток до вершины стека main,
+  * CCM RAM: секции .ccmram и .ccmram_bss, включая стеки потоков и кучу FreeRTOS,
+  * tasks: размер стека и наименьший запас за время работы (байт),
+  * pools: занятые блоки сейчас и в пике, отказы при исчерпании
+  */
+static void Generate_Memory_Stats_JSON(char *buffer, uint32_t size)
+{
+  extern uint8_t _sdata[], _ebss[], _estack[];
+  extern uint8_t _sccmram[], _eccmram_bss[];
+  const uint32_t ccm_size = 64 * 1024;
+  uint32_t used;
+
+  uint32_t sram_static = _ebss - _sdata;
+  uint32_t sram_free = _estack - _ebss;
+  uint32_t ccm_used = _eccmram_bss - _sccmram;
+
+  char *body = buffer + HTTP_HEADER_RESERVE;
+  uint32_t body_size = size - HTTP_HEADER_RESERVE;
+
+  used = snprintf(body, body_size,
+                  "{\"sram\":{\"static\":%lu,\"free\":%lu},"
+                  "\"ccm\":{\"used\":%lu,\"free\":%lu},"
+                  "\"heap\":{\"size\":%lu,\"free\":%lu,\"min_free\":%lu},"
+                  "\"tasks\":[",
+                  (unsigned long)sram_static, (unsigned long)sram_free,
+                  (unsigned long)ccm_used, (unsigned long)(ccm_size - ccm_used),
+                  (unsigned long)configTOTAL_HEAP_SIZE,
+                  (unsigned long)xPortGetFreeHeapSize(),
+                  (unsigned long)xPortGetMinimumEverFreeHeapSize());
+
+  // Наименьший за время работы запас стека каждого потока
+  for(uint8_t i = 0; i < sizeof(task_stack_budget) / sizeof(task_stack_budget[0]) && used < body_size; i++)
+  {
+    const TaskStackBudget *task = &task_stack_budget[i];
+    used += snprintf(body + used, body_size - used,
+                     "%s{\"name\":\"%s\",\"stack\":%lu,\"free_min\":%lu}",
+                     i ? "," : "", task->attributes->name,
+                     (unsigned long)task->attributes->stack_size,
+                     (unsigned long)osThreadGetStackSpace(*task->handle));
+  }
+
+  // Служба таймеров выполняет обработчик UDP маяка
+  if(used < body_size)
+  {
+    used += snprintf(body + used, body_size - used,
+                     ",{\"name\":\"timer\",\"stack\":%lu,\"free_min\":%lu}],\"pools\":[",
+                     (unsigned long)(configTIMER_TASK_STACK_DEPTH * sizeof(StackType_t)),
+                     (unsigned long)(uxTaskGetStackHighWaterMark(xTimerGetTimerDaemonTaskHandle()) *
+                                     sizeof(StackType_t)));
+  }
+
+  // Пулы буферов сети
+  for(uint8_t i = 0; i < sizeof(mem_pools) / sizeof(mem_pools[0]) && used < body_size; i++)
+  {
+    MemPoolTypeDef pool;
+    MemPool_Read(mem_pools[i], &pool);
+    used += snprintf(body + used, body_size - used,
+                     "%s{\"name\":\"%s\",\"block\":%lu,\"count\":%u,\"used\":%u,"
+                     "\"used_max\":%u,\"allocs\":%lu,\"failures\":%lu}",
+                     i ? "," : "", pool.name, (unsigned long)pool.block_size, pool.count,
+                     pool.used, pool.used_max, (unsigned long)pool.allocs,
+                     (unsigned long)pool.failures);
+  }
+  if(used < body_size)
+  {
+    used += snprintf(body + used, body_size - used, "]}");
+  }
+
+  HTTP_Build_Response(buffer, size, "application/json", MIN(used, body_size - 1));
+}
+
+/**
+  * @brief Генерация JSON загрузки потоков за последний интервал замера
+  * cpu - доля интервала в процентах (IDLE - свободное время процессора),
+  * stack_free_min - наименьший запас стека за время работы, байт
+  * Сравнение сборок по загрузке: после запуска точки доступа без клиентов
+  * и без запросов - IDLE cpu по 30 чтениям с шагом TASK_STATS_INTERVAL,
+  * среднее и наименьшее; то же при запросах /data раз в секунду
+  */
+static void Generate_Tasks_JSON(char *buffer, uint32_t size)
+{
+  static TaskStatsTypeDef stats CCMRAM;
+  const uint32_t cycles_per_us = SystemCoreClock / 1000000;
+  uint32_t used = 0;
+
+  char *body = buffer + HTTP_HEADER_RESERVE;
+  uint32_t body_size = size - HTTP_HEADER_RESERVE;
+
+  TaskStats_Read(&task_stats, &stats);
+
+  used += snprintf(body + used, body_size - used,
+                   "{\"interval_ms\":%lu,\"samples\":%lu,\"sample_us\":%lu,\"sample_max_us\":%lu,"
+                   "\"heap\":{\"size\":%lu,\"free\":%lu,\"min_free\":%lu},\"tasks\":[",
+                   (unsigned long)(stats.interval / (cycles_per_us * 1000)),
+                   (unsigned long)stats.samples,
+                   (unsigned long)(stats.sample_cycles / cycles_per_us),
+                   (unsigned long)(stats.sample_max_cycles / cycles_per_us),
+                   (unsigned long)configTOTAL_HEAP_SIZE,
+                   (unsigned long)xPortGetFreeHeapSize(),
+                   (unsigned long)xPortGetMinimumEverFreeHeapSize());
+
+  for(uint8_t i = 0; i < stats.count && used < body_size; i++)
+  {
+    const TaskStats_EntryTypeDef *entry = &stats.entries[i];
+    float cpu = stats.interval ? 100.0f * (float)entry->cycles / (float)stats.interval : 0.0f;
+
+    used += snprintf(body + used, body_size - used,
+                     "%s{\"name\":\"%s\",\"state\":\"%s\",\"priority\":%lu,"
+                     "\"cpu\":%.2f,\"stack_free_min\":%lu}",
+                     i ? "," : "", entry->name, TaskStats_StateName(entry->state),
+                     (unsigned long)entry->priority, cpu,
+                     (unsigned long)entry->stack_free_min);
+  }
+  if(used < body_size)
+  {
+    used += snprintf(body + used, body_size - used, "]}");
+  }
+
+  HTTP_Build_Response(buffer, size, "application/json", MIN(used, body_size - 1));
+}
+
+/**
+  * @brief Генерация JSON состояния журнала истории
+  */
+static void Generate_Flash_Stats_JSON(char *buffer, uint32_t size)
+{
+  uint32_t used;
+
+  used = snprintf(buffer + HTTP_HEADER_RESERVE, size - HTTP_HEADER_RESERVE,
+                  "{\"records\":%lu,\"buffered\":%u,\"flushes\":%lu,\"erases\":%lu,"
+                  "\"errors\":%lu,\"crc_errors\":%lu,\"scan_us\":%lu,\"sectors\":[",
+                  (unsigned long)history_log.records, history_log.buffered,
+                  (unsigned long)history_log.flushes, (unsigned long)history_log.erases,
+                  (unsigned long)history_log.errors, (unsigned long)history_log.crc_errors,
+                  (unsigned long)history_log_scan_us);
+
+  // Секторы по порядку заполнения: количество стираний показывает износ
+  for(uint8_t i = 0; i < history_log.order_count && used < size - HTTP_HEADER_RESERVE; i++)
+  {
+    const FlashLog_SectorTypeDef *sector = &history_log.sectors[history_log.order[i]];
+
+    used += snprintf(buffer + HTTP_HEADER_RESERVE + used, size - HTTP_HEADER_RESERVE - used,
+                     "%s{\"sector\":%u,\"erases\":%lu,\"count\":%lu,\"from\":%lu,\"to\":%lu}",
+                     i ? "," : "", history_log.order[i],
+                     (unsigned long)sector->erase_count, (unsigned long)sector->count,
+                     (unsigned long)(sector->count ? sector->first_time + EPOCH_2000_UNIX : 0),
+                     (unsigned long)(sector->count ? sector->last_time + EPOCH_2000_UNIX : 0));
+  }
+  if(used < size - HTTP_HEADER_RESERVE)
+  {
+    used += snprintf(buffer + HTTP_HEADER_RESERVE + used, size - HTTP_HEADER_RESERVE - used, "]}");
+  }
+
+  HTTP_Build_Response(buffer, size, "application/json", MIN(used, size - HTTP_HEADER_RESERVE - 1));
+}
+
+/**
+  * @brief Генерация JSON задержки управления
+  */
+static void Generate_Control_Stats_JSON(char *buffer, uint32_t size)
+{
+  uint32_t used;
+
+  used = snprintf(buffer + HTTP_HEADER_RESERVE, size - HTTP_HEADER_RESERVE,
+                  "{\"latency\":{\"count\":%lu,\"last_us\":%lu,\"max_us\":%lu,\"avg_us\":%lu},"
+                  "\"heating\":%u,\"humidification\":%u}",
+                  (unsigned long)control_latency_count, (unsigned long)control_latency_last_us,
+                  (unsigned long)control_latency_max_us,
+                  (unsigned long)(control_latency_count ?
+                                  control_latency_total_us / control_latency_count : 0),
+                  heating_active, humidification_active);
+
+  HTTP_Build_Response(buffer, size, "application/json", used);
+}
+
+/**
+  * @brief Генерация JSON статистики обмена с ESP
+  * http.latency - от приема запроса целиком до SEND OK, мс. Сравнение сборок
+  * по задержке: после перезапуска 100 запросов /data по одному, last/max/avg
+  * из ответа; в сборках без latency - время ответа на стороне клиента
+  */
+static void Generate_ESP_Stats_JSON(char *buffer, uint32_t size)
+{
+  uint32_t used;
+
+  used = snprintf(buffer + HTTP_HEADER_RESERVE, size - HTTP_HEADER_RESERVE,
+                  "{\"rx\":{\"bytes\":%lu,\"dropped\":%lu,\"errors\":%lu,"
+                  "\"lines\":%lu,\"unhandled\":%lu,\"overflows\":%lu},"
+                  "\"http\":{\"requests\":%lu,\"responses\":%lu,"
+                  "\"send_errors\":%lu,\"bytes_sent\":%lu,"
+                  "\"bytes_received\":%lu,\"passive\":%u,\"recv_reads\":%lu,\"rejected\":%lu,"
+                  "\"oversized\":%lu,"
+                  "\"last_bytes\":%lu,\"last_ms\":%lu,\"latency\":{\"last_ms\":%lu,"
+                  "\"max_ms\":%lu,\"avg_ms\":%lu}},\"baud\":%lu,"
+                  "\"init_ms\":%lu,\"ready_ms\":%lu,\"boot_ms\":%lu,"
+                  "\"mqtt\":{\"enabled\":%u,\"connected\":%u,\"retry_ms\":%lu,\"queued\":%u,\"published\":%lu,"
+                  "\"publishes\":%lu,\"dropped\":%lu,\"connects\":%lu,\"errors\":%lu},"
+                  "\"beacon\":{\"sent\":%lu,\"errors\":%lu,\"skipped\":%lu},"
+                  "\"at\":[",
+                  (unsigned long)at_parser.bytes, (unsigned long)esp_rx_dropped,
+                  (unsigned long)esp_rx_errors, (unsigned long)at_parser.lines,
+                  (unsigned long)at_parser.unhandled, (unsigned long)at_parser.overflows,
+                  (unsigned long)esp_server.requests, (unsigned long)esp_server.responses,
+                  (unsigned long)esp_server.send_errors, (unsigned long)esp_server.bytes_sent,
+                  (unsigned long)esp_server.bytes_received, esp_server.passive,
+                  (unsigned long)esp_server.recv_reads, (unsigned long)esp_server.rejected,
+                  (unsigned long)esp_server.oversized,
+                  (unsigned long)esp_server.last_response_bytes,
+                  (unsigned long)esp_server.last_response_ms,
+                  (unsigned long)esp_server.latency_last_ms,
+                  (unsigned long)esp_server.latency_max_ms,
+                  (unsigned long)(esp_server.responses ?
+                                  esp_server.latency_total_ms / esp_server.responses : 0),
+                  (unsigned long)esp_setup.baudrate,
+                  (unsigned long)esp_init_ms, (unsigned long)esp_ready_ms,
+                  (unsigned long)esp_setup.boot_ms,
+                  MQTT_ENABLED, mqtt_client.connected, (unsigned long)mqtt_client.retry_delay,
+                  MQTT_Client_Pending(&mqtt_client),
+                  (unsigned long)mqtt_client.published, (unsigned long)mqtt_client.publishes,
+                  (unsigned long)mqtt_client.dropped, (unsigned long)mqtt_client.connects,
+                  (unsigned long)mqtt_client.errors,
+                  (unsigned long)udp_beacon.sent, (unsigned long)udp_beacon.errors,
+                  (unsigned long)udp_beacon.skipped);
+
+  // Задержка и результаты AT команд по имени команды
+  for(uint32_t i = 0; i < at_engine.stats_count; i++)
+  {
+    const AT_CommandStatsTypeDef *stats = &at_engine.stats[i];
+
+    if(used + 128 > size - HTTP_HEADER_RESERVE)
+      break;
+    used += snprintf(buffer + HTTP_HEADER_RESERVE + used, size - HTTP_HEADER_RESERVE - used,
+                     "%s{\"cmd\":\"%s\",\"count\":%lu,\"errors\":%lu,\"timeouts\":%lu,"
+                     "\"avg_ms\":%lu,\"max_ms\":%lu}",
+                     i ? "," : "", stats->name, (unsigned long)stats->count,
+                     (unsigned long)stats->errors, (unsigned long)stats->timeouts,
+                     (unsigned long)(stats->count ? stats->total_ms / stats->count : 0),
+                     (unsigned long)stats->max_ms);
+  }
+  used += snprintf(buffer + HTTP_HEADER_RESERVE + used, size - HTTP_HEADER_RESERVE - used, "]}");
+
+  HTTP_Build_Response(buffer, size, "application/json", used);
+}
+
+/**
+  * @brief Перевод даты и времени RTC в секунды от 2000-01-01
+  */
+static uint32_t Timestamp_FromRTC(const RTC_DateTypeDef *date, const RTC_TimeTypeDef *time)
+{
+  static const uint16_t days_before_month[12] = {
+    0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334
+  };
+  uint32_t year = date->Year; // RTC хранит год 00..99 от 2000
+
+  // Для 2000..2099 високосным является каждый четвертый год
+  uint32_t days = year * 365 + (year + 3) / 4 +
+                  days_before_month[date->Month - 1] + date->Date - 1;
+  if(date->Month > 2 && (year % 4) == 0)
+  {
+    days++;
+  }
+
+  return ((days * 24 + time->Hours) * 60 + time->Minutes) * 60 + time->Seconds;
+}
+
+/**
+  * @brief Форматирование timestamp в строку "ГГГГ-ММ-ДД ЧЧ:ММ"
+  */
+static void Timestamp_Format(uint32_t timestamp, char *buffer, uint32_t size)
+{
+  static const uint8_t days_in_month[12] = {
+    31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+  };
+  uint32_t minutes = timestamp / 60;
+  uint32_t days = minutes / (24 * 60);
+  uint32_t year = 0;
+  uint32_t month = 0;
+
+  while(days >= ((year % 4) ? 365U : 366U))
+  {
+    days -= (year % 4) ? 365U : 366U;
+    year++;
+  }
+
+  while(month < 11)
+  {
+    uint32_t month_days = days_in_month[month] + ((month == 1 && (year % 4) == 0) ? 1 : 0);
+    if(days < month_days)
+      break;
+    days -= month_days;
+    month++;
+  }
+
+  snprintf(buffer, size, "%04lu-%02lu-%02lu %02lu:%02lu",
+           (unsigned long)(year + 2000), (unsigned long)(month + 1),
+           (unsigned long)(days + 1),
+           (unsigned long)((minutes / 60) % 24), (unsigned long)(minutes % 60));
+}
+
+/**
+  * @brief Проверка состояния Wi-Fi
+  * @retval Мс до следующей проверки
+  */
+static uint32_t Check_WiFi_Status(void)
+{
+    static uint32_t last_check = 0;
+    uint32_t current_time = osKernelGetTickCount();
+
+    if(current_time - last_check >= WIFI_CHECK_INTERVAL)
+    {
+        // Проверка клиентов без ожидания: поток не занимает USART6,
+        // предыдущий запрос мог еще стоять в очереди движка
+        if(wifi_ap_active && !cwlif_busy)
+        {
+            AT_Request_Init(&cwlif_request, "AT+CWLIF", "OK", 1000);
+            cwlif_request.done = CWLIF_Done;
+            cwlif_busy = AT_Engine_Submit(&at_engine, &cwlif_request);
+        }
+        last_check = current_time;
+    }
+
+    return WIFI_CHECK_INTERVAL - (current_time - last_check);
+}
+
+/**
+  * @brief Завершение AT+CWLIF (поток движка), запрос можно отправлять снова
+  */
+static void CWLIF_Done(void *ctx, AT_RequestTypeDef *request)
+{
+    cwlif_busy = 0;
+}
+
+/**
+  * @brief Таймер замера загрузки потоков
+  */
+static void TaskStats_Timer(void *argument)
+{
+    TaskStats_Sample(&task_stats);
+}
+
+/**
+  * @brief Таймер UDP маяка: пакет с текущими показаниями и состоянием выходов
+  */
+static void UDP_Beacon_Timer(void *argument)
+{
+    static SensorData data;
+    UDP_BeaconSampleTypeDef sample;
+
+    if(!wifi_ap_active)
+        return;
+
+    // Поток таймеров не ждет мьютекс: при занятом берутся прошлые показания
+    if(osMutexAcquire(sensor_data_mutex, 0) == osOK)
+    {
+        data = current_sensor_data;
+        osMutexRelease(sensor_data_mutex);
+    }
+
+    sample.timestamp = data.timestamp + EPOCH_2000_UNIX;
+    sample.temperature = data.temperature;
+    sample.humidity = data.humidity;
+    sample.flags = (heating_active ? UDP_BEACON_FLAG_HEATING : 0) |
+                   (humidification_active ? UDP_BEACON_FLAG_HUMIDIFICATION : 0) |
+                   (humidifier_alarm ? UDP_BEACON_FLAG_HUM_ALARM : 0) |
+                   (humidifier_running ? UDP_BEACON_FLAG_HUM_RUNNING : 0) |
+                   (humidifier_service ? UDP_BEACON_FLAG_HUM_SERVICE : 0) |
+                   (system_settings.auto_mode ? UDP_BEACON_FLAG_AUTO_MODE : 0);
+
+    UDP_Beacon_Send(&udp_beacon, &sample);
+}
+
+/**
+  * @brief Callback окончания приема в прерываниях
+  */
+void HAL_UART_RxCpltCallback(UART_HandleTypeDef *huart)
+{
+  if(huart->Instance == USART6)
+  {
+    // Обработка данных от ESP
+    // Данные обрабатываются в потоке веб-интерфейса
+  }
+  else if(huart->Instance == USART1)
+  {
+    // Ответ датчика принят - пробуждение потока RS485
+    osThreadFlagsSet(readRS485Handle, RS485_FLAG_DONE);
+  }
+}
+
+/**
+  * @brief Callback обработки DMA
   */
 void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart)
 {
   if(huart->Instance == USART6)
   {
-    // Передача данных на ESP завершена
+    // Передача данных на ESP завершена, передатчик свободен
+    osSemaphoreRelease(esp_tx_semaphore);
+  }
+  else if(huart->Instance == USART1)
+  {
+    // Запрос датчику ушел полностью: линия на прием до начала ответа
+    RS485_EnableRX();
+    if(HAL_UART_Receive_IT(&huart1, rs485_rx_buffer, rs485_rx_length) != HAL_OK)
+    {
+      osThreadFlagsSet(readRS485Handle, RS485_FLAG_ERROR);
+    }
+  }
+}
+
+/**
+  * @brief Callback приема DMA: Size - текущая позиция в кольцевом буфере
+  */
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size)
+{
+  if(huart->Instance == USART6)
+  {
+    uint16_t received = (Size >= esp_rx_dma_pos) ? Size - esp_rx_dma_pos
+                                                  : Size + ESP_RX_DMA_SIZE - esp_rx_dma_pos;
+    esp_rx_dma_pos = Size;
+    esp_rx_total += received;
+    osEventFlagsSet(esp_rx_event, ESP_RX_EVENT_DATA);
+  }
+}
+
+/**
+  * @brief Callback ошибки UART
+  */
+void HAL_UART_ErrorCallback(UART_HandleTypeDef *huart)
+{
+  if(huart->Instance == USART6 && huart->RxState == HAL_UART_STATE_READY)
+  {
+    // HAL остановил прием DMA
+    esp_rx_errors++;
+    ESP_RX_Restart();
+    osEventFlagsSet(esp_rx_event, ESP_RX_EVENT_DATA);
+  }
+  else if(huart->Instance == USART1)
+  {
+    // Обмен с датчиком прерывает поток RS485
+    osThreadFlagsSet(readRS485Handle, RS485_FLAG_ERROR);
   }
 }
 /* USER CODE END 4 */
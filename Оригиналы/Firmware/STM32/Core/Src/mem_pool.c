@@ -0,0 +1,99 @@
+/*
+ * mem_pool.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// mem_pool.c
+// Пулы блоков фиксированного размера для буферов сети и формирования
+// ответов. Свободные блоки связаны в список через свое первое слово,
+// поэтому пул не требует памяти сверх хранилища. Список изменяется
+// в короткой критической секции, которая допускает вложение и вызов
+// из прерываний.
+#include "mem_pool.h"
+#include "FreeRTOS.h"
+#include "task.h"
+
+/**
+  * @brief Инициализация пула во внешнем хранилище
+  * @param storage: MEM_POOL_WORDS(block_size, count) слов
+  */
+void MemPool_Init(MemPoolTypeDef *pool, const char *name, void *storage,
+                  uint32_t block_size, uint16_t count)
+{
+    pool->name = name;
+    pool->storage = storage;
+    pool->block_size = (block_size + 3) & ~3U;
+    pool->count = count;
+    pool->free_list = NULL;
+    pool->used = 0;
+    pool->used_max = 0;
+    pool->allocs = 0;
+    pool->failures = 0;
+
+    // Список в порядке адресов: первым выдается первый блок
+    for(uint16_t i = count; i > 0; i--)
+    {
+        void **block = (void**)(pool->storage + (i - 1) * pool->block_size);
+        *block = pool->free_list;
+        pool->free_list = block;
+    }
+}
+
+/**
+  * @brief Выделение блока (из любого потока или прерывания)
+  * @retval Блок или NULL, если свободных нет
+  */
+void* MemPool_Alloc(MemPoolTypeDef *pool)
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    void **block = pool->free_list;
+
+    if(block)
+    {
+        pool->free_list = *block;
+        pool->used++;
+        pool->allocs++;
+        if(pool->used > pool->used_max)
+        {
+            pool->used_max = pool->used;
+        }
+    }
+    else
+    {
+        pool->failures++;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+
+    return block;
+}
+
+/**
+  * @brief Возврат блока владельцем (из любого потока или прерывания)
+  * NULL и указатели вне хранилища пула пропускаются
+  */
+void MemPool_Free(MemPoolTypeDef *pool, void *block)
+{
+    uint32_t offset = (uint8_t*)block - pool->storage;
+
+    if(block == NULL || (uint8_t*)block < pool->storage ||
+       offset >= pool->count * pool->block_size || offset % pool->block_size != 0)
+        return;
+
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    *(void**)block = pool->free_list;
+    pool->free_list = block;
+    pool->used--;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+/**
+  * @brief Согласованная копия счетчиков пула
+  */
+void MemPool_Read(const MemPoolTypeDef *pool, MemPoolTypeDef *copy)
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    *copy = *pool;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
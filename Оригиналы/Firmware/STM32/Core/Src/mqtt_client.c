@@ -0,0 +1,330 @@
+/*
+ * mqtt_client.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// mqtt_client.c
+// Публикация показаний на MQTT брокер через AT+MQTT* команды ESP-AT.
+// Показания копятся в ограниченной очереди и отправляются пачками.
+// Пока брокер недоступен, очередь хранит последние показания, после
+// подключения она разбирается сериями публикаций.
+//
+// Подключение не ждет ответа в потоке клиента: команды ставятся в
+// очередь движка, результат приходит в обработчики завершения. ESP во
+// время AT+MQTTCONN занят до MQTT_CONNECT_TIMEOUT и отвечает "busy p..."
+// на другие команды, поэтому при недоступном брокере пауза между
+// попытками удваивается от MQTT_RETRY_INTERVAL до MQTT_RETRY_MAX.
+#include "mqtt_client.h"
+#include <stdio.h>
+#include <string.h>
+
+/**
+  * @brief Уведомление ESP о разрыве: "+MQTTDISCONNECTED:<link>"
+  */
+static void MQTT_Client_OnDisconnected(void *ctx, const char *line)
+{
+    MQTT_ClientTypeDef *client = ctx;
+
+    client->connected = 0;
+}
+
+// Конец попытки подключения (поток движка или клиента)
+static void MQTT_Client_Finish(MQTT_ClientTypeDef *client, uint8_t connected)
+{
+    if(connected)
+    {
+        client->connected = 1;
+        client->connects++;
+        client->retry_delay = 0;
+    }
+    else
+    {
+        client->errors++;
+        client->retry_delay = (client->retry_delay == 0) ? MQTT_RETRY_INTERVAL :
+                              (client->retry_delay < MQTT_RETRY_MAX / 2) ? client->retry_delay * 2 :
+                              MQTT_RETRY_MAX;
+    }
+    // Пауза отсчитывается от ответа: ESP занят все время попытки
+    client->last_attempt = osKernelGetTickCount();
+    client->connecting = 0;
+    if(client->thread)
+    {
+        osThreadFlagsSet(client->thread, client->wake_flag);
+    }
+}
+
+// Завершение AT+MQTTCONN (поток движка)
+static void MQTT_Client_OnConnected(void *ctx, AT_RequestTypeDef *request)
+{
+    MQTT_Client_Finish(ctx, request->status == AT_STATUS_OK);
+}
+
+static void MQTT_Client_SubmitConnect(MQTT_ClientTypeDef *client)
+{
+    char command[AT_COMMAND_SIZE - 2];
+
+    // Последний параметр 1 - повторное подключение силами ESP
+    snprintf(command, sizeof(command), "AT+MQTTCONN=0,\"%s\",%u,1", client->host, client->port);
+    AT_Request_Init(&client->connect_request, command, "OK", MQTT_CONNECT_TIMEOUT);
+    client->connect_request.done = MQTT_Client_OnConnected;
+    client->connect_request.ctx = client;
+    if(!AT_Engine_Submit(client->engine, &client->connect_request))
+    {
+        MQTT_Client_Finish(client, 0);
+    }
+}
+
+// Завершение AT+MQTTUSERCFG (поток движка)
+static void MQTT_Client_OnConfigured(void *ctx, AT_RequestTypeDef *request)
+{
+    MQTT_ClientTypeDef *client = ctx;
+
+    if(request->status == AT_STATUS_OK)
+    {
+        client->configured = 1;
+        MQTT_Client_SubmitConnect(client);
+        return;
+    }
+
+    // ERROR на первую команду - прошивка без MQTT
+    client->unsupported = (request->status == AT_STATUS_ERROR);
+    MQTT_Client_Finish(client, 0);
+}
+
+static void MQTT_Client_Connect(MQTT_ClientTypeDef *client)
+{
+    char command[AT_COMMAND_SIZE - 2];
+
+    client->connecting = 1;
+    if(client->configured)
+    {
+        MQTT_Client_SubmitConnect(client);
+        return;
+    }
+
+    // Схема 1 - MQTT поверх TCP, без логина и сертификатов
+    snprintf(command, sizeof(command), "AT+MQTTUSERCFG=0,1,\"%s\",\"\",\"\",0,0,\"\"",
+             client->client_id);
+    AT_Request_Init(&client->config_request, command, "OK", 1000);
+    client->config_request.done = MQTT_Client_OnConfigured;
+    client->config_request.ctx = client;
+    if(!AT_Engine_Submit(client->engine, &client->config_request))
+    {
+        MQTT_Client_Finish(client, 0);
+    }
+}
+
+/**
+  * @brief Формирование пачки: {"id":"<client>","s":[[<unix>,<t>,<h>],...]}
+  * @retval Число показаний в пачке
+  */
+static uint16_t MQTT_Client_Build(MQTT_ClientTypeDef *client, uint32_t *length)
+{
+    MQTT_SampleTypeDef batch[MQTT_BATCH_SIZE];
+    uint16_t count;
+    uint32_t used;
+
+    // Копия под блокировкой: поток датчика продолжает добавлять показания
+    osKernelLock();
+    count = (client->count < MQTT_BATCH_SIZE) ? client->count : MQTT_BATCH_SIZE;
+    client->batch_dropped = client->dropped;
+    for(uint16_t i = 0; i < count; i++)
+    {
+        batch[i] = client->samples[(client->head + i) % MQTT_QUEUE_SIZE];
+    }
+    osKernelUnlock();
+
+    used = snprintf(client->payload, sizeof(client->payload), "{\"id\":\"%s\",\"s\":[",
+                    client->client_id);
+    for(uint16_t i = 0; i < count; i++)
+    {
+        const MQTT_SampleTypeDef *sample = &batch[i];
+        int16_t t = sample->temperature;
+
+        // Целые десятые без printf для float
+        used += snprintf(client->payload + used, sizeof(client->payload) - used,
+                         "%s[%lu,%s%d.%d,%u.%u]", i ? "," : "",
+                         (unsigned long)sample->timestamp, (t < 0) ? "-" : "",
+                         (t < 0 ? -t : t) / 10, (t < 0 ? -t : t) % 10,
+                         sample->humidity / 10, sample->humidity % 10);
+    }
+    used += snprintf(client->payload + used, sizeof(client->payload) - used, "]}");
+
+    *length = used;
+    return count;
+}
+
+// Удаление отправленных показаний из начала очереди
+static void MQTT_Client_Drop(MQTT_ClientTypeDef *client, uint16_t count)
+{
+    osKernelLock();
+    // Пока шла публикация, часть этих показаний могла быть вытеснена
+    uint32_t evicted = client->dropped - client->batch_dropped;
+    count = (count > evicted) ? count - evicted : 0;
+    client->head = (client->head + count) % MQTT_QUEUE_SIZE;
+    client->count -= count;
+    osKernelUnlock();
+}
+
+// Мс до конца интервала
+static uint32_t MQTT_Client_Remaining(uint32_t elapsed, uint32_t interval)
+{
+    return (elapsed < interval) ? interval - elapsed : 0;
+}
+
+static uint8_t MQTT_Client_Publish(MQTT_ClientTypeDef *client)
+{
+    char command[AT_COMMAND_SIZE - 2];
+    uint32_t length;
+    uint16_t count = MQTT_Client_Build(client, &length);
+
+    // Данные после приглашения ">" - JSON не нужно экранировать, как в AT+MQTTPUB
+    snprintf(command, sizeof(command), "AT+MQTTPUBRAW=0,\"%s\",%lu,1,0",
+             client->topic, (unsigned long)length);
+    AT_Request_Init(&client->request, command, "+MQTTPUB:OK", MQTT_PUBLISH_TIMEOUT);
+    client->request.data = (const uint8_t*)client->payload;
+    client->request.data_length = length;
+
+    if(AT_Engine_Execute(client->engine, &client->request) != AT_STATUS_OK)
+    {
+        // Брокер недоступен - показания остаются в очереди
+        client->connected = 0;
+        client->errors++;
+        return 0;
+    }
+
+    MQTT_Client_Drop(client, count);
+    client->published += count;
+    client->publishes++;
+    client->last_publish = osKernelGetTickCount();
+    return 1;
+}
+
+/**
+  * @brief Инициализация клиента
+  * @param host: адрес брокера, доступный ESP
+  */
+void MQTT_Client_Init(MQTT_ClientTypeDef *client, AT_EngineTypeDef *engine,
+                      const char *host, uint16_t port, const char *client_id, const char *topic)
+{
+    memset(client, 0, sizeof(*client));
+    client->engine = engine;
+    client->host = host;
+    client->port = port;
+    client->client_id = client_id;
+    client->topic = topic;
+}
+
+/**
+  * @brief Подключение к разборщику уведомлений ESP
+  */
+void MQTT_Client_Attach(MQTT_ClientTypeDef *client, AT_ParserTypeDef *parser)
+{
+    AT_Parser_Register(parser, "+MQTTDISCONNECTED:", MQTT_Client_OnDisconnected, client);
+}
+
+/**
+  * @brief Поток, пробуждаемый флагом wake_flag по завершении подключения
+  */
+void MQTT_Client_SetThread(MQTT_ClientTypeDef *client, osThreadId_t thread, uint32_t wake_flag)
+{
+    client->thread = thread;
+    client->wake_flag = wake_flag;
+}
+
+/**
+  * @brief Сброс соединения (после перезапуска ESP и AT_Engine_Abort),
+  *        очередь сохраняется, подключение - сразу
+  */
+void MQTT_Client_Reset(MQTT_ClientTypeDef *client)
+{
+    client->connected = 0;
+    client->connecting = 0;
+    client->configured = 0;
+    client->unsupported = 0;
+    client->retry_delay = 0;
+}
+
+/**
+  * @brief Добавление показания в очередь (из любого потока)
+  */
+void MQTT_Client_Push(MQTT_ClientTypeDef *client, uint32_t timestamp, float temperature, float humidity)
+{
+    MQTT_SampleTypeDef sample;
+
+    sample.timestamp = timestamp;
+    sample.temperature = (int16_t)(temperature * 10.0f + (temperature < 0 ? -0.5f : 0.5f));
+    sample.humidity = (uint16_t)(humidity * 10.0f + 0.5f);
+
+    osKernelLock();
+    if(client->count == MQTT_QUEUE_SIZE)
+    {
+        // Очередь заполнена - теряется самое старое показание
+        client->head = (client->head + 1) % MQTT_QUEUE_SIZE;
+        client->count--;
+        client->dropped++;
+    }
+    client->samples[(client->head + client->count) % MQTT_QUEUE_SIZE] = sample;
+    client->count++;
+    osKernelUnlock();
+}
+
+/**
+  * @brief Подключение и публикация (поток, отличный от потока движка AT)
+  * Пачка отправляется, когда набрано MQTT_BATCH_SIZE показаний или
+  * прошло MQTT_PUBLISH_INTERVAL. Накопленная очередь разбирается
+  * сериями не больше MQTT_BURST_BATCHES публикаций
+  * @retval Мс до следующего вызова, osWaitForever - до нового показания
+  *         или завершения подключения
+  */
+uint32_t MQTT_Client_Process(MQTT_ClientTypeDef *client)
+{
+    uint32_t now = osKernelGetTickCount();
+
+    if(client->unsupported)
+        return osWaitForever;
+
+    if(!client->connected)
+    {
+        if(!client->connecting && (now - client->last_attempt) >= client->retry_delay)
+        {
+            MQTT_Client_Connect(client);
+        }
+    }
+    else
+    {
+        for(uint8_t n = 0; n < MQTT_BURST_BATCHES && client->connected; n++)
+        {
+            uint16_t count = client->count;
+
+            if(count == 0)
+                break;
+            if(count < MQTT_BATCH_SIZE && (now - client->last_publish) < MQTT_PUBLISH_INTERVAL)
+                break;
+            if(!MQTT_Client_Publish(client))
+                break;
+        }
+    }
+
+    // Срок следующего подключения или публикации
+    now = osKernelGetTickCount();
+    if(client->unsupported || client->connecting)
+        return osWaitForever;
+    if(!client->connected)
+        return MQTT_Client_Remaining(now - client->last_attempt, client->retry_delay);
+    if(client->count == 0)
+        return osWaitForever;
+    if(client->count >= MQTT_BATCH_SIZE)
+        return MQTT_BURST_PAUSE;
+    return MQTT_Client_Remaining(now - client->last_publish, MQTT_PUBLISH_INTERVAL);
+}
+
+/**
+  * @brief Показаний в очереди
+  */
+uint16_t MQTT_Client_Pending(MQTT_ClientTypeDef *client)
+{
+    return client->count;
+}
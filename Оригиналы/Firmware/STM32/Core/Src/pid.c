@@ -25,6 +25,14 @@ void PID_SetOutputLimits(PID_HandleTypeDef *pid, float min, float max)
     pid->output_max = max;
 }
 
+// Новые коэффициенты без сброса интеграла
+void PID_SetTunings(PID_HandleTypeDef *pid, float Kp, float Ki, float Kd)
+{
+    pid->Kp = Kp;
+    pid->Ki = Ki;
+    pid->Kd = Kd;
+}
+
 float PID_Compute(PID_HandleTypeDef *pid, float input, float setpoint)
 {
     float error = setpoint - input;
@@ -52,6 +60,21 @@ float PID_Compute(PID_HandleTypeDef *pid, float input, float setpoint)
     return output;
 }
 
+// Выход для новой уставки без шага регулятора: интеграл и
+// дифференциальная составляющая не меняются между измерениями
+float PID_Evaluate(PID_HandleTypeDef *pid, float input, float setpoint)
+{
+    float error = setpoint - input;
+    float output = pid->Kp * error + pid->Ki * pid->integral;
+
+    if(output > pid->output_max)
+        output = pid->output_max;
+    else if(output < pid->output_min)
+        output = pid->output_min;
+
+    return output;
+}
+
 void PID_Reset(PID_HandleTypeDef *pid)
 {
     pid->integral = 0.0f;
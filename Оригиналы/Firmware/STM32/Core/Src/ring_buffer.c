@@ -0,0 +1,90 @@
+/*
+ * ring_buffer.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// ring_buffer.c
+// Добавление записи - O(1) без сдвига массива. Читатели не блокируют
+// писателя: запись копируется, затем по head и generation проверяется,
+// что ее место не было занято новой записью во время копирования.
+#include "ring_buffer.h"
+#include <string.h>
+
+/**
+  * @brief Инициализация буфера во внешнем хранилище
+  * @param storage: element_size * capacity байт
+  */
+void Ring_Init(RingBufferTypeDef *ring, void *storage, uint32_t element_size, uint32_t capacity)
+{
+    ring->storage = storage;
+    ring->element_size = element_size;
+    ring->capacity = capacity;
+    ring->head = 0;
+    ring->generation = 0;
+}
+
+/**
+  * @brief Добавление записи (только из потока-писателя)
+  * Самая старая запись перезаписывается при заполнении
+  */
+void Ring_Append(RingBufferTypeDef *ring, const void *element)
+{
+    uint32_t seq = ring->head;
+
+    ring->generation++;
+    __DMB();
+    memcpy(ring->storage + (seq % ring->capacity) * ring->element_size, element, ring->element_size);
+    __DMB();
+    ring->head = seq + 1;
+    __DMB();
+    ring->generation++;
+}
+
+/**
+  * @brief Диапазон записей для чтения
+  * Самая старая запись не входит в диапазон, поэтому одно добавление
+  * во время обхода не делает прочитанные номера недействительными
+  * @param first: номер самой старой доступной записи
+  * @retval Количество записей, first + count - 1 - самая новая
+  */
+uint32_t Ring_Snapshot(const RingBufferTypeDef *ring, uint32_t *first)
+{
+    uint32_t head = ring->head;
+    uint32_t count = (head < ring->capacity - 1) ? head : ring->capacity - 1;
+
+    *first = head - count;
+    return count;
+}
+
+/**
+  * @brief Копирование записи по номеру (из любого потока)
+  * @retval 1 - запись действительна, 0 - уже перезаписана
+  */
+uint8_t Ring_Get(const RingBufferTypeDef *ring, uint32_t seq, void *element)
+{
+    if((int32_t)(ring->head - seq) <= 0)
+        return 0;
+
+    memcpy(element, ring->storage + (seq % ring->capacity) * ring->element_size, ring->element_size);
+    __DMB();
+
+    // Идущая запись уже занимает место записи seq + 1 - capacity
+    uint32_t writing = ring->generation & 1U;
+    uint32_t head = ring->head;
+
+    return (int32_t)(seq + ring->capacity - head - writing) >= 0;
+}
+
+/**
+  * @brief Удаление всех записей (только из потока-писателя)
+  */
+void Ring_Clear(RingBufferTypeDef *ring)
+{
+    ring->generation++;
+    __DMB();
+    ring->head = 0;
+    __DMB();
+    ring->generation++;
+}
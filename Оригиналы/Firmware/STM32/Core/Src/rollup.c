@@ -0,0 +1,217 @@
+/*
+ * rollup.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// rollup.c
+// Многоуровневая история: минимум, максимум, среднее и количество
+// показаний за интервалы разной длительности. Каждое показание сразу
+// учитывается во всех уровнях, при запросе интервалы только объединяются.
+// Показания добавляет один поток, читать можно из любого.
+#include "rollup.h"
+#include <string.h>
+
+static int16_t Rollup_Fixed(float value)
+{
+    return (int16_t)(value * ROLLUP_SCALE + (value < 0.0f ? -0.5f : 0.5f));
+}
+
+static void Rollup_Open(Rollup_TierTypeDef *tier, uint32_t start)
+{
+    memset(&tier->open, 0, sizeof(tier->open));
+    tier->open.start = start;
+}
+
+/**
+  * @brief Закрытие текущего интервала с переносом в кольцо
+  */
+static void Rollup_Close(Rollup_TierTypeDef *tier)
+{
+    Rollup_BucketTypeDef bucket;
+
+    memset(&bucket, 0, sizeof(bucket));
+    bucket.count = tier->open.count;
+    for(uint8_t c = 0; c < ROLLUP_CHANNELS && bucket.count; c++)
+    {
+        bucket.min[c] = tier->open.min[c];
+        bucket.max[c] = tier->open.max[c];
+        bucket.mean[c] = (int16_t)(tier->open.sum[c] / (int32_t)bucket.count);
+    }
+
+    Ring_Append(&tier->ring, &bucket);
+}
+
+/**
+  * @brief Инициализация уровня
+  * @param capacity: интервалов в storage (одно место - запас для читателей)
+  */
+void Rollup_TierInit(Rollup_TierTypeDef *tier, uint32_t period,
+                     Rollup_BucketTypeDef *storage, uint32_t capacity)
+{
+    memset(tier, 0, sizeof(*tier));
+    tier->period = period;
+    Ring_Init(&tier->ring, storage, sizeof(Rollup_BucketTypeDef), capacity);
+}
+
+/**
+  * @brief Учет показания
+  * @param values: ROLLUP_CHANNELS значений
+  */
+void Rollup_Add(Rollup_TierTypeDef *tier, uint32_t timestamp, const float *values)
+{
+    uint32_t start = timestamp - timestamp % tier->period;
+
+    if(!tier->started || start < tier->open.start ||
+       (start - tier->open.start) / tier->period > tier->ring.capacity)
+    {
+        // Первое показание или перевод часов - история уровня начинается заново
+        Ring_Clear(&tier->ring);
+        tier->origin = start;
+        tier->started = 1;
+        osKernelLock();
+        Rollup_Open(tier, start);
+        osKernelUnlock();
+    }
+
+    while(tier->open.start < start)
+    {
+        // Пропущенные интервалы остаются пустыми
+        Rollup_Close(tier);
+        osKernelLock();
+        Rollup_Open(tier, tier->open.start + tier->period);
+        osKernelUnlock();
+    }
+
+    osKernelLock();
+    for(uint8_t c = 0; c < ROLLUP_CHANNELS; c++)
+    {
+        int16_t value = Rollup_Fixed(values[c]);
+
+        if(tier->open.count == 0 || value < tier->open.min[c])
+            tier->open.min[c] = value;
+        if(tier->open.count == 0 || value > tier->open.max[c])
+            tier->open.max[c] = value;
+        tier->open.sum[c] += value;
+    }
+    tier->open.count++;
+    osKernelUnlock();
+}
+
+/**
+  * @brief Самый грубый уровень с интервалом не длиннее step
+  * Если уровень хранит историю меньшей глубины, чем нужно для from,
+  * выбирается следующий, более грубый
+  * @param tiers: от мелкого интервала к крупному
+  */
+uint8_t Rollup_Select(Rollup_TierTypeDef *tiers, uint8_t count, uint32_t from, uint32_t step)
+{
+    uint8_t selected = 0;
+
+    for(uint8_t i = 0; i < count; i++)
+    {
+        if(tiers[i].period <= step)
+        {
+            selected = i;
+        }
+    }
+
+    while(selected + 1 < count)
+    {
+        Rollup_TierTypeDef *tier = &tiers[selected];
+        uint32_t depth = (tier->ring.capacity - 1) * tier->period;
+
+        if(!tier->started || from >= tier->open.start || tier->open.start - from <= depth)
+            break;
+        selected++;
+    }
+
+    return selected;
+}
+
+static void Rollup_Merge(Rollup_RowTypeDef *row, const int16_t *min, const int16_t *max,
+                         const int32_t *sum, uint32_t count)
+{
+    if(count == 0)
+        return;
+
+    for(uint8_t c = 0; c < ROLLUP_CHANNELS; c++)
+    {
+        if(row->count == 0 || min[c] < row->min[c])
+            row->min[c] = min[c];
+        if(row->count == 0 || max[c] > row->max[c])
+            row->max[c] = max[c];
+        row->sum[c] += sum[c];
+    }
+    row->count += count;
+}
+
+/**
+  * @brief Интервалы уровня в диапазоне [from, to), объединенные по step секунд
+  * Строки без показаний не возвращаются
+  * @retval Количество строк
+  */
+uint32_t Rollup_Query(Rollup_TierTypeDef *tier, uint32_t from, uint32_t to, uint32_t step,
+                      Rollup_RowTypeDef *rows, uint32_t max_rows)
+{
+    uint32_t row_count = 0;
+    uint32_t first;
+    uint32_t count = Ring_Snapshot(&tier->ring, &first);
+    uint32_t origin = tier->origin;
+
+    if(!tier->started || step < tier->period)
+    {
+        step = tier->period;
+    }
+
+    for(uint32_t seq = first; seq <= first + count; seq++)
+    {
+        Rollup_BucketTypeDef bucket;
+        int32_t sum[ROLLUP_CHANNELS];
+        uint32_t time;
+
+        if(seq < first + count)
+        {
+            time = origin + seq * tier->period;
+            if(time < from || time >= to || !Ring_Get(&tier->ring, seq, &bucket))
+                continue;
+            for(uint8_t c = 0; c < ROLLUP_CHANNELS; c++)
+            {
+                sum[c] = (int32_t)bucket.mean[c] * bucket.count;
+            }
+        }
+        else
+        {
+            // Текущий интервал копируется целиком
+            Rollup_OpenTypeDef open;
+            osKernelLock();
+            open = tier->open;
+            osKernelUnlock();
+
+            time = open.start;
+            if(!tier->started || time < from || time >= to)
+                break;
+            memcpy(bucket.min, open.min, sizeof(bucket.min));
+            memcpy(bucket.max, open.max, sizeof(bucket.max));
+            memcpy(sum, open.sum, sizeof(sum));
+            bucket.count = open.count;
+        }
+
+        if(bucket.count == 0)
+            continue;
+
+        uint32_t row_time = time - (time - from) % step;
+        if(row_count == 0 || rows[row_count - 1].time != row_time)
+        {
+            if(row_count >= max_rows)
+                break;
+            memset(&rows[row_count], 0, sizeof(rows[row_count]));
+            rows[row_count].time = row_time;
+            row_count++;
+        }
+        Rollup_Merge(&rows[row_count - 1], bucket.min, bucket.max, sum, bucket.count);
+    }
+
+    return row_count;
+}
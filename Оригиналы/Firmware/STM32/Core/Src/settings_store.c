@@ -0,0 +1,114 @@
+/*
+ * settings_store.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// settings_store.c
+// Хранение настроек в двух слотах резервной SRAM. Запись идет в слот,
+// не содержащий последней действительной копии, при загрузке выбирается
+// действительный слот с большим номером. Резервная SRAM не изнашивается
+// и читается за несколько микросекунд.
+#include "settings_store.h"
+#include "crc32.h"
+#include <stddef.h>
+#include <string.h>
+
+#define SETTINGS_STORE_SLOTS 2
+
+static volatile SettingsStore_SlotTypeDef* SettingsStore_Slot(uint8_t index)
+{
+    return (volatile SettingsStore_SlotTypeDef*)SETTINGS_STORE_BASE + index;
+}
+
+static uint8_t SettingsStore_Valid(const SettingsStore_SlotTypeDef *slot)
+{
+    return slot->magic == SETTINGS_STORE_MAGIC &&
+           slot->length <= SETTINGS_STORE_PAYLOAD_MAX &&
+           slot->crc == CRC32_Compute(slot, offsetof(SettingsStore_SlotTypeDef, crc));
+}
+
+/**
+  * @brief Доступ к резервной SRAM и ее питание от VBAT
+  */
+void SettingsStore_Init(SettingsStoreTypeDef *store)
+{
+    memset(store, 0, sizeof(*store));
+
+    __HAL_RCC_PWR_CLK_ENABLE();
+    HAL_PWR_EnableBkUpAccess();
+    __HAL_RCC_BKPSRAM_CLK_ENABLE();
+    HAL_PWREx_EnableBkUpReg();
+}
+
+/**
+  * @brief Загрузка последней действительной записи
+  * @param version: запись другой версии не загружается
+  * @retval 1 - данные загружены, 0 - записи нет (data не изменяется)
+  */
+uint8_t SettingsStore_Load(SettingsStoreTypeDef *store, uint16_t version, void *data, uint16_t length)
+{
+    SettingsStore_SlotTypeDef slot;
+    uint8_t found = 0;
+
+    for(uint8_t i = 0; i < SETTINGS_STORE_SLOTS; i++)
+    {
+        memcpy(&slot, (const void*)SettingsStore_Slot(i), sizeof(slot));
+        if(!SettingsStore_Valid(&slot))
+            continue;
+
+        // Номер следующей записи продолжает оба слота, даже другой версии
+        if(!found || (int32_t)(slot.sequence - store->sequence) > 0)
+        {
+            store->sequence = slot.sequence;
+            store->active = i;
+            found = 1;
+        }
+    }
+
+    if(!found)
+        return 0;
+
+    memcpy(&slot, (const void*)SettingsStore_Slot(store->active), sizeof(slot));
+    if(slot.version != version || slot.length != length)
+        return 0;
+
+    memcpy(data, slot.payload, length);
+    store->restores++;
+    return 1;
+}
+
+/**
+  * @brief Запись в неактивный слот
+  * @retval 1 - записано, 0 - данные не помещаются в слот
+  */
+uint8_t SettingsStore_Save(SettingsStoreTypeDef *store, uint16_t version, const void *data, uint16_t length)
+{
+    SettingsStore_SlotTypeDef slot;
+    uint8_t target = store->active ^ 1;
+
+    if(length > SETTINGS_STORE_PAYLOAD_MAX)
+        return 0;
+
+    memset(&slot, 0, sizeof(slot));
+    slot.magic = SETTINGS_STORE_MAGIC;
+    slot.version = version;
+    slot.length = length;
+    slot.sequence = store->sequence + 1;
+    memcpy(slot.payload, data, length);
+    slot.crc = CRC32_Compute(&slot, offsetof(SettingsStore_SlotTypeDef, crc));
+
+    // Сначала данные, затем CRC: до ее записи слот недействителен
+    volatile SettingsStore_SlotTypeDef *destination = SettingsStore_Slot(target);
+    destination->crc = ~slot.crc;
+    __DMB();
+    memcpy((void*)destination, &slot, offsetof(SettingsStore_SlotTypeDef, crc));
+    __DMB();
+    destination->crc = slot.crc;
+
+    store->sequence = slot.sequence;
+    store->active = target;
+    store->saves++;
+    return 1;
+}
@@ -0,0 +1,122 @@
+/*
+ * stats.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// stats.c
+// Потоковая статистика: каждое показание обновляет среднее, дисперсию,
+// экстремумы, время в полосе и время работы выхода за O(1), без хранения
+// показаний. Показания добавляет один поток, читать можно из любого.
+#include "stats.h"
+#include <math.h>
+#include <string.h>
+
+static void Stats_Start(Stats_SummaryTypeDef *summary, uint32_t start)
+{
+    memset(summary, 0, sizeof(*summary));
+    summary->start = start;
+}
+
+/**
+  * @brief Инициализация окна
+  * @param period: длительность окна, с (3600 - час, 86400 - сутки по часам RTC)
+  */
+void Stats_Init(Stats_WindowTypeDef *window, uint32_t period)
+{
+    memset(window, 0, sizeof(*window));
+    window->period = period;
+}
+
+/**
+  * @brief Учет показания
+  * Время до показания относится к состоянию на момент показания
+  */
+void Stats_Add(Stats_WindowTypeDef *window, const Stats_SampleTypeDef *sample)
+{
+    uint32_t start = sample->timestamp - sample->timestamp % window->period;
+    uint32_t elapsed = 0;
+
+    osKernelLock();
+
+    if(window->current.start != start || window->last_time == 0)
+    {
+        // Новое окно: завершенное сохраняется только если оно предыдущее
+        if(window->last_time != 0 && start == window->current.start + window->period)
+        {
+            window->previous = window->current;
+        }
+        else if(window->last_time != 0)
+        {
+            Stats_Start(&window->previous, start - window->period);
+        }
+        Stats_Start(&window->current, start);
+    }
+    else if(sample->timestamp > window->last_time)
+    {
+        elapsed = sample->timestamp - window->last_time;
+        if(elapsed > STATS_MAX_GAP)
+        {
+            elapsed = 0;
+        }
+    }
+    window->last_time = sample->timestamp;
+    window->current.duration += elapsed;
+
+    for(uint8_t c = 0; c < STATS_CHANNELS; c++)
+    {
+        Stats_ChannelTypeDef *channel = &window->current.channel[c];
+        float value = sample->value[c];
+
+        channel->count++;
+        float delta = value - channel->mean;
+        channel->mean += delta / (float)channel->count;
+        channel->m2 += delta * (value - channel->mean);
+
+        if(channel->count == 1 || value < channel->min)
+        {
+            channel->min = value;
+            channel->min_time = sample->timestamp;
+        }
+        if(channel->count == 1 || value > channel->max)
+        {
+            channel->max = value;
+            channel->max_time = sample->timestamp;
+        }
+
+        if(fabsf(value - sample->setpoint[c]) <= sample->band[c])
+        {
+            channel->in_band += elapsed;
+        }
+        if(sample->relay[c])
+        {
+            channel->relay_on += elapsed;
+        }
+    }
+
+    osKernelUnlock();
+}
+
+/**
+  * @brief Согласованная копия текущего и предыдущего окна
+  */
+void Stats_Read(const Stats_WindowTypeDef *window, Stats_SummaryTypeDef *current,
+                Stats_SummaryTypeDef *previous)
+{
+    osKernelLock();
+    *current = window->current;
+    *previous = window->previous;
+    osKernelUnlock();
+}
+
+/**
+  * @brief Стандартное отклонение (выборочное)
+  */
+float Stats_StdDev(const Stats_ChannelTypeDef *channel)
+{
+    if(channel->count < 2)
+        return 0.0f;
+
+    return sqrtf(channel->m2 / (float)(channel->count - 1));
+}
@@ -0,0 +1,121 @@
+/*
+ * task_stats.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// task_stats.c
+// Загрузка процессора по потокам. Ядро считает такты DWT->CYCCNT каждого
+// потока при переключении (configGENERATE_RUN_TIME_STATS), замер раз в
+// интервал переводит накопленные счетчики в такты за интервал. Разности
+// 32-битных счетчиков верны, пока интервал короче переполнения (25 с).
+// Замеры делает один поток, читать можно из любого.
+#include "task_stats.h"
+#include <string.h>
+
+// Только для потока замера
+static TaskStatus_t task_status[TASK_STATS_COUNT];
+static TaskStats_EntryTypeDef task_entries[TASK_STATS_COUNT];
+
+static const TaskStats_EntryTypeDef* TaskStats_Find(const TaskStatsTypeDef *stats, TaskHandle_t handle)
+{
+    for(uint8_t i = 0; i < stats->count; i++)
+    {
+        if(stats->entries[i].handle == handle)
+            return &stats->entries[i];
+    }
+    return NULL;
+}
+
+/**
+  * @brief Инициализация (до запуска планировщика)
+  */
+void TaskStats_Init(TaskStatsTypeDef *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
+
+/**
+  * @brief Замер: состояние потоков и такты каждого с прошлого замера
+  * Вызывается периодически, не реже раза в 25 с
+  */
+void TaskStats_Sample(TaskStatsTypeDef *stats)
+{
+    uint32_t start = DWT->CYCCNT;
+    uint32_t total;
+    UBaseType_t count;
+
+    // Планировщик приостановлен только на время обхода списков ядра
+    count = uxTaskGetSystemState(task_status, TASK_STATS_COUNT, &total);
+    if(count == 0)
+        return;
+
+    // Потоки в порядке создания
+    uint8_t order[TASK_STATS_COUNT];
+    for(UBaseType_t i = 0; i < count; i++)
+    {
+        uint8_t position = i;
+        while(position > 0 && task_status[order[position - 1]].xTaskNumber > task_status[i].xTaskNumber)
+        {
+            order[position] = order[position - 1];
+            position--;
+        }
+        order[position] = i;
+    }
+
+    // Такты потока - разность с прошлым замером, у нового потока пока 0
+    for(UBaseType_t i = 0; i < count; i++)
+    {
+        const TaskStatus_t *status = &task_status[order[i]];
+        const TaskStats_EntryTypeDef *previous = TaskStats_Find(stats, status->xHandle);
+        TaskStats_EntryTypeDef *entry = &task_entries[i];
+
+        entry->handle = status->xHandle;
+        strncpy(entry->name, status->pcTaskName, sizeof(entry->name) - 1);
+        entry->name[sizeof(entry->name) - 1] = '\0';
+        entry->state = status->eCurrentState;
+        entry->priority = status->uxCurrentPriority;
+        entry->stack_free_min = status->usStackHighWaterMark * sizeof(StackType_t);
+        entry->runtime = status->ulRunTimeCounter;
+        entry->cycles = previous ? status->ulRunTimeCounter - previous->runtime : 0;
+    }
+
+    uint32_t sample_cycles = DWT->CYCCNT - start;
+
+    osKernelLock();
+    memcpy(stats->entries, task_entries, count * sizeof(task_entries[0]));
+    stats->count = count;
+    stats->interval = stats->samples ? total - stats->total : 0;
+    stats->total = total;
+    stats->samples++;
+    stats->sample_cycles = sample_cycles;
+    if(sample_cycles > stats->sample_max_cycles)
+    {
+        stats->sample_max_cycles = sample_cycles;
+    }
+    osKernelUnlock();
+}
+
+/**
+  * @brief Согласованная копия последнего замера
+  */
+void TaskStats_Read(const TaskStatsTypeDef *stats, TaskStatsTypeDef *copy)
+{
+    osKernelLock();
+    *copy = *stats;
+    osKernelUnlock();
+}
+
+const char* TaskStats_StateName(eTaskState state)
+{
+    switch(state)
+    {
+    case eRunning:   return "running";
+    case eReady:     return "ready";
+    case eBlocked:   return "blocked";
+    case eSuspended: return "suspended";
+    case eDeleted:   return "deleted";
+    default:         return "invalid";
+    }
+}
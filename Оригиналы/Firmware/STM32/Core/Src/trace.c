@@ -0,0 +1,157 @@
+/*
+ * trace.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// trace.c
+// Журнал трассировки в кольце RAM: переключения потоков, прерывания,
+// команды AT, обмен Modbus и этапы HTTP запросов. Запись события -
+// чтение DWT->CYCCNT и 8 байт в критической секции, из потоков,
+// прерываний и хука ядра traceTASK_SWITCHED_IN.
+// Выгрузка не копирует кольцо: запись приостанавливается, заголовок и
+// имена заполняются на месте, после отправки кольцо очищается.
+// Разбор дампа - Tools/trace_convert (Chrome trace-event JSON).
+#include "trace.h"
+#include "FreeRTOS.h"
+#include "task.h"
+#include <string.h>
+
+// Имена, заданные Trace_SetName: строки должны существовать постоянно
+typedef struct {
+    uint8_t kind;
+    uint8_t id;
+    const char *name;
+} TraceNameRefTypeDef;
+
+static TraceDumpTypeDef *trace_dump;
+static volatile uint32_t trace_head;
+static volatile uint8_t trace_frozen;
+static TraceNameRefTypeDef trace_names[TRACE_NAME_COUNT];
+static uint8_t trace_name_count;
+
+// Только для потока выгрузки
+static TaskStatus_t trace_tasks[TRACE_NAME_COUNT / 2];
+
+/**
+  * @brief Инициализация (до запуска планировщика)
+  * @param dump: память кольца и заголовка выгрузки
+  */
+void Trace_Init(TraceDumpTypeDef *dump)
+{
+    trace_dump = dump;
+    trace_head = 0;
+    trace_frozen = 0;
+}
+
+/**
+  * @brief Запись события (из любого потока или прерывания)
+  */
+void Trace_Record(uint8_t type, uint8_t id, uint16_t arg)
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+
+    if(trace_dump && !trace_frozen)
+    {
+        TraceRecordTypeDef *event = &trace_dump->events[trace_head & (TRACE_EVENT_COUNT - 1)];
+        event->cycles = DWT->CYCCNT;
+        event->type = type;
+        event->id = id;
+        event->arg = arg;
+        trace_head++;
+    }
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
+
+/**
+  * @brief Хук ядра: поток с номером task_number начал выполняться
+  */
+void Trace_TaskSwitchedIn(uint32_t task_number)
+{
+    Trace_Record(TRACE_TASK_SWITCH, (uint8_t)task_number, 0);
+}
+
+/**
+  * @brief Имя идентификатора в дампе (прерывания, команды AT)
+  * Повторный вызов с тем же kind и id заменяет имя
+  */
+void Trace_SetName(uint8_t kind, uint8_t id, const char *name)
+{
+    for(uint8_t i = 0; i < trace_name_count; i++)
+    {
+        if(trace_names[i].kind == kind && trace_names[i].id == id)
+        {
+            trace_names[i].name = name;
+            return;
+        }
+    }
+
+    if(trace_name_count < TRACE_NAME_COUNT)
+    {
+        trace_names[trace_name_count].kind = kind;
+        trace_names[trace_name_count].id = id;
+        trace_names[trace_name_count].name = name;
+        trace_name_count++;
+    }
+}
+
+static void Trace_AddDumpName(uint8_t kind, uint8_t id, const char *name)
+{
+    if(trace_dump->name_count == TRACE_NAME_COUNT)
+        return;
+
+    TraceNameTypeDef *entry = &trace_dump->names[trace_dump->name_count++];
+    entry->kind = kind;
+    entry->id = id;
+    strncpy(entry->name, name, TRACE_NAME_SIZE);
+}
+
+/**
+  * @brief Остановка записи и заполнение заголовка дампа
+  * @retval Размер дампа в байтах, 0 - предыдущая выгрузка не завершена
+  */
+uint32_t Trace_Freeze(void)
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    uint8_t frozen = trace_frozen;
+    trace_frozen = 1;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+
+    if(frozen || trace_dump == NULL)
+        return 0;
+
+    // Имена потоков по номерам, которые пишет хук переключения
+    UBaseType_t count = uxTaskGetSystemState(trace_tasks, TRACE_NAME_COUNT / 2, NULL);
+
+    memset(trace_dump->names, 0, sizeof(trace_dump->names));
+    trace_dump->name_count = 0;
+    for(UBaseType_t i = 0; i < count; i++)
+    {
+        Trace_AddDumpName(TRACE_NAME_TASK, (uint8_t)trace_tasks[i].xTaskNumber,
+                          trace_tasks[i].pcTaskName);
+    }
+    for(uint8_t i = 0; i < trace_name_count; i++)
+    {
+        Trace_AddDumpName(trace_names[i].kind, trace_names[i].id, trace_names[i].name);
+    }
+
+    trace_dump->magic = TRACE_MAGIC;
+    trace_dump->version = TRACE_VERSION;
+    trace_dump->cpu_hz = SystemCoreClock;
+    trace_dump->head = trace_head;
+    trace_dump->capacity = TRACE_EVENT_COUNT;
+
+    return sizeof(*trace_dump);
+}
+
+/**
+  * @brief Продолжение записи после выгрузки, кольцо начинается заново
+  */
+void Trace_Resume(void)
+{
+    UBaseType_t mask = taskENTER_CRITICAL_FROM_ISR();
+    trace_head = 0;
+    trace_frozen = 0;
+    taskEXIT_CRITICAL_FROM_ISR(mask);
+}
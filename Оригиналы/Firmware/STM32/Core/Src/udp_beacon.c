@@ -0,0 +1,156 @@
+/*
+ * udp_beacon.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// udp_beacon.c
+// Маяк телеметрии: пакет фиксированного формата по UDP через
+// AT+CIPSTART "UDP" на зарезервированном link ID. Один сборщик
+// слушает порт и принимает данные всех устройств без опроса по HTTP.
+#include "udp_beacon.h"
+#include <stdio.h>
+#include <string.h>
+
+static void UDP_Beacon_Put16(uint8_t *p, uint16_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+static void UDP_Beacon_Put32(uint8_t *p, uint32_t value)
+{
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+/**
+  * @brief Уведомление "<link>,CLOSED": соединение нужно открыть заново
+  */
+static void UDP_Beacon_OnClosed(void *ctx, const char *line)
+{
+    UDP_BeaconTypeDef *beacon = ctx;
+
+    beacon->opened = 0;
+}
+
+// Завершение AT+CIPSTART (поток движка)
+static void UDP_Beacon_OnOpened(void *ctx, AT_RequestTypeDef *request)
+{
+    UDP_BeaconTypeDef *beacon = ctx;
+
+    // "ALREADY CONNECTED" приходит с ERROR, но соединение открыто
+    beacon->opened = (request->status == AT_STATUS_OK) ||
+                     (strstr(request->response, "ALREADY CONNECTED") != NULL);
+}
+
+// Завершение AT+CIPSEND (поток движка)
+static void UDP_Beacon_OnSent(void *ctx, AT_RequestTypeDef *request)
+{
+    UDP_BeaconTypeDef *beacon = ctx;
+
+    if(request->status == AT_STATUS_OK)
+    {
+        beacon->sent++;
+    }
+    else
+    {
+        // Соединение недоступно - откроем перед следующим пакетом
+        beacon->opened = 0;
+        beacon->errors++;
+    }
+    beacon->busy = 0;
+}
+
+/**
+  * @brief Инициализация маяка
+  * @param link_id: link ID, который не занимают клиенты веб-сервера
+  */
+void UDP_Beacon_Init(UDP_BeaconTypeDef *beacon, AT_EngineTypeDef *engine, uint8_t link_id,
+                     const char *host, uint16_t port, uint32_t device_id)
+{
+    memset(beacon, 0, sizeof(*beacon));
+    beacon->engine = engine;
+    beacon->link_id = link_id;
+    beacon->host = host;
+    beacon->port = port;
+    beacon->device_id = device_id;
+    snprintf(beacon->closed_prefix, sizeof(beacon->closed_prefix), "%u,CLOSED", link_id);
+}
+
+/**
+  * @brief Подключение к разборщику уведомлений ESP
+  */
+void UDP_Beacon_Attach(UDP_BeaconTypeDef *beacon, AT_ParserTypeDef *parser)
+{
+    AT_Parser_Register(parser, beacon->closed_prefix, UDP_Beacon_OnClosed, beacon);
+}
+
+/**
+  * @brief Сброс после перезапуска ESP и AT_Engine_Abort
+  */
+void UDP_Beacon_Reset(UDP_BeaconTypeDef *beacon)
+{
+    beacon->opened = 0;
+    beacon->busy = 0;
+}
+
+/**
+  * @brief Отправка пакета без ожидания (из любого потока, в том числе таймера)
+  * Номер пакета растет и для пропущенных пакетов, поэтому сборщик
+  * видит их как потерянные
+  */
+void UDP_Beacon_Send(UDP_BeaconTypeDef *beacon, const UDP_BeaconSampleTypeDef *sample)
+{
+    char command[AT_COMMAND_SIZE - 2];
+    uint8_t *p = beacon->packet;
+    float t = sample->temperature * 10.0f;
+    float h = sample->humidity * 10.0f;
+
+    beacon->sequence++;
+    if(beacon->busy)
+    {
+        beacon->skipped++;
+        return;
+    }
+
+    UDP_Beacon_Put16(p + 0, UDP_BEACON_MAGIC);
+    p[2] = UDP_BEACON_VERSION;
+    p[3] = sample->flags;
+    UDP_Beacon_Put32(p + 4, beacon->device_id);
+    UDP_Beacon_Put32(p + 8, beacon->sequence);
+    UDP_Beacon_Put32(p + 12, sample->timestamp);
+    UDP_Beacon_Put16(p + 16, (uint16_t)(int16_t)(t + (t < 0 ? -0.5f : 0.5f)));
+    UDP_Beacon_Put16(p + 18, (uint16_t)(h + 0.5f));
+    UDP_Beacon_Put32(p + 20, osKernelGetTickCount());
+
+    beacon->busy = 1;
+
+    if(!beacon->opened)
+    {
+        // Открытие стоит в очереди движка перед отправкой
+        snprintf(command, sizeof(command), "AT+CIPSTART=%u,\"UDP\",\"%s\",%u,%u,0",
+                 beacon->link_id, beacon->host, beacon->port, UDP_BEACON_LOCAL_PORT);
+        AT_Request_Init(&beacon->open_request, command, "OK", UDP_BEACON_TIMEOUT);
+        beacon->open_request.response = beacon->open_response;
+        beacon->open_request.response_size = sizeof(beacon->open_response);
+        beacon->open_request.done = UDP_Beacon_OnOpened;
+        beacon->open_request.ctx = beacon;
+        AT_Engine_Submit(beacon->engine, &beacon->open_request);
+    }
+
+    snprintf(command, sizeof(command), "AT+CIPSEND=%u,%u", beacon->link_id, UDP_BEACON_PACKET_SIZE);
+    AT_Request_Init(&beacon->send_request, command, "SEND OK", UDP_BEACON_TIMEOUT);
+    beacon->send_request.data = beacon->packet;
+    beacon->send_request.data_length = UDP_BEACON_PACKET_SIZE;
+    beacon->send_request.done = UDP_Beacon_OnSent;
+    beacon->send_request.ctx = beacon;
+    if(!AT_Engine_Submit(beacon->engine, &beacon->send_request))
+    {
+        beacon->skipped++;
+        beacon->busy = 0;
+    }
+}
@@ -94,6 +94,37 @@ LoopFillZerobss:
   cmp r2, r4
   bcc FillZerobss
  
+/* Copy the ccmram segment initializers from flash to CCM-RAM */
+  ldr r0, =_sccmram
+  ldr r1, =_eccmram
+  ldr r2, =_siccmram
+  movs r3, #0
+  b LoopCopyCcmramInit
+
+CopyCcmramInit:
+  ldr r4, [r2, r3]
+  str r4, [r0, r3]
+  adds r3, r3, #4
+
+LoopCopyCcmramInit:
+  adds r4, r0, r3
+  cmp r4, r1
+  bcc CopyCcmramInit
+
+/* Zero fill the ccmram bss segment. */
+  ldr r2, =_sccmram_bss
+  ldr r4, =_eccmram_bss
+  movs r3, #0
+  b LoopFillZeroCcmram
+
+FillZeroCcmram:
+  str  r3, [r2]
+  adds r2, r2, #4
+
+LoopFillZeroCcmram:
+  cmp r2, r4
+  bcc FillZeroCcmram
+
 /* Call static constructors */
     bl __libc_init_array
 /* Call the application's entry point.*/
@@ -0,0 +1,300 @@
+/*
+ * at_parser_test.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// at_parser_test.c
+// Проверка разборщика at_parser на записях обмена с ESP-AT v2.2.1.0
+// (CIPMUX=1, CIPDINFO=1): запись подается целиком, по байту и кусками
+// случайной длины, как их отдает DMA по событию IDLE, - результат разбора
+// должен совпадать. Отдельно - ответ AT+CIPRECVDATA пассивного приема,
+// переполнение строки, поврежденный заголовок +IPD и скорость разбора.
+//
+// Сборка и запуск:  ./run_tests.sh at_parser_test
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "at_parser.h"
+
+#define LOG_SIZE 4096
+#define BENCH_SIZE (8 * 1024 * 1024)
+
+typedef struct {
+    char lines[LOG_SIZE];      // Строки с обработчиком через '|'
+    char data[LOG_SIZE];       // Данные соединений: "<link>:<данные>"
+    uint32_t data_length;
+    uint32_t prompts;
+    uint32_t notifications;    // +IPD без данных (пассивный прием)
+    uint8_t last_link;
+} ReplayTypeDef;
+
+static ReplayTypeDef replay;
+static int failures;
+
+#define CHECK(condition) do { \
+    if(!(condition)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while(0)
+
+// Запись обмена: ответы, приглашение без перевода строки, уведомления,
+// данные +IPD с "OK" и переводами строк внутри
+static const char transcript[] =
+    "AT+CIPSEND=0,5\r\n"
+    "\r\nOK\r\n\r\n>"
+    "\r\nRecv 5 bytes\r\n\r\nSEND OK\r\n"
+    "+STA_CONNECTED:\"2c:3a:e8:0a:1b:2c\"\r\n"
+    "+DIST_STA_IP:\"2c:3a:e8:0a:1b:2c\",\"192.168.4.2\"\r\n"
+    "1,CONNECT\r\n"
+    "\r\n+IPD,1,29,\"192.168.4.2\",50001:GET / HTTP/1.1\r\n\r\nOK\r\nERROR\r\n"
+    "2,CONNECT\r\n"
+    "\r\n+IPD,2,4,\"192.168.4.3\",50002:>>>>"
+    "\r\n+IPD,1,3:abc"
+    "busy p...\r\n"
+    "AT+CWLIF\r\n"
+    "+CWLIF:192.168.4.2,2c:3a:e8:0a:1b:2c\r\n"
+    "\r\nOK\r\n"
+    "+IPD,3,1460\r\n"
+    "1,CLOSED\r\n"
+    "2,CLOSED\r\n"
+    "\r\nERROR\r\n"
+    "+STA_DISCONNECTED:\"2c:3a:e8:0a:1b:2c\"\r\n";
+
+static const char expected_lines[] =
+    "AT+CIPSEND=0,5|OK|>|Recv 5 bytes|SEND OK|+STA_CONNECTED:\"2c:3a:e8:0a:1b:2c\"|"
+    "+DIST_STA_IP:\"2c:3a:e8:0a:1b:2c\",\"192.168.4.2\"|1,CONNECT|2,CONNECT|busy p...|AT+CWLIF|+CWLIF:192.168.4.2,2c:3a:e8:0a:1b:2c|OK|"
+    "+IPD,3,1460|1,CLOSED|2,CLOSED|ERROR|+STA_DISCONNECTED:\"2c:3a:e8:0a:1b:2c\"|";
+
+static const char expected_data[] =
+    "1:GET / HTTP/1.1\r\n\r\nOK\r\nERROR\r\n2:>>>>1:abc";
+
+static void Replay_Line(void *ctx, const char *line)
+{
+    ReplayTypeDef *log = ctx;
+
+    if(strcmp(line, ">") == 0)
+    {
+        log->prompts++;
+    }
+    if(strncmp(line, "+IPD,", 5) == 0)
+    {
+        log->notifications++;
+    }
+    strncat(log->lines, line, LOG_SIZE - strlen(log->lines) - 2);
+    strcat(log->lines, "|");
+}
+
+static void Replay_Data(void *ctx, uint8_t link_id, const uint8_t *data, uint32_t length)
+{
+    ReplayTypeDef *log = ctx;
+
+    // Пакет может прийти несколькими кусками, link ID - при смене соединения
+    if(link_id != log->last_link)
+    {
+        log->data_length += sprintf(log->data + log->data_length, "%u:", link_id);
+        log->last_link = link_id;
+    }
+    memcpy(log->data + log->data_length, data, length);
+    log->data_length += length;
+    log->data[log->data_length] = '\0';
+}
+
+// Разбор записи кусками: chunk = 0 - случайная длина 1..64.
+// Ответ AT+CIPRECVDATA - в формате AT+CIPDINFO=1
+static void Replay(AT_ParserTypeDef *parser, const char *text, uint32_t length, uint32_t chunk)
+{
+    static uint8_t copy[LOG_SIZE];
+    uint32_t offset = 0;
+
+    memset(&replay, 0, sizeof(replay));
+    replay.last_link = 0xFE;
+    AT_Parser_Init(parser);
+    AT_Parser_SetRecvInfo(parser, 1);
+    // Строки данных пропускаются только обработчиком всех строк
+    AT_Parser_Register(parser, "", Replay_Line, &replay);
+    AT_Parser_SetDataHandler(parser, Replay_Data, &replay);
+
+    // Копия: после куска DMA данные в буфере не сохраняются
+    while(offset < length)
+    {
+        uint32_t size = chunk ? chunk : 1 + rand() % 64;
+        if(size > length - offset)
+        {
+            size = length - offset;
+        }
+        memcpy(copy, text + offset, size);
+        AT_Parser_Input(parser, copy, size);
+        memset(copy, 0, size);
+        offset += size;
+    }
+}
+
+static void Test_Transcript(void)
+{
+    static const uint32_t chunks[] = { sizeof(transcript) - 1, 1, 2, 7, 0, 0, 0 };
+    AT_ParserTypeDef parser;
+
+    srand(1);
+    for(uint32_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+    {
+        Replay(&parser, transcript, sizeof(transcript) - 1, chunks[i]);
+        CHECK(strcmp(replay.lines, expected_lines) == 0);
+        CHECK(replay.data_length == sizeof(expected_data) - 1);
+        CHECK(memcmp(replay.data, expected_data, sizeof(expected_data) - 1) == 0);
+        CHECK(replay.prompts == 1);
+        CHECK(replay.notifications == 1);
+        CHECK(parser.bytes == sizeof(transcript) - 1);
+        CHECK(parser.overflows == 0);
+        if(failures)
+        {
+            printf("  chunk %u:\n  lines %s\n  data  %s\n", chunks[i], replay.lines, replay.data);
+            return;
+        }
+    }
+}
+
+static void Route(void *ctx, const char *line)
+{
+    (*(uint32_t*)ctx)++;
+}
+
+// Обработчики по началу строки: '?' - любой символ, строки без
+// обработчика считаются
+static void Test_Routing(void)
+{
+    static const char text[] = "0,CONNECT\r\n4,CLOSED\r\nOK\r\nSEND OK\r\nWIFI GOT IP\r\n";
+    AT_ParserTypeDef parser;
+    uint32_t links = 0, ok = 0, send_ok = 0;
+
+    AT_Parser_Init(&parser);
+    AT_Parser_Register(&parser, "?,CONNECT", Route, &links);
+    AT_Parser_Register(&parser, "?,CLOSED", Route, &links);
+    AT_Parser_Register(&parser, "OK", Route, &ok);
+    AT_Parser_Register(&parser, "SEND OK", Route, &send_ok);
+    AT_Parser_Input(&parser, (const uint8_t*)text, sizeof(text) - 1);
+
+    CHECK(links == 2);
+    CHECK(ok == 1);
+    CHECK(send_ok == 1);
+    CHECK(parser.lines == 5);
+    CHECK(parser.unhandled == 1);
+}
+
+// Строка длиннее AT_LINE_SIZE обрезается и считается, заголовок +IPD
+// без ':' отбрасывается и не захватывает следующие строки
+static void Test_Overflow(void)
+{
+    static char text[AT_LINE_SIZE * 3 + 256];
+    AT_ParserTypeDef parser;
+    uint32_t length = 0;
+
+    memset(text, 'x', AT_LINE_SIZE * 3);
+    length = AT_LINE_SIZE * 3;
+    length += sprintf(text + length, "\r\n+IPD,1,");
+    memset(text + length, 'y', 200);
+    length += 200;
+    length += sprintf(text + length, "\r\nOK\r\n");
+    Replay(&parser, text, length, 0);
+
+    // x - до AT_LINE_SIZE - 1, заголовок "+IPD,1," и 120 y отброшены,
+    // 121-й y сбрасывает разбор, остаток - отдельная строка
+    char expected[AT_LINE_SIZE * 2 + 8];
+    memset(expected, 'x', AT_LINE_SIZE - 1);
+    expected[AT_LINE_SIZE - 1] = '|';
+    memset(expected + AT_LINE_SIZE, 'y', 79);
+    strcpy(expected + AT_LINE_SIZE + 79, "|OK|");
+
+    CHECK(parser.overflows == 2);
+    CHECK(strcmp(replay.lines, expected) == 0);
+    CHECK(replay.data_length == 0);
+}
+
+// Пассивный прием: ответ AT+CIPRECVDATA в формате ESP-AT v2.2.1.0.
+// Данные содержат запятые, кавычки и строки "OK"
+static void Test_RecvData(void)
+{
+    static const char dinfo[] =
+        "+IPD,0,37\r\n"
+        "AT+CIPRECVDATA=0,512\r\n"
+        "+CIPRECVDATA:34,\"192.168.4.2\",50000,POST / HTTP/1.1\r\n\r\n\"a\",1,2\r\nOK\r\n\r\n"
+        "\r\nOK\r\n"
+        "AT+CIPRECVDATA=0,512\r\n"
+        "+CIPRECVDATA:3,\"192.168.4.2\",50000,,,,\r\n\r\nOK\r\n";
+    static const char plain[] =
+        "+CIPRECVDATA:6,\"1\",2,\r\n\r\nOK\r\n";
+    static const uint32_t chunks[] = { 0xFFFF, 1, 3, 0, 0 };
+    AT_ParserTypeDef parser;
+
+    for(uint32_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+    {
+        // С AT+CIPDINFO=1: данные после третьей запятой
+        Replay(&parser, dinfo, sizeof(dinfo) - 1, chunks[i]);
+        CHECK(strcmp(replay.data, "255:POST / HTTP/1.1\r\n\r\n\"a\",1,2\r\nOK\r\n\r\n,,,") == 0);
+        CHECK(strcmp(replay.lines, "+IPD,0,37|AT+CIPRECVDATA=0,512|OK|AT+CIPRECVDATA=0,512|OK|") == 0);
+        CHECK(parser.overflows == 0);
+
+        // Без адреса: данные сразу после длины, даже если начинаются с кавычки
+        AT_Parser_Init(&parser);
+        memset(&replay, 0, sizeof(replay));
+        replay.last_link = 0xFE;
+        AT_Parser_Register(&parser, "", Replay_Line, &replay);
+        AT_Parser_SetDataHandler(&parser, Replay_Data, &replay);
+        AT_Parser_SetRecvInfo(&parser, 0);
+        AT_Parser_Input(&parser, (const uint8_t*)plain, sizeof(plain) - 1);
+        CHECK(strcmp(replay.data, "255:\"1\",2,") == 0);
+        CHECK(strcmp(replay.lines, "OK|") == 0);
+    }
+}
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Скорость разбора потока ответов на AT+CIPSEND и пакетов +IPD по 512 байт
+static void Bench(void)
+{
+    static uint8_t stream[BENCH_SIZE];
+    AT_ParserTypeDef parser;
+    uint32_t length = 0;
+    uint32_t lines = 0;
+
+    while(length + 1024 < BENCH_SIZE)
+    {
+        length += sprintf((char*)stream + length, "\r\nRecv 2048 bytes\r\n\r\nSEND OK\r\n"
+                          "+IPD,0,512,\"192.168.4.2\",50000:");
+        memset(stream + length, 'd', 512);
+        length += 512;
+    }
+
+    AT_Parser_Init(&parser);
+    AT_Parser_Register(&parser, "", Route, &lines);
+    double start = Now();
+    for(uint32_t offset = 0; offset < length; offset += 512)
+    {
+        AT_Parser_Input(&parser, stream + offset, length - offset < 512 ? length - offset : 512);
+    }
+    double elapsed = Now() - start;
+
+    CHECK(parser.overflows == 0);
+    printf("  %u bytes, %u lines: %.2f ms, %.0f MB/s\n", length, lines,
+           elapsed * 1e3, length / elapsed / 1e6);
+}
+
+int main(void)
+{
+    Test_Transcript();
+    Test_Routing();
+    Test_Overflow();
+    Test_RecvData();
+    Bench();
+
+    printf("at_parser_test: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
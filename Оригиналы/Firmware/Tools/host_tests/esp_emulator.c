@@ -0,0 +1,630 @@
+/*
+ * esp_emulator.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// esp_emulator.c
+// Модель ESP-AT v2.2.1.0 (ESP8266). Форматы ответов - как у прошивки
+// Firmware/ESP8266-IDF-AT_V2.2.1.0: команды _CUR/_DEF не поддерживаются
+// (кроме AT+UART_CUR), сохранение настроек задает AT+SYSSTORE,
+// пассивный прием - "+IPD,<link>,<len>" и
+// "+CIPRECVDATA:<len>,"<ip>",<port>,<data>" при AT+CIPDINFO=1.
+// Время передачи по UART учитывается по скорости канала
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cmsis_os.h"
+#include "esp_emulator.h"
+
+EmuTypeDef emu;
+
+static void Emu_Output(const void *data, uint32_t length)
+{
+    const uint8_t *bytes = data;
+
+    for(uint32_t i = 0; i < length; i++)
+    {
+        emu.output[emu.output_tail % EMU_OUTPUT_SIZE] = bytes[i];
+        emu.output_tail++;
+    }
+}
+
+static void Emu_Printf(const char *format, ...)
+{
+    char text[512];
+    va_list args;
+
+    va_start(args, format);
+    int length = vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    Emu_Output(text, length);
+}
+
+// Копия с обрезкой до размера получателя
+static void Emu_Copy(char *destination, uint32_t size, const char *source)
+{
+    uint32_t length = strlen(source);
+
+    if(length >= size)
+    {
+        length = size - 1;
+    }
+    memcpy(destination, source, length);
+    destination[length] = '\0';
+}
+
+static void Emu_Later(uint32_t delay, const char *text)
+{
+    if(emu.event_count == EMU_EVENT_COUNT)
+        return;
+
+    EmuEventTypeDef *event = &emu.events[emu.event_count++];
+    event->due = stub_tick + delay;
+    Emu_Copy(event->text, sizeof(event->text), text);
+}
+
+// Время передачи байт по UART (старт, 8 бит, стоп)
+static void Emu_Wire(uint32_t bytes, uint32_t baudrate)
+{
+    Stub_Advance((uint32_t)((uint64_t)bytes * 10 * 1000000 / baudrate));
+}
+
+static uint8_t Emu_LinkValid(int link)
+{
+    return link >= 0 && link < EMU_LINK_COUNT && emu.links[link].connected;
+}
+
+// Настройка, которую при AT+SYSSTORE=1 прошивка пишет во flash
+static void Emu_Store(void)
+{
+    if(emu.sysstore)
+    {
+        emu.flash_writes++;
+        emu.stored_mode = emu.mode;
+        memcpy(emu.stored_ap_config, emu.ap_config, sizeof(emu.ap_config));
+        memcpy(emu.stored_ap_ip, emu.ap_ip, sizeof(emu.ap_ip));
+    }
+}
+
+// Заводские настройки во flash ESP
+static void Emu_Factory(void)
+{
+    emu.stored_mode = 1;
+    Emu_Copy(emu.stored_ap_config, sizeof(emu.stored_ap_config), "\"ESP_0A1B2C\",\"\",1,0,4,0");
+    Emu_Copy(emu.stored_ap_ip, sizeof(emu.stored_ap_ip), "192.168.4.1");
+}
+
+static void Emu_Command(const char *command)
+{
+    int a, b;
+    char text[128];
+
+    if(emu.command_count < EMU_COMMAND_LOG)
+    {
+        Emu_Copy(emu.commands[emu.command_count], sizeof(emu.commands[0]), command);
+    }
+    emu.command_count++;
+
+    if(emu.echo)
+    {
+        Emu_Printf("%s\r\n", command);
+    }
+    if(emu.busy)
+    {
+        Emu_Printf("\r\nbusy p...\r\n");
+        return;
+    }
+
+    if(strcmp(command, "AT") == 0)
+    {
+        Emu_Printf("\r\nOK\r\n");
+    }
+    else if(strcmp(command, "ATE0") == 0 || strcmp(command, "ATE1") == 0)
+    {
+        emu.echo = command[3] == '1';
+        Emu_Printf("\r\nOK\r\n");
+    }
+    else if(strcmp(command, "AT+RESTORE") == 0)
+    {
+        // Стирание настроек во flash и перезапуск
+        emu.restores++;
+        emu.flash_writes++;
+        Emu_Factory();
+        Emu_Printf("\r\nOK\r\n");
+        Emu_Poll();
+        Emu_Boot();
+    }
+    else if(sscanf(command, "AT+SYSSTORE=%d", &a) == 1 && (a == 0 || a == 1))
+    {
+        emu.sysstore = a;
+        Emu_Printf("\r\nOK\r\n");
+    }
+    else if(strcmp(command, "AT+SYSSTORE?") == 0)
+    {
+        Emu_Printf("+SYSSTORE:%u\r\n\r\nOK\r\n", emu.sysstore);
+    }
+    else if(sscanf(command, "AT+UART_CUR=%d,8,1,0,0", &a) == 1 && a >= 80 && a <= 5000000)
+    {
+        // Ответ еще на прежней скорости
+        Emu_Printf("\r\nOK\r\n");
+        Emu_Poll();
+        emu.baudrate = a;
+    }
+    else if(strcmp(command, "AT+CWMODE?") == 0)
+    {
+        Emu_Printf("+CWMODE:%u\r\n\r\nOK\r\n", emu.mode);
+    }
+    else if(sscanf(command, "AT+CWMODE=%d", &a) == 1 && a >= 0 && a <= 3)
+    {
+        emu.mode = a;
+        Emu_Store();
+        Emu_Printf("\r\nOK\r\n");
+    }
+    else if(strcmp(command, "AT+CWSAP?") == 0)
+    {
+        Emu_Printf("+CWSAP:%s\r\n\r\nOK\r\n", emu.ap_config);
+    }
+    else if(strncmp(command, "AT+CWSAP=", 9) == 0 && emu.mode >= 2)
+    {
+        // Необязательные <max conn>,<ssid hidden> - по умолчанию 10 и 0
+        int commas = 0;
+        for(const char *p = command; *p; p++)
+        {
+            commas += *p == ',';
+        }
+        Emu_Copy(text, sizeof(text) - 8, command + 9);
+        strcat(text, commas == 3 ? ",10,0" : commas == 4 ? ",0" : "");
+        Emu_Copy(emu.ap_config, sizeof(emu.ap_config), text);
+        Emu_Store();
+        Emu_Printf("\r\nOK\r\n");
+    }
+    else if(strcmp(command, "AT+CIPAP?") == 0)
+    {
+        Emu_Printf("+CIPAP:ip:\"%s\"\r\n+CIPAP:gateway:\"%s\"\r\n+CIPAP:netmask:\"255.255.255.0\"\r\n\r\nOK\r\n",
+                   emu.ap_ip, emu.ap_ip);
+    }
+    else if(sscanf(command, "AT+CIPAP=\"%15[0-9.]\"", text) == 1)
+    {
+        Emu_Copy(emu.ap_ip, sizeof(emu.ap_ip), text);
+        Emu_Store();
+        Emu_Printf("\r\nOK\r\n");
+    }
+    else if(sscanf(command, "AT+CIPMUX=%d", &a) == 1)
+    {
+        emu.mux = a;
+        Emu_Printf("\r\nOK\r\n");
+    }
+    else if(sscanf(command, "AT+CIPDINFO=%d", &a) == 1)
+    {
+        emu.dinfo = a;
+        Emu_Printf("\r\nOK\r\n");
+    }
+    else if(sscanf(command, "AT+CIPRECVMODE=%d", &a) == 1)
+    {
+        emu.passive = a;
+        Emu_Printf("\r\nOK\r\n");
+    }
+    else if(sscanf(command, "AT+CIPSERVERMAXCONN=%d", &a) == 1 ||
+            sscanf(command, "AT+CIPSTO=%d", &a) == 1)
+    {
+        Emu_Printf("\r\nOK\r\n");
+    }
+    else if(sscanf(command, "AT+CIPSERVER=%d", &a) == 1)
+    {
+        emu.server = a;
+        Emu_Printf("\r\nOK\r\n");
+    }
+    else if(strcmp(command, "AT+CWLIF") == 0)
+    {
+        for(int i = 0; i < EMU_LINK_COUNT; i++)
+        {
+            if(emu.links[i].connected)
+            {
+                Emu_Printf("+CWLIF:192.168.4.%d,2c:3a:e8:00:00:%02x\r\n", 2 + i, i);
+            }
+        }
+        Emu_Printf("\r\nOK\r\n");
+    }
+    else if(sscanf(command, "AT+CIPSEND=%d,%d", &a, &b) == 2)
+    {
+        if(!Emu_LinkValid(a))
+        {
+            Emu_Printf("link is not valid\r\n\r\nERROR\r\n");
+            return;
+        }
+        emu.data_link = a;
+        emu.data_expected = b;
+        emu.data_received = 0;
+        Emu_Printf("\r\nOK\r\n\r\n>");
+    }
+    else if(sscanf(command, "AT+CIPCLOSE=%d", &a) == 1)
+    {
+        if(!Emu_LinkValid(a))
+        {
+            Emu_Printf("\r\nERROR\r\n");
+            return;
+        }
+        emu.links[a].connected = 0;
+        emu.links[a].closed_at = stub_tick;
+        Emu_Printf("%d,CLOSED\r\n\r\nOK\r\n", a);
+    }
+    else if(sscanf(command, "AT+CIPRECVDATA=%d,%d", &a, &b) == 2)
+    {
+        if(!emu.passive || a < 0 || a >= EMU_LINK_COUNT)
+        {
+            Emu_Printf("\r\nERROR\r\n");
+            return;
+        }
+
+        EmuLinkTypeDef *link = &emu.links[a];
+        uint32_t length = (uint32_t)b < link->buffered_length ? (uint32_t)b : link->buffered_length;
+
+        if(emu.dinfo)
+            Emu_Printf("+CIPRECVDATA:%u,\"%s\",%u,", length, EMU_PEER_IP, EMU_PEER_PORT + a);
+        else
+            Emu_Printf("+CIPRECVDATA:%u,", length);
+        Emu_Output(link->buffered, length);
+        memmove(link->buffered, link->buffered + length, link->buffered_length - length);
+        link->buffered_length -= length;
+        Emu_Printf("\r\n\r\nOK\r\n");
+    }
+    else if(strncmp(command, "AT+MQTTUSERCFG=", 15) == 0)
+    {
+        Emu_Printf(emu.mqtt_supported ? "\r\nOK\r\n" : "\r\nERROR\r\n");
+    }
+    else if(strncmp(command, "AT+MQTTCONN=", 12) == 0 && emu.mqtt_supported)
+    {
+        // Подключение к брокеру занимает ESP до ответа
+        emu.busy = 1;
+        if(emu.mqtt_broker)
+        {
+            emu.mqtt_connected = 1;
+            Emu_Later(50, "+MQTTCONNECTED:0,1,\"" EMU_PEER_IP "\",\"1883\",\"\",1\r\n\r\nOK\r\n");
+        }
+        else
+        {
+            Emu_Later(emu.mqtt_fail_delay, "\r\nERROR\r\n");
+        }
+    }
+    else if(sscanf(command, "AT+MQTTPUBRAW=0,\"%127[^\"]\",%d", text, &b) == 2 && emu.mqtt_supported)
+    {
+        emu.data_link = 0xFF;
+        emu.data_expected = b;
+        emu.data_received = 0;
+        Emu_Printf("\r\nOK\r\n\r\n>");
+    }
+    else
+    {
+        // Неизвестная команда, в том числе AT+CWMODE_CUR и другие _CUR/_DEF
+        Emu_Printf("\r\nERROR\r\n");
+    }
+}
+
+// Данные после приглашения ">" приняты полностью
+static void Emu_DataDone(void)
+{
+    if(emu.data_link == 0xFF)
+    {
+        if(emu.mqtt_connected)
+        {
+            emu.mqtt_published++;
+            Emu_Printf("\r\n+MQTTPUB:OK\r\n");
+        }
+        else
+        {
+            Emu_Printf("\r\n+MQTTPUB:FAIL\r\n");
+        }
+        return;
+    }
+
+    EmuLinkTypeDef *link = &emu.links[emu.data_link];
+    char text[64];
+
+    snprintf(text, sizeof(text), "\r\nRecv %u bytes\r\n\r\nSEND OK\r\n", emu.data_expected);
+    if(link->send_delay > 0)
+    {
+        // Медленный клиент: ESP ждет подтверждения TCP
+        emu.busy = 1;
+        Emu_Later(link->send_delay, text);
+    }
+    else
+    {
+        Emu_Printf("%s", text);
+    }
+}
+
+static uint8_t Emu_Corrupt(uint8_t *byte, uint32_t baudrate_a, uint32_t baudrate_b)
+{
+    if(baudrate_a != baudrate_b)
+    {
+        *byte ^= 0x5A;
+        return 1;
+    }
+    if(baudrate_a > emu.max_baudrate && (++emu.corrupt_counter % 97) == 0)
+    {
+        *byte ^= 0x20;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+  * @brief Начальное состояние: ESP после включения, сохраненные настройки
+  *        по умолчанию, эхо включено, скорость 115200
+  */
+void Emu_Init(AT_ParserTypeDef *parser)
+{
+    memset(&emu, 0, sizeof(emu));
+    emu.parser = parser;
+    emu.baudrate = 115200;
+    emu.host_baudrate = 115200;
+    emu.max_baudrate = 921600;
+    emu.boot_time = 500;
+    emu.echo = 1;
+    emu.sysstore = 1;
+    Emu_Factory();
+    emu.mode = emu.stored_mode;
+    memcpy(emu.ap_config, emu.stored_ap_config, sizeof(emu.ap_config));
+    memcpy(emu.ap_ip, emu.stored_ap_ip, sizeof(emu.ap_ip));
+    emu.mqtt_supported = 1;
+    emu.mqtt_fail_delay = 7000;
+    stub_idle = Emu_Idle;
+}
+
+/**
+  * @brief Аппаратный сброс: настройки без сохранения и скорость сбрасываются,
+  *        сохраненные во flash загружаются
+  */
+void Emu_Boot(void)
+{
+    emu.baudrate = 115200;
+    emu.mode = emu.stored_mode;
+    memcpy(emu.ap_config, emu.stored_ap_config, sizeof(emu.ap_config));
+    memcpy(emu.ap_ip, emu.stored_ap_ip, sizeof(emu.ap_ip));
+    emu.echo = 1;
+    emu.sysstore = 1;
+    emu.mux = 0;
+    emu.dinfo = 0;
+    emu.passive = 0;
+    emu.server = 0;
+    emu.busy = 0;
+    emu.event_count = 0;
+    emu.line_length = 0;
+    emu.data_expected = 0;
+    emu.mqtt_connected = 0;
+    memset(emu.links, 0, sizeof(emu.links));
+
+    // Загрузчик выводит сообщения на 74880 - на 115200 это мусор
+    static const uint8_t boot_noise[] = { 0x00, 0xE0, 0x1C, 0x8C, 0xFE, 0x7F, 0x72, 0x0C };
+    Emu_Output(boot_noise, sizeof(boot_noise));
+    Emu_Later(emu.boot_time, "\r\nready\r\n");
+}
+
+/**
+  * @brief Байты от USART6 (обработчик передачи движка AT)
+  */
+void Emu_Transmit(const uint8_t *data, uint32_t length)
+{
+    Emu_Wire(length, emu.host_baudrate);
+    emu.bytes_in += length;
+
+    for(uint32_t i = 0; i < length; i++)
+    {
+        uint8_t c = data[i];
+        Emu_Corrupt(&c, emu.host_baudrate, emu.baudrate);
+
+        if(emu.data_expected > 0)
+        {
+            if(emu.data_link != 0xFF)
+            {
+                EmuLinkTypeDef *link = &emu.links[emu.data_link];
+                if(link->received_length < EMU_CLIENT_BUFFER)
+                {
+                    link->received[link->received_length++] = c;
+                }
+            }
+            else if(emu.data_received < sizeof(emu.mqtt_last) - 1)
+            {
+                emu.mqtt_last[emu.data_received] = c;
+                emu.mqtt_last[emu.data_received + 1] = '\0';
+            }
+            if(++emu.data_received == emu.data_expected)
+            {
+                emu.data_expected = 0;
+                Emu_DataDone();
+            }
+            continue;
+        }
+
+        if(c == '\n')
+        {
+            if(emu.line_length > 0 && emu.line[emu.line_length - 1] == '\r')
+            {
+                emu.line[--emu.line_length] = '\0';
+                Emu_Command(emu.line);
+            }
+            emu.line_length = 0;
+        }
+        else if(emu.line_length < sizeof(emu.line) - 1)
+        {
+            emu.line[emu.line_length++] = c;
+            emu.line[emu.line_length] = '\0';
+        }
+    }
+}
+
+/**
+  * @brief Передача вывода ESP в разборщик (обработчик приема движка AT)
+  * За вызов передается не больше emu.chunk байт - одно событие DMA
+  */
+void Emu_Poll(void)
+{
+    uint8_t buffer[512];
+
+    // Отложенные ответы, срок которых наступил
+    for(uint8_t i = 0; i < emu.event_count; )
+    {
+        if((int32_t)(stub_tick - emu.events[i].due) >= 0)
+        {
+            Emu_Output(emu.events[i].text, strlen(emu.events[i].text));
+            emu.busy = 0;
+            emu.events[i] = emu.events[--emu.event_count];
+        }
+        else
+        {
+            i++;
+        }
+    }
+
+    uint32_t limit = emu.chunk ? emu.chunk : 0xFFFFFFFFU;
+    while(emu.output_head != emu.output_tail && limit > 0)
+    {
+        uint32_t length = 0;
+        while(emu.output_head != emu.output_tail && length < sizeof(buffer) && length < limit)
+        {
+            buffer[length] = emu.output[emu.output_head % EMU_OUTPUT_SIZE];
+            emu.host_rx_errors += Emu_Corrupt(&buffer[length], emu.baudrate, emu.host_baudrate) &&
+                                  emu.baudrate != emu.host_baudrate;
+            emu.output_head++;
+            length++;
+        }
+        limit -= length;
+        emu.bytes_out += length;
+        Emu_Wire(length, emu.baudrate);
+        if(emu.parser)
+        {
+            AT_Parser_Input(emu.parser, buffer, length);
+        }
+    }
+}
+
+/**
+  * @brief Есть ли непереданный вывод
+  */
+uint8_t Emu_Pending(void)
+{
+    return emu.output_head != emu.output_tail;
+}
+
+/**
+  * @brief Ожидание потока: время идет до ближайшего отложенного ответа,
+  *        но не дольше timeout
+  */
+void Emu_Idle(uint32_t timeout)
+{
+    if(Emu_Pending() || timeout == 0)
+        return;
+
+    uint32_t wait = timeout;
+    for(uint8_t i = 0; i < emu.event_count; i++)
+    {
+        int32_t remaining = (int32_t)(emu.events[i].due - stub_tick);
+        if(remaining < 0)
+        {
+            remaining = 0;
+        }
+        if((uint32_t)remaining < wait)
+        {
+            wait = remaining;
+        }
+    }
+    if(wait == osWaitForever)
+    {
+        wait = 1000;
+    }
+    Stub_Advance((wait ? wait : 1) * 1000);
+}
+
+/**
+  * @brief Смена скорости USART6
+  */
+void Emu_SetHostBaudrate(uint32_t baudrate)
+{
+    emu.host_baudrate = baudrate;
+}
+
+/**
+  * @brief Клиент подключился к серверу ESP
+  */
+void Emu_Connect(uint8_t link)
+{
+    memset(&emu.links[link], 0, sizeof(emu.links[link]));
+    emu.links[link].connected = 1;
+    Emu_Printf("%u,CONNECT\r\n", link);
+}
+
+/**
+  * @brief Клиент отправил данные: в активном режиме - +IPD с данными,
+  *        в пассивном - данные остаются в ESP, выводится уведомление
+  */
+void Emu_ClientSend(uint8_t link, const void *data, uint32_t length)
+{
+    const uint8_t *bytes = data;
+
+    while(length > 0)
+    {
+        // Данные приходят сегментами TCP
+        uint32_t segment = length < 1460 ? length : 1460;
+
+        if(emu.passive)
+        {
+            EmuLinkTypeDef *entry = &emu.links[link];
+            memcpy(entry->buffered + entry->buffered_length, bytes, segment);
+            entry->buffered_length += segment;
+            Emu_Printf("+IPD,%u,%u\r\n", link, segment);
+        }
+        else
+        {
+            if(emu.dinfo)
+                Emu_Printf("+IPD,%u,%u,\"%s\",%u:", link, segment, EMU_PEER_IP, EMU_PEER_PORT + link);
+            else
+                Emu_Printf("+IPD,%u,%u:", link, segment);
+            Emu_Output(bytes, segment);
+        }
+        bytes += segment;
+        length -= segment;
+    }
+}
+
+/**
+  * @brief Клиент закрыл соединение
+  */
+void Emu_ClientClose(uint8_t link)
+{
+    if(!emu.links[link].connected)
+        return;
+
+    emu.links[link].connected = 0;
+    Emu_Printf("%u,CLOSED\r\n", link);
+}
+
+/**
+  * @brief Доступность MQTT брокера, при потере - уведомление о разрыве
+  */
+void Emu_SetBroker(uint8_t available)
+{
+    emu.mqtt_broker = available;
+    if(!available && emu.mqtt_connected)
+    {
+        emu.mqtt_connected = 0;
+        Emu_Printf("+MQTTDISCONNECTED:0\r\n");
+    }
+}
+
+/**
+  * @brief Количество принятых команд, начинающихся с prefix
+  */
+uint32_t Emu_CountCommands(const char *prefix)
+{
+    uint32_t count = 0;
+    uint32_t logged = emu.command_count < EMU_COMMAND_LOG ? emu.command_count : EMU_COMMAND_LOG;
+
+    for(uint32_t i = 0; i < logged; i++)
+    {
+        count += strncmp(emu.commands[i], prefix, strlen(prefix)) == 0;
+    }
+    return count;
+}
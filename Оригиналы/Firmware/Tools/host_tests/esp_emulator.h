@@ -0,0 +1,111 @@
+// esp_emulator.h
+// Модель ESP8266 с прошивкой ESP-AT v2.2.1.0 для проверок на Linux:
+// команды, ответы и уведомления в формате этой прошивки, клиенты
+// веб-сервера, MQTT брокер и канал UART с учетом скорости
+#ifndef __ESP_EMULATOR_H
+#define __ESP_EMULATOR_H
+
+#include <stdint.h>
+#include "at_parser.h"
+
+#define EMU_LINK_COUNT 5
+#define EMU_CLIENT_BUFFER (64 * 1024)  // Данные клиента в каждую сторону
+#define EMU_OUTPUT_SIZE (256 * 1024)
+#define EMU_EVENT_COUNT 16
+#define EMU_COMMAND_LOG 256
+#define EMU_PEER_IP "192.168.4.2"
+#define EMU_PEER_PORT 50000
+
+typedef struct {
+    uint8_t connected;
+    uint8_t buffered[EMU_CLIENT_BUFFER];  // Пассивный прием: данные в ESP
+    uint32_t buffered_length;
+    uint8_t received[EMU_CLIENT_BUFFER];  // Ответ, полученный клиентом
+    uint32_t received_length;
+    uint32_t send_delay;                  // От данных AT+CIPSEND до SEND OK, мс
+    uint32_t closed_at;                   // Время закрытия сервером, 0 - открыто
+} EmuLinkTypeDef;
+
+// Отложенный ответ (SEND OK медленному клиенту, результат AT+MQTTCONN)
+typedef struct {
+    uint32_t due;
+    char text[96];
+} EmuEventTypeDef;
+
+typedef struct {
+    AT_ParserTypeDef *parser;
+
+    // Канал UART: при разных скоростях сторон байты искажаются,
+    // выше max_baudrate искажается каждый 97-й байт
+    uint32_t baudrate;        // Скорость ESP
+    uint32_t host_baudrate;   // Скорость USART6
+    uint32_t max_baudrate;
+    uint32_t host_rx_errors;  // Ошибки кадра на стороне USART6
+    uint32_t corrupt_counter;
+    uint32_t chunk;           // Байт за один Emu_Poll (событие DMA/IDLE), 0 - все
+
+    // Состояние ESP
+    uint32_t boot_time;       // От сброса до "ready", мс (оценка, не замер)
+    uint8_t echo;
+    uint8_t sysstore;         // AT+SYSSTORE: 1 - настройки пишутся во flash
+    uint8_t mode;
+    char ap_config[96];       // "<ssid>","<pwd>",<chl>,<ecn>,<max>,<hidden>
+    char ap_ip[16];
+    uint8_t stored_mode;      // Настройки во flash ESP, загружаются при сбросе
+    char stored_ap_config[96];
+    char stored_ap_ip[16];
+    uint8_t mux;
+    uint8_t dinfo;
+    uint8_t passive;
+    uint8_t server;
+    uint32_t flash_writes;    // Команды, записавшие настройки во flash ESP
+    uint32_t restores;
+
+    // Прием команды и данных после приглашения
+    char line[256];
+    uint32_t line_length;
+    uint32_t data_expected;
+    uint32_t data_received;
+    uint8_t data_link;        // 0xFF - данные AT+MQTTPUBRAW
+    uint8_t busy;             // Ждет отложенного ответа, команды получают "busy p..."
+
+    EmuLinkTypeDef links[EMU_LINK_COUNT];
+
+    // MQTT
+    uint8_t mqtt_supported;
+    uint8_t mqtt_broker;          // Брокер доступен
+    uint8_t mqtt_connected;
+    uint32_t mqtt_fail_delay;     // AT+MQTTCONN до ERROR при недоступном брокере, мс
+    uint32_t mqtt_published;      // Принято публикаций
+    char mqtt_last[1024];
+
+    // Вывод ESP, еще не переданный USART6
+    uint8_t output[EMU_OUTPUT_SIZE];
+    uint32_t output_head;
+    uint32_t output_tail;
+    EmuEventTypeDef events[EMU_EVENT_COUNT];
+    uint8_t event_count;
+
+    // Журнал принятых команд без \r\n
+    char commands[EMU_COMMAND_LOG][64];
+    uint32_t command_count;
+    uint32_t bytes_in;
+    uint32_t bytes_out;
+} EmuTypeDef;
+
+extern EmuTypeDef emu;
+
+void Emu_Init(AT_ParserTypeDef *parser);
+void Emu_Boot(void);
+void Emu_Transmit(const uint8_t *data, uint32_t length);
+void Emu_Poll(void);
+void Emu_Idle(uint32_t timeout);
+uint8_t Emu_Pending(void);
+void Emu_SetHostBaudrate(uint32_t baudrate);
+void Emu_Connect(uint8_t link);
+void Emu_ClientSend(uint8_t link, const void *data, uint32_t length);
+void Emu_ClientClose(uint8_t link);
+void Emu_SetBroker(uint8_t available);
+uint32_t Emu_CountCommands(const char *prefix);
+
+#endif /* __ESP_EMULATOR_H */
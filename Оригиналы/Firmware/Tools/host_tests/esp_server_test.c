@@ -0,0 +1,295 @@
+/*
+ * esp_server_test.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// esp_server_test.c
+// Проверка таблицы соединений esp_server с моделью ESP-AT: 1, 3 и 5
+// одновременных клиентов, чередование порций AT+CIPSEND между
+// соединениями, медленный клиент и пассивный прием POST, ответ 413
+// на тело больше блока запроса. Время - модельное, по скорости UART
+// 115200 и задержкам ESP, поэтому пропускная способность - оценка
+// канала, а не замер на устройстве.
+//
+// Сборка и запуск:  ./run_tests.sh esp_server_test
+#include <stdio.h>
+#include <string.h>
+#include "esp_emulator.h"
+#include "esp_server.h"
+
+#define RESPONSE_BODY (7 * 1024)  // Четыре порции AT+CIPSEND с заголовком
+#define POOL_REQUESTS 5
+#define POOL_RESPONSES 2
+
+static AT_ParserTypeDef parser;
+static AT_EngineTypeDef engine;
+static ESP_ServerTypeDef server;
+static StaticEventGroup_t event;
+static MemPoolTypeDef request_pool;
+static MemPoolTypeDef response_pool;
+static uint32_t request_storage[MEM_POOL_WORDS(ESP_LINK_REQUEST_SIZE, POOL_REQUESTS)];
+static uint32_t response_storage[MEM_POOL_WORDS(ESP_LINK_RESPONSE_SIZE, POOL_RESPONSES)];
+static char responses[ESP_LINK_COUNT][RESPONSE_BODY + 128];
+static uint32_t response_length[ESP_LINK_COUNT];
+static uint32_t handled;
+static char last_request[ESP_LINK_REQUEST_SIZE];
+static int failures;
+
+#define CHECK(condition) do { \
+    if(!(condition)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while(0)
+
+// Ответ из отдельного буфера соединения, тело - буква соединения
+static void Test_Handler(uint8_t link_id, char *request, uint32_t length)
+{
+    char *response = responses[link_id];
+    uint32_t header = sprintf(response, "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n\r\n", RESPONSE_BODY);
+
+    memcpy(last_request, request, length);
+    last_request[length] = '\0';
+    memset(response + header, 'a' + link_id, RESPONSE_BODY);
+    response_length[link_id] = header + RESPONSE_BODY;
+    handled++;
+    ESP_Server_Respond(&server, link_id, response, response_length[link_id], NULL, NULL);
+}
+
+static void Test_Setup(void)
+{
+    AT_Parser_Init(&parser);
+    Emu_Init(&parser);
+    emu.mux = 1;
+    emu.server = 1;
+    AT_Engine_Init(&engine, &parser, Emu_Transmit, Emu_Poll, &event, 0x01, 0x02);
+    AT_Engine_SetThread(&engine, osThreadGetId());
+    MemPool_Init(&request_pool, "req", request_storage, ESP_LINK_REQUEST_SIZE, POOL_REQUESTS);
+    MemPool_Init(&response_pool, "resp", response_storage, ESP_LINK_RESPONSE_SIZE, POOL_RESPONSES);
+    ESP_Server_Init(&server, &engine, Test_Handler, &request_pool, &response_pool);
+    ESP_Server_Attach(&server, &parser);
+    handled = 0;
+}
+
+// Цикл потока движка AT (StartATEngine) до освобождения всех соединений
+static uint32_t Test_Run(uint32_t limit)
+{
+    uint32_t start = stub_tick;
+
+    while((stub_tick - start) < limit)
+    {
+        Emu_Poll();
+        AT_Engine_Process(&engine);
+        ESP_Server_Process(&server);
+        if(!Emu_Pending() && !AT_Engine_Busy(&engine) && !ESP_Server_Busy(&server))
+            break;
+
+        uint32_t timeout = AT_Engine_Timeout(&engine);
+        uint32_t server_timeout = ESP_Server_Timeout(&server);
+        osEventFlagsWait(&event, 0x03, osFlagsWaitAny,
+                         server_timeout < timeout ? server_timeout : timeout);
+    }
+    return stub_tick - start;
+}
+
+static void Test_Request(uint8_t link)
+{
+    static const char request[] = "GET /data HTTP/1.1\r\nHost: 192.168.4.1\r\n"
+                                  "User-Agent: test\r\nAccept: */*\r\n\r\n";
+    Emu_Connect(link);
+    Emu_ClientSend(link, request, sizeof(request) - 1);
+}
+
+// Ответ дошел до клиента целиком и без чужих данных
+static void Test_CheckReceived(uint8_t link)
+{
+    EmuLinkTypeDef *client = &emu.links[link];
+
+    CHECK(client->received_length == response_length[link]);
+    CHECK(memcmp(client->received, responses[link], response_length[link]) == 0);
+    CHECK(client->closed_at != 0);
+}
+
+static void Test_Clients(uint8_t count)
+{
+    Test_Setup();
+    for(uint8_t i = 0; i < count; i++)
+    {
+        Test_Request(i);
+    }
+
+    uint32_t elapsed = Test_Run(60000);
+
+    CHECK(handled == count);
+    CHECK(server.responses == count);
+    CHECK(server.send_errors == 0);
+    for(uint8_t i = 0; i < count; i++)
+    {
+        Test_CheckReceived(i);
+    }
+
+    // Порции разных соединений чередуются: первые count команд
+    // AT+CIPSEND идут разным соединениям
+    uint8_t seen = 0;
+    uint32_t sends = 0;
+    for(uint32_t i = 0; i < emu.command_count && sends < count; i++)
+    {
+        int link, length;
+        if(sscanf(emu.commands[i], "AT+CIPSEND=%d,%d", &link, &length) == 2)
+        {
+            CHECK(!(seen & (1U << link)));
+            seen |= 1U << link;
+            sends++;
+        }
+    }
+
+    // Блоки пулов возвращены
+    CHECK(request_pool.used == 0);
+    CHECK(response_pool.used == 0);
+
+    uint32_t bytes = count * response_length[0];
+    // Загрузка передачи USART6: байты ответов и команд за время обмена
+    printf("  %u clients: %u bytes in %u ms, %u B/s, TX busy %u%%, latency max %u ms\n",
+           count, bytes, elapsed, bytes * 1000 / elapsed,
+           (uint32_t)((uint64_t)emu.bytes_in * 10 * 1000 * 100 / 115200 / elapsed),
+           server.latency_max_ms);
+}
+
+// Медленный клиент (каждая порция подтверждается 400 мс) не занимает
+// канал целиком: порции остальных соединений идут между его порциями
+static void Test_SlowClient(void)
+{
+    Test_Setup();
+    for(uint8_t i = 0; i < 3; i++)
+    {
+        Test_Request(i);
+    }
+    emu.links[0].send_delay = 400;
+
+    uint32_t start = stub_tick;
+    Test_Run(60000);
+
+    for(uint8_t i = 0; i < 3; i++)
+    {
+        Test_CheckReceived(i);
+    }
+    CHECK(server.send_errors == 0);
+    CHECK(emu.links[1].closed_at < emu.links[0].closed_at);
+    CHECK(emu.links[2].closed_at < emu.links[0].closed_at);
+    printf("  slow client: fast links closed at %u and %u ms, slow at %u ms\n",
+           emu.links[1].closed_at - start, emu.links[2].closed_at - start, emu.links[0].closed_at - start);
+}
+
+// Клиент закрыл соединение, не дождавшись ответа: блоки возвращаются,
+// остальные соединения получают ответы
+static void Test_PeerClosed(void)
+{
+    Test_Setup();
+    Test_Request(0);
+    Test_Request(1);
+    Emu_Poll();
+    AT_Engine_Process(&engine);
+    ESP_Server_Process(&server);
+    Emu_ClientClose(0);
+
+    Test_Run(60000);
+
+    Test_CheckReceived(1);
+    CHECK(request_pool.used == 0);
+    CHECK(response_pool.used == 0);
+    CHECK(server.links[0].state == ESP_LINK_IDLE);
+}
+
+// Пассивный прием (AT+CIPRECVMODE=1, AT+CIPDINFO=1): POST из нескольких
+// порций AT+CIPRECVDATA с адресом и портом клиента в ответе ESP. Тело
+// начинается с кавычки и содержит запятые - данные не должны приниматься
+// за поля заголовка
+static uint32_t Test_Post(char *request, uint32_t headers, uint32_t body)
+{
+    static const char cookie[] = "Cookie: session=0123456789abcdef0123456789abcdef\r\n";
+    uint32_t length;
+
+    Test_Setup();
+    emu.passive = 1;
+    emu.dinfo = 1;
+    AT_Parser_SetRecvInfo(&parser, 1);
+    ESP_Server_SetPassive(&server, 1);
+
+    // Длинные заголовки в блок запроса не попадают
+    length = sprintf(request, "POST /settings HTTP/1.1\r\nHost: 192.168.4.1\r\n");
+    for(uint32_t i = 0; i < headers; i++)
+    {
+        length += sprintf(request + length, "%s", cookie);
+    }
+    length += sprintf(request + length, "Content-Length: %u\r\n\r\n", body);
+    for(uint32_t i = 0; i < body; i++)
+    {
+        request[length + i] = (i % 9 == 0) ? ',' : (i % 13 == 0) ? '"' : 'a' + i % 26;
+    }
+    Emu_Connect(0);
+    Emu_ClientSend(0, request, length + body);
+
+    Test_Run(60000);
+    return length;
+}
+
+// Тело, которое помещается в блок запроса, доходит до обработчика целиком
+static void Test_PassivePost(void)
+{
+    static char request[4096];
+    uint32_t body = ESP_LINK_REQUEST_SIZE - 64;
+    uint32_t header = Test_Post(request, 40, body);
+
+    CHECK(handled == 1);
+    CHECK(strncmp(last_request, "POST /settings HTTP/1.1\r\n\r\n", 27) == 0);
+    char *payload = strstr(last_request, "\r\n\r\n");
+    CHECK(payload && strlen(payload + 4) == body);
+    CHECK(payload && memcmp(payload + 4, request + header, body) == 0);
+    CHECK(server.bytes_received == header + body);
+    CHECK(server.recv_reads >= (header + body) / ESP_RECV_CHUNK);
+    CHECK(server.oversized == 0);
+    CHECK(emu.links[0].buffered_length == 0);
+    Test_CheckReceived(0);
+    CHECK(parser.overflows == 0);
+    CHECK(request_pool.used == 0);
+    printf("  passive POST: %u bytes in %u AT+CIPRECVDATA, body intact\n",
+           server.bytes_received, server.recv_reads);
+}
+
+// Тело больше блока запроса: обработчик не вызывается, клиент получает 413,
+// остаток тела не читается
+static void Test_PassivePostTooLarge(void)
+{
+    static char request[4096];
+    static const char expected[] = "HTTP/1.1 413 Payload Too Large\r\n";
+
+    Test_Post(request, 0, 3000);
+
+    EmuLinkTypeDef *client = &emu.links[0];
+    CHECK(handled == 0);
+    CHECK(server.oversized == 1);
+    CHECK(client->received_length > sizeof(expected) - 1);
+    CHECK(memcmp(client->received, expected, sizeof(expected) - 1) == 0);
+    CHECK(client->closed_at != 0);
+    CHECK(server.bytes_received <= 2 * ESP_RECV_CHUNK);
+    CHECK(parser.overflows == 0);
+    CHECK(request_pool.used == 0);
+    CHECK(server.links[0].state == ESP_LINK_IDLE);
+    printf("  passive POST of 3000 bytes: 413 after %u bytes read\n", server.bytes_received);
+}
+
+int main(void)
+{
+    Test_Clients(1);
+    Test_Clients(3);
+    Test_Clients(5);
+    Test_SlowClient();
+    Test_PeerClosed();
+    Test_PassivePost();
+    Test_PassivePostTooLarge();
+
+    printf("esp_server_test: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,220 @@
+/*
+ * esp_setup_test.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// esp_setup_test.c
+// Проверка запуска ESP (ESP_Setup_Start) и повышения скорости обмена
+// (ESP_Setup_Negotiate) с моделью ESP-AT v2.2.1.0. Модель искажает каждый
+// 97-й байт выше своей предельной скорости, а при разных скоростях
+// сторон - все байты с ошибкой кадра. Выбранная скорость должна быть
+// наибольшей надежной, связь после отката - сохраниться. Запуск не должен
+// писать во flash ESP и отправлять команды, которых нет в v2.2.1.0.
+// Время - модельное (скорость UART, ответы ESP, загрузка за
+// emu.boot_time), не замер на устройстве.
+//
+// Сборка и запуск:  ./run_tests.sh esp_setup_test
+#include <stdio.h>
+#include <string.h>
+#include "esp_emulator.h"
+#include "esp_setup.h"
+
+#define PAGE_SIZE (20 * 1024)  // Страница для оценки времени передачи
+
+static const uint32_t baudrates[] = { 921600, 460800, 230400 };
+
+// Как esp_setup_config в main.c
+static const ESP_SetupConfigTypeDef config = {
+    .ap_config = "\"SVS_Kursov\",\"12345678\",1,3",
+    .ap_ip = "\"192.168.4.1\"",
+    .baudrates = baudrates,
+    .baudrate_count = sizeof(baudrates) / sizeof(baudrates[0]),
+    .max_connections = 4,
+    .server_port = 80,
+    .server_timeout = 30
+};
+
+static AT_ParserTypeDef parser;
+static AT_EngineTypeDef engine;
+static ESP_SetupTypeDef setup;
+static StaticEventGroup_t event;
+static MemPoolTypeDef response_pool;
+static uint32_t response_storage[MEM_POOL_WORDS(160, 1)];
+static int failures;
+
+#define CHECK(condition) do { \
+    if(!(condition)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while(0)
+
+// Смена скорости USART6: непринятое на старой скорости отбрасывается
+static void Port_SetBaudrate(uint32_t baudrate)
+{
+    Stub_Advance(5000);
+    emu.output_head = emu.output_tail;
+    AT_Parser_Reset(&parser);
+    Emu_SetHostBaudrate(baudrate);
+}
+
+static uint32_t Port_RxErrors(void)
+{
+    return emu.host_rx_errors;
+}
+
+static const ESP_SetupPortTypeDef port = {
+    .set_baudrate = Port_SetBaudrate,
+    .rx_errors = Port_RxErrors
+};
+
+static void Test_Setup(uint32_t max_baudrate)
+{
+    AT_Parser_Init(&parser);
+    Emu_Init(&parser);
+    emu.max_baudrate = max_baudrate;
+    AT_Engine_Init(&engine, &parser, Emu_Transmit, Emu_Poll, &event, 0x01, 0x02);
+    AT_Engine_SetThread(&engine, osThreadGetId());
+    MemPool_Init(&response_pool, "at_response", response_storage, 160, 1);
+    ESP_Setup_Init(&setup, &engine, &response_pool, &port);
+}
+
+static void Test_Negotiate(uint32_t max_baudrate, uint32_t expected)
+{
+    Test_Setup(max_baudrate);
+
+    uint32_t start = stub_tick;
+    uint32_t baudrate = ESP_Setup_Negotiate(&setup, baudrates, sizeof(baudrates) / sizeof(baudrates[0]));
+    uint32_t elapsed = stub_tick - start;
+
+    CHECK(baudrate == expected);
+    CHECK(setup.baudrate == expected);
+    CHECK(emu.baudrate == expected);
+    CHECK(emu.host_baudrate == expected);
+    // Связь после согласования и отката работает
+    CHECK(ESP_Setup_Command(&setup, "AT", "OK", 500, NULL, 0) == AT_STATUS_OK);
+    CHECK(response_pool.used == 0);
+
+    printf("  ESP limit %u: %u baud after %u checks (%u failed), %u ms; "
+           "%u KB page %u ms\n",
+           max_baudrate, baudrate, setup.checks, setup.check_failures, elapsed,
+           PAGE_SIZE / 1024, (uint32_t)((uint64_t)PAGE_SIZE * 10 * 1000 / baudrate));
+}
+
+// Запрос значения: остаток строки после префикса
+static void Test_Query(void)
+{
+    char value[64];
+
+    Test_Setup(921600);
+    CHECK(ESP_Setup_Query(&setup, "AT+SYSSTORE?", "+SYSSTORE:", value, sizeof(value)));
+    CHECK(strcmp(value, "1") == 0);
+    CHECK(!ESP_Setup_Query(&setup, "AT+CWMODE_CUR?", "+CWMODE_CUR:", value, sizeof(value)));
+    CHECK(response_pool.used == 0);
+}
+
+// Запуск после сброса: ESP с заводскими настройками во flash
+static uint32_t Test_Start(void)
+{
+    Test_Setup(921600);
+    Emu_Boot();
+
+    uint32_t start = stub_tick;
+    CHECK(ESP_Setup_Start(&setup, &config));
+    uint32_t elapsed = stub_tick - start;
+
+    CHECK(emu.mode == 2);
+    CHECK(strncmp(emu.ap_config, config.ap_config, strlen(config.ap_config)) == 0);
+    CHECK(strcmp(emu.ap_ip, "192.168.4.1") == 0);
+    CHECK(emu.mux && emu.dinfo && emu.passive && emu.server);
+    CHECK(setup.passive);
+    CHECK(setup.baudrate == 921600);
+    CHECK(setup.boot_ms >= emu.boot_time);
+    CHECK(setup.changes == 2);  // Режим и точка доступа, адрес совпадает
+    // Ни одной записи во flash ESP и ни одной неизвестной команды
+    CHECK(emu.flash_writes == 0);
+    CHECK(Emu_CountCommands("AT+SYSSTORE=0") == 1);
+    CHECK(Emu_CountCommands("AT+CWMODE_") == 0);
+    CHECK(Emu_CountCommands("AT+RESTORE") == 0);
+    CHECK(response_pool.used == 0);
+
+    // Настройки не сохранились: после сброса - снова заводские
+    Emu_Boot();
+    CHECK(emu.mode == 1);
+    return elapsed;
+}
+
+// Настройки во flash ESP уже совпадают: только запросы, без изменений
+static void Test_StartConfigured(void)
+{
+    Test_Setup(921600);
+    emu.stored_mode = 2;
+    snprintf(emu.stored_ap_config, sizeof(emu.stored_ap_config), "%s,4,0", config.ap_config);
+    Emu_Boot();
+
+    CHECK(ESP_Setup_Start(&setup, &config));
+    CHECK(setup.changes == 0);
+    CHECK(Emu_CountCommands("AT+CWMODE=") == 0);
+    CHECK(Emu_CountCommands("AT+CWSAP=") == 0);
+    CHECK(Emu_CountCommands("AT+CIPAP=") == 0);
+    CHECK(emu.flash_writes == 0);
+}
+
+// ESP не загрузился: "ready" и AT не приходят
+static void Test_StartNoModule(void)
+{
+    Test_Setup(921600);
+    Emu_Boot();
+    emu.event_count = 0;
+    emu.parser = NULL;
+
+    CHECK(!ESP_Setup_Start(&setup, &config));
+}
+
+// Запуск до исправления: пауза 3 с после сброса, AT+RESTORE, пауза 2 с,
+// все настройки заново (с записью во flash) на 115200
+static uint32_t Test_Baseline(void)
+{
+    Test_Setup(921600);
+    Emu_Boot();
+
+    uint32_t start = stub_tick;
+    osDelay(100);
+    osDelay(3000);
+    Emu_Poll();
+    CHECK(ESP_Setup_Command(&setup, "AT", "OK", 1000, NULL, 0) == AT_STATUS_OK);
+    ESP_Setup_Command(&setup, "AT+RESTORE", "OK", 1000, NULL, 0);
+    osDelay(2000);
+    Emu_Poll();
+    CHECK(ESP_Setup_Command(&setup, "AT+CWMODE=2", "OK", 2000, NULL, 0) == AT_STATUS_OK);
+    CHECK(ESP_Setup_Command(&setup, "AT+CWSAP=\"SVS_Kursov\",\"12345678\",1,3", "OK", 5000, NULL, 0) == AT_STATUS_OK);
+    ESP_Setup_Command(&setup, "AT+CIPAP=\"192.168.4.1\"", "OK", 2000, NULL, 0);
+    ESP_Setup_Command(&setup, "AT+CIPMUX=1", "OK", 2000, NULL, 0);
+    CHECK(ESP_Setup_Command(&setup, "AT+CIPSERVER=1,80", "OK", 2000, NULL, 0) == AT_STATUS_OK);
+    uint32_t elapsed = stub_tick - start;
+
+    CHECK(emu.flash_writes > 0);
+    printf("  baseline: server after %u ms, %u ESP flash writes\n", elapsed, emu.flash_writes);
+    return elapsed;
+}
+
+int main(void)
+{
+    Test_Negotiate(921600, 921600);
+    Test_Negotiate(460800, 460800);
+    Test_Negotiate(230400, 230400);
+    Test_Negotiate(115200, 115200);
+    Test_Query();
+
+    uint32_t before = Test_Baseline();
+    uint32_t after = Test_Start();
+    printf("  ESP_Setup_Start: server after %u ms (ESP boot %u ms), 0 ESP flash writes; "
+           "%u ms faster than baseline\n", after, emu.boot_time, before - after);
+    Test_StartConfigured();
+    Test_StartNoModule();
+
+    printf("esp_setup_test: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,254 @@
+/*
+ * flash_log_test.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// flash_log_test.c
+// Проверка журнала flash_log на порте в RAM, который ведет себя как
+// flash STM32F4: стирание заполняет сектор 0xFF, программирование только
+// сбрасывает биты. Проверяются смена секторов по кругу и равномерность
+// стираний, поиск по времени, а также отключение питания на каждом слове
+// пачки, включая стирание и заголовок нового сектора: после перезапуска
+// журнал должен содержать все ранее записанные записи по порядку, без
+// поврежденных, и продолжать запись.
+//
+// Сборка и запуск:  ./run_tests.sh flash_log_test
+#include <stdio.h>
+#include <string.h>
+#include "flash_log.h"
+
+#define SECTOR_SIZE 1024   // 63 записи в секторе
+#define SECTOR_COUNT 4
+#define RECORDS_PER_SECTOR ((SECTOR_SIZE - sizeof(FlashLog_HeaderTypeDef)) / sizeof(FlashLog_RecordTypeDef))
+#define POWERED (-1)
+
+static uint32_t flash[SECTOR_COUNT * SECTOR_SIZE / 4];
+static int32_t budget = POWERED;   // Слов до отключения питания
+static uint32_t sector_erases[SECTOR_COUNT];
+static uint32_t overwrites;        // Программирование непустого слова
+static FlashLogTypeDef log;
+static int failures;
+
+#define CHECK(condition) do { \
+    if(!(condition)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while(0)
+
+// Стирание - одна операция: прерванное оставляет сектор как был
+static uint8_t Port_Erase(uint8_t sector)
+{
+    if(budget == 0)
+        return 0;
+    if(budget > 0)
+        budget--;
+
+    memset((uint8_t*)flash + sector * SECTOR_SIZE, 0xFF, SECTOR_SIZE);
+    sector_erases[sector]++;
+    return 1;
+}
+
+// Слово, на котором пропало питание, записывается наполовину
+static uint8_t Port_Program(uint32_t offset, const uint32_t *words, uint32_t count)
+{
+    uint32_t *target = flash + offset / 4;
+
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(budget == 0)
+        {
+            target[i] &= words[i] | 0xFFFF0000UL;
+            return 0;
+        }
+        if(budget > 0)
+            budget--;
+
+        if(target[i] != 0xFFFFFFFFUL)
+        {
+            overwrites++;
+        }
+        target[i] &= words[i];
+    }
+    return 1;
+}
+
+static const FlashLog_PortTypeDef port = {
+    .base = (const uint8_t*)flash,
+    .sector_size = SECTOR_SIZE,
+    .sector_count = SECTOR_COUNT,
+    .erase = Port_Erase,
+    .program = Port_Program
+};
+
+// Данные записи - ее номер и его инверсия, время - номер * 5 с
+static void Log_Append(uint32_t seq)
+{
+    uint32_t data[2] = { seq, ~seq };
+
+    FlashLog_Append(&log, 1000 + seq * 5, data);
+}
+
+// Чтение журнала целиком: записи идут подряд с номера *first
+// @retval Количество записей, 0xFFFFFFFF - нарушен порядок или данные
+static uint32_t Log_Read(uint32_t *first)
+{
+    FlashLog_CursorTypeDef cursor;
+    uint32_t timestamp, data[2];
+    uint32_t count = 0;
+
+    if(!FlashLog_SeekLast(&log, 0xFFFFFFFFUL, &cursor))
+        return 0;
+
+    while(FlashLog_Next(&log, &cursor, &timestamp, data))
+    {
+        if(data[1] != ~data[0] || timestamp != 1000 + data[0] * 5 ||
+           (count > 0 && data[0] != *first + count))
+            return 0xFFFFFFFFUL;
+        if(count == 0)
+        {
+            *first = data[0];
+        }
+        count++;
+    }
+    return count;
+}
+
+static void Test_Reset(void)
+{
+    memset(flash, 0x5A, sizeof(flash));   // Чужие данные до первого запуска
+    memset(sector_erases, 0, sizeof(sector_erases));
+    overwrites = 0;
+    budget = POWERED;
+    FlashLog_Init(&log, &port);
+}
+
+// Заполнение по кругу: самые старые записи теряются целым сектором,
+// стирания распределяются равномерно, индекс после перезапуска тот же
+static void Test_Rotation(void)
+{
+    uint32_t first, count, total = 40 * RECORDS_PER_SECTOR + 17;
+
+    Test_Reset();
+    CHECK(log.order_count == 1 && log.active == 0);
+
+    for(uint32_t seq = 0; seq < total; seq++)
+    {
+        Log_Append(seq);
+    }
+    FlashLog_Flush(&log);
+
+    count = Log_Read(&first);
+    CHECK(count != 0xFFFFFFFFUL);
+    CHECK(first + count == total);
+    CHECK(count > (SECTOR_COUNT - 1) * RECORDS_PER_SECTOR && count <= SECTOR_COUNT * RECORDS_PER_SECTOR);
+    CHECK(log.records == count);
+    CHECK(log.errors == 0 && overwrites == 0);
+
+    uint32_t min = 0xFFFFFFFFUL, max = 0;
+    for(uint8_t s = 0; s < SECTOR_COUNT; s++)
+    {
+        min = sector_erases[s] < min ? sector_erases[s] : min;
+        max = sector_erases[s] > max ? sector_erases[s] : max;
+        CHECK(log.sectors[s].erase_count == sector_erases[s]);
+    }
+    CHECK(max - min <= 1);
+
+    // Перезапуск: индекс строится заново по содержимому flash
+    FlashLogTypeDef before = log;
+    FlashLog_Init(&log, &port);
+    CHECK(log.records == before.records);
+    CHECK(log.active == before.active);
+    CHECK(memcmp(log.order, before.order, sizeof(log.order)) == 0);
+    CHECK(Log_Read(&first) == count);
+
+    // Поиск по времени
+    FlashLog_CursorTypeDef cursor;
+    uint32_t timestamp, data[2];
+    uint32_t target = first + count / 2;
+    CHECK(FlashLog_Seek(&log, 1000 + target * 5 - 2, &cursor));
+    CHECK(FlashLog_Next(&log, &cursor, &timestamp, data) && data[0] == target);
+    CHECK(FlashLog_Seek(&log, 0, &cursor));
+    CHECK(FlashLog_Next(&log, &cursor, &timestamp, data) && data[0] == first);
+    CHECK(!FlashLog_Seek(&log, 1000 + total * 5, &cursor));
+
+    printf("  %u records appended, %u kept, sector erases %u..%u\n",
+           total, count, min, max);
+}
+
+// Отключение питания на каждом слове пачки, в том числе при переходе
+// на следующий сектор (стирание и заголовок)
+static void Test_PowerLoss(void)
+{
+    static uint32_t image[sizeof(flash) / 4];
+    uint32_t prefix = 2 * RECORDS_PER_SECTOR - 2;  // Пачка переходит на третий сектор
+    uint32_t batch_words = 1 + 4 + FLASH_LOG_BATCH_RECORDS * sizeof(FlashLog_RecordTypeDef) / 4;
+    uint32_t recovered_max = 0, crc_errors = 0;
+
+    Test_Reset();
+    for(uint32_t seq = 0; seq < prefix; seq++)
+    {
+        Log_Append(seq);
+    }
+    FlashLog_Flush(&log);
+    memcpy(image, flash, sizeof(flash));
+
+    for(uint32_t cut = 0; cut <= batch_words; cut++)
+    {
+        uint32_t first = 0, count;
+
+        memcpy(flash, image, sizeof(flash));
+        FlashLog_Init(&log, &port);
+        budget = cut;
+        for(uint32_t seq = prefix; seq < prefix + FLASH_LOG_BATCH_RECORDS; seq++)
+        {
+            Log_Append(seq);
+        }
+
+        // Перезапуск
+        budget = POWERED;
+        FlashLog_Init(&log, &port);
+        count = Log_Read(&first);
+        CHECK(count != 0xFFFFFFFFUL);
+        CHECK(first == 0);
+        CHECK(count >= prefix && count <= prefix + FLASH_LOG_BATCH_RECORDS);
+        recovered_max = (count - prefix > recovered_max) ? count - prefix : recovered_max;
+        crc_errors += log.crc_errors;
+
+        // Запись продолжается после перезапуска
+        for(uint32_t seq = count; seq < count + 3 * FLASH_LOG_BATCH_RECORDS; seq++)
+        {
+            Log_Append(seq);
+        }
+        FlashLog_Flush(&log);
+        FlashLog_Init(&log, &port);
+        CHECK(Log_Read(&first) == count + 3 * FLASH_LOG_BATCH_RECORDS);
+        CHECK(first == 0);
+        CHECK(log.errors == 0);
+
+        // Поиск по времени не сбивается на записи с оборванным временем
+        for(uint32_t seq = prefix - 2; seq < count + 3 * FLASH_LOG_BATCH_RECORDS; seq++)
+        {
+            FlashLog_CursorTypeDef cursor;
+            uint32_t timestamp, data[2];
+
+            CHECK(FlashLog_Seek(&log, 1000 + seq * 5, &cursor) &&
+                  FlashLog_Next(&log, &cursor, &timestamp, data) && data[0] == seq);
+        }
+    }
+    CHECK(recovered_max == FLASH_LOG_BATCH_RECORDS);
+
+    printf("  power loss at %u points: all earlier records kept, %u torn records skipped\n",
+           batch_words + 1, crc_errors);
+}
+
+int main(void)
+{
+    Test_Rotation();
+    Test_PowerLoss();
+
+    printf("flash_log_test: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
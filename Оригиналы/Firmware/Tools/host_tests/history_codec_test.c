@@ -0,0 +1,235 @@
+/*
+ * history_codec_test.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// history_codec_test.c
+// Проверка сжатия истории history_codec: показания кодируются блоками
+// и читаются обратно без потерь - медленно меняющиеся с пропусками,
+// случайные во всем диапазоне int16 и времени (включая перевод часов
+// назад), поврежденный блок не читается за пределами данных. Печатает
+// степень сжатия и скорость кодирования на машине сборки.
+//
+// Сборка и запуск:  ./run_tests.sh history_codec_test
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "history_codec.h"
+
+#define SAMPLES 200000
+#define BLOCKS_MAX (SAMPLES)
+
+typedef struct {
+    uint32_t time;
+    int16_t value[CODEC_CHANNELS];
+} SampleTypeDef;
+
+static SampleTypeDef samples[SAMPLES];
+static Codec_BlockTypeDef blocks[BLOCKS_MAX];
+static uint32_t block_count;
+static int failures;
+
+#define CHECK(condition) do { \
+    if(!(condition)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while(0)
+
+static double Now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Кодирование как в History_Add: полный блок закрывается, показание
+// переносится в новый
+static void Encode(uint32_t count)
+{
+    static Codec_EncoderTypeDef encoder;
+
+    Codec_Reset(&encoder);
+    block_count = 0;
+    for(uint32_t i = 0; i < count; i++)
+    {
+        if(!Codec_Append(&encoder, samples[i].time, samples[i].value))
+        {
+            blocks[block_count++] = encoder.block;
+            Codec_Reset(&encoder);
+            Codec_Append(&encoder, samples[i].time, samples[i].value);
+        }
+    }
+    blocks[block_count++] = encoder.block;
+}
+
+// @retval Количество показаний, совпавших с исходными по порядку
+static uint32_t Decode(uint32_t count)
+{
+    Codec_DecoderTypeDef decoder;
+    uint32_t time, matched = 0;
+    int16_t value[CODEC_CHANNELS];
+
+    for(uint32_t b = 0; b < block_count; b++)
+    {
+        Codec_DecoderInit(&decoder, &blocks[b]);
+        while(Codec_Next(&decoder, &time, value))
+        {
+            if(matched >= count || time != samples[matched].time ||
+               memcmp(value, samples[matched].value, sizeof(value)) != 0)
+                return matched;
+            matched++;
+        }
+    }
+    return matched;
+}
+
+static uint32_t Encoded_Bytes(void)
+{
+    uint32_t bytes = 0;
+
+    for(uint32_t b = 0; b < block_count; b++)
+    {
+        bytes += blocks[b].length;
+    }
+    return bytes;
+}
+
+// Датчик раз в 5 с, изредка пропуски опроса и ошибки датчика
+static void Test_Sensor(void)
+{
+    uint32_t time = 1700000000;
+
+    srand(1);
+    for(uint32_t i = 0; i < SAMPLES; i++)
+    {
+        float t = 21.0f + 3.0f * sinf(i / 4000.0f) + (rand() % 5 - 2) * 0.05f;
+        float h = 45.0f + 10.0f * cosf(i / 9000.0f) + (rand() % 5 - 2) * 0.1f;
+
+        time += (rand() % 200 == 0) ? 5 + 5 * (rand() % 30) : 5;
+        samples[i].time = time;
+        samples[i].value[0] = Codec_Fixed(t);
+        samples[i].value[1] = Codec_Fixed(h);
+    }
+
+    double start = Now();
+    Encode(SAMPLES);
+    double encoded = Now();
+    uint32_t matched = Decode(SAMPLES);
+    double decoded = Now();
+
+    CHECK(matched == SAMPLES);
+    uint32_t bytes = Encoded_Bytes() + block_count * (sizeof(Codec_BlockTypeDef) - CODEC_BLOCK_DATA);
+    printf("  sensor: %u samples in %u blocks, %.2f bytes per sample with headers "
+           "(%.2f in data), encode %.1f Msamples/s, decode %.1f Msamples/s\n",
+           SAMPLES, block_count, (double)bytes / SAMPLES, (double)Encoded_Bytes() / SAMPLES,
+           SAMPLES / (encoded - start) / 1e6, SAMPLES / (decoded - encoded) / 1e6);
+}
+
+// Крайние значения: скачки через весь диапазон int16, время назад и
+// через переполнение uint32
+static void Test_Extremes(void)
+{
+    static const uint32_t times[] = { 0, 0xFFFFFFFFUL, 5, 1700000000, 1600000000, 0x80000000UL, 0x7FFFFFFFUL };
+    static const int16_t values[] = { -32768, 32767, 0, -1, 1, -32768, -32767 };
+    uint32_t count = 0;
+
+    for(uint32_t i = 0; i < 7; i++)
+    {
+        for(uint32_t j = 0; j < 7; j++)
+        {
+            samples[count].time = times[(i + j) % 7];
+            samples[count].value[0] = values[j];
+            samples[count].value[1] = values[(i * 3 + j) % 7];
+            count++;
+        }
+    }
+    srand(2);
+    while(count < SAMPLES / 10)
+    {
+        samples[count].time = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+        samples[count].value[0] = (int16_t)rand();
+        samples[count].value[1] = (int16_t)rand();
+        count++;
+    }
+
+    Encode(count);
+    CHECK(Decode(count) == count);
+}
+
+// Постоянный интервал и значения: первое показание в заголовке, второе
+// задает интервал (длинная форма, 4 байта), остальные - по байту
+static void Test_Capacity(void)
+{
+    Codec_EncoderTypeDef encoder;
+    int16_t value[CODEC_CHANNELS] = { 215, 450 };
+    uint32_t count = 0;
+
+    Codec_Reset(&encoder);
+    while(Codec_Append(&encoder, 1000 + count * 5, value))
+    {
+        count++;
+    }
+    CHECK(count == 2 + CODEC_BLOCK_DATA - 4);
+    CHECK(count <= CODEC_BLOCK_SAMPLES);
+    CHECK(encoder.block.length == CODEC_BLOCK_DATA);
+}
+
+// Поврежденный блок: чтение останавливается, не выходя за length
+static void Test_Corrupted(void)
+{
+    Codec_DecoderTypeDef decoder;
+    Codec_BlockTypeDef block;
+    uint32_t time, read;
+    int16_t value[CODEC_CHANNELS];
+
+    Test_Extremes();
+    block = blocks[0];
+    CHECK(block.count > 2);
+
+    // Длина меньше записанной: последнее показание обрывается
+    block.length--;
+    Codec_DecoderInit(&decoder, &block);
+    for(read = 0; Codec_Next(&decoder, &time, value); read++)
+    {
+    }
+    CHECK(read < block.count);
+    CHECK(decoder.position <= block.length);
+
+    // Счетчик больше, чем показаний в данных
+    block = blocks[0];
+    block.count += 10;
+    Codec_DecoderInit(&decoder, &block);
+    for(read = 0; Codec_Next(&decoder, &time, value); read++)
+    {
+    }
+    CHECK(read == blocks[0].count);
+
+    // Незавершенный varint в конце данных
+    memset(&block, 0, sizeof(block));
+    block.count = 2;
+    block.length = 3;
+    block.data[0] = 0x80;
+    block.data[1] = 0xFF;
+    block.data[2] = 0xFF;
+    Codec_DecoderInit(&decoder, &block);
+    CHECK(Codec_Next(&decoder, &time, value));
+    CHECK(!Codec_Next(&decoder, &time, value));
+    CHECK(decoder.position <= block.length);
+}
+
+int main(void)
+{
+    Test_Sensor();
+    Test_Extremes();
+    Test_Capacity();
+    Test_Corrupted();
+
+    printf("history_codec_test: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * http_cache_test.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// http_cache_test.c
+// Проверка кэша HTTP ответов: перерисовка только после изменения
+// источника и только при свободном буфере, счетчик readers не уходит
+// в минус и не застревает после лишних Release.
+//
+// Сборка и запуск:  ./run_tests.sh http_cache_test
+#include <stdio.h>
+#include <string.h>
+#include "http_cache.h"
+
+static HTTP_CacheEntryTypeDef entry;
+static char buffer[64];
+static uint32_t renders;
+static int failures;
+
+#define CHECK(condition) do { \
+    if(!(condition)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while(0)
+
+static uint32_t Render(char *out, uint32_t size)
+{
+    renders++;
+    return snprintf(out, size, "render %u", renders);
+}
+
+int main(void)
+{
+    uint32_t length;
+    const char *response;
+
+    HTTP_Cache_Init(&entry, buffer, sizeof(buffer), HTTP_DEP(HTTP_STATE_SENSOR), Render);
+
+    // Первый запрос формирует ответ, второй берет его из кэша
+    response = HTTP_Cache_Get(&entry, &length);
+    CHECK(renders == 1 && strcmp(response, "render 1") == 0 && length == 8);
+    HTTP_Cache_Release(&entry);
+    HTTP_Cache_Get(&entry, &length);
+    CHECK(renders == 1 && entry.hits == 1);
+    CHECK(entry.readers == 1);
+
+    // Источник изменился, пока ответ отправляется: буфер не трогается
+    HTTP_Cache_Touch(HTTP_STATE_SENSOR);
+    response = HTTP_Cache_Get(&entry, &length);
+    CHECK(renders == 1 && strcmp(response, "render 1") == 0);
+    CHECK(entry.stale_hits == 1);
+    CHECK(entry.readers == 2);
+
+    // Изменение источника, от которого ответ не зависит, не перерисовывает
+    HTTP_Cache_Touch(HTTP_STATE_HISTORY);
+
+    // Отправки завершены: следующий запрос перерисовывает
+    HTTP_Cache_Release(&entry);
+    HTTP_Cache_Release(&entry);
+    CHECK(entry.readers == 0);
+    HTTP_Cache_Release(&entry);
+    CHECK(entry.readers == 0);
+    response = HTTP_Cache_Get(&entry, &length);
+    CHECK(renders == 2 && strcmp(response, "render 2") == 0);
+    CHECK(entry.readers == 1);
+    HTTP_Cache_Release(&entry);
+
+    HTTP_Cache_Get(&entry, &length);
+    CHECK(renders == 2 && entry.hits == 2 && entry.misses == 2);
+    HTTP_Cache_Release(&entry);
+
+    printf("http_cache_test: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
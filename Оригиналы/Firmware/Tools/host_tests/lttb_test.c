@@ -0,0 +1,191 @@
+/*
+ * lttb_test.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// lttb_test.c
+// Проверка LTTB_Downsample и замер на Linux: скорость прореживания
+// и отклонение прореженного ряда от исходного (линейная интерполяция
+// между выбранными точками) в сравнении с выборкой с равным шагом.
+//
+// Сборка и запуск:  ./run_tests.sh lttb_test
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "lttb.h"
+
+#define SERIES_SIZE 100000  // Около 70 суток показаний раз в минуту
+#define POINTS 200          // HISTORY_POINTS_MAX ответа /history
+#define BENCH_RUNS 20
+
+static LTTB_PointTypeDef series[SERIES_SIZE];
+static uint32_t selected[SERIES_SIZE];
+static uint32_t reads;
+static int failures;
+
+#define CHECK(condition) do { \
+    if(!(condition)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while(0)
+
+static LTTB_PointTypeDef Series_Point(void *ctx, uint32_t index)
+{
+    reads++;
+    return ((LTTB_PointTypeDef*)ctx)[index];
+}
+
+static double Now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Температура в десятых долях: суточный ход, шум датчика и ступеньки
+// от включения нагрева
+static void Series_Generate(uint32_t count)
+{
+    srand(1);
+    for(uint32_t i = 0; i < count; i++)
+    {
+        double day = 2 * M_PI * i / (24 * 60);
+        int32_t step = (i / 5000) % 3 == 1 ? 25 : 0;
+
+        series[i].x = i * 60;
+        series[i].y = (int32_t)(215 + 30 * sin(day) + step + rand() % 5 - 2);
+    }
+}
+
+// Отклонение от исходного ряда: линейная интерполяция между выбранными точками
+static void Series_Error(uint32_t count, const uint32_t *indexes, uint32_t selected_count,
+                         double *max_error, double *rms_error)
+{
+    double max = 0;
+    double sum = 0;
+
+    for(uint32_t s = 0; s + 1 < selected_count; s++)
+    {
+        LTTB_PointTypeDef a = series[indexes[s]];
+        LTTB_PointTypeDef b = series[indexes[s + 1]];
+
+        // Последняя точка выбрана и отклонения не дает
+        for(uint32_t i = indexes[s]; i < indexes[s + 1]; i++)
+        {
+            double y = a.y + (double)(b.y - a.y) * (series[i].x - a.x) / (b.x - a.x ? b.x - a.x : 1);
+            double error = fabs(series[i].y - y);
+
+            if(error > max)
+                max = error;
+            sum += error * error;
+        }
+    }
+    *max_error = max / 10;
+    *rms_error = sqrt(sum / count) / 10;
+}
+
+static void Test_Short(void)
+{
+    // Ряд не длиннее порога возвращается целиком
+    Series_Generate(10);
+    CHECK(LTTB_Downsample(Series_Point, series, 10, 10, selected) == 10);
+    CHECK(LTTB_Downsample(Series_Point, series, 10, 50, selected) == 10);
+    for(uint32_t i = 0; i < 10; i++)
+    {
+        CHECK(selected[i] == i);
+    }
+    CHECK(LTTB_Downsample(Series_Point, series, 2, 3, selected) == 2);
+    CHECK(LTTB_Downsample(Series_Point, series, 0, 3, selected) == 0);
+}
+
+static void Test_Selection(void)
+{
+    static const uint32_t counts[] = { 3, 4, 7, 100, 1001, SERIES_SIZE };
+    static const uint32_t thresholds[] = { 3, 4, 5, 17, 200, 999 };
+
+    Series_Generate(SERIES_SIZE);
+    for(uint32_t c = 0; c < sizeof(counts) / sizeof(counts[0]); c++)
+    {
+        for(uint32_t t = 0; t < sizeof(thresholds) / sizeof(thresholds[0]); t++)
+        {
+            uint32_t count = counts[c];
+            uint32_t threshold = thresholds[t];
+            uint32_t n = LTTB_Downsample(Series_Point, series, count, threshold, selected);
+
+            // Ровно threshold точек, первая и последняя на месте, по возрастанию
+            CHECK(n == (threshold < count ? threshold : count));
+            CHECK(selected[0] == 0);
+            CHECK(selected[n - 1] == count - 1);
+            for(uint32_t i = 1; i < n; i++)
+            {
+                CHECK(selected[i] > selected[i - 1]);
+            }
+        }
+    }
+}
+
+static void Test_Spike(void)
+{
+    // Одиночный выброс на ровном ряду выбирается всегда
+    for(uint32_t i = 0; i < 10000; i++)
+    {
+        series[i].x = i * 60;
+        series[i].y = 200;
+    }
+    series[6789].y = 450;
+
+    uint32_t n = LTTB_Downsample(Series_Point, series, 10000, 20, selected);
+    int found = 0;
+    for(uint32_t i = 0; i < n; i++)
+    {
+        found |= selected[i] == 6789;
+    }
+    CHECK(found);
+}
+
+static void Bench(void)
+{
+    uint32_t stride[POINTS];
+    double max_error, rms_error;
+
+    Series_Generate(SERIES_SIZE);
+
+    reads = 0;
+    double start = Now();
+    uint32_t n = 0;
+    for(int run = 0; run < BENCH_RUNS; run++)
+    {
+        n = LTTB_Downsample(Series_Point, series, SERIES_SIZE, POINTS, selected);
+    }
+    double elapsed = (Now() - start) / BENCH_RUNS;
+
+    printf("  %u -> %u points: %.2f ms, %.1f Mpoints/s, %.2f reads per point\n",
+           SERIES_SIZE, n, elapsed * 1e3, SERIES_SIZE / elapsed / 1e6,
+           (double)reads / BENCH_RUNS / SERIES_SIZE);
+
+    Series_Error(SERIES_SIZE, selected, n, &max_error, &rms_error);
+    printf("  LTTB error:        max %.1f, rms %.2f (deg C)\n", max_error, rms_error);
+
+    // Для сравнения - равный шаг с той же первой и последней точкой
+    for(uint32_t i = 0; i < POINTS; i++)
+    {
+        stride[i] = (uint32_t)((uint64_t)i * (SERIES_SIZE - 1) / (POINTS - 1));
+    }
+    Series_Error(SERIES_SIZE, stride, POINTS, &max_error, &rms_error);
+    printf("  stride error:      max %.1f, rms %.2f (deg C)\n", max_error, rms_error);
+}
+
+int main(void)
+{
+    Test_Short();
+    Test_Selection();
+    Test_Spike();
+    Bench();
+
+    printf("%s\n", failures ? "lttb_test: FAILED" : "lttb_test: ok");
+    return failures != 0;
+}
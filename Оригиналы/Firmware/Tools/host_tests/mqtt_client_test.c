@@ -0,0 +1,216 @@
+/*
+ * mqtt_client_test.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// mqtt_client_test.c
+// Проверка подключения mqtt_client к брокеру через модель ESP-AT: при
+// недоступном брокере AT+MQTTCONN занимает ESP до ответа ERROR, поэтому
+// вызов MQTT_Client_Process не должен ждать ответа, а пауза между
+// попытками - удваиваться. После появления брокера накопленная очередь
+// публикуется пачками. Время - модельное, не замер на устройстве.
+//
+// Сборка и запуск:  ./run_tests.sh mqtt_client_test
+#include <stdio.h>
+#include <string.h>
+#include "esp_emulator.h"
+#include "mqtt_client.h"
+
+#define WAKE_FLAG 0x04
+#define ATTEMPTS_MAX 16
+
+static AT_ParserTypeDef parser;
+static AT_EngineTypeDef engine;
+static MQTT_ClientTypeDef client;
+static StaticEventGroup_t event;
+static uint32_t next_process;
+static uint32_t attempts[ATTEMPTS_MAX];  // Отправка AT+MQTTCONN, мс
+static uint32_t attempt_count;
+static int failures;
+
+#define CHECK(condition) do { \
+    if(!(condition)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while(0)
+
+static void Test_Setup(void)
+{
+    AT_Parser_Init(&parser);
+    Emu_Init(&parser);
+    AT_Engine_Init(&engine, &parser, Emu_Transmit, Emu_Poll, &event, 0x01, 0x02);
+    AT_Engine_SetThread(&engine, osThreadGetId());
+    MQTT_Client_Init(&client, &engine, "192.168.4.2", 1883, "svs_kursov",
+                     "microclimate/svs_kursov/telemetry");
+    MQTT_Client_Attach(&client, &parser);
+    MQTT_Client_SetThread(&client, osThreadGetId(), WAKE_FLAG);
+    next_process = stub_tick;
+    attempt_count = 0;
+}
+
+// Потоки движка AT и обмена (StartExchangeATCommand) в одном цикле.
+// Вызов MQTT_Client_Process не продвигает модельное время
+static void Test_Run(uint32_t duration)
+{
+    uint32_t end = stub_tick + duration;
+
+    while((int32_t)(end - stub_tick) > 0)
+    {
+        Emu_Poll();
+        AT_Engine_Process(&engine);
+
+        uint32_t sent = Emu_CountCommands("AT+MQTTCONN");
+        if(sent > attempt_count && attempt_count < ATTEMPTS_MAX)
+        {
+            attempts[attempt_count] = stub_tick;
+        }
+        attempt_count = sent;
+
+        if(osThreadFlagsClear(WAKE_FLAG) & WAKE_FLAG || (int32_t)(next_process - stub_tick) <= 0)
+        {
+            uint32_t before = stub_tick;
+            uint8_t connected = client.connected;
+            uint32_t timeout = MQTT_Client_Process(&client);
+
+            // Без подключения публикации нет - ожидания ответа ESP тоже
+            if(!connected)
+            {
+                CHECK(stub_tick == before);
+            }
+            next_process = (timeout == osWaitForever) ? end : stub_tick + timeout;
+        }
+
+        uint32_t timeout = AT_Engine_Timeout(&engine);
+        uint32_t wait = ((int32_t)(next_process - stub_tick) > 0) ? next_process - stub_tick : 0;
+        if(wait > end - stub_tick)
+            wait = end - stub_tick;
+        osEventFlagsWait(&event, 0x03, osFlagsWaitAny, timeout < wait ? timeout : wait);
+    }
+}
+
+// Статистика движка по имени команды
+static const AT_CommandStatsTypeDef* Test_Stats(const char *name)
+{
+    for(uint32_t i = 0; i < engine.stats_count; i++)
+    {
+        if(strcmp(engine.stats[i].name, name) == 0)
+            return &engine.stats[i];
+    }
+    return NULL;
+}
+
+// Брокер недоступен час: попытки реже с каждой неудачей, другие команды
+// ждут в очереди движка не дольше одной попытки
+static void Test_BrokerDown(void)
+{
+    static AT_RequestTypeDef request;
+    const uint32_t hour = 3600000;
+
+    Test_Setup();
+    Emu_SetBroker(0);
+
+    // Первая попытка и AT+CWLIF следом
+    Test_Run(100);
+    CHECK(client.connecting);
+    AT_Request_Init(&request, "AT+CWLIF", "OK", 1000);
+    AT_Engine_Submit(&engine, &request);
+    uint32_t submitted = stub_tick;
+    while(request.status == AT_STATUS_PENDING)
+    {
+        Test_Run(10);
+    }
+    uint32_t waited = stub_tick - submitted;
+    CHECK(request.status == AT_STATUS_OK);
+    CHECK(waited <= MQTT_CONNECT_TIMEOUT);
+
+    Test_Run(hour - 100 - waited);
+
+    // Паузы между попытками: ответ ERROR через emu.mqtt_fail_delay и
+    // 15, 30, 60 ... 600 с
+    uint32_t delay = MQTT_RETRY_INTERVAL;
+    for(uint32_t i = 1; i < attempt_count && i < ATTEMPTS_MAX; i++)
+    {
+        uint32_t gap = attempts[i] - attempts[i - 1] - emu.mqtt_fail_delay;
+        CHECK(gap >= delay && gap <= delay + 100);
+        delay = (delay * 2 < MQTT_RETRY_MAX) ? delay * 2 : MQTT_RETRY_MAX;
+    }
+    CHECK(attempt_count >= 6 && attempt_count <= 12);
+    CHECK(client.errors == attempt_count || client.errors + 1 == attempt_count);
+    CHECK(!client.connected);
+
+    const AT_CommandStatsTypeDef *stats = Test_Stats("AT+MQTTCONN");
+    CHECK(stats != NULL);
+    if(stats)
+    {
+        // При постоянном интервале 15 с ESP был бы занят 7 с из каждых 22
+        printf("  broker down 1 h: %u attempts, ESP busy %u ms (%u.%u%%, 32%% with a fixed 15 s retry), "
+               "AT+CWLIF waited %u ms\n",
+               attempt_count, stats->total_ms, stats->total_ms * 100 / hour,
+               stats->total_ms * 1000 / hour % 10, waited);
+    }
+}
+
+// Брокер появился: очередь публикуется, интервал попыток сбрасывается
+static void Test_BrokerUp(void)
+{
+    static const char batch[] = "{\"id\":\"svs_kursov\",\"s\":[[1700000120,21.5,64.0],"
+        "[1700000125,21.5,65.0],[1700000130,21.5,66.0],[1700000135,21.5,67.0],"
+        "[1700000140,21.5,68.0],[1700000145,21.5,69.0]]}";
+
+    Test_Setup();
+    Emu_SetBroker(0);
+    for(uint32_t i = 0; i < 30; i++)
+    {
+        MQTT_Client_Push(&client, 1700000000 + i * 5, 21.5f, 40.0f + i);
+    }
+    Test_Run(60000);
+    CHECK(!client.connected && client.retry_delay > MQTT_RETRY_INTERVAL);
+
+    Emu_SetBroker(1);
+    for(uint32_t i = 0; i < MQTT_RETRY_MAX / 1000 && !client.connected; i++)
+    {
+        Test_Run(1000);
+    }
+    Test_Run(1000);
+
+    CHECK(client.connected);
+    CHECK(client.retry_delay == 0);
+    // Две полные пачки и остаток: с прошлой публикации прошло больше
+    // MQTT_PUBLISH_INTERVAL
+    CHECK(client.published == 30);
+    CHECK(emu.mqtt_published == 3);
+    CHECK(MQTT_Client_Pending(&client) == 0);
+    CHECK(strcmp(emu.mqtt_last, batch) == 0);
+
+    // Разрыв: повторное подключение сразу, без накопленной паузы
+    Emu_SetBroker(0);
+    Test_Run(100);
+    CHECK(!client.connected && client.connecting);
+}
+
+// Прошивка ESP без AT+MQTT*: одна попытка до следующего сброса
+static void Test_Unsupported(void)
+{
+    Test_Setup();
+    emu.mqtt_supported = 0;
+    Test_Run(MQTT_RETRY_MAX * 2);
+
+    CHECK(client.unsupported);
+    CHECK(!client.connecting);
+    CHECK(Emu_CountCommands("AT+MQTTUSERCFG") == 1);
+    CHECK(Emu_CountCommands("AT+MQTTCONN") == 0);
+    CHECK(MQTT_Client_Process(&client) == osWaitForever);
+}
+
+int main(void)
+{
+    Test_BrokerDown();
+    Test_BrokerUp();
+    Test_Unsupported();
+
+    printf("mqtt_client_test: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
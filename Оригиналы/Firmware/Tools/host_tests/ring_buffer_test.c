@@ -0,0 +1,179 @@
+/*
+ * ring_buffer_test.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// ring_buffer_test.c
+// Проверка кольцевого буфера истории: диапазон Ring_Snapshot после
+// переполнения, отказ Ring_Get для перезаписанных и еще не добавленных
+// записей, запись в процессе добавления. Отдельно - писатель и читатель
+// в разных потоках: принятая читателем запись не должна быть смесью
+// старой и новой.
+//
+// Сборка и запуск:  ./run_tests.sh ring_buffer_test
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include "ring_buffer.h"
+
+#define CAPACITY 16
+#define STRESS_RECORDS 2000000
+
+typedef struct {
+    uint32_t seq;
+    uint32_t payload[6];
+    uint32_t check;   // seq ^ payload[i]
+} RecordTypeDef;
+
+static RingBufferTypeDef ring;
+static RecordTypeDef storage[CAPACITY];
+static volatile uint8_t writer_done;
+static int failures;
+
+#define CHECK(condition) do { \
+    if(!(condition)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while(0)
+
+static void Record_Make(RecordTypeDef *record, uint32_t seq)
+{
+    record->seq = seq;
+    record->check = seq;
+    for(uint32_t i = 0; i < 6; i++)
+    {
+        record->payload[i] = seq * 2654435761U + i;
+        record->check ^= record->payload[i];
+    }
+}
+
+static uint8_t Record_Valid(const RecordTypeDef *record, uint32_t seq)
+{
+    uint32_t check = record->seq;
+
+    for(uint32_t i = 0; i < 6; i++)
+    {
+        check ^= record->payload[i];
+    }
+    return record->seq == seq && check == record->check;
+}
+
+static void Test_Sequential(void)
+{
+    RecordTypeDef record;
+    uint32_t first, count;
+
+    Ring_Init(&ring, storage, sizeof(RecordTypeDef), CAPACITY);
+    count = Ring_Snapshot(&ring, &first);
+    CHECK(count == 0 && first == 0);
+    CHECK(!Ring_Get(&ring, 0, &record));
+
+    // До заполнения доступны все записи
+    for(uint32_t seq = 0; seq < 5; seq++)
+    {
+        Record_Make(&record, seq);
+        Ring_Append(&ring, &record);
+    }
+    count = Ring_Snapshot(&ring, &first);
+    CHECK(count == 5 && first == 0);
+    for(uint32_t seq = first; seq < first + count; seq++)
+    {
+        CHECK(Ring_Get(&ring, seq, &record) && Record_Valid(&record, seq));
+    }
+    CHECK(!Ring_Get(&ring, 5, &record));
+
+    // После нескольких оборотов: capacity - 1 самых новых записей
+    for(uint32_t seq = 5; seq < 3 * CAPACITY + 7; seq++)
+    {
+        Record_Make(&record, seq);
+        Ring_Append(&ring, &record);
+    }
+    count = Ring_Snapshot(&ring, &first);
+    CHECK(count == CAPACITY - 1);
+    CHECK(first + count == 3 * CAPACITY + 7);
+    for(uint32_t seq = first; seq < first + count; seq++)
+    {
+        CHECK(Ring_Get(&ring, seq, &record) && Record_Valid(&record, seq));
+    }
+    // Самая старая запись еще на месте, более ранние перезаписаны
+    CHECK(Ring_Get(&ring, first - 1, &record) && Record_Valid(&record, first - 1));
+    CHECK(!Ring_Get(&ring, first - 2, &record));
+    CHECK(!Ring_Get(&ring, first + count, &record));
+
+    // Идет добавление: место самой старой записи уже занято
+    ring.generation++;
+    CHECK(!Ring_Get(&ring, first - 1, &record));
+    CHECK(Ring_Get(&ring, first, &record) && Record_Valid(&record, first));
+    ring.generation++;
+
+    Ring_Clear(&ring);
+    count = Ring_Snapshot(&ring, &first);
+    CHECK(count == 0);
+    CHECK(!Ring_Get(&ring, 0, &record));
+}
+
+static void* Writer(void *arg)
+{
+    RecordTypeDef record;
+
+    for(uint32_t seq = 0; seq < STRESS_RECORDS; seq++)
+    {
+        Record_Make(&record, seq);
+        Ring_Append(&ring, &record);
+    }
+    writer_done = 1;
+    return NULL;
+}
+
+// Читатель обходит снимок, пока писатель добавляет записи:
+// запись либо цела, либо отвергнута
+static void Test_Concurrent(void)
+{
+    pthread_t writer;
+    RecordTypeDef record;
+    uint32_t accepted = 0, rejected = 0, torn = 0;
+
+    Ring_Init(&ring, storage, sizeof(RecordTypeDef), CAPACITY);
+    writer_done = 0;
+    pthread_create(&writer, NULL, Writer, NULL);
+
+    while(!writer_done)
+    {
+        uint32_t first;
+        uint32_t count = Ring_Snapshot(&ring, &first);
+
+        for(uint32_t seq = first; seq < first + count; seq++)
+        {
+            if(!Ring_Get(&ring, seq, &record))
+            {
+                rejected++;
+            }
+            else if(Record_Valid(&record, seq))
+            {
+                accepted++;
+            }
+            else
+            {
+                torn++;
+            }
+        }
+    }
+    pthread_join(writer, NULL);
+
+    CHECK(torn == 0);
+    CHECK(accepted > 0);
+    printf("  %u records written: %u reads accepted, %u rejected, %u torn\n",
+           STRESS_RECORDS, accepted, rejected, torn);
+}
+
+int main(void)
+{
+    Test_Sequential();
+    Test_Concurrent();
+
+    printf("ring_buffer_test: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
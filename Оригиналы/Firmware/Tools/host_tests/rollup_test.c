@@ -0,0 +1,309 @@
+/*
+ * rollup_test.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// rollup_test.c
+// Проверка многоуровневой истории rollup: три дня показаний раз в 5 с
+// с перерывом датчика добавляются в уровни 1 мин, 30 мин и 1 сутки, ответы
+// Rollup_Query сравниваются с расчетом по исходным показаниям (минимум,
+// максимум, количество - точно, среднее - в пределах округления).
+// Отдельно - выбор уровня, перевод часов назад, перерыв длиннее глубины
+// и год показаний одной строкой.
+//
+// Сборка и запуск:  ./run_tests.sh rollup_test
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "rollup.h"
+
+#define DAY 86400
+#define T0 (1700000000 - 1700000000 % DAY)
+#define SAMPLE_PERIOD 5
+#define SAMPLES (3 * DAY / SAMPLE_PERIOD)
+#define GAP_START (T0 + 30000)   // Датчик не отвечал 2 часа
+#define GAP_END (T0 + 37200)
+#define ROWS_MAX 512
+
+typedef struct {
+    uint32_t period;
+    uint32_t capacity;
+} TierConfigTypeDef;
+
+static const TierConfigTypeDef configs[] = {
+    { 60, 121 },        // 2 часа
+    { 30 * 60, 49 },    // Сутки
+    { DAY, 8 }          // Неделя
+};
+#define TIER_COUNT (sizeof(configs) / sizeof(configs[0]))
+
+static Rollup_TierTypeDef tiers[TIER_COUNT];
+static Rollup_BucketTypeDef storage[TIER_COUNT][128];
+static uint32_t times[SAMPLES];
+static int16_t fixed[SAMPLES][ROLLUP_CHANNELS];
+static uint32_t sample_count;
+static Rollup_RowTypeDef rows[ROWS_MAX];
+static Rollup_RowTypeDef expected[ROWS_MAX];
+static int failures;
+
+#define CHECK(condition) do { \
+    if(!(condition)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+        failures++; \
+    } \
+} while(0)
+
+// Как Rollup_Fixed
+static int16_t Fixed(float value)
+{
+    return (int16_t)(value * ROLLUP_SCALE + (value < 0.0f ? -0.5f : 0.5f));
+}
+
+static void Test_Init(void)
+{
+    for(uint32_t i = 0; i < TIER_COUNT; i++)
+    {
+        Rollup_TierInit(&tiers[i], configs[i].period, storage[i], configs[i].capacity);
+    }
+    sample_count = 0;
+}
+
+static void Test_Add(uint32_t timestamp, float temperature, float humidity)
+{
+    float values[ROLLUP_CHANNELS] = { temperature, humidity };
+
+    for(uint32_t i = 0; i < TIER_COUNT; i++)
+    {
+        Rollup_Add(&tiers[i], timestamp, values);
+    }
+    times[sample_count] = timestamp;
+    for(uint8_t c = 0; c < ROLLUP_CHANNELS; c++)
+    {
+        fixed[sample_count][c] = Fixed(values[c]);
+    }
+    sample_count++;
+}
+
+// Расчет по исходным показаниям: интервалы уровня, которые еще хранятся,
+// среднее интервала с тем же округлением, что и при закрытии (exact = 0)
+// или точная сумма (exact = 1)
+static uint32_t Reference(const Rollup_TierTypeDef *tier, uint32_t from, uint32_t to,
+                          uint32_t step, uint32_t oldest, uint8_t exact)
+{
+    uint32_t row_count = 0;
+    uint32_t period = tier->period;
+    uint32_t i = 0;
+
+    while(i < sample_count)
+    {
+        uint32_t start = times[i] - times[i] % period;
+        int16_t min[ROLLUP_CHANNELS], max[ROLLUP_CHANNELS];
+        int32_t sum[ROLLUP_CHANNELS] = { 0 };
+        uint32_t count = 0;
+
+        for(; i < sample_count && times[i] - times[i] % period == start; i++)
+        {
+            for(uint8_t c = 0; c < ROLLUP_CHANNELS; c++)
+            {
+                if(count == 0 || fixed[i][c] < min[c])
+                    min[c] = fixed[i][c];
+                if(count == 0 || fixed[i][c] > max[c])
+                    max[c] = fixed[i][c];
+                sum[c] += fixed[i][c];
+            }
+            count++;
+        }
+
+        if(start < oldest || start < from || start >= to)
+            continue;
+
+        // Закрытый интервал хранит только среднее
+        if(!exact && start != tier->open.start)
+        {
+            for(uint8_t c = 0; c < ROLLUP_CHANNELS; c++)
+            {
+                sum[c] = (sum[c] / (int32_t)count) * (int32_t)count;
+            }
+        }
+
+        uint32_t row_time = start - (start - from) % step;
+        if(row_count == 0 || expected[row_count - 1].time != row_time)
+        {
+            memset(&expected[row_count], 0, sizeof(expected[row_count]));
+            expected[row_count].time = row_time;
+            row_count++;
+        }
+        Rollup_RowTypeDef *row = &expected[row_count - 1];
+        for(uint8_t c = 0; c < ROLLUP_CHANNELS; c++)
+        {
+            if(row->count == 0 || min[c] < row->min[c])
+                row->min[c] = min[c];
+            if(row->count == 0 || max[c] > row->max[c])
+                row->max[c] = max[c];
+            row->sum[c] += sum[c];
+        }
+        row->count += count;
+    }
+    return row_count;
+}
+
+static void Test_Compare(uint8_t t, uint32_t from, uint32_t to, uint32_t step)
+{
+    Rollup_TierTypeDef *tier = &tiers[t];
+    uint32_t oldest = tier->open.start - (tier->ring.capacity - 1) * tier->period;
+    uint32_t count = Rollup_Query(tier, from, to, step, rows, ROWS_MAX);
+    uint32_t reference = Reference(tier, from, to, step, oldest, 0);
+
+    CHECK(reference > 0);
+    CHECK(count == reference);
+    for(uint32_t i = 0; i < count && i < reference; i++)
+    {
+        CHECK(rows[i].time == expected[i].time);
+        CHECK(rows[i].count == expected[i].count);
+        CHECK(memcmp(rows[i].min, expected[i].min, sizeof(rows[i].min)) == 0);
+        CHECK(memcmp(rows[i].max, expected[i].max, sizeof(rows[i].max)) == 0);
+        CHECK(memcmp(rows[i].sum, expected[i].sum, sizeof(rows[i].sum)) == 0);
+    }
+}
+
+static void Test_Days(void)
+{
+    Test_Init();
+    srand(1);
+    for(uint32_t i = 0; i < SAMPLES; i++)
+    {
+        uint32_t t = T0 + i * SAMPLE_PERIOD;
+        float noise = (float)(rand() % 21 - 10) / 20.0f;
+
+        if(t >= GAP_START && t < GAP_END)
+            continue;
+        // Температура переходит через ноль
+        Test_Add(t, 2.0f + 5.0f * sinf((float)(t - T0) / 7200.0f) + noise,
+                 55.0f + 20.0f * cosf((float)(t - T0) / 20000.0f) - noise);
+    }
+
+    uint32_t now = times[sample_count - 1];
+
+    // Последние 2 часа поминутно и по 5 минут, сутки по 30 минут и по 3 часа,
+    // вся история по суткам, с началом, не кратным шагу
+    Test_Compare(0, now - 7200, now + 1, 60);
+    Test_Compare(0, now - 7200 + 17, now + 1, 300);
+    Test_Compare(1, now - DAY, now + 1, 1800);
+    Test_Compare(1, now - DAY + 600, now - 3600, 3 * 3600);
+    Test_Compare(2, 0, now + 1, DAY);
+    Test_Compare(2, T0 + 12345, now + 1, 2 * DAY);
+
+    // Среднее строки отличается от точного меньше чем на 0.1
+    uint32_t count = Rollup_Query(&tiers[1], now - DAY, now + 1, 3 * 3600, rows, ROWS_MAX);
+    uint32_t reference = Reference(&tiers[1], now - DAY, now + 1, 3 * 3600, 0, 1);
+    double error = 0;
+    CHECK(count == reference);
+    for(uint32_t i = 0; i < count && i < reference; i++)
+    {
+        for(uint8_t c = 0; c < ROLLUP_CHANNELS; c++)
+        {
+            double mean = (double)rows[i].sum[c] / rows[i].count;
+            double exact = (double)expected[i].sum[c] / expected[i].count;
+            error = fabs(mean - exact) > error ? fabs(mean - exact) : error;
+        }
+    }
+    CHECK(error < 1.0);
+
+    // Выбор уровня по шагу и глубине истории
+    CHECK(Rollup_Select(tiers, TIER_COUNT, now - 3600, 60) == 0);
+    CHECK(Rollup_Select(tiers, TIER_COUNT, now - 3600, 1800) == 1);
+    CHECK(Rollup_Select(tiers, TIER_COUNT, now - 5 * 3600, 60) == 1);
+    CHECK(Rollup_Select(tiers, TIER_COUNT, now - 2 * DAY, 60) == 2);
+    CHECK(Rollup_Select(tiers, TIER_COUNT, now - DAY, 7 * DAY) == 2);
+
+    printf("  %u samples: 3 tiers match the raw data, mean error %.3f\n",
+           sample_count, error / ROLLUP_SCALE);
+}
+
+// Перерыв датчика внутри глубины уровня: пустые интервалы не выдаются;
+// перерыв длиннее глубины начинает историю уровня заново
+static void Test_Gaps(void)
+{
+    uint32_t count;
+
+    Test_Init();
+    for(uint32_t t = T0; t < T0 + 20 * 3600; t += SAMPLE_PERIOD)
+    {
+        if(t < GAP_START || t >= GAP_END)
+            Test_Add(t, 20.0f, 50.0f);
+    }
+    // 12 интервалов по 30 мин, 3 из них целиком в перерыве
+    count = Rollup_Query(&tiers[1], GAP_START - 7200, GAP_END + 7200, 1800, rows, ROWS_MAX);
+    CHECK(count == 9);
+    Test_Compare(1, GAP_START - 7200, GAP_END + 7200, 1800);
+
+    // 3 часа без показаний: уровень 1 мин (глубина 2 часа) очищается
+    uint32_t resume = T0 + 23 * 3600;
+    Test_Add(resume, 21.0f, 51.0f);
+    count = Rollup_Query(&tiers[0], 0, resume + 60, 60, rows, ROWS_MAX);
+    CHECK(count == 1 && rows[0].time == resume - resume % 60 && rows[0].count == 1);
+    count = Rollup_Query(&tiers[1], resume - 6 * 3600, resume + 60, 1800, rows, ROWS_MAX);
+    CHECK(count == 7);
+    Test_Compare(1, resume - 6 * 3600, resume + 60, 1800);
+}
+
+// Перевод часов назад на 2 часа: история уровней 1 и 30 мин начинается
+// заново, суточный интервал тот же и продолжает накапливаться
+static void Test_ClockBack(void)
+{
+    uint32_t first;
+
+    Test_Init();
+    for(uint32_t t = T0; t < T0 + 3 * 3600; t += SAMPLE_PERIOD)
+    {
+        Test_Add(t, 20.0f, 50.0f);
+    }
+    Test_Add(T0 + 3600, 25.0f, 40.0f);
+    for(uint32_t i = 0; i < 2; i++)
+    {
+        CHECK(Ring_Snapshot(&tiers[i].ring, &first) == 0);
+        CHECK(Rollup_Query(&tiers[i], 0, 0xFFFFFFFFUL, 1, rows, ROWS_MAX) == 1);
+        CHECK(rows[0].count == 1 && rows[0].min[0] == 250 && rows[0].max[1] == 400);
+    }
+    CHECK(Rollup_Query(&tiers[2], 0, 0xFFFFFFFFUL, DAY, rows, ROWS_MAX) == 1);
+    CHECK(rows[0].count == 3 * 3600 / SAMPLE_PERIOD + 1);
+    CHECK(rows[0].max[0] == 250 && rows[0].min[1] == 400);
+}
+
+// Год показаний раз в 5 с одной строкой: сумма строки больше int32
+static void Test_Year(void)
+{
+    static Rollup_BucketTypeDef year_storage[400];
+    Rollup_TierTypeDef tier;
+    float values[ROLLUP_CHANNELS] = { 22.0f, 60.0f };
+    uint32_t days = 365;
+    uint32_t count;
+
+    Rollup_TierInit(&tier, DAY, year_storage, 400);
+    for(uint32_t t = T0; t < T0 + days * DAY; t += SAMPLE_PERIOD)
+    {
+        Rollup_Add(&tier, t, values);
+    }
+
+    count = Rollup_Query(&tier, T0, T0 + days * DAY, days * DAY, rows, ROWS_MAX);
+    CHECK(count == 1);
+    CHECK(rows[0].count == days * DAY / SAMPLE_PERIOD);
+    CHECK(rows[0].sum[1] > INT32_MAX);
+    CHECK(rows[0].sum[0] / rows[0].count == 220);
+    CHECK(rows[0].sum[1] / rows[0].count == 600);
+    CHECK(rows[0].min[1] == 600 && rows[0].max[1] == 600);
+}
+
+int main(void)
+{
+    Test_Days();
+    Test_Gaps();
+    Test_ClockBack();
+    Test_Year();
+
+    printf("rollup_test: %s\n", failures ? "FAILED" : "passed");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,59 @@
+#!/bin/sh
+# run_tests.sh
+# Проверки модулей прошивки на Linux. Модули собираются из STM32/Core/Src
+# без изменений, вместо HAL, CMSIS-RTOS2 и FreeRTOS - заглушки из stub/.
+# Модель ESP (esp_emulator.c) и другие файлы проверок берутся из этого
+# каталога. Каждая проверка - отдельная программа, код возврата 0 - успех.
+#
+# Запуск:  ./run_tests.sh [проверка...]   (по умолчанию - все)
+cd "$(dirname "$0")" || exit 1
+SRC=../../STM32/Core/Src
+CFLAGS="-O2 -Wall -Wno-pointer-to-int-cast -Istub -I../../STM32/Core/Inc"
+ONLY="$*"
+FAILED=""
+
+mkdir -p build
+
+# run имя исходники... - сборка name.c с модулями и запуск. Исходник
+# ищется в этом каталоге, затем среди модулей прошивки
+run()
+{
+    name=$1
+    shift
+    if [ -n "$ONLY" ] && ! echo " $ONLY " | grep -q " $name "; then
+        return
+    fi
+
+    sources="stub/os_stub.c"
+    for file in "$@"; do
+        if [ -f "$file" ]; then
+            sources="$sources $file"
+        else
+            sources="$sources $SRC/$file"
+        fi
+    done
+
+    echo "== $name"
+    if ! gcc $CFLAGS -o "build/$name" "$name.c" $sources -lm -pthread; then
+        FAILED="$FAILED $name"
+    elif ! "./build/$name"; then
+        FAILED="$FAILED $name"
+    fi
+}
+
+run lttb_test lttb.c
+run at_parser_test at_parser.c
+run http_cache_test http_cache.c
+run ring_buffer_test ring_buffer.c
+run flash_log_test flash_log.c crc32.c
+run rollup_test rollup.c ring_buffer.c
+run history_codec_test history_codec.c
+run esp_setup_test esp_emulator.c esp_setup.c at_engine.c at_parser.c mem_pool.c
+run esp_server_test esp_emulator.c esp_server.c at_engine.c at_parser.c mem_pool.c
+run mqtt_client_test esp_emulator.c mqtt_client.c at_engine.c at_parser.c
+
+if [ -n "$FAILED" ]; then
+    echo "FAILED:$FAILED"
+    exit 1
+fi
+echo "all passed"
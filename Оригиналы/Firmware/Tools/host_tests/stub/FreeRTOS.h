@@ -0,0 +1,36 @@
+// FreeRTOS.h
+// Заглушка FreeRTOS для проверок на Linux: типы статических объектов
+#ifndef INC_FREERTOS_H
+#define INC_FREERTOS_H
+
+#include <stdint.h>
+
+#define configMAX_TASK_NAME_LEN 16
+
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+typedef uint32_t StackType_t;
+typedef void* TaskHandle_t;
+
+// Очередь заглушки: копии элементов по кругу во внешней памяти
+typedef struct {
+    uint8_t *storage;
+    uint32_t capacity;
+    uint32_t element_size;
+    uint32_t head;
+    uint32_t count;
+} StaticQueue_t;
+
+typedef struct {
+    uint32_t flags;
+} StaticEventGroup_t;
+
+typedef struct {
+    uint32_t count;
+} StaticSemaphore_t;
+
+typedef struct {
+    uint32_t period;
+} StaticTimer_t;
+
+#endif /* INC_FREERTOS_H */
@@ -0,0 +1,61 @@
+// cmsis_os.h
+// Заглушка CMSIS-RTOS2 для проверок на Linux. Проверки однопоточные:
+// время идет только по Stub_Advance и ожиданиям, ожидание вызывает
+// stub_idle - проверка может продвинуть эмулятор до следующего события
+#ifndef CMSIS_OS_H_
+#define CMSIS_OS_H_
+
+#include <stdint.h>
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define osWaitForever 0xFFFFFFFFU
+#define osFlagsWaitAny 0x00000000U
+#define osFlagsWaitAll 0x00000001U
+#define osFlagsNoClear 0x00000002U
+
+typedef enum {
+    osOK = 0,
+    osError = -1,
+    osErrorTimeout = -2,
+    osErrorResource = -3
+} osStatus_t;
+
+typedef void* osThreadId_t;
+typedef StaticQueue_t* osMessageQueueId_t;
+typedef StaticEventGroup_t* osEventFlagsId_t;
+
+typedef struct {
+    const char *name;
+    uint32_t attr_bits;
+    void *cb_mem;
+    uint32_t cb_size;
+    void *mq_mem;
+    uint32_t mq_size;
+} osMessageQueueAttr_t;
+
+// Текущее время заглушки и ожидание: timeout - наибольшее ожидание, мс
+extern uint32_t stub_tick;
+extern void (*stub_idle)(uint32_t timeout);
+void Stub_Advance(uint32_t us);
+
+uint32_t osKernelGetTickCount(void);
+int32_t osKernelLock(void);
+int32_t osKernelUnlock(void);
+osStatus_t osDelay(uint32_t ticks);
+
+osThreadId_t osThreadGetId(void);
+uint32_t osThreadFlagsSet(osThreadId_t thread, uint32_t flags);
+uint32_t osThreadFlagsClear(uint32_t flags);
+uint32_t osThreadFlagsWait(uint32_t flags, uint32_t options, uint32_t timeout);
+
+osMessageQueueId_t osMessageQueueNew(uint32_t count, uint32_t size, const osMessageQueueAttr_t *attr);
+osStatus_t osMessageQueuePut(osMessageQueueId_t queue, const void *element, uint8_t priority, uint32_t timeout);
+osStatus_t osMessageQueueGet(osMessageQueueId_t queue, void *element, uint8_t *priority, uint32_t timeout);
+uint32_t osMessageQueueGetCount(osMessageQueueId_t queue);
+uint32_t osMessageQueueGetSpace(osMessageQueueId_t queue);
+
+uint32_t osEventFlagsSet(osEventFlagsId_t event, uint32_t flags);
+uint32_t osEventFlagsWait(osEventFlagsId_t event, uint32_t flags, uint32_t options, uint32_t timeout);
+
+#endif /* CMSIS_OS_H_ */
@@ -0,0 +1,171 @@
+/*
+ * os_stub.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// os_stub.c
+// Заглушки HAL, CMSIS-RTOS2 и журнала трассировки для однопоточных
+// проверок на Linux. Поток один, поэтому блокировки пустые, а ожидание
+// флагов только продвигает время
+#include <stdlib.h>
+#include <string.h>
+#include "cmsis_os.h"
+#include "stm32f4xx_hal.h"
+#include "trace.h"
+
+uint32_t stub_tick = 1;
+DWT_Type stub_dwt;
+static uint32_t stub_us;
+static uint32_t stub_thread_flags;
+static uint8_t stub_thread;
+
+// По умолчанию ожидание длится 1 мс
+static void Stub_IdleDefault(uint32_t timeout)
+{
+    if(timeout > 0)
+    {
+        Stub_Advance(1000);
+    }
+}
+
+void (*stub_idle)(uint32_t timeout) = Stub_IdleDefault;
+
+/**
+  * @brief Продвижение времени заглушки, мкс
+  */
+void Stub_Advance(uint32_t us)
+{
+    stub_us += us;
+    stub_tick += stub_us / 1000;
+    stub_us %= 1000;
+    stub_dwt.CYCCNT += us * 168;
+}
+
+uint32_t HAL_GetTick(void)
+{
+    return stub_tick;
+}
+
+uint32_t osKernelGetTickCount(void)
+{
+    return stub_tick;
+}
+
+int32_t osKernelLock(void)
+{
+    return 0;
+}
+
+int32_t osKernelUnlock(void)
+{
+    return 0;
+}
+
+osStatus_t osDelay(uint32_t ticks)
+{
+    Stub_Advance(ticks * 1000);
+    return osOK;
+}
+
+osThreadId_t osThreadGetId(void)
+{
+    return &stub_thread;
+}
+
+uint32_t osThreadFlagsSet(osThreadId_t thread, uint32_t flags)
+{
+    stub_thread_flags |= flags;
+    return stub_thread_flags;
+}
+
+uint32_t osThreadFlagsClear(uint32_t flags)
+{
+    uint32_t previous = stub_thread_flags;
+    stub_thread_flags &= ~flags;
+    return previous;
+}
+
+uint32_t osThreadFlagsWait(uint32_t flags, uint32_t options, uint32_t timeout)
+{
+    if(!(stub_thread_flags & flags))
+    {
+        stub_idle(timeout);
+    }
+    uint32_t result = stub_thread_flags & flags;
+    stub_thread_flags &= ~result;
+    return result;
+}
+
+osMessageQueueId_t osMessageQueueNew(uint32_t count, uint32_t size, const osMessageQueueAttr_t *attr)
+{
+    StaticQueue_t *queue = (attr && attr->cb_mem) ? attr->cb_mem : calloc(1, sizeof(StaticQueue_t));
+
+    queue->storage = (attr && attr->mq_mem) ? attr->mq_mem : calloc(count, size);
+    queue->capacity = count;
+    queue->element_size = size;
+    queue->head = 0;
+    queue->count = 0;
+    return queue;
+}
+
+osStatus_t osMessageQueuePut(osMessageQueueId_t queue, const void *element, uint8_t priority, uint32_t timeout)
+{
+    if(queue->count == queue->capacity)
+        return osErrorResource;
+
+    uint32_t index = (queue->head + queue->count) % queue->capacity;
+    memcpy(queue->storage + index * queue->element_size, element, queue->element_size);
+    queue->count++;
+    return osOK;
+}
+
+osStatus_t osMessageQueueGet(osMessageQueueId_t queue, void *element, uint8_t *priority, uint32_t timeout)
+{
+    if(queue->count == 0)
+        return osErrorResource;
+
+    memcpy(element, queue->storage + queue->head * queue->element_size, queue->element_size);
+    queue->head = (queue->head + 1) % queue->capacity;
+    queue->count--;
+    return osOK;
+}
+
+uint32_t osMessageQueueGetCount(osMessageQueueId_t queue)
+{
+    return queue->count;
+}
+
+uint32_t osMessageQueueGetSpace(osMessageQueueId_t queue)
+{
+    return queue->capacity - queue->count;
+}
+
+uint32_t osEventFlagsSet(osEventFlagsId_t event, uint32_t flags)
+{
+    if(event == NULL)
+        return flags;
+
+    event->flags |= flags;
+    return event->flags;
+}
+
+uint32_t osEventFlagsWait(osEventFlagsId_t event, uint32_t flags, uint32_t options, uint32_t timeout)
+{
+    if(event == NULL || !(event->flags & flags))
+    {
+        stub_idle(timeout);
+    }
+    if(event == NULL)
+        return 0;
+
+    uint32_t result = event->flags & flags;
+    event->flags &= ~result;
+    return result;
+}
+
+// Журнал трассировки в проверках не ведется
+void Trace_Record(uint8_t type, uint8_t id, uint16_t arg)
+{
+}
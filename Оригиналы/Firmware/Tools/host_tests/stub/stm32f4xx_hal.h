@@ -0,0 +1,28 @@
+// stm32f4xx_hal.h
+// Заглушка HAL для проверок модулей на Linux: только то, что используют
+// модули без доступа к периферии (тики, счетчик тактов DWT, барьеры)
+#ifndef __STM32F4xx_HAL_H
+#define __STM32F4xx_HAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum {
+    HAL_OK = 0,
+    HAL_ERROR,
+    HAL_BUSY,
+    HAL_TIMEOUT
+} HAL_StatusTypeDef;
+
+typedef struct {
+    volatile uint32_t CYCCNT;
+} DWT_Type;
+
+extern DWT_Type stub_dwt;
+#define DWT (&stub_dwt)
+
+#define __DMB() __sync_synchronize()
+
+uint32_t HAL_GetTick(void);
+
+#endif /* __STM32F4xx_HAL_H */
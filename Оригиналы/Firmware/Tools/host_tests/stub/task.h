@@ -0,0 +1,14 @@
+// task.h
+// Заглушка FreeRTOS для проверок на Linux: проверки однопоточные,
+// критические секции пустые
+#ifndef INC_TASK_H
+#define INC_TASK_H
+
+#include "FreeRTOS.h"
+
+#define taskENTER_CRITICAL_FROM_ISR() 0
+#define taskEXIT_CRITICAL_FROM_ISR(x) ((void)(x))
+#define taskENTER_CRITICAL()
+#define taskEXIT_CRITICAL()
+
+#endif /* INC_TASK_H */
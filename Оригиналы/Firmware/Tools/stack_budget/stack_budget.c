@@ -0,0 +1,412 @@
+/*
+ * stack_budget.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// stack_budget.c
+// Оценка худшего случая стека задач (Linux). Читает графы вызовов .ci,
+// которые gcc создает с -fstack-usage -fcallgraph-info=su, и для каждой
+// точки входа ищет самую глубокую цепочку вызовов по размерам кадров.
+//
+// Функции без .ci (newlib: snprintf, strtof...) учитываются оценкой -f имя=байт
+// или общей оценкой -u, косвенные вызовы - по ребрам -e вызывающая=вызываемая.
+// Рекурсия, неописанные косвенные вызовы и кадры переменного размера
+// выводятся как предупреждения (-v).
+// К цепочке добавляется кадр исключения и сохраненный контекст задачи -c.
+//
+// Сборка:  gcc -O2 -Wall -o stack_budget stack_budget.c
+// Запуск:  ./stack_budget -v -r StartATEngine -e AT_Parser_Dispatch=ESP_Server_OnLine
+//              -f snprintf=400 $(find Debug -name '*.ci')
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NODE_COUNT 8192
+#define EDGE_COUNT 32768
+#define ROOT_COUNT 64
+#define NAME_SIZE 160
+#define LINE_SIZE 1024
+
+// Кадр исключения с контекстом FPU (26 слов) и контекст, который порт
+// FreeRTOS сохраняет на стеке вытесненной задачи (r4-r11, lr, s16-s31)
+#define CONTEXT_BYTES (26 * 4 + 25 * 4)
+
+// Оценка кадров функций библиотеки, для которых нет .ci и -f
+#define UNKNOWN_BYTES 64
+
+typedef enum {
+    NODE_NEW = 0,
+    NODE_ACTIVE,  // На пути обхода - повторный вход означает рекурсию
+    NODE_DONE
+} NodeStateTypeDef;
+
+typedef struct {
+    char title[NAME_SIZE];  // Имя функции, у static - "файл:имя"
+    long frame;             // Байт собственного кадра, -1 - нет .ci
+    int dynamic;            // Кадр зависит от alloca/VLA
+    int first_edge;
+    NodeStateTypeDef state;
+    long depth;             // Худший стек от входа в функцию
+    int next;               // Следующая функция самой глубокой цепочки
+    int recursive;
+    int indirect;           // Есть косвенный вызов
+    int described;          // Цели косвенных вызовов заданы -e
+} Node;
+
+typedef struct {
+    int from;
+    int to;
+    int next;
+} Edge;
+
+static Node nodes[NODE_COUNT];
+static int node_count;
+static Edge edges[EDGE_COUNT];
+static int edge_count;
+static long unknown_bytes = UNKNOWN_BYTES;
+
+static const char* Short_Name(const char *title)
+{
+    const char *colon = strrchr(title, ':');
+    return colon ? colon + 1 : title;
+}
+
+static int Find_Node(const char *title)
+{
+    for(int i = 0; i < node_count; i++)
+    {
+        if(strcmp(nodes[i].title, title) == 0)
+            return i;
+    }
+    return -1;
+}
+
+static int Add_Node(const char *title)
+{
+    int index = Find_Node(title);
+    if(index >= 0)
+        return index;
+
+    if(node_count == NODE_COUNT)
+    {
+        fprintf(stderr, "too many functions\n");
+        exit(1);
+    }
+    index = node_count++;
+    snprintf(nodes[index].title, NAME_SIZE, "%s", title);
+    nodes[index].frame = -1;
+    nodes[index].first_edge = -1;
+    nodes[index].next = -1;
+    return index;
+}
+
+// Поиск по полному имени, затем по имени без файла (static функции)
+static int Resolve(const char *name)
+{
+    int index = Find_Node(name);
+    if(index >= 0)
+        return index;
+
+    for(int i = 0; i < node_count; i++)
+    {
+        if(strcmp(Short_Name(nodes[i].title), name) == 0 && nodes[i].frame >= 0)
+            return i;
+    }
+    return -1;
+}
+
+static void Add_Edge(int from, int to)
+{
+    for(int e = nodes[from].first_edge; e >= 0; e = edges[e].next)
+    {
+        if(edges[e].to == to)
+            return;
+    }
+    if(edge_count == EDGE_COUNT)
+    {
+        fprintf(stderr, "too many calls\n");
+        exit(1);
+    }
+    edges[edge_count].from = from;
+    edges[edge_count].to = to;
+    edges[edge_count].next = nodes[from].first_edge;
+    nodes[from].first_edge = edge_count++;
+}
+
+// Значение поля "key: "..."" строки графа VCG
+static int Field(const char *line, const char *key, char *value, size_t size)
+{
+    const char *p = strstr(line, key);
+    if(p == NULL)
+        return 0;
+
+    p += strlen(key);
+    const char *end = strchr(p, '"');
+    if(end == NULL)
+        return 0;
+
+    size_t length = (size_t)(end - p);
+    if(length >= size)
+    {
+        length = size - 1;
+    }
+    memcpy(value, p, length);
+    value[length] = '\0';
+    return 1;
+}
+
+static void Load(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    char line[LINE_SIZE];
+    char title[NAME_SIZE];
+    char target[NAME_SIZE];
+    char label[LINE_SIZE];
+
+    if(file == NULL)
+    {
+        perror(path);
+        exit(1);
+    }
+
+    while(fgets(line, sizeof(line), file))
+    {
+        if(strncmp(line, "node:", 5) == 0 && Field(line, "title: \"", title, sizeof(title)))
+        {
+            int index = Add_Node(title);
+            const char *bytes;
+
+            // Метка определенной функции: "имя\nфайл:строка\nN bytes (static)"
+            if(Field(line, "label: \"", label, sizeof(label)) &&
+               (bytes = strstr(label, " bytes (")) != NULL)
+            {
+                const char *number = bytes;
+                while(number > label && number[-1] >= '0' && number[-1] <= '9')
+                {
+                    number--;
+                }
+                nodes[index].frame = strtol(number, NULL, 10);
+                nodes[index].dynamic = strstr(bytes, "dynamic") != NULL;
+            }
+        }
+        else if(strncmp(line, "edge:", 5) == 0 &&
+                Field(line, "sourcename: \"", title, sizeof(title)) &&
+                Field(line, "targetname: \"", target, sizeof(target)))
+        {
+            Add_Edge(Add_Node(title), Add_Node(target));
+        }
+    }
+    fclose(file);
+}
+
+static long Depth(int index)
+{
+    Node *node = &nodes[index];
+
+    if(node->state == NODE_DONE)
+        return node->depth;
+    if(node->state == NODE_ACTIVE)
+    {
+        node->recursive = 1;
+        return 0;
+    }
+
+    node->state = NODE_ACTIVE;
+    long deepest = 0;
+    for(int e = node->first_edge; e >= 0; e = edges[e].next)
+    {
+        int callee = edges[e].to;
+
+        if(strcmp(nodes[callee].title, "__indirect_call") == 0)
+        {
+            node->indirect = 1;
+            continue;
+        }
+
+        long depth = Depth(callee);
+        if(depth > deepest)
+        {
+            deepest = depth;
+            node->next = callee;
+        }
+    }
+    node->state = NODE_DONE;
+    node->depth = (node->frame >= 0 ? node->frame : unknown_bytes) + deepest;
+    return node->depth;
+}
+
+// Предупреждения по всем функциям, достижимым из точки входа
+static void Warnings(int index, char *seen)
+{
+    if(seen[index])
+        return;
+    seen[index] = 1;
+
+    const Node *node = &nodes[index];
+    if(node->recursive)
+        printf("    recursion:     %s\n", node->title);
+    if(node->indirect && !node->described)
+        printf("    indirect call: %s (add -e %s=<callee>)\n", node->title, Short_Name(node->title));
+    if(node->dynamic)
+        printf("    dynamic frame: %s\n", node->title);
+
+    for(int e = node->first_edge; e >= 0; e = edges[e].next)
+    {
+        int callee = edges[e].to;
+        if(strcmp(nodes[callee].title, "__indirect_call") != 0)
+            Warnings(callee, seen);
+    }
+}
+
+static void Report(int root, long context, int verbose)
+{
+    long depth = Depth(root);
+
+    printf("%-28s %6ld bytes (%ld + context %ld)\n", Short_Name(nodes[root].title),
+           depth + context, depth, context);
+
+    for(int i = root; i >= 0; i = nodes[i].next)
+    {
+        if(nodes[i].frame >= 0)
+            printf("    %6ld  %s\n", nodes[i].frame, nodes[i].title);
+        else
+            printf("    %6ld? %s\n", unknown_bytes, nodes[i].title);
+    }
+
+    if(verbose)
+    {
+        char *seen = calloc(node_count, 1);
+        Warnings(root, seen);
+        free(seen);
+    }
+    printf("\n");
+}
+
+int main(int argc, char **argv)
+{
+    const char *roots[ROOT_COUNT];
+    const char *extra[EDGE_COUNT / 16];
+    const char *frames[ROOT_COUNT];
+    int root_count = 0;
+    int extra_count = 0;
+    int frame_count = 0;
+    long context = CONTEXT_BYTES;
+    int verbose = 0;
+    int opt;
+
+    while((opt = getopt(argc, argv, "r:e:f:u:c:v")) != -1)
+    {
+        switch(opt)
+        {
+        case 'r':
+            if(root_count < ROOT_COUNT)
+                roots[root_count++] = optarg;
+            break;
+        case 'e':
+            if(extra_count < EDGE_COUNT / 16)
+                extra[extra_count++] = optarg;
+            break;
+        case 'f':
+            if(frame_count < ROOT_COUNT)
+                frames[frame_count++] = optarg;
+            break;
+        case 'u': unknown_bytes = atol(optarg); break;
+        case 'c': context = atol(optarg); break;
+        case 'v': verbose = 1; break;
+        default:
+            fprintf(stderr, "usage: %s [-r entry]... [-e caller=callee]... [-f function=bytes]... "
+                            "[-u unknown-bytes] [-c context-bytes] [-v] file.ci...\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if(optind == argc)
+    {
+        fprintf(stderr, "no .ci files (compile with -fstack-usage -fcallgraph-info=su)\n");
+        return 2;
+    }
+    for(int i = optind; i < argc; i++)
+    {
+        Load(argv[i]);
+    }
+
+    // Косвенные вызовы, описанные вручную
+    for(int i = 0; i < extra_count; i++)
+    {
+        char caller[NAME_SIZE];
+        const char *callee = strchr(extra[i], '=');
+        int from, to;
+
+        if(callee == NULL || (size_t)(callee - extra[i]) >= sizeof(caller))
+        {
+            fprintf(stderr, "bad edge: %s\n", extra[i]);
+            return 2;
+        }
+        memcpy(caller, extra[i], callee - extra[i]);
+        caller[callee - extra[i]] = '\0';
+        callee++;
+
+        // static функция, встроенная оптимизатором, в графе отсутствует -
+        // ее косвенный вызов описывается ребром от функции, куда она встроена
+        if((from = Resolve(caller)) < 0 || (to = Resolve(callee)) < 0)
+        {
+            fprintf(stderr, "edge skipped (no such function, inlined?): %s\n", extra[i]);
+            continue;
+        }
+        Add_Edge(from, to);
+        nodes[from].described = 1;
+    }
+
+    // Оценки функций без .ci
+    for(int i = 0; i < frame_count; i++)
+    {
+        const char *bytes = strchr(frames[i], '=');
+        char name[NAME_SIZE];
+        int index;
+
+        if(bytes == NULL || (size_t)(bytes - frames[i]) >= sizeof(name))
+        {
+            fprintf(stderr, "bad frame: %s\n", frames[i]);
+            return 2;
+        }
+        memcpy(name, frames[i], bytes - frames[i]);
+        name[bytes - frames[i]] = '\0';
+
+        if((index = Find_Node(name)) >= 0 && nodes[index].frame < 0)
+        {
+            nodes[index].frame = atol(bytes + 1);
+        }
+    }
+
+    if(root_count == 0)
+    {
+        // Без -r - все функции, которые никто не вызывает
+        char *called = calloc(node_count, 1);
+        for(int e = 0; e < edge_count; e++)
+        {
+            called[edges[e].to] = 1;
+        }
+        for(int i = 0; i < node_count; i++)
+        {
+            if(!called[i] && nodes[i].frame >= 0)
+                Report(i, context, verbose);
+        }
+        free(called);
+        return 0;
+    }
+
+    for(int i = 0; i < root_count; i++)
+    {
+        int root = Resolve(roots[i]);
+        if(root < 0)
+        {
+            fprintf(stderr, "unknown entry: %s\n", roots[i]);
+            return 2;
+        }
+        Report(root, context, verbose);
+    }
+    return 0;
+}
@@ -0,0 +1,74 @@
+#!/bin/sh
+# stack_budget.sh
+# Худший случай стека потоков прошивки по графам вызовов сборки Debug
+# (-fstack-usage -fcallgraph-info=su). Бюджеты задаются в .ioc (Tasks01)
+# и configTIMER_TASK_STACK_DEPTH, наименьший запас во время работы - /debug/memory.
+#
+# Бюджет потока - худший путь по сборкам Debug и Release для ARM с запасом
+# не менее 25%, округленный до 256 байт. После изменения цепочек вызовов или
+# буферов на стеке бюджеты пересчитываются, худший путь и запас каждого
+# потока записываются в сообщение коммита.
+#
+# Запуск:  ./stack_budget.sh [каталог сборки, по умолчанию ../../STM32/Debug]
+cd "$(dirname "$0")" || exit 1
+BUILD=${1:-../../STM32/Debug}
+
+# Точки входа: потоки и служба таймеров (обработчики вызываются из нее)
+ROOTS="-r StartReadRS485 -r StartControlPIDTemp -r StartControlPIDHum
+       -r StartExchangeATCommand -r StartWebInterface -r StartATEngine
+       -r prvTimerTask"
+
+# Косвенные вызовы: обработчики разборщика AT, завершение команд движка,
+# генераторы кэша HTTP, ответы из отдельных буферов (история, трассировка),
+# источники точек LTTB, порты журнала во flash, настройки ESP, обработчики
+# таймеров CMSIS-RTOS2 и функции, отложенные в службу таймеров. Ребра от
+# static функций, встроенных в Release (-Os), повторены для функции, в которую
+# они встраиваются; отсутствующие в графе пропускаются
+EDGES="-e AT_Parser_Dispatch=AT_Engine_OnLine -e AT_Parser_Dispatch=ESP_Server_OnLink
+       -e AT_Parser_Dispatch=ESP_Server_OnNotify -e AT_Parser_Dispatch=MQTT_Client_OnDisconnected
+       -e AT_Parser_Dispatch=UDP_Beacon_OnClosed -e AT_Parser_Input=ESP_Server_OnData
+       -e AT_Engine_Complete=ESP_Server_OnReceived -e AT_Engine_Complete=ESP_Server_OnSent
+       -e AT_Engine_Complete=UDP_Beacon_OnOpened -e AT_Engine_Complete=UDP_Beacon_OnSent
+       -e AT_Engine_Complete=CWLIF_Done -e AT_Engine_Complete=MQTT_Client_OnConfigured
+       -e AT_Engine_Complete=MQTT_Client_OnConnected
+       -e AT_Engine_OnLine=Send_AT_Data -e AT_Engine_Process=Send_AT_Data
+       -e AT_Engine_Execute=ESP_RX_Poll -e ESP_Server_Process=Queue_HTTP_Request
+       -e ESP_Link_ReleaseResponse=HTTP_Cache_Sent -e ESP_Server_Respond=HTTP_Cache_Sent
+       -e ESP_Link_ReleaseResponse=Trace_Sent -e ESP_Server_Respond=Trace_Sent
+       -e ESP_Link_ReleaseResponse=History_Sent -e ESP_Server_Respond=History_Sent
+       -e HTTP_Cache_Get=Generate_HTML_Page -e HTTP_Cache_Get=Generate_JSON_Data
+       -e LTTB_Downsample=History_TemperaturePoint -e LTTB_Downsample=History_HumidityPoint
+       -e History_AppendSeries=History_TemperaturePoint -e History_AppendSeries=History_HumidityPoint
+       -e FlashLog_Flush=FlashLogPort_Program -e FlashLog_Activate=FlashLogPort_Erase
+       -e FlashLog_Activate=FlashLogPort_Program
+       -e ESP_Setup_SetBaudrate=ESP_UART_SetBaudrate -e ESP_Setup_CheckUart=ESP_UART_Errors
+       -e ESP_Setup_Negotiate=ESP_UART_SetBaudrate -e ESP_Setup_Negotiate=ESP_UART_Errors
+       -e prvTimerTask=TimerCallback -e prvProcessExpiredTimer=TimerCallback
+       -e prvSampleTimeNow=TimerCallback -e prvSwitchTimerLists=TimerCallback
+       -e prvProcessReceivedCommands=TimerCallback -e TimerCallback=UDP_Beacon_Timer
+       -e TimerCallback=TaskStats_Timer -e prvTimerTask=vEventGroupSetBitsCallback
+       -e prvProcessReceivedCommands=vEventGroupSetBitsCallback"
+
+# Оценки newlib-nano (printf с float), библиотека собрана без .su
+FRAMES="-f snprintf=400 -f vsnprintf=400 -f sscanf=400 -f strtof=160 -f atof=160
+        -f strtol=64 -f strtoul=64 -f atoi=64"
+
+# Размеры кадров (.su) зависят от архитектуры: граф сборки для другой
+# машины дает другие числа, поэтому принимаются только объекты ARM
+OBJECTS=$(find "$BUILD" -name '*.o')
+[ -n "$OBJECTS" ] || { echo "stack_budget: в $BUILD нет объектов сборки" >&2; exit 1; }
+for object in $OBJECTS; do
+    if command -v readelf >/dev/null 2>&1; then
+        machine=$(readelf -h "$object" 2>/dev/null | sed -n 's/^ *Machine: *//p')
+    else
+        machine=$(file -b "$object" | cut -d, -f2)
+    fi
+    case "$machine" in
+        *ARM*) ;;
+        *) echo "stack_budget: $object - не объект ARM (${machine:-неизвестно})" >&2; exit 1 ;;
+    esac
+done
+
+[ -x ./stack_budget ] || gcc -O2 -Wall -o stack_budget stack_budget.c || exit 1
+
+exec ./stack_budget -v $ROOTS $EDGES $FRAMES $(find "$BUILD" -name '*.ci')
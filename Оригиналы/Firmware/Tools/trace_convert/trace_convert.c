@@ -0,0 +1,338 @@
+/*
+ * trace_convert.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// trace_convert.c
+// Преобразование дампа журнала трассировки (GET /debug/trace, формат
+// trace.h) в Chrome trace-event JSON для chrome://tracing или Perfetto (Linux).
+//
+// Дорожки: потоки (выполнение от переключения до следующего), прерывания,
+// команды AT и обмен Modbus, HTTP запросы по link ID. Время - такты
+// DWT->CYCCNT, переполнение счетчика (25 с при 168 МГц) учитывается
+// между соседними событиями.
+//
+// Сборка:  gcc -O2 -Wall -o trace_convert trace_convert.c
+// Запуск:  curl -o trace.bin http://192.168.4.1/debug/trace
+//          ./trace_convert trace.bin > trace.json
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_MAGIC 0x31435254U
+#define TRACE_VERSION 1
+#define TRACE_HEADER_SIZE 20
+#define TRACE_NAME_SIZE 14
+#define TRACE_NAME_RECORD 16
+#define TRACE_EVENT_SIZE 8
+#define NAME_COUNT 32
+
+enum {
+    TRACE_TASK_SWITCH = 1,
+    TRACE_ISR_ENTER,
+    TRACE_ISR_EXIT,
+    TRACE_AT_START,
+    TRACE_AT_END,
+    TRACE_MODBUS_START,
+    TRACE_MODBUS_END,
+    TRACE_HTTP_CONNECT,
+    TRACE_HTTP_REQUEST,
+    TRACE_HTTP_RESPOND,
+    TRACE_HTTP_SENT,
+    TRACE_HTTP_CLOSE
+};
+
+enum {
+    TRACE_NAME_TASK = 1,
+    TRACE_NAME_IRQ,
+    TRACE_NAME_AT
+};
+
+// Процессы в просмотрщике
+enum {
+    PID_TASKS = 1,
+    PID_IRQ,
+    PID_IO,
+    PID_HTTP
+};
+
+// Дорожки процесса PID_IO
+#define TID_AT 1
+#define TID_MODBUS 2
+
+static const char *at_status[] = { "pending", "ok", "error", "timeout" };
+
+typedef struct {
+    uint8_t kind;
+    uint8_t id;
+    char name[TRACE_NAME_SIZE + 1];
+} Name;
+
+static Name names[NAME_COUNT];
+static unsigned name_count;
+static int first_event = 1;
+
+static uint16_t Get16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static uint32_t Get32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static const char* Find_Name(uint8_t kind, uint8_t id, char *fallback, size_t size)
+{
+    for(unsigned i = 0; i < name_count; i++)
+    {
+        if(names[i].kind == kind && names[i].id == id)
+            return names[i].name;
+    }
+    snprintf(fallback, size, "%s %u",
+             kind == TRACE_NAME_TASK ? "task" : kind == TRACE_NAME_IRQ ? "irq" : "at", id);
+    return fallback;
+}
+
+// Одно событие JSON; args - готовый объект или NULL
+static void Emit(const char *phase, int pid, int tid, double us, const char *name, const char *args)
+{
+    printf("%s\n{\"ph\":\"%s\",\"pid\":%d,\"tid\":%d,\"ts\":%.3f", first_event ? "" : ",",
+           phase, pid, tid, us);
+    if(name)
+        printf(",\"name\":\"%s\"", name);
+    if(phase[0] == 'i')
+        printf(",\"s\":\"t\"");
+    if(args)
+        printf(",\"args\":%s", args);
+    printf("}");
+    first_event = 0;
+}
+
+static void Emit_Meta(const char *what, int pid, int tid, const char *name)
+{
+    printf("%s\n{\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"name\":\"%s\",\"args\":{\"name\":\"%s\"}}",
+           first_event ? "" : ",", pid, tid, what, name);
+    first_event = 0;
+}
+
+int main(int argc, char **argv)
+{
+    if(argc != 2)
+    {
+        fprintf(stderr, "usage: %s trace.bin > trace.json\n", argv[0]);
+        return 2;
+    }
+
+    FILE *file = fopen(argv[1], "rb");
+    if(file == NULL)
+    {
+        perror(argv[1]);
+        return 1;
+    }
+
+    uint8_t header[TRACE_HEADER_SIZE];
+    if(fread(header, 1, sizeof(header), file) != sizeof(header) || Get32(header) != TRACE_MAGIC)
+    {
+        fprintf(stderr, "%s: not a trace dump\n", argv[1]);
+        return 1;
+    }
+    if(Get16(header + 4) != TRACE_VERSION)
+    {
+        fprintf(stderr, "%s: unsupported version %u\n", argv[1], Get16(header + 4));
+        return 1;
+    }
+
+    unsigned dump_names = Get16(header + 6);
+    double cycles_per_us = Get32(header + 8) / 1e6;
+    uint32_t head = Get32(header + 12);
+    uint32_t capacity = Get32(header + 16);
+
+    // Таблица имен фиксированного размера, заполнено dump_names записей
+    uint8_t record[TRACE_NAME_RECORD];
+    for(unsigned i = 0; i < NAME_COUNT; i++)
+    {
+        if(fread(record, 1, sizeof(record), file) != sizeof(record))
+        {
+            fprintf(stderr, "%s: truncated name table\n", argv[1]);
+            return 1;
+        }
+        if(i < dump_names)
+        {
+            names[name_count].kind = record[0];
+            names[name_count].id = record[1];
+            memcpy(names[name_count].name, record + 2, TRACE_NAME_SIZE);
+            name_count++;
+        }
+    }
+
+    uint8_t *events = malloc((size_t)capacity * TRACE_EVENT_SIZE);
+    if(events == NULL ||
+       fread(events, TRACE_EVENT_SIZE, capacity, file) != capacity)
+    {
+        fprintf(stderr, "%s: truncated event ring\n", argv[1]);
+        return 1;
+    }
+    fclose(file);
+
+    // Кольцо: самое старое событие - head % capacity, если кольцо заполнено
+    uint32_t count = head < capacity ? head : capacity;
+    uint32_t first = head - count;
+
+    printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    Emit_Meta("process_name", PID_TASKS, 0, "tasks");
+    Emit_Meta("process_name", PID_IRQ, 0, "interrupts");
+    Emit_Meta("process_name", PID_IO, 0, "exchange");
+    Emit_Meta("process_name", PID_HTTP, 0, "http links");
+    Emit_Meta("thread_name", PID_IO, TID_AT, "AT commands");
+    Emit_Meta("thread_name", PID_IO, TID_MODBUS, "Modbus RS485");
+    for(unsigned i = 0; i < name_count; i++)
+    {
+        if(names[i].kind == TRACE_NAME_TASK)
+            Emit_Meta("thread_name", PID_TASKS, names[i].id, names[i].name);
+        else if(names[i].kind == TRACE_NAME_IRQ)
+            Emit_Meta("thread_name", PID_IRQ, names[i].id, names[i].name);
+    }
+
+    uint64_t time = 0;
+    uint32_t last_cycles = 0;
+    int running = -1;       // Поток, выполняющийся с последнего переключения
+    int at_open = 0;
+    int modbus_open = 0;
+    uint8_t irq_open[256] = { 0 };
+    uint8_t http_open[256] = { 0 };
+    char fallback[32];
+    char args[96];
+    double us = 0;
+
+    for(uint32_t seq = first; seq < head; seq++)
+    {
+        const uint8_t *event = events + (size_t)(seq % capacity) * TRACE_EVENT_SIZE;
+        uint32_t cycles = Get32(event);
+        uint8_t type = event[4];
+        uint8_t id = event[5];
+        uint16_t arg = Get16(event + 6);
+
+        // Время от первого события, разность по модулю 2^32
+        if(seq != first)
+        {
+            time += (uint32_t)(cycles - last_cycles);
+        }
+        last_cycles = cycles;
+        us = time / cycles_per_us;
+
+        switch(type)
+        {
+        case TRACE_TASK_SWITCH:
+            if(running >= 0)
+                Emit("E", PID_TASKS, running, us, NULL, NULL);
+            Emit("B", PID_TASKS, id, us, Find_Name(TRACE_NAME_TASK, id, fallback, sizeof(fallback)), NULL);
+            running = id;
+            break;
+
+        case TRACE_ISR_ENTER:
+            Emit("B", PID_IRQ, id, us, Find_Name(TRACE_NAME_IRQ, id, fallback, sizeof(fallback)), NULL);
+            irq_open[id] = 1;
+            break;
+
+        case TRACE_ISR_EXIT:
+            // Выход без входа - вход остался до начала кольца
+            if(irq_open[id])
+                Emit("E", PID_IRQ, id, us, NULL, NULL);
+            irq_open[id] = 0;
+            break;
+
+        case TRACE_AT_START:
+            if(at_open)
+                Emit("E", PID_IO, TID_AT, us, NULL, NULL);
+            Emit("B", PID_IO, TID_AT, us, Find_Name(TRACE_NAME_AT, id, fallback, sizeof(fallback)), NULL);
+            at_open = 1;
+            break;
+
+        case TRACE_AT_END:
+            if(at_open)
+            {
+                snprintf(args, sizeof(args), "{\"status\":\"%s\"}", arg < 4 ? at_status[arg] : "?");
+                Emit("E", PID_IO, TID_AT, us, NULL, args);
+            }
+            at_open = 0;
+            break;
+
+        case TRACE_MODBUS_START:
+            snprintf(args, sizeof(args), "{\"slave\":%u,\"register\":\"0x%04X\"}", id, arg);
+            Emit("B", PID_IO, TID_MODBUS, us, "modbus", args);
+            modbus_open = 1;
+            break;
+
+        case TRACE_MODBUS_END:
+            if(modbus_open)
+            {
+                snprintf(args, sizeof(args), "{\"ok\":%u}", arg);
+                Emit("E", PID_IO, TID_MODBUS, us, NULL, args);
+            }
+            modbus_open = 0;
+            break;
+
+        case TRACE_HTTP_CONNECT:
+            Emit("i", PID_HTTP, id, us, "connect", NULL);
+            break;
+
+        case TRACE_HTTP_REQUEST:
+            // Запрос от передачи обработчику до отправки ответа
+            snprintf(args, sizeof(args), "{\"request_bytes\":%u}", arg);
+            Emit("B", PID_HTTP, id, us, "request", args);
+            http_open[id] = 1;
+            break;
+
+        case TRACE_HTTP_RESPOND:
+            snprintf(args, sizeof(args), "{\"response_bytes\":%u}", arg);
+            Emit("i", PID_HTTP, id, us, "respond", args);
+            break;
+
+        case TRACE_HTTP_SENT:
+            if(http_open[id])
+            {
+                snprintf(args, sizeof(args), "{\"error\":%u}", arg);
+                Emit("E", PID_HTTP, id, us, NULL, args);
+            }
+            http_open[id] = 0;
+            break;
+
+        case TRACE_HTTP_CLOSE:
+            if(http_open[id])
+                Emit("E", PID_HTTP, id, us, NULL, NULL);
+            http_open[id] = 0;
+            Emit("i", PID_HTTP, id, us, "close", NULL);
+            break;
+
+        default:
+            fprintf(stderr, "unknown event type %u at %u\n", type, seq);
+            break;
+        }
+    }
+
+    // Незавершенные на момент дампа интервалы закрываются последним событием
+    if(running >= 0)
+        Emit("E", PID_TASKS, running, us, NULL, NULL);
+    if(at_open)
+        Emit("E", PID_IO, TID_AT, us, NULL, NULL);
+    if(modbus_open)
+        Emit("E", PID_IO, TID_MODBUS, us, NULL, NULL);
+    for(int i = 0; i < 256; i++)
+    {
+        if(irq_open[i])
+            Emit("E", PID_IRQ, i, us, NULL, NULL);
+        if(http_open[i])
+            Emit("E", PID_HTTP, i, us, NULL, NULL);
+    }
+
+    printf("\n]}\n");
+    fprintf(stderr, "%u events (%u written, %u lost to ring wrap), %.3f ms\n",
+            count, head, head - count, us / 1000.0);
+    free(events);
+    return 0;
+}
@@ -0,0 +1,291 @@
+/*
+ * udp_beacon_rx.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: chepu
+ */
+
+// udp_beacon_rx.c
+// Сборщик UDP маяков устройств (Linux). Разбирает пакеты формата
+// udp_beacon.h и ведет по каждому устройству счетчики потерь,
+// повторов и джиттер интервала между пакетами (RFC 3550).
+//
+// Сборка:  gcc -O2 -Wall -o udp_beacon_rx udp_beacon_rx.c -lm
+// Запуск:  ./udp_beacon_rx [-p порт] [-g multicast-группа] [-i период отчета, с] [-v]
+#include <arpa/inet.h>
+#include <errno.h>
+#include <math.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BEACON_MAGIC 0x4D43U
+#define BEACON_VERSION 1
+#define BEACON_PACKET_SIZE 24
+#define DEVICE_COUNT 1024
+
+typedef struct {
+    uint32_t device_id;
+    uint8_t version;
+    uint8_t flags;
+    uint32_t sequence;
+    uint32_t timestamp;
+    int16_t temperature;
+    uint16_t humidity;
+    uint32_t uptime;
+} BeaconPacket;
+
+typedef struct {
+    uint32_t device_id;
+    char address[INET_ADDRSTRLEN];
+    uint64_t received;
+    uint64_t lost;        // Пропуски в номерах пакетов
+    uint64_t duplicates;  // Повторные и запоздавшие пакеты
+    uint64_t restarts;    // Сброс номера (перезагрузка устройства)
+    uint32_t last_sequence;
+    uint32_t last_uptime;
+    double last_arrival_ms;
+    double jitter_ms;
+    BeaconPacket last;
+} DeviceStats;
+
+static DeviceStats devices[DEVICE_COUNT];
+static unsigned device_count;
+static volatile sig_atomic_t stop;
+
+static uint16_t Get16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t Get32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static double Now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
+static int Decode(const uint8_t *data, ssize_t length, BeaconPacket *packet)
+{
+    if(length < BEACON_PACKET_SIZE || Get16(data) != BEACON_MAGIC || data[2] != BEACON_VERSION)
+        return 0;
+
+    packet->version = data[2];
+    packet->flags = data[3];
+    packet->device_id = Get32(data + 4);
+    packet->sequence = Get32(data + 8);
+    packet->timestamp = Get32(data + 12);
+    packet->temperature = (int16_t)Get16(data + 16);
+    packet->humidity = Get16(data + 18);
+    packet->uptime = Get32(data + 20);
+    return 1;
+}
+
+static DeviceStats* Find_Device(uint32_t device_id)
+{
+    for(unsigned i = 0; i < device_count; i++)
+    {
+        if(devices[i].device_id == device_id)
+            return &devices[i];
+    }
+    if(device_count == DEVICE_COUNT)
+        return NULL;
+
+    DeviceStats *device = &devices[device_count++];
+    memset(device, 0, sizeof(*device));
+    device->device_id = device_id;
+    return device;
+}
+
+static void Update(DeviceStats *device, const BeaconPacket *packet, double arrival_ms)
+{
+    if(device->received > 0)
+    {
+        int32_t gap = (int32_t)(packet->sequence - device->last_sequence);
+
+        if(gap <= 0 && packet->uptime < device->last_uptime)
+        {
+            // Устройство перезагрузилось, номера начались заново
+            device->restarts++;
+        }
+        else if(gap <= 0)
+        {
+            device->duplicates++;
+            return;
+        }
+        else
+        {
+            device->lost += gap - 1;
+
+            // Отклонение интервала прихода от интервала отправки
+            double d = (arrival_ms - device->last_arrival_ms) -
+                       (double)(uint32_t)(packet->uptime - device->last_uptime);
+            device->jitter_ms += (fabs(d) - device->jitter_ms) / 16.0;
+        }
+    }
+
+    device->received++;
+    device->last_sequence = packet->sequence;
+    device->last_uptime = packet->uptime;
+    device->last_arrival_ms = arrival_ms;
+    device->last = *packet;
+}
+
+static void Print_Report(void)
+{
+    printf("%-10s %-15s %9s %7s %7s %6s %9s %7s %6s %5s\n",
+           "device", "address", "received", "lost", "loss%", "dup", "jitter_ms",
+           "temp", "hum", "flags");
+    for(unsigned i = 0; i < device_count; i++)
+    {
+        const DeviceStats *device = &devices[i];
+        uint64_t expected = device->received + device->lost;
+
+        printf("%08X   %-15s %9llu %7llu %7.2f %6llu %9.2f %7.1f %6.1f  0x%02X\n",
+               device->device_id, device->address,
+               (unsigned long long)device->received, (unsigned long long)device->lost,
+               expected ? 100.0 * device->lost / expected : 0.0,
+               (unsigned long long)device->duplicates, device->jitter_ms,
+               device->last.temperature / 10.0, device->last.humidity / 10.0,
+               device->last.flags);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+static void On_Signal(int signal)
+{
+    (void)signal;
+    stop = 1;
+}
+
+int main(int argc, char **argv)
+{
+    uint16_t port = 40000;
+    const char *group = NULL;
+    int interval = 10;
+    int verbose = 0;
+    int opt;
+
+    while((opt = getopt(argc, argv, "p:g:i:v")) != -1)
+    {
+        switch(opt)
+        {
+        case 'p': port = (uint16_t)atoi(optarg); break;
+        case 'g': group = optarg; break;
+        case 'i': interval = atoi(optarg); break;
+        case 'v': verbose = 1; break;
+        default:
+            fprintf(stderr, "usage: %s [-p port] [-g multicast-group] [-i report-seconds] [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if(fd < 0)
+    {
+        perror("socket");
+        return 1;
+    }
+
+    int yes = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    struct sockaddr_in local = {0};
+    local.sin_family = AF_INET;
+    local.sin_port = htons(port);
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    if(bind(fd, (struct sockaddr*)&local, sizeof(local)) < 0)
+    {
+        perror("bind");
+        return 1;
+    }
+
+    if(group)
+    {
+        struct ip_mreq mreq;
+        mreq.imr_multiaddr.s_addr = inet_addr(group);
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        if(setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0)
+        {
+            perror("IP_ADD_MEMBERSHIP");
+            return 1;
+        }
+    }
+
+    // Прием прерывается раз в секунду для периодического отчета
+    struct timeval timeout = { 1, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    struct sigaction action = {0};
+    action.sa_handler = On_Signal;
+    sigaction(SIGINT, &action, NULL);
+    sigaction(SIGTERM, &action, NULL);
+
+    fprintf(stderr, "listening on UDP port %u%s%s\n", port, group ? ", group " : "", group ? group : "");
+
+    double next_report = Now_ms() + interval * 1000.0;
+    uint64_t invalid = 0;
+
+    while(!stop)
+    {
+        uint8_t buffer[512];
+        struct sockaddr_in from;
+        socklen_t from_length = sizeof(from);
+        ssize_t length = recvfrom(fd, buffer, sizeof(buffer), 0, (struct sockaddr*)&from, &from_length);
+        double now = Now_ms();
+
+        if(length >= 0)
+        {
+            BeaconPacket packet;
+            DeviceStats *device;
+
+            if(!Decode(buffer, length, &packet) || (device = Find_Device(packet.device_id)) == NULL)
+            {
+                invalid++;
+                continue;
+            }
+
+            inet_ntop(AF_INET, &from.sin_addr, device->address, sizeof(device->address));
+            Update(device, &packet, now);
+
+            if(verbose)
+            {
+                printf("%08X seq=%u ts=%u t=%.1f h=%.1f flags=0x%02X\n",
+                       packet.device_id, packet.sequence, packet.timestamp,
+                       packet.temperature / 10.0, packet.humidity / 10.0, packet.flags);
+            }
+        }
+        else if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+        {
+            perror("recvfrom");
+            break;
+        }
+
+        if(interval > 0 && now >= next_report)
+        {
+            Print_Report();
+            next_report = now + interval * 1000.0;
+        }
+    }
+
+    Print_Report();
+    if(invalid)
+    {
+        fprintf(stderr, "invalid packets: %llu\n", (unsigned long long)invalid);
+    }
+    close(fd);
+    return 0;
+}